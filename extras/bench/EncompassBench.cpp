@@ -0,0 +1,304 @@
+/*
+  EncompassBench.cpp
+  Host (Linux) build
+
+  Microbenchmarks for the portal's hot paths. Each result is one JSON object per line on stdout:
+    {"bench":"networkListAsString","version":"v1.0.1","label":"","networks":20,"fields":0,"iterations":81920,
+     "ns_per_op":2310.4,"allocs_per_op":41.00,"bytes_per_op":1893.2}
+
+    pio run -e bench && .pio/build/bench/program > bench.jsonl
+
+  ENCOMPASS_BENCH_FILTER  only benchmarks whose name contains this
+  ENCOMPASS_BENCH_MS      time spent on each benchmark (default 200)
+  ENCOMPASS_BENCH_LABEL   copied into every line, e.g. the firmware revision being measured
+
+  Handlers are driven through hostExchange() - the catch-all handler, route table and the host HTTP parser are part of
+  every request benchmark; "exchange_probe" (a bare redirect) is that overhead on its own. Allocations come from the
+  host heap accounting (hostHeapStats()), so they follow the host String (std::string) rather than the core's String:
+  compare revisions with each other, not with the chip. Build without sanitizers, they leave the counts at 0.
+
+  Timing only - the known-answer tests for the crypto and the clock are in test/ (pio test -e test).
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#include "Encompass.h"
+
+#include <time.h>
+
+#define BENCH_MAX_FIELDS      16
+
+AsyncWebServer  webServer(80);
+DNSServer       dnsServer;
+
+static uint64_t benchNowNs()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+class EncompassBench
+{
+  public:
+
+    EncompassBench(Encompass &wm) : _wm(wm), _networks(0), _fields(0)
+    {
+      const char *env = getenv("ENCOMPASS_BENCH_MS");
+
+      _filter = getenv("ENCOMPASS_BENCH_FILTER");
+      _label  = getenv("ENCOMPASS_BENCH_LABEL");
+      _minNs  = (uint64_t) (env ? atoi(env) : 200) * 1000000ULL;
+
+      for (int i = 0; i < BENCH_MAX_FIELDS; i++)
+      {
+        snprintf(_fieldIDs[i], sizeof(_fieldIDs[i]), "field%d", i);
+        _pool[i] = new DataField(_fieldIDs[i], _fieldIDs[i], "value", 32);
+      }
+    }
+
+    void run();
+
+  private:
+
+    void    setNetworks(int count);
+    void    setDataFields(int count);
+    String  request(const char *method, const char *url, const char *accept = NULL, const String &body = String());
+
+    template <typename Op>
+    void    measure(const char *name, Op op);
+
+    Encompass   &_wm;
+    int         _networks;
+    int         _fields;
+    const char  *_filter;
+    const char  *_label;
+    uint64_t    _minNs;
+    char        _fieldIDs[BENCH_MAX_FIELDS][12];
+    DataField   *_pool[BENCH_MAX_FIELDS];
+};
+
+// The radio hears count APs - every fifth one repeats the previous SSID (a second BSSID), every fourth one is open
+void EncompassBench::setNetworks(int count)
+{
+  char ssid[33];
+
+  WiFi.hostClearNetworks();
+
+  for (int i = 0; i < count; i++)
+  {
+    snprintf(ssid, sizeof(ssid), "Network-%02d", (i % 5 == 4) ? i - 1 : i);
+
+    WiFi.hostAddNetwork(ssid, (i % 4 == 3) ? "" : "password", -40 - (i * 55) / (count ? count : 1), 1 + i % 11);
+  }
+
+  int n = WiFi.scanNetworks();
+
+  _wm.storeScanResults(n > 0 ? n : 0);
+  _networks = count;
+}
+
+void EncompassBench::setDataFields(int count)
+{
+  _wm._DataFieldsCount = 0;
+
+  for (int i = 0; i < count; i++)
+    _wm.addDataField(_pool[i]);
+
+  _fields = count;
+}
+
+String EncompassBench::request(const char *method, const char *url, const char *accept, const String &body)
+{
+  String raw = method;
+
+  raw += ' ';
+  raw += url;
+  raw += F(" HTTP/1.1\r\nHost: 192.168.4.1\r\n");
+
+  if (accept)
+  {
+    raw += F("Accept: ");
+    raw += accept;
+    raw += F("\r\n");
+  }
+
+  if (body.length())
+  {
+    raw += F("Content-Type: application/x-www-form-urlencoded\r\nContent-Length: ");
+    raw += body.length();
+    raw += F("\r\n");
+  }
+
+  raw += F("\r\n");
+  raw += body;
+
+  return raw;
+}
+
+template <typename Op>
+void EncompassBench::measure(const char *name, Op op)
+{
+  if (_filter && !strstr(name, _filter))
+    return;
+
+  // Warm up - first-use allocations (scan buffers, statics) are not the steady state
+  op();
+
+  HostHeapStats before;
+  HostHeapStats after;
+
+  uint64_t iterations = 0;
+  uint64_t batch      = 1;
+  uint64_t elapsed    = 0;
+
+  hostHeapStats(before);
+
+  while (elapsed < _minNs)
+  {
+    uint64_t start = benchNowNs();
+
+    for (uint64_t i = 0; i < batch; i++)
+      op();
+
+    elapsed    += benchNowNs() - start;
+    iterations += batch;
+
+    if (batch < (1 << 20))
+      batch *= 2;
+  }
+
+  hostHeapStats(after);
+
+  uint64_t allocs = after.allocs - before.allocs;
+  uint64_t bytes  = after.bytes - before.bytes;
+
+  printf("{\"bench\":\"%s\",\"version\":\"%s\",\"label\":\"%s\",\"networks\":%d,\"fields\":%d,\"iterations\":%llu,"
+         "\"ns_per_op\":%.1f,\"allocs_per_op\":%.2f,\"bytes_per_op\":%.1f}\n",
+         name, ENCOMPASS_VERSION, _label ? _label : "", _networks, _fields, (unsigned long long) iterations,
+         (double) elapsed / iterations, (double) allocs / iterations, (double) bytes / iterations);
+
+  fflush(stdout);
+}
+
+void EncompassBench::run()
+{
+  static const int networkCounts[] = { 1, 10, 30, 60 };
+  static const int fieldCounts[]   = { 0, 4, BENCH_MAX_FIELDS };
+
+  volatile int  sink = 0;
+  String        ip   = "192.168.4.1";
+  String        host = "connectivitycheck.gstatic.com";
+
+  setNetworks(10);
+  setDataFields(0);
+
+  measure("getRSSIasQuality", [&]()
+  {
+    static int rssi = -30;
+
+    sink  = sink + _wm.getRSSIasQuality(rssi);
+    rssi  = (rssi <= -100) ? -30 : rssi - 1;
+  });
+
+  measure("derivePSK", [&]()
+  {
+    uint8_t key[WPA_PSK_SIZE];
+
+    EncompassPBKDF2::derive("password", 8, "Network-01", 10, WPA_PSK_ITERATIONS, key, sizeof(key));
+    sink = sink + key[0];
+  });
+
+#if ENCOMPASS_TIME
+  measure("getTimeUs", [&]() { sink = sink + (uint32_t) _wm.getTimeUs(); });
+#endif
+
+  measure("isIp_ip",   [&]() { sink = sink + _wm.isIp(ip); });
+  measure("isIp_host", [&]() { sink = sink + _wm.isIp(host); });
+  measure("toStringIp", [&]() { sink = sink + _wm.toStringIp(WiFi.softAPIP()).length(); });
+
+  String probe = request("GET", "/generate_204");
+
+  measure("exchange_probe", [&]() { sink = sink + hostExchange(webServer, probe).length(); });
+
+  for (size_t n = 0; n < sizeof(networkCounts) / sizeof(networkCounts[0]); n++)
+  {
+    setNetworks(networkCounts[n]);
+
+    int results = WiFi.scanComplete();
+
+    measure("storeScanResults",    [&]() { _wm.storeScanResults(results); });
+    measure("networkListAsString", [&]() { sink = sink + _wm.networkListAsString().length(); });
+
+    String wifi   = request("GET", "/wifi-setup");
+    String info   = request("GET", "/info");
+    String state  = request("GET", "/state");
+    String cbor   = request("GET", "/state", "application/cbor");
+
+    for (size_t f = 0; f < sizeof(fieldCounts) / sizeof(fieldCounts[0]); f++)
+    {
+      setDataFields(fieldCounts[f]);
+      measure("handleWifi", [&]() { sink = sink + hostExchange(webServer, wifi).length(); });
+    }
+
+    setDataFields(0);
+
+    measure("handleInfo",       [&]() { sink = sink + hostExchange(webServer, info).length(); });
+    measure("handleState_json", [&]() { sink = sink + hostExchange(webServer, state).length(); });
+    measure("handleState_cbor", [&]() { sink = sink + hostExchange(webServer, cbor).length(); });
+  }
+
+  setNetworks(10);
+
+  for (size_t f = 0; f < sizeof(fieldCounts) / sizeof(fieldCounts[0]); f++)
+  {
+    String form = F("s=Network-01&p=password");
+
+    for (int i = 0; i < fieldCounts[f]; i++)
+    {
+      form += '&';
+      form += _fieldIDs[i];
+      form += F("=some+value+");
+      form += i;
+    }
+
+    setDataFields(fieldCounts[f]);
+
+    String save = request("POST", "/save", NULL, form);
+
+    // Along with the loop() side applying the job it posts, or the queue fills and the rest measure a 503
+    measure("handleSave", [&]()
+    {
+      sink = sink + hostExchange(webServer, save).length();
+      _wm.processJobs();
+    });
+  }
+}
+
+void setup()
+{
+  // Instant scans and connects, the benchmarks measure the library, not the simulated radio
+  WiFi.hostSetTiming(0, 0);
+
+  Encompass *wm = new Encompass(&webServer, &dnsServer, "encompass-bench");
+
+  // Full pages however much the bench itself has allocated, degraded ones are not what is being measured
+  for (uint8_t level = PRESSURE_LOW; level < PRESSURE_LEVELS; level++)
+    wm->setMemoryThresholds(level, 0, 0);
+
+  wm->startConfigPortalModeless("Encompass_Bench", NULL);
+
+  EncompassBench bench(*wm);
+
+  bench.run();
+
+  exit(0);
+}
+
+void loop()
+{
+}
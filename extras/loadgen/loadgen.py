@@ -0,0 +1,418 @@
+#!/usr/bin/env python3
+"""
+  loadgen.py
+  Host (Linux) build
+
+  Concurrent-client load generator for the captive portal. Replays a room of phones joining the soft AP at once
+  against a host build (linux/): every client opens with a join burst - DNS lookups, the OS connectivity probes and
+  the portal root - then loops over a weighted request mix with a think time between requests.
+
+    pio run -e native
+    extras/loadgen/loadgen.py --spawn .pio/build/native/program --clients 20 --duration 30
+
+  --spawn starts the program, stops it with SIGINT at the end and reads the "host heap: peak" line it prints on exit;
+  without it the tool loads an already running portal. Free heap is also sampled from /metrics while the load runs.
+
+  The report lists throughput, per-route count, p50/p99 latency, errors (non-2xx/3xx, malformed replies) and drops
+  (refused, reset or timed-out connections, unanswered DNS queries). --json prints the same as one JSON object, with
+  --label copied in, so results can be collected per firmware revision.
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+"""
+
+import argparse
+import asyncio
+import json
+import random
+import re
+import signal
+import socket
+import struct
+import subprocess
+import sys
+import time
+
+PORTAL_HOST = "192.168.4.1"
+
+# What a phone sends on joining: lookups for its connectivity check hosts, the probes themselves, then the portal
+JOIN_DNS    = ["connectivitycheck.gstatic.com", "captive.apple.com", "www.msftconnecttest.com", "clients3.google.com"]
+JOIN_PROBES = ["/generate_204", "/hotspot-detect.html", "/connecttest.txt", "/"]
+
+DEFAULT_MIX = "/wifi-setup=4,/=2,/generate_204=3,/hotspot-detect.html=2,/state=1,/networks=1,/info=1,dns=4"
+
+
+def parse_mix(text):
+    mix = []
+
+    for item in text.split(","):
+        route, _, weight = item.strip().partition("=")
+
+        if not route:
+            continue
+
+        mix.append((route, float(weight) if weight else 1.0))
+
+    if not mix:
+        raise argparse.ArgumentTypeError("empty request mix")
+
+    return mix
+
+
+def parse_range(text):
+    low, _, high = text.partition("-")
+
+    return (int(low), int(high or low))
+
+
+def percentile(samples, p):
+    if not samples:
+        return 0.0
+
+    ordered = sorted(samples)
+    index   = min(len(ordered) - 1, max(0, int(round(p / 100.0 * len(ordered) + 0.5)) - 1))
+
+    return ordered[index]
+
+
+class Route:
+
+    def __init__(self):
+        self.latencies  = []
+        self.errors     = 0
+        self.drops      = 0
+        self.bytes      = 0
+
+
+class Stats:
+
+    def __init__(self):
+        self.routes     = {}
+        self.heapFree   = None
+
+    def route(self, name):
+        if name not in self.routes:
+            self.routes[name] = Route()
+
+        return self.routes[name]
+
+
+class DnsClient(asyncio.DatagramProtocol):
+
+    def __init__(self):
+        self.pending    = {}
+        self.transport  = None
+
+    def connection_made(self, transport):
+        self.transport = transport
+
+    def datagram_received(self, data, addr):
+        if len(data) < 2:
+            return
+
+        waiter = self.pending.pop(struct.unpack(">H", data[:2])[0], None)
+
+        if waiter and not waiter.done():
+            waiter.set_result(data)
+
+    def error_received(self, exc):
+        pass
+
+
+class LoadGen:
+
+    def __init__(self, args):
+        self.args       = args
+        self.stats      = Stats()
+        self.deadline   = 0.0
+        self.nextId     = random.randrange(0x10000)
+
+    def source(self, index):
+        # Every phone has its own address on the AP - the DNS responder rate-limits per source address
+        if not self.args.host.startswith("127.") or self.args.shared_source:
+            return None
+
+        return "127.0.%d.%d" % (1 + index // 250, 1 + index % 250)
+
+    async def http(self, source, method, path, body=None):
+        args    = self.args
+        route   = self.stats.route(path)
+        start   = time.monotonic()
+
+        head = "%s %s HTTP/1.1\r\nHost: %s\r\nUser-Agent: encompass-loadgen\r\nConnection: close\r\n" % (method, path, PORTAL_HOST)
+
+        if body is not None:
+            head += "Content-Type: application/x-www-form-urlencoded\r\nContent-Length: %d\r\n" % len(body)
+
+        try:
+            connect = asyncio.open_connection(args.host, args.http_port, local_addr=(source, 0) if source else None)
+
+            reader, writer = await asyncio.wait_for(connect, args.timeout)
+
+            try:
+                writer.write((head + "\r\n" + (body or "")).encode())
+                await writer.drain()
+
+                reply = await asyncio.wait_for(reader.read(), max(0.0, args.timeout - (time.monotonic() - start)))
+            finally:
+                writer.close()
+        except (OSError, asyncio.TimeoutError):
+            route.drops += 1
+            return
+
+        match = re.match(rb"HTTP/1\.[01] (\d{3})", reply)
+
+        if not match:
+            # The server accepted and closed without answering
+            if not reply:
+                route.drops += 1
+            else:
+                route.errors += 1
+            return
+
+        if int(match.group(1)) >= 400:
+            route.errors += 1
+            return
+
+        route.latencies.append((time.monotonic() - start) * 1000.0)
+        route.bytes += len(reply)
+
+    async def lookup(self, dns, name):
+        route   = self.stats.route("dns")
+        start   = time.monotonic()
+        qid     = self.nextId = (self.nextId + 1) & 0xFFFF
+
+        query  = struct.pack(">HHHHHH", qid, 0x0100, 1, 0, 0, 0)
+        query += b"".join(bytes([len(label)]) + label.encode() for label in name.split(".")) + b"\0"
+        query += struct.pack(">HH", 1, 1)
+
+        waiter = asyncio.get_event_loop().create_future()
+
+        dns.pending[qid] = waiter
+        dns.transport.sendto(query)
+
+        try:
+            reply = await asyncio.wait_for(waiter, self.args.timeout)
+        except asyncio.TimeoutError:
+            dns.pending.pop(qid, None)
+            route.drops += 1
+            return
+
+        # Every name should resolve to the portal - anything else means the captive DNS is not answering for it
+        if len(reply) < 16 or (reply[3] & 0x0F) != 0 or reply[-4:] != socket.inet_aton(PORTAL_HOST):
+            route.errors += 1
+            return
+
+        route.latencies.append((time.monotonic() - start) * 1000.0)
+        route.bytes += len(reply)
+
+    async def think(self):
+        low, high = self.args.think
+
+        await asyncio.sleep(random.uniform(low, high) / 1000.0)
+
+    async def request(self, source, dns, target):
+        if target == "dns":
+            await self.lookup(dns, random.choice(JOIN_DNS))
+        elif target == "/save":
+            await self.http(source, "POST", "/save", "s=%s&p=%s" % (self.args.ssid, self.args.password))
+        else:
+            await self.http(source, "GET", target)
+
+    async def client(self, index):
+        args    = self.args
+        source  = self.source(index)
+
+        _, dns = await asyncio.get_event_loop().create_datagram_endpoint(DnsClient, remote_addr=(args.host, args.dns_port),
+                                                                         local_addr=(source, 0) if source else None)
+
+        try:
+            await self.session(index, source, dns)
+        finally:
+            dns.transport.close()
+
+    async def session(self, index, source, dns):
+        args = self.args
+
+        await asyncio.sleep(args.ramp * index / max(1, args.clients))
+
+        # The join burst - phones fire the lookups and the probes together, not one by one
+        await asyncio.gather(*[self.lookup(dns, name) for name in JOIN_DNS])
+        await asyncio.gather(*[self.http(source, "GET", probe) for probe in JOIN_PROBES])
+
+        routes  = [route for route, _ in args.mix]
+        weights = [weight for _, weight in args.mix]
+
+        while time.monotonic() < self.deadline:
+            await self.think()
+
+            if time.monotonic() >= self.deadline:
+                break
+
+            await self.request(source, dns, random.choices(routes, weights)[0])
+
+    async def scrape(self):
+        while time.monotonic() < self.deadline:
+            try:
+                reader, writer = await asyncio.wait_for(asyncio.open_connection(self.args.host, self.args.http_port), 1.0)
+
+                try:
+                    writer.write(("GET /metrics HTTP/1.1\r\nHost: %s\r\nConnection: close\r\n\r\n" % PORTAL_HOST).encode())
+                    reply = await asyncio.wait_for(reader.read(), 2.0)
+                finally:
+                    writer.close()
+
+                match = re.search(rb"^encompass_heap_free_bytes (\d+)", reply, re.M)
+
+                if match:
+                    free = int(match.group(1))
+
+                    if self.stats.heapFree is None or free < self.stats.heapFree:
+                        self.stats.heapFree = free
+            except (OSError, asyncio.TimeoutError):
+                pass
+
+            await asyncio.sleep(self.args.scrape_ms / 1000.0)
+
+    async def run(self):
+        start           = time.monotonic()
+        self.deadline   = start + self.args.ramp + self.args.duration
+
+        tasks = [self.client(i) for i in range(self.args.clients)]
+
+        if self.args.scrape_ms > 0:
+            tasks.append(self.scrape())
+
+        await asyncio.gather(*tasks)
+
+        return time.monotonic() - start
+
+
+def wait_for_port(host, port, timeout):
+    end = time.monotonic() + timeout
+
+    while time.monotonic() < end:
+        try:
+            socket.create_connection((host, port), 0.2).close()
+            return True
+        except OSError:
+            time.sleep(0.05)
+
+    return False
+
+
+def report(args, stats, elapsed, heapPeak, heapBudget):
+    total   = sum(len(r.latencies) for r in stats.routes.values())
+    result  = {
+        "label":        args.label,
+        "clients":      args.clients,
+        "seconds":      round(elapsed, 2),
+        "requests":     total,
+        "throughput":   round(total / elapsed, 1) if elapsed else 0.0,
+        "errors":       sum(r.errors for r in stats.routes.values()),
+        "drops":        sum(r.drops for r in stats.routes.values()),
+        "heap_min_free": stats.heapFree,
+        "heap_peak":    heapPeak,
+        "heap_budget":  heapBudget,
+        "routes":       {},
+    }
+
+    for name in sorted(stats.routes):
+        route = stats.routes[name]
+
+        result["routes"][name] = {
+            "count":    len(route.latencies),
+            "p50_ms":   round(percentile(route.latencies, 50), 2),
+            "p99_ms":   round(percentile(route.latencies, 99), 2),
+            "errors":   route.errors,
+            "drops":    route.drops,
+            "bytes":    route.bytes,
+        }
+
+    if args.json:
+        print(json.dumps(result))
+        return
+
+    print("%d clients, %.1f s, %d requests, %.1f req/s, %d errors, %d drops"
+          % (args.clients, elapsed, total, result["throughput"], result["errors"], result["drops"]))
+    print("%-22s %8s %10s %10s %8s %8s" % ("route", "count", "p50 ms", "p99 ms", "errors", "drops"))
+
+    for name, route in result["routes"].items():
+        print("%-22s %8d %10.2f %10.2f %8d %8d"
+              % (name, route["count"], route["p50_ms"], route["p99_ms"], route["errors"], route["drops"]))
+
+    if stats.heapFree is not None:
+        print("heap: %d bytes free at the lowest /metrics sample" % stats.heapFree)
+
+    if heapPeak is not None:
+        print("heap: peak %d of %d bytes" % (heapPeak, heapBudget))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Concurrent-client load generator for the Encompass host portal")
+
+    parser.add_argument("--clients",    type=int,   default=20,     help="simulated phones (default 20)")
+    parser.add_argument("--duration",   type=float, default=20.0,   help="seconds of load after the ramp (default 20)")
+    parser.add_argument("--ramp",       type=float, default=0.0,    help="seconds over which clients join (default 0, all at once)")
+    parser.add_argument("--think",      type=parse_range, default=(200, 1500), help="think time range in ms, e.g. 200-1500")
+    parser.add_argument("--mix",        type=parse_mix, default=parse_mix(DEFAULT_MIX), help="weighted request mix, route=weight,... - 'dns' is a lookup (default %s)" % DEFAULT_MIX)
+    parser.add_argument("--host",       default="127.0.0.1")
+    parser.add_argument("--http-port",  type=int,   default=8080)
+    parser.add_argument("--dns-port",   type=int,   default=8053)
+    parser.add_argument("--shared-source", action="store_true",     help="send every client from one address instead of one 127.0.x.y each")
+    parser.add_argument("--timeout",    type=float, default=5.0,    help="seconds before a request counts as dropped")
+    parser.add_argument("--scrape-ms",  type=int,   default=500,    help="/metrics sampling period, 0 disables (default 500)")
+    parser.add_argument("--ssid",       default="Network-01",       help="SSID posted by /save in the mix")
+    parser.add_argument("--password",   default="password")
+    parser.add_argument("--seed",       type=int,                   help="random seed, for repeatable mixes")
+    parser.add_argument("--spawn",                                  help="host program to start and stop around the run")
+    parser.add_argument("--settle",     type=float, default=3.0,    help="seconds between --spawn and the first client (default 3)")
+    parser.add_argument("--label",      default="",                 help="copied into the JSON report, e.g. the firmware revision")
+    parser.add_argument("--json",       action="store_true",        help="print the report as one JSON object")
+
+    args = parser.parse_args()
+
+    if args.seed is not None:
+        random.seed(args.seed)
+
+    host = None
+
+    if args.spawn:
+        host = subprocess.Popen([args.spawn], stdout=subprocess.DEVNULL, stderr=subprocess.PIPE)
+
+        if not wait_for_port(args.host, args.http_port, 5.0):
+            host.kill()
+            sys.exit("loadgen: %s is not listening on %s:%d" % (args.spawn, args.host, args.http_port))
+
+        # Phones join a device that has booted - let the portal's startup scan finish first
+        time.sleep(args.settle)
+
+    stats = None
+
+    try:
+        gen     = LoadGen(args)
+        elapsed = asyncio.get_event_loop().run_until_complete(gen.run())
+        stats   = gen.stats
+    finally:
+        heapPeak = heapBudget = None
+
+        if host:
+            host.send_signal(signal.SIGINT)
+
+            try:
+                _, err = host.communicate(timeout=5.0)
+            except subprocess.TimeoutExpired:
+                host.kill()
+                _, err = host.communicate()
+
+            match = re.search(rb"host heap: peak (\d+) of (\d+) bytes", err or b"")
+
+            if match:
+                heapPeak, heapBudget = int(match.group(1)), int(match.group(2))
+
+    report(args, stats, elapsed, heapPeak, heapBudget)
+
+
+if __name__ == "__main__":
+    main()
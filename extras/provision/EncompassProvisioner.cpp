@@ -0,0 +1,359 @@
+/*
+  EncompassProvisioner.cpp
+  Host (Linux) build
+
+  Sends one provisioning request (see src/EncompassProvision.h) to a device or, broadcast, to every device listening
+  on the network, repeats it until the devices have answered, and prints one JSON object per device that did:
+    {"mac":"5c:cf:7f:01:02:03","chip_id":"10203","ap":"Encompass_0102","status":"ok","job":3,"ms":41}
+
+    pio run -e provisioner
+    ENCOMPASS_PROVISION_KEY=secret .pio/build/provisioner/program --ssid Rack --pass rackpass --field mqtt=10.0.0.5 \
+      --expect 24 > acks.jsonl
+
+  Options:
+    --ssid S, --pass P            Credentials
+    --ip A --gw A --sn A          Static station IP
+    --dns1 A --dns2 A
+    --field ID=VALUE              A DataField, repeat for more
+    --to ADDR                     Destination, default the broadcast 255.255.255.255
+    --port N                      Default 4210 (ENCOMPASS_PROVISION_PORT)
+    --target MAC                  Only the device with this station MAC applies it
+    --expect N                    Stop once N devices have answered
+    --timeout MS                  Give up after this long, default 5000
+    --retry MS                    Time between repeats, default 250
+
+  The key comes from ENCOMPASS_PROVISION_KEY so it stays out of the process list. Every repeat carries the same
+  nonce and counter: a device that already applied the request only answers again. The counter is this host's clock
+  in us, so a device answers "stale" to a sender whose clock is behind the one it last took a request from. The exit code is 0 when every device that
+  answered took the request (and --expect of them did), 1 otherwise.
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#include "EncompassProvision.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <string>
+#include <vector>
+
+#define PROVISIONER_MAX_DEVICES   1024
+
+struct ProvisionerDevice
+{
+  uint8_t     mac[6];
+};
+
+// Request counter, see EncompassProvision.h
+static uint64_t provisionerClockUs()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_REALTIME, &ts);
+
+  return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static uint64_t provisionerNowMs()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static bool provisionerParseMAC(const char *text, uint8_t mac[6])
+{
+  unsigned int b[6];
+
+  if (sscanf(text, "%x:%x:%x:%x:%x:%x", &b[0], &b[1], &b[2], &b[3], &b[4], &b[5]) != 6)
+    return false;
+
+  for (int i = 0; i < 6; i++)
+    mac[i] = (uint8_t) b[i];
+
+  return true;
+}
+
+static const char* provisionerStatusName(uint8_t status)
+{
+  switch (status)
+  {
+    case PROVISION_OK:          return "ok";
+    case PROVISION_MALFORMED:   return "malformed";
+    case PROVISION_BUSY:        return "busy";
+    case PROVISION_UNSUPPORTED: return "unsupported";
+    case PROVISION_STALE:       return "stale";
+    default:                    return "unknown";
+  }
+}
+
+static void provisionerUsage()
+{
+  fprintf(stderr, "usage: ENCOMPASS_PROVISION_KEY=key provisioner --ssid S [--pass P] [--ip A --gw A --sn A]\n"
+                  "         [--dns1 A] [--dns2 A] [--field ID=VALUE]... [--to ADDR] [--port N] [--target MAC]\n"
+                  "         [--expect N] [--timeout MS] [--retry MS]\n");
+}
+
+int main(int argc, char **argv)
+{
+  const char      *key      = getenv("ENCOMPASS_PROVISION_KEY");
+  const char      *ssid     = NULL;
+  const char      *to       = "255.255.255.255";
+  int             port      = 4210;
+  int             expect    = 0;
+  int             timeoutMs = 5000;
+  int             retryMs   = 250;
+  uint8_t         target[6] = { 0 };
+  uint8_t         nonce[PROVISION_NONCE_SIZE];
+  uint8_t         request[PROVISION_MAX_PACKET];
+  ProvisionWriter writer(request, sizeof(request));
+
+  static const char * const ipOptions[] = { "--ip", "--gw", "--sn", "--dns1", "--dns2" };
+
+  // Nonce first, the header goes in ahead of the TLVs the options add
+  int random = open("/dev/urandom", O_RDONLY);
+
+  if (random < 0 || read(random, nonce, sizeof(nonce)) != (ssize_t) sizeof(nonce))
+  {
+    fprintf(stderr, "provisioner: no /dev/urandom\n");
+    return 1;
+  }
+
+  close(random);
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--target") == 0 && i + 1 < argc && !provisionerParseMAC(argv[i + 1], target))
+    {
+      fprintf(stderr, "provisioner: bad MAC %s\n", argv[i + 1]);
+      return 1;
+    }
+  }
+
+  writer.header(PROVISION_REQUEST, nonce, target, provisionerClockUs());
+
+  for (int i = 1; i < argc; i++)
+  {
+    const char  *opt  = argv[i];
+    const char  *arg  = (i + 1 < argc) ? argv[i + 1] : NULL;
+    bool        known = false;
+
+    if (arg == NULL)
+    {
+      provisionerUsage();
+      return 1;
+    }
+
+    i++;
+
+    for (uint8_t t = 0; t < sizeof(ipOptions) / sizeof(ipOptions[0]); t++)
+    {
+      if (strcmp(opt, ipOptions[t]) == 0)
+      {
+        struct in_addr addr;
+
+        if (inet_pton(AF_INET, arg, &addr) != 1)
+        {
+          fprintf(stderr, "provisioner: bad address %s\n", arg);
+          return 1;
+        }
+
+        // Network order, as the device keeps it
+        writer.add(PTAG_IP + t, &addr.s_addr, 4);
+        known = true;
+      }
+    }
+
+    if (known)
+      continue;
+
+    if (strcmp(opt, "--ssid") == 0)
+    {
+      ssid = arg;
+      writer.addString(PTAG_SSID, arg);
+    }
+    else if (strcmp(opt, "--pass") == 0)
+    {
+      writer.addString(PTAG_PASS, arg);
+    }
+    else if (strcmp(opt, "--field") == 0)
+    {
+      const char *eq = strchr(arg, '=');
+
+      if (eq == NULL)
+      {
+        provisionerUsage();
+        return 1;
+      }
+
+      // id, a 0, the value
+      std::string field(arg, eq - arg);
+
+      field += '\0';
+      field += eq + 1;
+
+      writer.add(PTAG_FIELD, field.data(), field.size());
+    }
+    else if (strcmp(opt, "--to") == 0)
+      to = arg;
+    else if (strcmp(opt, "--port") == 0)
+      port = atoi(arg);
+    else if (strcmp(opt, "--expect") == 0)
+      expect = atoi(arg);
+    else if (strcmp(opt, "--timeout") == 0)
+      timeoutMs = atoi(arg);
+    else if (strcmp(opt, "--retry") == 0)
+      retryMs = atoi(arg);
+    else if (strcmp(opt, "--target") != 0)
+    {
+      provisionerUsage();
+      return 1;
+    }
+  }
+
+  if (key == NULL || *key == 0 || ssid == NULL || retryMs <= 0)
+  {
+    provisionerUsage();
+    return 1;
+  }
+
+  ProvisionKeys keys;
+
+  keys.derive(key, strlen(key));
+
+  size_t requestLen = writer.seal(keys);
+
+  if (requestLen == 0)
+  {
+    fprintf(stderr, "provisioner: request does not fit in %d bytes\n", PROVISION_MAX_PACKET);
+    return 1;
+  }
+
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  int one = 1;
+
+  setsockopt(fd, SOL_SOCKET, SO_BROADCAST, &one, sizeof(one));
+
+  struct sockaddr_in dest;
+
+  memset(&dest, 0, sizeof(dest));
+  dest.sin_family = AF_INET;
+  dest.sin_port   = htons(port);
+
+  if (inet_pton(AF_INET, to, &dest.sin_addr) != 1)
+  {
+    fprintf(stderr, "provisioner: bad address %s\n", to);
+    return 1;
+  }
+
+  std::vector<ProvisionerDevice> devices;
+  uint64_t  start     = provisionerNowMs();
+  uint64_t  nextSend  = start;
+  int       failed    = 0;
+  int       sent      = 0;
+
+  while (provisionerNowMs() - start < (uint64_t) timeoutMs && (expect == 0 || (int) devices.size() < expect))
+  {
+    uint64_t now = provisionerNowMs();
+
+    if (now >= nextSend)
+    {
+      if (sendto(fd, request, requestLen, 0, (struct sockaddr *) &dest, sizeof(dest)) < 0)
+        fprintf(stderr, "provisioner: send failed (%s)\n", strerror(errno));
+
+      sent++;
+      nextSend = now + retryMs;
+    }
+
+    struct pollfd pfd = { fd, POLLIN, 0 };
+
+    if (poll(&pfd, 1, (int) (nextSend - now)) <= 0)
+      continue;
+
+    uint8_t reply[PROVISION_MAX_PACKET];
+    ssize_t len = recv(fd, reply, sizeof(reply), 0);
+
+    if (len <= 0)
+      continue;
+
+    ProvisionReader reader(reply, len);
+
+    // Someone else's, or an old run's
+    if (!reader.open(keys) || reader.type() != PROVISION_ACK ||
+        memcmp(reader.nonce(), nonce, PROVISION_NONCE_SIZE) != 0)
+      continue;
+
+    bool known = false;
+
+    for (size_t d = 0; d < devices.size() && !known; d++)
+      known = (memcmp(devices[d].mac, reader.target(), 6) == 0);
+
+    uint8_t       tag;
+    const uint8_t *value;
+    uint8_t       vlen;
+    uint8_t       status  = 0xFF;
+    uint16_t      job     = 0;
+    uint32_t      chipId  = 0;
+    std::string   ap;
+
+    while (reader.next(tag, value, vlen))
+    {
+      if (tag == PTAG_STATUS && vlen == 1)
+        status = value[0];
+      else if (tag == PTAG_JOB && vlen == 2)
+        job = ProvisionReader::u16(value);
+      else if (tag == PTAG_CHIP_ID && vlen == 4)
+        chipId = ProvisionReader::u32(value);
+      else if (tag == PTAG_AP_NAME)
+        ap.assign((const char *) value, vlen);
+    }
+
+    // Busy devices get the next repeat, the rest are done
+    if (known || status == PROVISION_BUSY || devices.size() >= PROVISIONER_MAX_DEVICES)
+      continue;
+
+    ProvisionerDevice device;
+
+    memcpy(device.mac, reader.target(), 6);
+    devices.push_back(device);
+
+    if (status != PROVISION_OK)
+      failed++;
+
+    const uint8_t *mac = reader.target();
+
+    printf("{\"mac\":\"%02x:%02x:%02x:%02x:%02x:%02x\",\"chip_id\":\"%x\",\"ap\":\"", mac[0], mac[1], mac[2], mac[3],
+           mac[4], mac[5], chipId);
+
+    for (size_t c = 0; c < ap.size(); c++)
+    {
+      if (ap[c] == '"' || ap[c] == '\\')
+        printf("\\%c", ap[c]);
+      else if ((uint8_t) ap[c] >= 0x20)
+        putchar(ap[c]);
+    }
+
+    printf("\",\"status\":\"%s\",\"job\":%u,\"ms\":%llu}\n", provisionerStatusName(status), job,
+           (unsigned long long) (provisionerNowMs() - start));
+    fflush(stdout);
+  }
+
+  close(fd);
+
+  fprintf(stderr, "provisioner: %d sent, %zu answered, %d refused\n", sent, devices.size(), failed);
+
+  return (failed || devices.empty() || (expect && (int) devices.size() < expect)) ? 1 : 0;
+}
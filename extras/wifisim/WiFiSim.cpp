@@ -0,0 +1,809 @@
+/*
+  WiFiSim.cpp
+  Host (Linux) build
+
+  Scripted WiFi scenarios for scan() / scanWifiNetworks() / connectWifi() / reconnectWifi() against the simulated
+  radio (linux/ESP8266WiFi.h) on the virtual clock. Every scenario starts from a reset radio and a new Encompass,
+  runs its steps and checks its expectations; the result is one JSON object per line on stdout:
+    {"scenario":"home/slow_dhcp[dhcp=2000]","passed":true,"virtual_ms":5300,"wall_us":412,"connect_ms":5200,
+     "connect_result":"connected","scan_ms":0,"scans":0,"connects":1,"auth_failures":0,"link_losses":0,"failures":[]}
+
+    pio run -e wifisim && .pio/build/wifisim/program > wifisim.jsonl
+
+  ENCOMPASS_WIFISIM_SCENARIOS   scenario files or directories, ':' separated (default extras/wifisim/scenarios)
+  ENCOMPASS_WIFISIM_FILTER      only scenarios whose name contains this
+
+  The process exits with 1 when an expectation failed. Runs are deterministic - the same tree gives the same output,
+  so diffing the output of two revisions shows which scenarios got slower, faster or different.
+
+  Scenario files, one directive per line, # starts a comment, "quoted strings" may hold spaces:
+    scenario NAME                   starts a scenario, everything up to the next one belongs to it
+    vary KEY VALUE...               runs the scenario once per value (all combinations), ${KEY} is replaced
+    seed N                          jitter sequence, before any ap
+    timing SCAN_MS CONNECT_MS       the radio's scan time, and association time for APs without connect_ms
+    jitter DB                       scan RSSI jitter, default 3
+    ap SSID [psk=P] [bssid=B] [channel=C] [enc=open|wep|tkip|ccmp|auto] [rssi=R[,MS:R...]] [connect_ms=MS]
+            [dhcp_ms=MS] [auth_fail=N] [dhcp_fail] [hidden]
+    saved SSID [PSK]                station config left in flash
+    credentials SSID PSK [SSID PSK] what the portal collected, for reconnect
+    connect_timeout S               setConnectTimeout()
+    min_quality Q                   setMinimumSignalQuality()
+    static_ip IP GATEWAY SUBNET     setSTAStaticIPConfig()
+  Steps, each timed on the virtual clock:
+    scan                            scan(), as the portal pages do
+    scan_networks                   scanWifiNetworks()
+    connect [SSID PSK]              connectWifi(), no SSID - the saved network
+    reconnect                       reconnectWifi(), the credentials in turn
+    roam MS                         the roaming monitor for MS, sampling as the scheduler would
+    wait MS                         time passes
+  Checks, against the last step:
+    expect KEY OP VALUE             OP is one of == != < <= > >=
+      result status                 connected, no_ssid, failed, wrong_password, lost, idle, disconnected, timeout
+      elapsed clock                 ms the last step took, ms since the scenario started
+      networks                      networks listed by the last scan step (duplicates and weak ones left out)
+      ssid bssid channel rssi       the station now
+      scans connects auth_failures link_losses    the radio's counters
+      roams                         moves the roaming monitor made
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#include "Encompass.h"
+
+#include <time.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+AsyncWebServer  webServer(80);
+DNSServer       dnsServer;
+
+typedef std::vector<std::string> SimTokens;
+
+struct SimLine
+{
+  int         number;
+  SimTokens   tokens;
+};
+
+struct SimScenario
+{
+  std::string           file;
+  std::string           name;
+  std::vector<SimLine>  lines;
+};
+
+static uint64_t simNowUs()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t) ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static const char* simStatusName(int status)
+{
+  switch (status)
+  {
+    case WL_CONNECTED:
+      return "connected";
+    case WL_NO_SSID_AVAIL:
+      return "no_ssid";
+    case WL_CONNECT_FAILED:
+      return "failed";
+    case WL_WRONG_PASSWORD:
+      return "wrong_password";
+    case WL_CONNECTION_LOST:
+      return "lost";
+    case WL_IDLE_STATUS:
+      return "idle";
+    case WL_DISCONNECTED:
+      return "disconnected";
+    case -1:
+      return "timeout";
+    default:
+      return "unknown";
+  }
+}
+
+static void simJSONString(const std::string &str)
+{
+  putchar('"');
+
+  for (size_t i = 0; i < str.size(); i++)
+  {
+    char c = str[i];
+
+    if (c == '"' || c == '\\')
+      printf("\\%c", c);
+    else if ((unsigned char) c < 0x20)
+      printf("\\u%04x", c);
+    else
+      putchar(c);
+  }
+
+  putchar('"');
+}
+
+// Whitespace separated, "quoted" tokens keep their spaces, # to the end of the line is a comment
+static SimTokens simTokenize(const std::string &line)
+{
+  SimTokens   tokens;
+  size_t      i = 0;
+
+  while (i < line.size())
+  {
+    while (i < line.size() && isspace((unsigned char) line[i]))
+      i++;
+
+    if (i == line.size() || line[i] == '#')
+      break;
+
+    std::string token;
+
+    while (i < line.size() && !isspace((unsigned char) line[i]))
+    {
+      if (line[i] == '"')
+      {
+        size_t end = line.find('"', i + 1);
+
+        if (end == std::string::npos)
+          end = line.size();
+
+        token += line.substr(i + 1, end - i - 1);
+        i = (end < line.size()) ? end + 1 : end;
+      }
+      else
+      {
+        token += line[i++];
+      }
+    }
+
+    tokens.push_back(token);
+  }
+
+  return tokens;
+}
+
+static std::string simSubstitute(const std::string &token, const std::vector<std::pair<std::string, std::string> > &values)
+{
+  std::string out = token;
+
+  for (size_t i = 0; i < values.size(); i++)
+  {
+    std::string key = "${" + values[i].first + "}";
+    size_t      at;
+
+    while ((at = out.find(key)) != std::string::npos)
+      out.replace(at, key.size(), values[i].second);
+  }
+
+  return out;
+}
+
+class EncompassWiFiSim
+{
+  public:
+
+    EncompassWiFiSim() : _run(0), _failed(0)
+    {
+      _filter = getenv("ENCOMPASS_WIFISIM_FILTER");
+    }
+
+    void    load(const std::string &path);
+    void    run();
+
+    int     failed()
+    {
+      return _failed;
+    }
+
+  private:
+
+    void    loadFile(const std::string &path);
+    void    expand(const SimScenario &scenario, const std::vector<SimLine> &varies);
+    void    runScenario(const SimScenario &scenario);
+    bool    addAP(const SimTokens &tokens, std::string &error);
+    bool    step(const SimTokens &tokens, std::string &error);
+    bool    check(const SimTokens &tokens, std::string &error);
+
+    std::vector<SimScenario>  _scenarios;
+    const char                *_filter;
+    int                       _run;
+    int                       _failed;
+
+    // The scenario being run
+    Encompass                 *_wm;
+    uint32_t                  _start;
+    uint32_t                  _elapsed;
+    int                       _result;
+    int                       _networks;
+    int32_t                   _connectMs;
+    int                       _connectResult;
+    uint32_t                  _scanMs;
+};
+
+void EncompassWiFiSim::load(const std::string &path)
+{
+  struct stat st;
+
+  if (stat(path.c_str(), &st) != 0)
+  {
+    fprintf(stderr, "wifisim: can't open %s\n", path.c_str());
+    _failed++;
+    return;
+  }
+
+  if (!S_ISDIR(st.st_mode))
+  {
+    loadFile(path);
+    return;
+  }
+
+  // *.wifi in name order, so the output order does not depend on the file system
+  std::vector<std::string>  names;
+  DIR                       *dir = opendir(path.c_str());
+  struct dirent             *entry;
+
+  while (dir && (entry = readdir(dir)) != NULL)
+  {
+    std::string name = entry->d_name;
+
+    if (name.size() > 5 && name.compare(name.size() - 5, 5, ".wifi") == 0)
+      names.push_back(name);
+  }
+
+  if (dir)
+    closedir(dir);
+
+  std::sort(names.begin(), names.end());
+
+  for (size_t i = 0; i < names.size(); i++)
+    loadFile(path + "/" + names[i]);
+}
+
+void EncompassWiFiSim::loadFile(const std::string &path)
+{
+  FILE *f = fopen(path.c_str(), "r");
+
+  if (f == NULL)
+  {
+    fprintf(stderr, "wifisim: can't open %s\n", path.c_str());
+    _failed++;
+    return;
+  }
+
+  std::string           base  = path.substr(path.rfind('/') + 1);
+  SimScenario           current;
+  std::vector<SimLine>  varies;
+  char                  buf[512];
+  int                   number = 0;
+
+  base = base.substr(0, base.rfind('.'));
+
+  while (fgets(buf, sizeof(buf), f))
+  {
+    SimLine line;
+
+    line.number = ++number;
+    line.tokens = simTokenize(buf);
+
+    if (line.tokens.empty())
+      continue;
+
+    if (line.tokens[0] == "scenario")
+    {
+      if (!current.name.empty())
+        expand(current, varies);
+
+      current.file  = path;
+      current.name  = base + "/" + (line.tokens.size() > 1 ? line.tokens[1] : std::string("unnamed"));
+      current.lines.clear();
+      varies.clear();
+    }
+    else if (current.name.empty())
+    {
+      fprintf(stderr, "wifisim: %s:%d: \"%s\" before the first scenario\n", path.c_str(), number, line.tokens[0].c_str());
+      _failed++;
+    }
+    else if (line.tokens[0] == "vary")
+    {
+      varies.push_back(line);
+    }
+    else
+    {
+      current.lines.push_back(line);
+    }
+  }
+
+  if (!current.name.empty())
+    expand(current, varies);
+
+  fclose(f);
+}
+
+// One scenario per combination of the vary values, "name[key=value,...]"
+void EncompassWiFiSim::expand(const SimScenario &scenario, const std::vector<SimLine> &varies)
+{
+  std::vector<size_t> pick(varies.size(), 0);
+
+  for (size_t i = 0; i < varies.size(); i++)
+  {
+    if (varies[i].tokens.size() < 3)
+    {
+      fprintf(stderr, "wifisim: %s:%d: vary needs a key and values\n", scenario.file.c_str(), varies[i].number);
+      _failed++;
+      return;
+    }
+  }
+
+  while (true)
+  {
+    std::vector<std::pair<std::string, std::string> > values;
+    SimScenario                                       one = scenario;
+
+    for (size_t i = 0; i < varies.size(); i++)
+      values.push_back(std::make_pair(varies[i].tokens[1], varies[i].tokens[2 + pick[i]]));
+
+    if (!values.empty())
+    {
+      one.name += "[";
+
+      for (size_t i = 0; i < values.size(); i++)
+        one.name += (i ? "," : "") + values[i].first + "=" + values[i].second;
+
+      one.name += "]";
+    }
+
+    for (size_t l = 0; l < one.lines.size(); l++)
+    {
+      for (size_t t = 0; t < one.lines[l].tokens.size(); t++)
+        one.lines[l].tokens[t] = simSubstitute(one.lines[l].tokens[t], values);
+    }
+
+    if (_filter == NULL || one.name.find(_filter) != std::string::npos)
+      _scenarios.push_back(one);
+
+    // Next combination, the last vary moving fastest
+    size_t i = varies.size();
+
+    while (i > 0 && ++pick[i - 1] == varies[i - 1].tokens.size() - 2)
+      pick[--i] = 0;
+
+    if (i == 0)
+      break;
+  }
+}
+
+static bool simNumber(const std::string &str, long &value)
+{
+  char *end;
+
+  if (str.empty())
+    return false;
+
+  value = strtol(str.c_str(), &end, 0);
+
+  return *end == 0;
+}
+
+bool EncompassWiFiSim::addAP(const SimTokens &tokens, std::string &error)
+{
+  HostAPConfig  ap;
+  std::string   psk;
+  std::string   rssi;
+
+  if (tokens.size() < 2)
+  {
+    error = "ap needs an SSID";
+    return false;
+  }
+
+  ap.ssid = tokens[1].c_str();
+
+  for (size_t i = 2; i < tokens.size(); i++)
+  {
+    std::string key   = tokens[i].substr(0, tokens[i].find('='));
+    std::string value = (tokens[i].find('=') != std::string::npos) ? tokens[i].substr(tokens[i].find('=') + 1) : "";
+    long        n     = 0;
+    bool        num   = simNumber(value, n);
+
+    if (key == "psk")
+      psk = value;
+    else if (key == "channel" && num)
+      ap.channel = n;
+    else if (key == "connect_ms" && num)
+      ap.connectMs = n;
+    else if (key == "dhcp_ms" && num)
+      ap.dhcpMs = n;
+    else if (key == "auth_fail" && num)
+      ap.authFailures = n;
+    else if (key == "dhcp_fail" && value.empty())
+      ap.dhcpFails = true;
+    else if (key == "hidden" && value.empty())
+      ap.hidden = true;
+    else if (key == "rssi")
+      rssi = value;
+    else if (key == "bssid")
+    {
+      unsigned int b[6];
+
+      if (sscanf(value.c_str(), "%x:%x:%x:%x:%x:%x", &b[0], &b[1], &b[2], &b[3], &b[4], &b[5]) != 6)
+      {
+        error = "bad bssid " + value;
+        return false;
+      }
+
+      for (int j = 0; j < 6; j++)
+        ap.bssid[j] = b[j];
+    }
+    else if (key == "enc")
+    {
+      static const char     *names[] = { "open", "wep", "tkip", "ccmp", "auto" };
+      static const uint8_t  types[]  = { ENC_TYPE_NONE, ENC_TYPE_WEP, ENC_TYPE_TKIP, ENC_TYPE_CCMP, ENC_TYPE_AUTO };
+
+      for (size_t j = 0; j < sizeof(types); j++)
+      {
+        if (value == names[j])
+          ap.encryption = types[j];
+      }
+
+      if (ap.encryption == 0)
+      {
+        error = "bad enc " + value;
+        return false;
+      }
+    }
+    else
+    {
+      error = "bad ap setting " + tokens[i];
+      return false;
+    }
+  }
+
+  ap.passphrase = psk.c_str();
+
+  // rssi=-60,20000:-85,30000:-100 - the RSSI at 0, then at each point in time
+  std::vector<std::pair<long, long> > points;
+  size_t                              start = 0;
+
+  while (start < rssi.size())
+  {
+    size_t      end   = rssi.find(',', start);
+    std::string item  = rssi.substr(start, (end == std::string::npos) ? std::string::npos : end - start);
+    size_t      colon = item.find(':');
+    long        at    = 0;
+    long        value = 0;
+
+    if ((colon == std::string::npos && !simNumber(item, value)) ||
+        (colon != std::string::npos && (!simNumber(item.substr(0, colon), at) || !simNumber(item.substr(colon + 1), value))))
+    {
+      error = "bad rssi " + item;
+      return false;
+    }
+
+    points.push_back(std::make_pair(at, value));
+    start = (end == std::string::npos) ? rssi.size() : end + 1;
+  }
+
+  if (!points.empty())
+    ap.rssi = points[0].second;
+
+  int index = WiFi.hostAddAP(ap);
+
+  for (size_t i = 1; i < points.size(); i++)
+    WiFi.hostAddRSSIPoint(index, points[i].first, points[i].second);
+
+  return true;
+}
+
+bool EncompassWiFiSim::step(const SimTokens &tokens, std::string &error)
+{
+  const std::string &op     = tokens[0];
+  uint32_t          before  = millis();
+
+  if (op == "scan")
+  {
+    _wm->shouldscan = true;
+    _wm->scan();
+
+    _networks = 0;
+
+    for (int i = 0; i < _wm->wifiSSIDCount; i++)
+    {
+      if (!_wm->wifiSSIDs[i].duplicate && (_wm->_minimumQuality == -1 ||
+                                           _wm->_minimumQuality < _wm->getRSSIasQuality(_wm->wifiSSIDs[i].RSSI)))
+        _networks++;
+    }
+  }
+  else if (op == "scan_networks")
+  {
+    int *indices  = NULL;
+    int n         = _wm->scanWifiNetworks(&indices);
+
+    _networks = 0;
+
+    for (int i = 0; i < n && indices; i++)
+    {
+      if (indices[i] != -1)
+        _networks++;
+    }
+
+    free(indices);
+  }
+  else if (op == "connect" || op == "reconnect")
+  {
+    if (op == "reconnect")
+      _result = _wm->reconnectWifi();
+    else if (tokens.size() >= 2)
+      _result = _wm->connectWifi(tokens[1].c_str(), (tokens.size() >= 3) ? tokens[2].c_str() : "");
+    else
+      _result = _wm->connectWifi();
+  }
+  else if (op == "roam")
+  {
+    long ms;
+
+    if (tokens.size() < 2 || !simNumber(tokens[1], ms))
+    {
+      error = "roam needs a time in ms";
+      return false;
+    }
+
+#if ENCOMPASS_ROAMING
+    for (long t = 0; t < ms; t += ENCOMPASS_ROAM_SAMPLE_MS)
+    {
+      _wm->processRoaming();
+      delay(ENCOMPASS_ROAM_SAMPLE_MS);
+    }
+#else
+    delay(ms);
+#endif
+  }
+  else if (op == "wait")
+  {
+    long ms;
+
+    if (tokens.size() < 2 || !simNumber(tokens[1], ms))
+    {
+      error = "wait needs a time in ms";
+      return false;
+    }
+
+    delay(ms);
+  }
+  else
+  {
+    error = "unknown directive " + op;
+    return false;
+  }
+
+  _elapsed = millis() - before;
+
+  if (op == "scan" || op == "scan_networks")
+    _scanMs += _elapsed;
+
+  if (op == "connect" || op == "reconnect")
+  {
+    _connectMs      = _elapsed;
+    _connectResult  = _result;
+  }
+
+  return true;
+}
+
+bool EncompassWiFiSim::check(const SimTokens &tokens, std::string &error)
+{
+  if (tokens.size() != 4)
+  {
+    error = "expect KEY OP VALUE";
+    return false;
+  }
+
+  const std::string &key  = tokens[1];
+  const std::string &op   = tokens[2];
+  const std::string &want = tokens[3];
+  std::string       got;
+  HostRadioStats    stats;
+  char              buf[24];
+
+  WiFi.hostRadioStats(stats);
+
+  if (key == "result")
+    got = simStatusName(_result);
+  else if (key == "status")
+    got = simStatusName(WiFi.status());
+  else if (key == "elapsed" || key == "clock" || key == "networks" || key == "channel" || key == "rssi" ||
+           key == "scans" || key == "connects" || key == "auth_failures" || key == "link_losses" || key == "roams")
+  {
+    long value = (key == "elapsed")       ? (long) _elapsed :
+                 (key == "clock")         ? (long) (millis() - _start) :
+                 (key == "networks")      ? (long) _networks :
+                 (key == "channel")       ? (long) WiFi.channel() :
+                 (key == "rssi")          ? (long) WiFi.RSSI() :
+                 (key == "scans")         ? (long) stats.scans :
+                 (key == "connects")      ? (long) stats.connects :
+                 (key == "roams")         ? (long) _wm->_metrics.roams :
+                 (key == "auth_failures") ? (long) stats.authFailures : (long) stats.linkLosses;
+
+    snprintf(buf, sizeof(buf), "%ld", value);
+    got = buf;
+  }
+  else if (key == "ssid")
+    got = WiFi.SSID().c_str();
+  else if (key == "bssid")
+    got = WiFi.BSSIDstr().c_str();
+  else
+  {
+    error = "unknown expect key " + key;
+    return false;
+  }
+
+  long  a;
+  long  b;
+  int   cmp;
+
+  // Numbers as numbers, anything else as text (BSSIDs case-insensitively)
+  if (simNumber(got, a) && simNumber(want, b))
+    cmp = (a < b) ? -1 : (a > b);
+  else
+    cmp = strcasecmp(got.c_str(), want.c_str());
+
+  bool pass = (op == "==") ? cmp == 0 : (op == "!=") ? cmp != 0 : (op == "<")  ? cmp < 0 :
+              (op == "<=") ? cmp <= 0 : (op == ">")  ? cmp > 0  : (op == ">=") ? cmp >= 0 : false;
+
+  if (!pass)
+    error = "expect " + key + " " + op + " " + want + ", got " + got;
+
+  return pass;
+}
+
+void EncompassWiFiSim::runScenario(const SimScenario &scenario)
+{
+  std::vector<std::string>  failures;
+  HostHeapStats             heapBefore;
+  HostHeapStats             heapAfter;
+  HostRadioStats            stats;
+  uint64_t                  wallStart = simNowUs();
+
+  hostHeapStats(heapBefore);
+
+  WiFi.hostResetRadio();
+
+  _wm             = new Encompass(&webServer, &dnsServer, "encompass-sim");
+  _start          = millis();
+  _elapsed        = 0;
+  _result         = WL_IDLE_STATUS;
+  _networks       = 0;
+  _connectMs      = -1;
+  _connectResult  = WL_IDLE_STATUS;
+  _scanMs         = 0;
+
+  for (size_t i = 0; i < scenario.lines.size(); i++)
+  {
+    const SimTokens   &t = scenario.lines[i].tokens;
+    std::string       error;
+    bool              ok = true;
+    long              n;
+    IPAddress         ip, gw, sn;
+
+    if (t[0] == "seed" && t.size() == 2 && simNumber(t[1], n))
+      WiFi.hostResetRadio(n);
+    else if (t[0] == "timing" && t.size() == 3)
+      WiFi.hostSetTiming(atol(t[1].c_str()), atol(t[2].c_str()));
+    else if (t[0] == "jitter" && t.size() == 2)
+      WiFi.hostSetRSSIJitter(atoi(t[1].c_str()));
+    else if (t[0] == "ap")
+      ok = addAP(t, error);
+    else if (t[0] == "saved" && t.size() >= 2)
+      WiFi.begin(t[1].c_str(), (t.size() >= 3) ? t[2].c_str() : "", 0, NULL, false);
+    else if (t[0] == "credentials" && t.size() >= 3)
+    {
+      for (size_t c = 0; c < MAX_WIFI_CREDENTIALS && 1 + 2 * c + 1 < t.size(); c++)
+      {
+        _wm->_ssid[c] = t[1 + 2 * c].c_str();
+        _wm->_pass[c] = t[2 + 2 * c].c_str();
+      }
+    }
+    else if (t[0] == "connect_timeout" && t.size() == 2)
+      _wm->setConnectTimeout(atol(t[1].c_str()));
+    else if (t[0] == "min_quality" && t.size() == 2)
+      _wm->setMinimumSignalQuality(atoi(t[1].c_str()));
+    else if (t[0] == "static_ip" && t.size() == 4 && ip.fromString(t[1].c_str()) && gw.fromString(t[2].c_str()) &&
+             sn.fromString(t[3].c_str()))
+      _wm->setSTAStaticIPConfig(ip, gw, sn);
+    else if (t[0] == "expect")
+      ok = check(t, error);
+    else
+      ok = step(t, error);
+
+    if (!ok)
+    {
+      char where[16];
+
+      snprintf(where, sizeof(where), "line %d: ", scenario.lines[i].number);
+      failures.push_back(where + error);
+    }
+  }
+
+  uint32_t virtualMs = millis() - _start;
+
+  WiFi.hostRadioStats(stats);
+
+  delete _wm;
+
+  hostHeapStats(heapAfter);
+
+  _run++;
+
+  if (!failures.empty())
+    _failed++;
+
+  printf("{\"scenario\":");
+  simJSONString(scenario.name);
+  printf(",\"passed\":%s,\"virtual_ms\":%u,\"wall_us\":%llu,\"connect_ms\":%d,\"connect_result\":\"%s\","
+         "\"scan_ms\":%u,\"scans\":%u,\"connects\":%u,\"auth_failures\":%u,\"link_losses\":%u,\"allocs\":%llu,\"failures\":[",
+         failures.empty() ? "true" : "false", virtualMs, (unsigned long long) (simNowUs() - wallStart), _connectMs,
+         (_connectMs < 0) ? "" : simStatusName(_connectResult), _scanMs, stats.scans, stats.connects,
+         stats.authFailures, stats.linkLosses, (unsigned long long) (heapAfter.allocs - heapBefore.allocs));
+
+  for (size_t i = 0; i < failures.size(); i++)
+  {
+    if (i)
+      putchar(',');
+
+    simJSONString(failures[i]);
+  }
+
+  printf("]}\n");
+
+  for (size_t i = 0; i < failures.size(); i++)
+    fprintf(stderr, "wifisim: %s: %s: %s\n", scenario.file.c_str(), scenario.name.c_str(), failures[i].c_str());
+}
+
+void EncompassWiFiSim::run()
+{
+  uint64_t start = simNowUs();
+
+  for (size_t i = 0; i < _scenarios.size(); i++)
+    runScenario(_scenarios[i]);
+
+  fprintf(stderr, "wifisim: %d scenarios, %d failed, %.1f ms\n", _run, _failed, (simNowUs() - start) / 1000.0);
+}
+
+void setup()
+{
+  // Scans and connects take their simulated time without anyone waiting for it
+  hostUseVirtualClock(true);
+
+  const char        *env  = getenv("ENCOMPASS_WIFISIM_SCENARIOS");
+  std::string       paths = env ? env : "extras/wifisim/scenarios";
+  EncompassWiFiSim  sim;
+  size_t            start = 0;
+
+  while (start <= paths.size())
+  {
+    size_t end = paths.find(':', start);
+
+    if (end == std::string::npos)
+      end = paths.size();
+
+    if (end > start)
+      sim.load(paths.substr(start, end - start));
+
+    start = end + 1;
+  }
+
+  sim.run();
+
+  exit(sim.failed() ? 1 : 0);
+}
+
+void loop()
+{
+}
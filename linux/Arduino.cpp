@@ -0,0 +1,709 @@
+/*
+  Arduino.cpp
+  Host (Linux) build
+
+  Time, Serial, IPAddress, the simulated EspClass and RTC, and main().
+
+  Time is CLOCK_MONOTONIC unless hostUseVirtualClock() is on: then it only moves when the sketch waits - delay() and
+  delayMicroseconds() add their full time, yield() and each pass of the main loop a little - so hours of scans and
+  connects run in milliseconds and every run sees the same times.
+
+  Run the host build with the sketch's setup() / loop() linked in, e.g. linux/HostPortal.cpp:
+    pio run -e native && .pio/build/native/program
+  The portal is then on http://127.0.0.1:8080/ and its DNS on 127.0.0.1:8053 (see hostPort()).
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#include "Arduino.h"
+#include "cont.h"
+
+extern "C"
+{
+  #include "user_interface.h"
+}
+
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <malloc.h>
+#include <pthread.h>
+
+HardwareSerial  Serial;
+EspClass        ESP;
+
+const IPAddress INADDR_NONE(0, 0, 0, 0);
+
+static uint64_t hostMonotonicUs()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// What one yield() costs on the virtual clock - a busy-wait on yield() still gets somewhere
+#define HOST_VIRTUAL_YIELD_US     100
+
+static bool     hostVirtual     = false;
+static uint64_t hostVirtualUs   = 0;
+static uint64_t hostClockOffset = 0;
+
+// Time since the process started (first asked), like time since boot
+uint64_t micros64()
+{
+  static uint64_t boot = hostMonotonicUs();
+
+  if (hostVirtual)
+    return hostVirtualUs;
+
+  return hostMonotonicUs() - boot + hostClockOffset;
+}
+
+void hostUseVirtualClock(bool enable)
+{
+  if (enable == hostVirtual)
+    return;
+
+  // Carries on from the current time either way, millis() never jumps back
+  uint64_t now = micros64();
+
+  hostVirtual = enable;
+
+  if (enable)
+    hostVirtualUs = now;
+  else
+    hostClockOffset += now - micros64();
+}
+
+void hostAdvanceClock(uint64_t us)
+{
+  if (hostVirtual)
+    hostVirtualUs += us;
+}
+
+unsigned long micros()
+{
+  return (uint32_t) micros64();
+}
+
+unsigned long millis()
+{
+  return (uint32_t) (micros64() / 1000);
+}
+
+void delay(unsigned long ms)
+{
+  if (hostVirtual)
+  {
+    hostPoll(0);
+    hostVirtualUs += ms * 1000ULL;
+    return;
+  }
+
+  uint64_t end = micros64() + ms * 1000ULL;
+
+  do
+  {
+    uint64_t now = micros64();
+
+    hostPoll((now < end) ? (int) ((end - now + 999) / 1000) : 0);
+  } while (micros64() < end);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+  if (hostVirtual)
+  {
+    hostVirtualUs += us;
+    return;
+  }
+
+  uint64_t end = micros64() + us;
+
+  while (micros64() < end)
+    ;
+}
+
+void yield()
+{
+  hostPoll(0);
+  hostAdvanceClock(HOST_VIRTUAL_YIELD_US);
+}
+
+long random(long howbig)
+{
+  return howbig ? ::random() % howbig : 0;
+}
+
+long random(long howsmall, long howbig)
+{
+  return (howsmall >= howbig) ? howsmall : howsmall + random(howbig - howsmall);
+}
+
+void randomSeed(unsigned long seed)
+{
+  if (seed)
+    srandom(seed);
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  (void) pin;
+  (void) mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+  (void) pin;
+  (void) val;
+}
+
+int digitalRead(uint8_t pin)
+{
+  (void) pin;
+  return LOW;
+}
+
+int analogRead(uint8_t pin)
+{
+  (void) pin;
+  return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Serial - stdout, input from stdin when something is there
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int hostSerialPeek = -1;
+
+int HardwareSerial::available()
+{
+  return (peek() >= 0) ? 1 : 0;
+}
+
+int HardwareSerial::peek()
+{
+  if (hostSerialPeek < 0)
+  {
+    uint8_t c;
+    int     flags = fcntl(STDIN_FILENO, F_GETFL);
+
+    fcntl(STDIN_FILENO, F_SETFL, flags | O_NONBLOCK);
+
+    if (::read(STDIN_FILENO, &c, 1) == 1)
+      hostSerialPeek = c;
+
+    fcntl(STDIN_FILENO, F_SETFL, flags);
+  }
+
+  return hostSerialPeek;
+}
+
+int HardwareSerial::read()
+{
+  int c = peek();
+
+  hostSerialPeek = -1;
+
+  return c;
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+  return fwrite(&c, 1, 1, stdout);
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+  return fwrite(buffer, 1, size, stdout);
+}
+
+void HardwareSerial::flush()
+{
+  fflush(stdout);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// IPAddress
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool IPAddress::fromString(const char *address)
+{
+  unsigned  acc   = 0;
+  int       dots  = 0;
+  bool      digit = false;
+  uint8_t   bytes[4];
+
+  for (; *address; address++)
+  {
+    char c = *address;
+
+    if (c >= '0' && c <= '9')
+    {
+      acc   = acc * 10 + (c - '0');
+      digit = true;
+
+      if (acc > 255)
+        return false;
+    }
+    else if (c == '.' && digit && dots < 3)
+    {
+      bytes[dots++] = acc;
+      acc           = 0;
+      digit         = false;
+    }
+    else
+    {
+      return false;
+    }
+  }
+
+  if (dots != 3 || !digit)
+    return false;
+
+  bytes[3] = acc;
+  memcpy(_address.bytes, bytes, 4);
+
+  return true;
+}
+
+String IPAddress::toString() const
+{
+  char buf[16];
+
+  snprintf(buf, sizeof(buf), "%u.%u.%u.%u", _address.bytes[0], _address.bytes[1], _address.bytes[2], _address.bytes[3]);
+
+  return String(buf);
+}
+
+size_t IPAddress::printTo(Print &p) const
+{
+  return p.print(toString());
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// EspClass - a NodeMCU v2 (4 MB flash)
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static uint32_t hostHeapSize()
+{
+  static uint32_t size = 0;
+
+  if (size == 0)
+  {
+    const char *env = getenv("ENCOMPASS_HOST_HEAP");
+
+    size = env ? strtoul(env, NULL, 10) : 51200;
+  }
+
+  return size;
+}
+
+#if defined(__SANITIZE_ADDRESS__)
+  #define HOST_HEAP_ACCOUNTING    0
+#else
+  #define HOST_HEAP_ACCOUNTING    1
+#endif
+
+static uint64_t hostHeapAllocs  = 0;
+static uint64_t hostHeapBytes   = 0;
+static size_t   hostHeapLive    = 0;
+static size_t   hostHeapPeak    = 0;
+static size_t   hostHeapBase    = 0;
+
+#if HOST_HEAP_ACCOUNTING
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+extern "C" void  __libc_free(void *ptr);
+
+static void hostHeapAdd(void *ptr, size_t requested)
+{
+  if (!ptr)
+    return;
+
+  hostHeapAllocs++;
+  hostHeapBytes += requested;
+  hostHeapLive  += malloc_usable_size(ptr);
+
+  if (hostHeapLive > hostHeapPeak)
+    hostHeapPeak = hostHeapLive;
+}
+
+extern "C" void *malloc(size_t size)
+{
+  void *ptr = __libc_malloc(size);
+
+  hostHeapAdd(ptr, size);
+
+  return ptr;
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+  void *ptr = __libc_calloc(count, size);
+
+  hostHeapAdd(ptr, count * size);
+
+  return ptr;
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+  size_t old = ptr ? malloc_usable_size(ptr) : 0;
+  void   *p  = __libc_realloc(ptr, size);
+
+  if (p || size == 0)
+    hostHeapLive -= std::min(old, hostHeapLive);
+
+  hostHeapAdd(p, size);
+
+  return p;
+}
+
+extern "C" void free(void *ptr)
+{
+  if (ptr)
+    hostHeapLive -= std::min(malloc_usable_size(ptr), hostHeapLive);
+
+  __libc_free(ptr);
+}
+
+#endif
+
+void hostHeapStats(HostHeapStats &stats)
+{
+  stats.allocs  = hostHeapAllocs;
+  stats.bytes   = hostHeapBytes;
+  stats.used    = (hostHeapLive > hostHeapBase) ? hostHeapLive - hostHeapBase : 0;
+  stats.peak    = (hostHeapPeak > hostHeapBase) ? hostHeapPeak - hostHeapBase : 0;
+}
+
+static void hostHeapReport()
+{
+#if HOST_HEAP_ACCOUNTING
+  HostHeapStats stats;
+
+  hostHeapStats(stats);
+  fprintf(stderr, "host heap: peak %u of %u bytes\n", stats.peak, hostHeapSize());
+#endif
+}
+
+static size_t hostHeapUsed()
+{
+  HostHeapStats stats;
+
+  hostHeapStats(stats);
+
+  return stats.used;
+}
+
+uint32_t EspClass::getChipId()
+{
+  return 0x00C0FFEE;
+}
+
+uint32_t EspClass::getFlashChipId()
+{
+  return 0x001640EF;
+}
+
+uint32_t EspClass::getFlashChipSize()
+{
+  return 4 * 1024 * 1024;
+}
+
+uint32_t EspClass::getFlashChipRealSize()
+{
+  return 4 * 1024 * 1024;
+}
+
+uint32_t EspClass::getFlashChipSpeed()
+{
+  return 40000000;
+}
+
+uint8_t EspClass::getCpuFreqMHz()
+{
+  return 80;
+}
+
+uint32_t EspClass::getCycleCount()
+{
+  return (uint32_t) (micros64() * 80);
+}
+
+uint32_t EspClass::getSketchSize()
+{
+  return 400 * 1024;
+}
+
+uint32_t EspClass::getFreeSketchSpace()
+{
+  return 1024 * 1024;
+}
+
+const char* EspClass::getSdkVersion()
+{
+  return "host";
+}
+
+String EspClass::getCoreVersion()
+{
+  return String("host");
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// RTC - user memory and the reason the next start will see, in ENCOMPASS_HOST_RTC
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#define HOST_RTC_USER_BLOCKS    128
+#define HOST_RTC_PERIOD_Q12     (5 << 12)     // A 200 kHz counter, the chip's runs at about 150 kHz
+
+struct HostRTC
+{
+  uint32_t    user[HOST_RTC_USER_BLOCKS];
+  uint32_t    reason;
+};
+
+static HostRTC    hostRTCState;
+static rst_info   hostResetInfo;
+
+static void hostRTCSave(uint32_t reason)
+{
+  const char *path = getenv("ENCOMPASS_HOST_RTC");
+
+  if (path == NULL)
+    return;
+
+  hostRTCState.reason = reason;
+
+  FILE *f = fopen(path, "wb");
+
+  if (f)
+  {
+    fwrite(&hostRTCState, sizeof(hostRTCState), 1, f);
+    fclose(f);
+  }
+}
+
+static HostRTC& hostRTC()
+{
+  static bool loaded = false;
+
+  if (!loaded)
+  {
+    loaded = true;
+
+    const char  *path = getenv("ENCOMPASS_HOST_RTC");
+    FILE        *f    = path ? fopen(path, "rb") : NULL;
+
+    hostResetInfo.reason = REASON_DEFAULT_RST;
+
+    if (f)
+    {
+      if (fread(&hostRTCState, sizeof(hostRTCState), 1, f) == 1)
+        hostResetInfo.reason = hostRTCState.reason;
+      else
+        memset(&hostRTCState, 0, sizeof(hostRTCState));
+
+      fclose(f);
+    }
+
+    // Unless this process ends through EspClass, the next one finds an external reset
+    hostRTCSave(REASON_EXT_SYS_RST);
+  }
+
+  return hostRTCState;
+}
+
+struct rst_info* system_get_rst_info(void)
+{
+  hostRTC();
+
+  return &hostResetInfo;
+}
+
+uint32 system_get_rtc_time(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_REALTIME, &ts);
+
+  uint64_t us = (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+
+  return (uint32) ((us << 12) / HOST_RTC_PERIOD_Q12);
+}
+
+uint32 system_rtc_clock_cali_proc(void)
+{
+  return HOST_RTC_PERIOD_Q12;
+}
+
+String EspClass::getResetReason()
+{
+  static const char *const reasons[] = { "Power On", "Hardware Watchdog", "Exception", "Software Watchdog",
+                                         "Software/System restart", "Deep-Sleep Wake", "External System" };
+
+  uint32_t reason = getResetInfoPtr()->reason;
+
+  return String(reason <= REASON_EXT_SYS_RST ? reasons[reason] : "Unknown");
+}
+
+struct rst_info* EspClass::getResetInfoPtr()
+{
+  return system_get_rst_info();
+}
+
+bool EspClass::rtcUserMemoryRead(uint32_t offset, uint32_t *data, size_t size)
+{
+  if (offset * 4 + size > sizeof(hostRTC().user) || (size & 3))
+    return false;
+
+  memcpy(data, &hostRTC().user[offset], size);
+
+  return true;
+}
+
+bool EspClass::rtcUserMemoryWrite(uint32_t offset, uint32_t *data, size_t size)
+{
+  if (offset * 4 + size > sizeof(hostRTC().user) || (size & 3))
+    return false;
+
+  memcpy(&hostRTC().user[offset], data, size);
+  hostRTCSave(REASON_EXT_SYS_RST);
+
+  return true;
+}
+
+uint32_t EspClass::getFreeHeap()
+{
+  size_t used = hostHeapUsed();
+
+  return (used < hostHeapSize()) ? hostHeapSize() - used : 0;
+}
+
+uint32_t EspClass::getMaxFreeBlockSize()
+{
+  // glibc doesn't fragment like umm_malloc, the simulated heap is one block
+  return getFreeHeap();
+}
+
+uint8_t EspClass::getHeapFragmentation()
+{
+  return 0;
+}
+
+void EspClass::getHeapStats(uint32_t *free, uint16_t *max, uint8_t *frag)
+{
+  if (free)
+    *free = getFreeHeap();
+
+  if (max)
+    *max = std::min<uint32_t>(getMaxFreeBlockSize(), 0xFFFF);
+
+  if (frag)
+    *frag = getHeapFragmentation();
+}
+
+void EspClass::reset()
+{
+  hostRTC();
+  hostRTCSave(REASON_SOFT_RESTART);
+
+  fflush(stdout);
+  fprintf(stderr, "ESP.reset()\n");
+  exit(0);
+}
+
+void EspClass::restart()
+{
+  hostRTC();
+  hostRTCSave(REASON_SOFT_RESTART);
+
+  fflush(stdout);
+  fprintf(stderr, "ESP.restart()\n");
+  exit(0);
+}
+
+void EspClass::deepSleep(uint64_t time_us)
+{
+  hostRTC();
+  hostRTCSave(REASON_DEEP_SLEEP_AWAKE);
+
+  fflush(stdout);
+  fprintf(stderr, "ESP.deepSleep(%llu)\n", (unsigned long long) time_us);
+  exit(0);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// main - the core's loop task
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// No continuation, loop() runs on the process stack - filled in from its bounds
+static cont_t hostCont;
+
+cont_t *g_pcont = NULL;
+
+static void hostStack()
+{
+  pthread_attr_t  attr;
+  void            *low;
+  size_t          size;
+
+  if (pthread_getattr_np(pthread_self(), &attr) != 0)
+    return;
+
+  if (pthread_attr_getstack(&attr, &low, &size) == 0)
+  {
+    hostCont.stack      = (unsigned *) low;
+    hostCont.stack_end  = (unsigned *) ((uint8_t *) low + size);
+    g_pcont             = &hostCont;
+  }
+
+  pthread_attr_destroy(&attr);
+}
+
+int main(int argc, char **argv)
+{
+  (void) argc;
+  (void) argv;
+
+  // Line buffered like a UART terminal, even when piped
+  setvbuf(stdout, NULL, _IOLBF, 0);
+
+  // Allocations made before the sketch starts (iostreams, the runtime) are not the sketch's
+  hostHeapBase = hostHeapLive;
+  hostHeapPeak = hostHeapLive;
+  atexit(hostHeapReport);
+
+  hostStack();
+
+  setup();
+
+  // ENCOMPASS_HOST_IDLE_MS - how long to wait for socket activity between loop() calls, 0 spins like the chip
+  const char  *env  = getenv("ENCOMPASS_HOST_IDLE_MS");
+  int         idle  = env ? atoi(env) : 1;
+
+  while (true)
+  {
+    loop();
+
+    if (hostVirtual)
+    {
+      hostPoll(0);
+      hostVirtualUs += (idle ? idle : 1) * 1000ULL;
+    }
+    else
+    {
+      hostPoll(idle);
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,129 @@
+/*
+  Arduino.h
+  Host (Linux) build
+
+  The parts of the ESP8266 Arduino core Encompass uses, backed by the host: time from CLOCK_MONOTONIC, Serial on
+  stdout, delay() and yield() service the sockets (the ESP8266 runs its network callbacks at the same points).
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+#include "pgmspace.h"
+#include "WString.h"
+#include "Print.h"
+#include "IPAddress.h"
+#include "Esp.h"
+#include "HostLoop.h"
+
+#define ARDUINO               10813
+#define ARDUINO_ARCH_ESP8266
+#define ESP8266
+#define ENCOMPASS_HOST
+
+#define HIGH                  0x1
+#define LOW                   0x0
+#define INPUT                 0x00
+#define OUTPUT                0x01
+#define INPUT_PULLUP          0x02
+#define LED_BUILTIN           2
+
+#define PI                    3.1415926535897932384626433832795
+
+typedef bool      boolean;
+typedef uint8_t   byte;
+typedef uint16_t  word;
+
+typedef uint8_t   uint8;
+typedef uint16_t  uint16;
+typedef uint32_t  uint32;
+typedef int8_t    sint8;
+typedef int16_t   sint16;
+typedef int32_t   sint32;
+
+using std::min;
+using std::max;
+
+#define constrain(amt, low, high)     ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#define bitRead(value, bit)           (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit)            ((value) |= (1UL << (bit)))
+#define bitClear(value, bit)          ((value) &= ~(1UL << (bit)))
+#define lowByte(w)                    ((uint8_t) ((w) & 0xff))
+#define highByte(w)                   ((uint8_t) ((w) >> 8))
+
+// UART interrupts - nothing to mask on the host
+#define ETS_UART_INTR_DISABLE()
+#define ETS_UART_INTR_ENABLE()
+
+unsigned long millis();
+unsigned long micros();
+uint64_t      micros64();
+void          delay(unsigned long ms);
+void          delayMicroseconds(unsigned int us);
+void          yield();
+
+// Host only - see Arduino.cpp. Virtual time moves on delay() / yield() / loop() and hostAdvanceClock() only.
+void          hostUseVirtualClock(bool enable);
+void          hostAdvanceClock(uint64_t us);
+
+long          random(long howbig);
+long          random(long howsmall, long howbig);
+void          randomSeed(unsigned long seed);
+
+void          pinMode(uint8_t pin, uint8_t mode);
+void          digitalWrite(uint8_t pin, uint8_t val);
+int           digitalRead(uint8_t pin);
+int           analogRead(uint8_t pin);
+
+// stdout, never blocks for long - availableForWrite() reports a UART sized FIFO
+class HardwareSerial : public Stream
+{
+  public:
+
+    void begin(unsigned long baud)
+    {
+      (void) baud;
+    }
+
+    void end() {}
+
+    void setDebugOutput(bool enable)
+    {
+      (void) enable;
+    }
+
+    virtual int available() override;
+    virtual int read() override;
+    virtual int peek() override;
+
+    virtual int availableForWrite() override
+    {
+      return 128;
+    }
+
+    virtual size_t write(uint8_t c) override;
+    virtual size_t write(const uint8_t *buffer, size_t size) override;
+    virtual void flush() override;
+
+    using Print::write;
+
+    operator bool() const
+    {
+      return true;
+    }
+};
+
+extern HardwareSerial Serial;
+
+// Sketch entry points, called by the host main()
+void setup();
+void loop();
@@ -0,0 +1,228 @@
+/*
+  AsyncEventSource.cpp
+  Host (Linux) build
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#include "AsyncEventSource.h"
+
+// "retry:", "id:", "event:" and one "data:" line per line of the message, then a blank line
+static std::string hostEventMessage(const char *message, const char *event, uint32_t id, uint32_t reconnect)
+{
+  std::string out;
+  char        line[32];
+
+  if (reconnect)
+  {
+    snprintf(line, sizeof(line), "retry: %lu\r\n", (unsigned long) reconnect);
+    out += line;
+  }
+
+  if (id)
+  {
+    snprintf(line, sizeof(line), "id: %lu\r\n", (unsigned long) id);
+    out += line;
+  }
+
+  if (event)
+  {
+    out += "event: ";
+    out += event;
+    out += "\r\n";
+  }
+
+  if (message)
+  {
+    const char *start = message;
+
+    while (true)
+    {
+      const char *end = start + strcspn(start, "\r\n");
+
+      out += "data: ";
+      out.append(start, end - start);
+      out += "\r\n";
+
+      if (*end == 0)
+        break;
+
+      start = (end[0] == '\r' && end[1] == '\n') ? end + 2 : end + 1;
+    }
+  }
+
+  out += "\r\n";
+
+  return out;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// AsyncEventSourceClient
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+AsyncEventSourceClient::AsyncEventSourceClient(AsyncWebServerRequest *request, AsyncEventSource *server)
+  : _client(request->client()), _server(server), _lastId(0), _connected(true), _packets(0)
+{
+  if (request->hasHeader("Last-Event-ID"))
+    _lastId = strtoul(request->getHeader("Last-Event-ID")->value().c_str(), NULL, 10);
+}
+
+// The stream ends at the next pump, never from inside a handler or callback that is still using the request
+void AsyncEventSourceClient::close()
+{
+  _connected = false;
+}
+
+void AsyncEventSourceClient::write(const char *message, size_t len)
+{
+  if (!_connected || _packets >= SSE_MAX_QUEUED_MESSAGES)
+    return;
+
+  _queue.append(message, len);
+  _packets++;
+}
+
+void AsyncEventSourceClient::send(const char *message, const char *event, uint32_t id, uint32_t reconnect)
+{
+  std::string ev = hostEventMessage(message, event, id, reconnect);
+
+  write(ev.data(), ev.size());
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// AsyncEventSource
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+AsyncEventSource::AsyncEventSource(const String &url) : _url(url)
+{
+}
+
+// Removed from the server (reset()) with clients still connected - their streams end, the responses free them
+AsyncEventSource::~AsyncEventSource()
+{
+  for (size_t i = 0; i < _clients.size(); i++)
+  {
+    _clients[i]->_server = NULL;
+    _clients[i]->close();
+  }
+}
+
+void AsyncEventSource::close()
+{
+  for (size_t i = 0; i < _clients.size(); i++)
+    _clients[i]->close();
+}
+
+void AsyncEventSource::onConnect(ArEventHandlerFunction cb)
+{
+  _connectcb = cb;
+}
+
+void AsyncEventSource::send(const char *message, const char *event, uint32_t id, uint32_t reconnect)
+{
+  std::string ev = hostEventMessage(message, event, id, reconnect);
+
+  for (size_t i = 0; i < _clients.size(); i++)
+    _clients[i]->write(ev.data(), ev.size());
+}
+
+size_t AsyncEventSource::count() const
+{
+  size_t n = 0;
+
+  for (size_t i = 0; i < _clients.size(); i++)
+  {
+    if (_clients[i]->connected())
+      n++;
+  }
+
+  return n;
+}
+
+size_t AsyncEventSource::avgPacketsWaiting() const
+{
+  size_t waiting = 0;
+  size_t n       = 0;
+
+  for (size_t i = 0; i < _clients.size(); i++)
+  {
+    if (_clients[i]->connected())
+    {
+      waiting += _clients[i]->packetsWaiting();
+      n++;
+    }
+  }
+
+  return n ? (waiting + n - 1) / n : 0;
+}
+
+bool AsyncEventSource::canHandle(AsyncWebServerRequest *request)
+{
+  return request->method() == HTTP_GET && request->url() == _url;
+}
+
+void AsyncEventSource::handleRequest(AsyncWebServerRequest *request)
+{
+  AsyncEventSourceClient *client = new AsyncEventSourceClient(request, this);
+
+  request->onDisconnect([client]()
+  {
+    if (client->_server)
+      client->_server->removeClient(client);
+  });
+
+  request->send(new AsyncEventSourceResponse(client));
+  _clients.push_back(client);
+
+  if (_connectcb)
+    _connectcb(client);
+}
+
+void AsyncEventSource::removeClient(AsyncEventSourceClient *client)
+{
+  client->_server     = NULL;
+  client->_connected  = false;
+
+  _clients.erase(std::remove(_clients.begin(), _clients.end(), client), _clients.end());
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// AsyncEventSourceResponse
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+AsyncEventSourceResponse::AsyncEventSourceResponse(AsyncEventSourceClient *client) : _client(client)
+{
+  _code               = 200;
+  _contentType        = "text/event-stream";
+  _sendContentLength  = false;
+
+  addHeader("Cache-Control", "no-cache");
+}
+
+AsyncEventSourceResponse::~AsyncEventSourceResponse()
+{
+  if (_client->_server)
+    _client->_server->removeClient(_client);
+
+  delete _client;
+}
+
+size_t AsyncEventSourceResponse::fill(uint8_t *buffer, size_t maxLen, size_t index)
+{
+  (void) index;
+
+  if (_client->_queue.empty())
+    return _client->_connected ? RESPONSE_TRY_AGAIN : 0;
+
+  size_t n = std::min(maxLen, _client->_queue.size());
+
+  memcpy(buffer, _client->_queue.data(), n);
+  _client->_queue.erase(0, n);
+
+  if (_client->_queue.empty())
+    _client->_packets = 0;
+
+  return n;
+}
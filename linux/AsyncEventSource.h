@@ -0,0 +1,126 @@
+/*
+  AsyncEventSource.h
+  Host (Linux) build
+
+  Server-Sent Events the way ESPAsyncWebServer does them: a handler on one URL whose responses never end, events sent
+  to every client are queued per client and go out as the connection is pumped. A client that falls more than
+  SSE_MAX_QUEUED_MESSAGES behind loses the newest ones.
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#pragma once
+
+#include "ESPAsyncWebServer.h"
+
+#include <string>
+#include <vector>
+
+#define SSE_MAX_QUEUED_MESSAGES     32
+
+class AsyncEventSource;
+class AsyncEventSourceResponse;
+class AsyncEventSourceClient;
+
+typedef std::function<void(AsyncEventSourceClient *client)> ArEventHandlerFunction;
+
+class AsyncEventSourceClient
+{
+  friend class AsyncEventSource;
+  friend class AsyncEventSourceResponse;
+
+  public:
+
+    AsyncEventSourceClient(AsyncWebServerRequest *request, AsyncEventSource *server);
+
+    AsyncClient*  client()
+    {
+      return _client;
+    }
+
+    void          close();
+    void          write(const char *message, size_t len);
+    void          send(const char *message, const char *event = NULL, uint32_t id = 0, uint32_t reconnect = 0);
+
+    bool          connected() const
+    {
+      return _connected;
+    }
+
+    uint32_t      lastId() const
+    {
+      return _lastId;
+    }
+
+    size_t        packetsWaiting() const
+    {
+      return _packets;
+    }
+
+  private:
+
+    AsyncClient       *_client;
+    AsyncEventSource  *_server;             // NULL once the source is gone
+    uint32_t          _lastId;
+    bool              _connected;
+    std::string       _queue;
+    size_t            _packets;
+};
+
+class AsyncEventSource : public AsyncWebHandler
+{
+  friend class AsyncEventSourceClient;
+  friend class AsyncEventSourceResponse;
+
+  public:
+
+    AsyncEventSource(const String &url);
+    ~AsyncEventSource();
+
+    const char*   url() const
+    {
+      return _url.c_str();
+    }
+
+    void          close();
+    void          onConnect(ArEventHandlerFunction cb);
+    void          send(const char *message, const char *event = NULL, uint32_t id = 0, uint32_t reconnect = 0);
+    // Connected clients
+    size_t        count() const;
+    size_t        avgPacketsWaiting() const;
+
+    virtual bool  canHandle(AsyncWebServerRequest *request) override;
+    virtual void  handleRequest(AsyncWebServerRequest *request) override;
+
+    virtual bool  isRequestHandlerTrivial() override
+    {
+      return false;
+    }
+
+  private:
+
+    void          removeClient(AsyncEventSourceClient *client);
+
+    String                                _url;
+    std::vector<AsyncEventSourceClient *> _clients;
+    ArEventHandlerFunction                _connectcb;
+};
+
+// Owns its client, the stream ends once the client is closed
+class AsyncEventSourceResponse : public AsyncWebServerResponse
+{
+  public:
+
+    AsyncEventSourceResponse(AsyncEventSourceClient *client);
+    ~AsyncEventSourceResponse();
+
+  protected:
+
+    virtual size_t      fill(uint8_t *buffer, size_t maxLen, size_t index) override;
+
+  private:
+
+    AsyncEventSourceClient  *_client;
+};
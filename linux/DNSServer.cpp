@@ -0,0 +1,132 @@
+/*
+  DNSServer.cpp
+  Host (Linux) build
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#include "DNSServer.h"
+
+#define DNS_HEADER_SIZE     12
+
+DNSServer::DNSServer() : _port(0), _ttl(60), _errorReplyCode(DNSReplyCode::NonExistentDomain)
+{
+  memset(_resolvedIP, 0, sizeof(_resolvedIP));
+}
+
+bool DNSServer::start(const uint16_t &port, const String &domainName, const IPAddress &resolvedIP)
+{
+  _port       = port;
+  _domainName = domainName;
+  _domainName.toLowerCase();
+
+  _resolvedIP[0] = resolvedIP[0];
+  _resolvedIP[1] = resolvedIP[1];
+  _resolvedIP[2] = resolvedIP[2];
+  _resolvedIP[3] = resolvedIP[3];
+
+  return _udp.begin(_port) == 1;
+}
+
+void DNSServer::stop()
+{
+  _udp.stop();
+}
+
+void DNSServer::setErrorReplyCode(const DNSReplyCode &replyCode)
+{
+  _errorReplyCode = replyCode;
+}
+
+void DNSServer::setTTL(const uint32_t &ttl)
+{
+  _ttl = ttl;
+}
+
+bool DNSServer::requestIncludesOnlyOneQuestion(const uint8_t *buffer, size_t len)
+{
+  (void) len;
+
+  // QDCOUNT 1, no answers or authority records
+  return buffer[4] == 0 && buffer[5] == 1 && buffer[6] == 0 && buffer[7] == 0 && buffer[8] == 0 && buffer[9] == 0;
+}
+
+String DNSServer::questionName(const uint8_t *buffer, size_t len, size_t &end)
+{
+  String  name;
+  size_t  p = DNS_HEADER_SIZE;
+
+  while (p < len && buffer[p] != 0)
+  {
+    uint8_t label = buffer[p++];
+
+    if (label & 0xC0 || p + label > len)
+    {
+      end = 0;
+      return String();
+    }
+
+    if (name.length())
+      name += '.';
+
+    name.concat((const char *) &buffer[p], label);
+    p += label;
+  }
+
+  end = p + 1 + 4;
+  name.toLowerCase();
+
+  return name;
+}
+
+void DNSServer::processNextRequest()
+{
+  int len = _udp.parsePacket();
+
+  if (len < DNS_HEADER_SIZE)
+    return;
+
+  uint8_t buffer[HOST_UDP_MAX_PACKET];
+
+  _udp.read(buffer, len);
+
+  // Queries only
+  if (buffer[2] & 0x80)
+    return;
+
+  size_t  end   = 0;
+  String  name  = questionName(buffer, len, end);
+  bool    match = (end != 0 && end <= (size_t) len) && (_domainName == "*" || name == _domainName);
+
+  _udp.beginPacket(_udp.remoteIP(), _udp.remotePort());
+
+  if (match && (buffer[2] & 0x78) == 0 && requestIncludesOnlyOneQuestion(buffer, len))
+  {
+    static const uint8_t tail[] = { 0xC0, 0x0C, 0x00, 0x01, 0x00, 0x01 };
+
+    buffer[2] = 0x84 | (buffer[2] & 0x01);
+    buffer[3] = 0x00;
+    buffer[7] = 0x01;
+
+    uint8_t ttl[4] = { (uint8_t) (_ttl >> 24), (uint8_t) (_ttl >> 16), (uint8_t) (_ttl >> 8), (uint8_t) _ttl };
+    uint8_t rdlen[2] = { 0x00, 0x04 };
+
+    _udp.write(buffer, end);
+    _udp.write(tail, sizeof(tail));
+    _udp.write(ttl, sizeof(ttl));
+    _udp.write(rdlen, sizeof(rdlen));
+    _udp.write(_resolvedIP, sizeof(_resolvedIP));
+  }
+  else
+  {
+    buffer[2] = 0x80 | (buffer[2] & 0x79);
+    buffer[3] = (uint8_t) _errorReplyCode;
+    memset(&buffer[4], 0, 8);
+
+    _udp.write(buffer, DNS_HEADER_SIZE);
+  }
+
+  _udp.endPacket();
+}
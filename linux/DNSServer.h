@@ -0,0 +1,54 @@
+/*
+  DNSServer.h
+  Host (Linux) build
+
+  The ESP8266 core's DNSServer - one query per processNextRequest(), every name ("*") or one domain resolved
+  to a single IP, everything else answered with the error reply code.
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#pragma once
+
+#include "WiFiUdp.h"
+
+enum class DNSReplyCode
+{
+  NoError           = 0,
+  FormError         = 1,
+  ServerFailure     = 2,
+  NonExistentDomain = 3,
+  NotImplemented    = 4,
+  Refused           = 5,
+  YXDomain          = 6,
+  YXRRSet           = 7,
+  NXRRSet           = 8
+};
+
+class DNSServer
+{
+  public:
+
+    DNSServer();
+
+    void          processNextRequest();
+    void          setErrorReplyCode(const DNSReplyCode &replyCode);
+    void          setTTL(const uint32_t &ttl);
+
+    bool          start(const uint16_t &port, const String &domainName, const IPAddress &resolvedIP);
+    void          stop();
+
+  private:
+
+    bool          requestIncludesOnlyOneQuestion(const uint8_t *buffer, size_t len);
+    String        questionName(const uint8_t *buffer, size_t len, size_t &end);
+
+    WiFiUDP       _udp;
+    uint16_t      _port;
+    String        _domainName;
+    uint8_t       _resolvedIP[4];
+    uint32_t      _ttl;
+    DNSReplyCode  _errorReplyCode;
+};
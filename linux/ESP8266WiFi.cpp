@@ -0,0 +1,1467 @@
+/*
+  ESP8266WiFi.cpp
+  Host (Linux) build
+
+  The simulated hostRadio(). Connection state moves on when status() (or the SDK status call) is polled, the way the
+  SDK's state changes become visible to the sketch between loop() calls. The steps of a connect (association, DHCP)
+  are timed from when the previous one was due, not from when it was noticed, so polling less often never makes a
+  connect look slower.
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#include "ESP8266WiFi.h"
+#include "EncompassCrypto.h"
+#include "HostLoop.h"
+#include "lwip/dns.h"
+
+extern "C"
+{
+  #include "user_interface.h"
+}
+
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <strings.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+ESP8266WiFiClass WiFi;
+
+struct HostRSSIPoint
+{
+  uint32_t    atMs;
+  int32_t     rssi;
+};
+
+struct HostNetwork
+{
+  std::string                 ssid;
+  std::string                 passphrase;
+  std::string                 psk;            // 64 hex digits, derived from the passphrase on the first connect
+  uint8_t                     enc;
+  uint8_t                     channel;
+  uint8_t                     bssid[6];
+  bool                        hidden;
+  std::vector<HostRSSIPoint>  rssi;           // Sorted by atMs, never empty
+  int32_t                     connectMs;
+  uint32_t                    dhcpMs;
+  uint8_t                     authFailures;
+  bool                        dhcpFails;
+};
+
+struct HostScanResult
+{
+  String      ssid;
+  uint8_t     enc;
+  int32_t     rssi;
+  uint8_t     bssid[6];
+  int32_t     channel;
+  bool        hidden;
+};
+
+struct HostRadio
+{
+  bool                          loaded;
+  WiFiMode_t                    mode;
+  bool                          persistent;
+  bool                          autoConnect;
+  bool                          autoReconnect;
+  uint32_t                      scanMs;
+  uint32_t                      connectMs;
+  uint32_t                      epoch;          // millis() the RSSI timelines start from
+  uint32_t                      seed;           // Jitter sequence
+  uint8_t                       jitter;
+  HostRadioStats                stats;
+
+  std::vector<HostNetwork>      networks;
+  std::vector<HostScanResult>   results;
+  bool                          scanRunning;
+  uint32_t                      scanDoneAt;
+
+  // Station
+  struct station_config         current;
+  struct station_config         saved;
+  uint8                         sdkStatus;
+  uint32_t                      connectAt;      // Association due
+  uint32_t                      dhcpAt;         // Address due, once associated
+  uint32_t                      upAt;           // Got the address - the link is watched from here on
+  int                           target;         // Index in networks being associated with
+  int                           network;        // Index in networks once associated
+  IPAddress                     staticIP, staticGW, staticSN, staticDNS1, staticDNS2;
+  IPAddress                     ip, gw, sn, dns1, dns2;
+  String                        hostname;
+
+  // Soft AP
+  String                        apSSID;
+  String                        apPSK;
+  uint8_t                       apChannel;
+  IPAddress                     apIP, apGW, apSN;
+  uint32_t                      apStartMs;
+  uint32_t                      apUpAt;         // softAPIP() answers 0.0.0.0 until then
+};
+
+// Constructed on first use - sketch globals (an Encompass instance) already call into WiFi from their constructors
+static HostRadio& hostRadio()
+{
+  static HostRadio radio;
+  return radio;
+}
+
+static uint8_t hostSTAMAC[6]  = { 0x18, 0xFE, 0x34, 0xC0, 0xFF, 0xEE };
+static uint8_t hostAPMAC[6]   = { 0x1A, 0xFE, 0x34, 0xC0, 0xFF, 0xEE };
+
+static String hostMACString(const uint8_t *mac)
+{
+  char buf[18];
+
+  snprintf(buf, sizeof(buf), "%02X:%02X:%02X:%02X:%02X:%02X", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+
+  return String(buf);
+}
+
+static uint32_t hostEnvMs(const char *name, uint32_t def)
+{
+  const char *env = getenv(name);
+
+  return env ? strtoul(env, NULL, 10) : def;
+}
+
+static void hostFlashSave()
+{
+  const char *path = getenv("ENCOMPASS_HOST_FLASH");
+
+  if (path == NULL)
+    return;
+
+  FILE *f = fopen(path, "wb");
+
+  if (f)
+  {
+    fwrite(&hostRadio().saved, sizeof(hostRadio().saved), 1, f);
+    fclose(f);
+  }
+}
+
+static void hostFlashLoad()
+{
+  const char *path = getenv("ENCOMPASS_HOST_FLASH");
+
+  if (path == NULL)
+    return;
+
+  FILE *f = fopen(path, "rb");
+
+  if (f)
+  {
+    if (fread(&hostRadio().saved, sizeof(hostRadio().saved), 1, f) != 1)
+      memset(&hostRadio().saved, 0, sizeof(hostRadio().saved));
+
+    fclose(f);
+  }
+}
+
+static void hostLoadNetworks()
+{
+  const char *env = getenv("ENCOMPASS_HOST_NETWORKS");
+
+  if (env == NULL)
+  {
+    // A home network seen through two APs (for duplicate removal), a neighbour and an open hotspot
+    WiFi.hostAddNetwork("HomeNet",    "password123", -58, 6);
+    WiFi.hostAddNetwork("HomeNet",    "password123", -81, 11);
+    WiFi.hostAddNetwork("Neighbour",  "letmein!",    -74, 1);
+    WiFi.hostAddNetwork("Cafe Free",  "",            -86, 11);
+    return;
+  }
+
+  String list(env);
+  int    start = 0;
+
+  while (start < (int) list.length())
+  {
+    int end = list.indexOf(';', start);
+
+    if (end < 0)
+      end = list.length();
+
+    String  item    = list.substring(start, end);
+    int     c1      = item.indexOf(':');
+    int     c2      = (c1 >= 0) ? item.indexOf(':', c1 + 1) : -1;
+    int     c3      = (c2 >= 0) ? item.indexOf(':', c2 + 1) : -1;
+
+    if (c1 > 0)
+    {
+      String  ssid    = item.substring(0, c1);
+      String  pass    = (c2 > 0) ? item.substring(c1 + 1, c2) : item.substring(c1 + 1);
+      int32_t rssi    = (c2 > 0) ? item.substring(c2 + 1, (c3 > 0) ? c3 : item.length()).toInt() : -60;
+      uint8_t channel = (c3 > 0) ? item.substring(c3 + 1).toInt() : 1;
+
+      WiFi.hostAddNetwork(ssid.c_str(), pass.c_str(), rssi, channel);
+    }
+
+    start = end + 1;
+  }
+}
+
+// xorshift32 - the radio's own sequence, so the sketch's random() calls do not change what a scan returns
+static int32_t hostJitter()
+{
+  uint32_t &x = hostRadio().seed;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+
+  return hostRadio().jitter ? (int32_t) (x % (2 * hostRadio().jitter + 1)) - hostRadio().jitter : 0;
+}
+
+static void hostRadioDefaults(uint32_t seed)
+{
+  hostRadio().loaded        = true;
+  hostRadio().mode          = WIFI_STA;
+  hostRadio().persistent    = true;
+  hostRadio().autoConnect   = true;
+  hostRadio().autoReconnect = true;
+  hostRadio().scanMs        = hostEnvMs("ENCOMPASS_HOST_SCAN_MS", 2100);
+  hostRadio().connectMs     = hostEnvMs("ENCOMPASS_HOST_CONNECT_MS", 3000);
+  hostRadio().epoch         = millis();
+  hostRadio().seed          = seed ? seed : 1;
+  hostRadio().jitter        = 3;
+  hostRadio().sdkStatus     = STATION_IDLE;
+  hostRadio().target        = -1;
+  hostRadio().network       = -1;
+  hostRadio().hostname      = "ESP-C0FFEE";
+  hostRadio().apChannel     = 1;
+  hostRadio().apIP          = IPAddress(192, 168, 4, 1);
+  hostRadio().apGW          = IPAddress(192, 168, 4, 1);
+  hostRadio().apSN          = IPAddress(255, 255, 255, 0);
+  hostRadio().apStartMs     = hostEnvMs("ENCOMPASS_HOST_AP_START_MS", 0);
+  hostRadio().apUpAt        = millis();
+}
+
+static void hostRadioInit()
+{
+  if (hostRadio().loaded)
+    return;
+
+  hostRadioDefaults(1);
+  hostFlashLoad();
+  memcpy(&hostRadio().current, &hostRadio().saved, sizeof(hostRadio().current));
+
+  hostLoadNetworks();
+}
+
+// The AP's RSSI at millis() now, from its timeline
+static int32_t hostRSSIAt(const HostNetwork &n, uint32_t now)
+{
+  uint32_t t = now - hostRadio().epoch;
+
+  if (t <= n.rssi.front().atMs)
+    return n.rssi.front().rssi;
+
+  for (size_t i = 1; i < n.rssi.size(); i++)
+  {
+    const HostRSSIPoint &a = n.rssi[i - 1];
+    const HostRSSIPoint &b = n.rssi[i];
+
+    if (t < b.atMs)
+      return a.rssi + (int32_t) ((int64_t) (b.rssi - a.rssi) * (t - a.atMs) / (b.atMs - a.atMs));
+  }
+
+  return n.rssi.back().rssi;
+}
+
+static bool hostInRange(const HostNetwork &n, uint32_t now)
+{
+  return hostRSSIAt(n, now) > HOST_RSSI_OUT_OF_RANGE;
+}
+
+// The first millis() in [from, to] the AP is out of range at, false if it stays in range
+static bool hostOutOfRangeAt(const HostNetwork &n, uint32_t from, uint32_t to, uint32_t &at)
+{
+  if (!hostInRange(n, from))
+  {
+    at = from;
+    return true;
+  }
+
+  uint32_t t0 = from - hostRadio().epoch;
+  uint32_t t1 = to - hostRadio().epoch;
+
+  // In range at t0, so the first segment ending out of range crosses over - where the interpolation first says so
+  for (size_t i = 1; i < n.rssi.size(); i++)
+  {
+    const HostRSSIPoint &a = n.rssi[i - 1];
+    const HostRSSIPoint &b = n.rssi[i];
+
+    if (b.atMs <= t0 || b.rssi > HOST_RSSI_OUT_OF_RANGE)
+      continue;
+
+    uint64_t num  = (uint64_t) (a.rssi - HOST_RSSI_OUT_OF_RANGE) * (b.atMs - a.atMs);
+    uint64_t den  = a.rssi - b.rssi;
+    uint32_t t    = std::max(t0, a.atMs + (uint32_t) ((num + den - 1) / den));
+
+    if (t > t1)
+      return false;
+
+    at = hostRadio().epoch + t;
+
+    return true;
+  }
+
+  return false;
+}
+
+static int hostFindNetwork(const std::string &ssid, const uint8_t *bssid, uint32_t now)
+{
+  int     best      = -1;
+  int32_t bestRSSI  = 0;
+
+  for (size_t i = 0; i < hostRadio().networks.size(); i++)
+  {
+    const HostNetwork &n    = hostRadio().networks[i];
+    int32_t           rssi  = hostRSSIAt(n, now);
+
+    if (n.ssid != ssid || rssi <= HOST_RSSI_OUT_OF_RANGE)
+      continue;
+
+    if (bssid && memcmp(bssid, n.bssid, 6) != 0)
+      continue;
+
+    // Like the SDK, the strongest AP of an SSID unless a BSSID was given
+    if (best < 0 || rssi > bestRSSI)
+    {
+      best      = i;
+      bestRSSI  = rssi;
+    }
+  }
+
+  return best;
+}
+
+static std::string hostConfigString(const uint8_t *field, size_t size)
+{
+  // The SDK's fields are not terminated when full
+  return std::string((const char *) field, strnlen((const char *) field, size));
+}
+
+// An attempt starting at millis() now
+static void hostStartConnect(uint32_t now)
+{
+  HostRadio   &radio  = hostRadio();
+
+  radio.network   = -1;
+  radio.ip        = (uint32_t) 0;
+  radio.sdkStatus = radio.current.ssid[0] ? STATION_CONNECTING : STATION_IDLE;
+
+  if (radio.sdkStatus == STATION_IDLE)
+    return;
+
+  // The AP is picked when the attempt starts and its association time applies - no AP, the radio's
+  std::string ssid = hostConfigString(radio.current.ssid, sizeof(radio.current.ssid));
+
+  radio.target    = hostFindNetwork(ssid, radio.current.bssid_set ? radio.current.bssid : NULL, now);
+  radio.connectAt = now + ((radio.target >= 0 && radio.networks[radio.target].connectMs >= 0) ?
+                           (uint32_t) radio.networks[radio.target].connectMs : radio.connectMs);
+
+  radio.stats.connects++;
+}
+
+static void hostGotIP()
+{
+  HostRadio &radio = hostRadio();
+
+  radio.sdkStatus = STATION_GOT_IP;
+
+  if (radio.staticIP.isSet())
+  {
+    radio.ip    = radio.staticIP;
+    radio.gw    = radio.staticGW;
+    radio.sn    = radio.staticSN;
+    radio.dns1  = radio.staticDNS1.isSet() ? radio.staticDNS1 : radio.staticGW;
+    radio.dns2  = radio.staticDNS2;
+  }
+  else
+  {
+    radio.ip    = IPAddress(192, 168, 1, 100 + radio.network);
+    radio.gw    = IPAddress(192, 168, 1, 1);
+    radio.sn    = IPAddress(255, 255, 255, 0);
+    radio.dns1  = IPAddress(192, 168, 1, 1);
+    radio.dns2  = (uint32_t) 0;
+  }
+}
+
+// A station may give the passphrase or, as the SDK also takes, the PSK derived from it
+static bool hostKeyMatches(HostNetwork &network, const std::string &key)
+{
+  if (key.size() != 2 * WPA_PSK_SIZE || network.passphrase.size() < 8 || network.passphrase.size() > 63)
+    return network.passphrase == key;
+
+  if (network.psk.empty())
+  {
+    uint8_t psk[WPA_PSK_SIZE];
+    char    hex[3];
+
+    EncompassPBKDF2::derive(network.passphrase.data(), network.passphrase.size(), network.ssid.data(),
+                            network.ssid.size(), WPA_PSK_ITERATIONS, psk, sizeof(psk));
+
+    for (uint8_t i = 0; i < WPA_PSK_SIZE; i++)
+    {
+      snprintf(hex, sizeof(hex), "%02x", psk[i]);
+      network.psk += hex;
+    }
+  }
+
+  return strcasecmp(network.psk.c_str(), key.c_str()) == 0;
+}
+
+// Association, then DHCP - true once the address is in, false while a step is still due or the attempt failed
+static bool hostConnectStep(uint32_t now)
+{
+  HostRadio &radio = hostRadio();
+
+  if (radio.network < 0)
+  {
+    if ((int32_t) (now - radio.connectAt) < 0)
+      return false;
+
+    std::string psk = hostConfigString(radio.current.password, sizeof(radio.current.password));
+    int         ap  = radio.target;
+
+    if (ap < 0 || !hostInRange(radio.networks[ap], radio.connectAt))
+    {
+      radio.sdkStatus = STATION_NO_AP_FOUND;
+      return false;
+    }
+
+    if (!hostKeyMatches(radio.networks[ap], psk))
+    {
+      radio.sdkStatus = STATION_WRONG_PASSWORD;
+      return false;
+    }
+
+    if (radio.networks[ap].authFailures)
+    {
+      radio.networks[ap].authFailures--;
+      radio.stats.authFailures++;
+      radio.sdkStatus = STATION_CONNECT_FAIL;
+      return false;
+    }
+
+    radio.network = ap;
+    radio.dhcpAt  = radio.connectAt + (radio.staticIP.isSet() ? 0 : radio.networks[ap].dhcpMs);
+  }
+
+  // Waiting for an address
+  if ((int32_t) (now - radio.dhcpAt) < 0 || (radio.networks[radio.network].dhcpFails && !radio.staticIP.isSet()))
+    return false;
+
+  return true;
+}
+
+// Plays the connection forward to millis() now - pending connect steps, and a link lost when its AP goes out of range
+// (and the reconnect after it), each at the time it was due
+static void hostRadioUpdate()
+{
+  hostRadioInit();
+
+  HostRadio   &radio  = hostRadio();
+  uint32_t    now     = millis();
+
+  while (true)
+  {
+    uint32_t lostAt;
+
+    if (radio.sdkStatus == STATION_GOT_IP && radio.network >= 0)
+    {
+      if (!hostOutOfRangeAt(radio.networks[radio.network], radio.upAt, now, lostAt))
+        return;
+
+      radio.stats.linkLosses++;
+
+      // The SDK starts over by itself when auto reconnect is on
+      if (!radio.autoReconnect)
+      {
+        radio.sdkStatus = STATION_IDLE;
+        radio.network   = -1;
+        radio.ip        = (uint32_t) 0;
+        return;
+      }
+
+      hostStartConnect(lostAt);
+    }
+
+    if (radio.sdkStatus != STATION_CONNECTING)
+      return;
+
+    if (!(radio.mode & WIFI_STA))
+    {
+      radio.sdkStatus = STATION_IDLE;
+      return;
+    }
+
+    if (!hostConnectStep(now))
+      return;
+
+    hostGotIP();
+    radio.upAt = radio.dhcpAt;
+  }
+}
+
+
+static void hostSetConfig(const char *ssid, const char *passphrase, const uint8_t *bssid)
+{
+  struct station_config conf;
+
+  memset(&conf, 0, sizeof(conf));
+
+  if (ssid)
+    strncpy((char *) conf.ssid, ssid, sizeof(conf.ssid));
+
+  if (passphrase)
+    strncpy((char *) conf.password, passphrase, sizeof(conf.password));
+
+  if (bssid)
+  {
+    conf.bssid_set = 1;
+    memcpy(conf.bssid, bssid, 6);
+  }
+
+  if (hostRadio().persistent)
+    wifi_station_set_config(&conf);
+  else
+    wifi_station_set_config_current(&conf);
+}
+
+ESP8266WiFiClass::ESP8266WiFiClass()
+{
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Generic
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool ESP8266WiFiClass::mode(WiFiMode_t m)
+{
+  hostRadioInit();
+
+  if ((hostRadio().mode & WIFI_STA) && !(m & WIFI_STA))
+  {
+    hostRadio().sdkStatus = STATION_IDLE;
+    hostRadio().network   = -1;
+    hostRadio().ip        = (uint32_t) 0;
+  }
+  else if (!(hostRadio().mode & WIFI_STA) && (m & WIFI_STA) && hostRadio().autoConnect && hostRadio().current.ssid[0])
+  {
+    // The SDK reconnects to the stored network as soon as the station interface comes up
+    hostStartConnect(millis());
+  }
+
+  hostRadio().mode = m;
+
+  return true;
+}
+
+WiFiMode_t ESP8266WiFiClass::getMode()
+{
+  hostRadioInit();
+  return hostRadio().mode;
+}
+
+bool ESP8266WiFiClass::enableSTA(bool enable)
+{
+  WiFiMode_t m = getMode();
+
+  return mode((WiFiMode_t) (enable ? (m | WIFI_STA) : (m & ~WIFI_STA)));
+}
+
+bool ESP8266WiFiClass::enableAP(bool enable)
+{
+  WiFiMode_t m = getMode();
+
+  return mode((WiFiMode_t) (enable ? (m | WIFI_AP) : (m & ~WIFI_AP)));
+}
+
+void ESP8266WiFiClass::persistent(bool persistent)
+{
+  hostRadioInit();
+  hostRadio().persistent = persistent;
+}
+
+bool ESP8266WiFiClass::getPersistent()
+{
+  hostRadioInit();
+  return hostRadio().persistent;
+}
+
+bool ESP8266WiFiClass::setSleepMode(int type, uint8_t listenInterval)
+{
+  (void) type;
+  (void) listenInterval;
+  return true;
+}
+
+void ESP8266WiFiClass::setOutputPower(float dBm)
+{
+  (void) dBm;
+}
+
+int ESP8266WiFiClass::hostByName(const char *hostname, IPAddress &result)
+{
+  struct addrinfo hints;
+  struct addrinfo *res = NULL;
+
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+
+  if (!isConnected() || getaddrinfo(hostname, NULL, &hints, &res) != 0 || res == NULL)
+    return 0;
+
+  result = (uint32_t) ((struct sockaddr_in *) res->ai_addr)->sin_addr.s_addr;
+  freeaddrinfo(res);
+
+  return 1;
+}
+
+// Answers dns_gethostbyname() has for the next hostPoll(), signalled through a pipe so poll() wakes up for them
+class HostDNS : public HostPollable
+{
+  public:
+
+    struct Answer
+    {
+      std::string         name;
+      ip_addr_t           addr;
+      bool                found;
+      dns_found_callback  callback;
+      void                *arg;
+    };
+
+    HostDNS()
+    {
+      if (pipe(_pipe) == 0)
+      {
+        fcntl(_pipe[0], F_SETFL, fcntl(_pipe[0], F_GETFL) | O_NONBLOCK);
+        fcntl(_pipe[1], F_SETFL, fcntl(_pipe[1], F_GETFL) | O_NONBLOCK);
+        hostRegisterPollable(this);
+      }
+    }
+
+    void queue(const Answer &answer)
+    {
+      _answers.push_back(answer);
+
+      // A full pipe has a wake-up pending already
+      if (write(_pipe[1], "", 1) < 0)
+        return;
+    }
+
+    int pollFds(struct pollfd *fds, int room) override
+    {
+      if (room < 1)
+        return 0;
+
+      fds[0].fd     = _pipe[0];
+      fds[0].events = POLLIN;
+
+      return 1;
+    }
+
+    void pollDone(struct pollfd *fds, int count) override
+    {
+      char drain[16];
+
+      if (count < 1 || !(fds[0].revents & POLLIN))
+        return;
+
+      while (read(_pipe[0], drain, sizeof(drain)) > 0)
+        ;
+
+      // A callback may start another lookup
+      std::vector<Answer> answers;
+
+      answers.swap(_answers);
+
+      for (size_t i = 0; i < answers.size(); i++)
+        answers[i].callback(answers[i].name.c_str(), answers[i].found ? &answers[i].addr : NULL, answers[i].arg);
+    }
+
+  private:
+
+    int                 _pipe[2];
+    std::vector<Answer> _answers;
+};
+
+err_t dns_gethostbyname(const char *hostname, ip_addr_t *addr, dns_found_callback found, void *callback_arg)
+{
+  static HostDNS  dns;
+  struct in_addr  literal;
+
+  if (hostname == NULL || *hostname == 0 || found == NULL)
+    return ERR_ARG;
+
+  if (inet_pton(AF_INET, hostname, &literal) == 1)
+  {
+    addr->addr = literal.s_addr;
+    return ERR_OK;
+  }
+
+  HostDNS::Answer answer;
+  IPAddress       ip;
+
+  answer.name     = hostname;
+  answer.found    = WiFi.hostByName(hostname, ip) == 1;
+  answer.addr     = { (uint32_t) ip };
+  answer.callback = found;
+  answer.arg      = callback_arg;
+
+  dns.queue(answer);
+
+  return ERR_INPROGRESS;
+}
+
+int32_t ESP8266WiFiClass::channel()
+{
+  hostRadioUpdate();
+
+  if (hostRadio().network >= 0)
+    return hostRadio().networks[hostRadio().network].channel;
+
+  return (hostRadio().mode & WIFI_AP) ? hostRadio().apChannel : 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Station
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+wl_status_t ESP8266WiFiClass::begin(const char *ssid, const char *passphrase, int32_t channel, const uint8_t *bssid, bool connect)
+{
+  (void) channel;
+
+  hostRadioInit();
+
+  if (!enableSTA(true))
+    return WL_CONNECT_FAILED;
+
+  if (!ssid || !*ssid || strlen(ssid) > WL_SSID_MAX_LENGTH)
+    return WL_CONNECT_FAILED;
+
+  if (passphrase && strlen(passphrase) > 64)
+    return WL_CONNECT_FAILED;
+
+  hostSetConfig(ssid, passphrase, bssid);
+
+  if (connect)
+    hostStartConnect(millis());
+
+  return status();
+}
+
+wl_status_t ESP8266WiFiClass::begin(const String &ssid, const String &passphrase, int32_t channel, const uint8_t *bssid,
+                                    bool connect)
+{
+  return begin(ssid.c_str(), passphrase.c_str(), channel, bssid, connect);
+}
+
+wl_status_t ESP8266WiFiClass::begin()
+{
+  hostRadioInit();
+
+  if (!enableSTA(true))
+    return WL_CONNECT_FAILED;
+
+  hostStartConnect(millis());
+
+  return status();
+}
+
+bool ESP8266WiFiClass::config(IPAddress local_ip, IPAddress gateway, IPAddress subnet, IPAddress dns1, IPAddress dns2)
+{
+  hostRadioInit();
+
+  hostRadio().staticIP    = local_ip;
+  hostRadio().staticGW    = gateway;
+  hostRadio().staticSN    = subnet;
+  hostRadio().staticDNS1  = dns1;
+  hostRadio().staticDNS2  = dns2;
+
+  return true;
+}
+
+bool ESP8266WiFiClass::reconnect()
+{
+  if ((getMode() & WIFI_STA) == 0)
+    return false;
+
+  hostStartConnect(millis());
+
+  return true;
+}
+
+bool ESP8266WiFiClass::disconnect(bool wifioff)
+{
+  hostRadioInit();
+
+  // Like the core, disconnect() also forgets the network
+  hostSetConfig(NULL, NULL, NULL);
+  wifi_station_disconnect();
+
+  if (wifioff)
+    enableSTA(false);
+
+  return true;
+}
+
+bool ESP8266WiFiClass::isConnected()
+{
+  return status() == WL_CONNECTED;
+}
+
+bool ESP8266WiFiClass::setAutoConnect(bool autoConnect)
+{
+  hostRadioInit();
+  hostRadio().autoConnect = autoConnect;
+  return true;
+}
+
+bool ESP8266WiFiClass::getAutoConnect()
+{
+  hostRadioInit();
+  return hostRadio().autoConnect;
+}
+
+bool ESP8266WiFiClass::setAutoReconnect(bool autoReconnect)
+{
+  hostRadioInit();
+  hostRadio().autoReconnect = autoReconnect;
+  return true;
+}
+
+bool ESP8266WiFiClass::getAutoReconnect()
+{
+  hostRadioInit();
+  return hostRadio().autoReconnect;
+}
+
+int8_t ESP8266WiFiClass::waitForConnectResult(unsigned long timeoutLength)
+{
+  if ((getMode() & WIFI_STA) == 0)
+    return WL_DISCONNECTED;
+
+  unsigned long start = millis();
+
+  while (status() == WL_DISCONNECTED)
+  {
+    if (millis() - start >= timeoutLength)
+      return -1;
+
+    delay(100);
+  }
+
+  return status();
+}
+
+IPAddress ESP8266WiFiClass::localIP()
+{
+  hostRadioUpdate();
+  return hostRadio().ip;
+}
+
+uint8_t* ESP8266WiFiClass::macAddress(uint8_t *mac)
+{
+  memcpy(mac, hostSTAMAC, 6);
+  return mac;
+}
+
+String ESP8266WiFiClass::macAddress()
+{
+  return hostMACString(hostSTAMAC);
+}
+
+IPAddress ESP8266WiFiClass::subnetMask()
+{
+  hostRadioUpdate();
+  return hostRadio().sn;
+}
+
+IPAddress ESP8266WiFiClass::gatewayIP()
+{
+  hostRadioUpdate();
+  return hostRadio().gw;
+}
+
+IPAddress ESP8266WiFiClass::dnsIP(uint8_t dns_no)
+{
+  hostRadioUpdate();
+  return dns_no ? hostRadio().dns2 : hostRadio().dns1;
+}
+
+String ESP8266WiFiClass::hostname()
+{
+  hostRadioInit();
+  return hostRadio().hostname;
+}
+
+bool ESP8266WiFiClass::hostname(const char *aHostname)
+{
+  hostRadioInit();
+
+  if (aHostname == NULL || strlen(aHostname) == 0 || strlen(aHostname) > 32)
+    return false;
+
+  hostRadio().hostname = aHostname;
+
+  return true;
+}
+
+bool ESP8266WiFiClass::hostname(const String &aHostname)
+{
+  return hostname(aHostname.c_str());
+}
+
+wl_status_t ESP8266WiFiClass::status()
+{
+  switch (wifi_station_get_connect_status())
+  {
+    case STATION_GOT_IP:
+      return WL_CONNECTED;
+    case STATION_NO_AP_FOUND:
+      return WL_NO_SSID_AVAIL;
+    case STATION_CONNECT_FAIL:
+    case STATION_WRONG_PASSWORD:
+      return WL_CONNECT_FAILED;
+    case STATION_IDLE:
+      return WL_IDLE_STATUS;
+    default:
+      return WL_DISCONNECTED;
+  }
+}
+
+String ESP8266WiFiClass::SSID() const
+{
+  struct station_config conf;
+
+  wifi_station_get_config(&conf);
+
+  return String((const char *) conf.ssid, strnlen((const char *) conf.ssid, sizeof(conf.ssid)));
+}
+
+String ESP8266WiFiClass::psk() const
+{
+  struct station_config conf;
+
+  wifi_station_get_config(&conf);
+
+  return String((const char *) conf.password, strnlen((const char *) conf.password, sizeof(conf.password)));
+}
+
+uint8_t* ESP8266WiFiClass::BSSID()
+{
+  hostRadioUpdate();
+
+  static uint8_t none[6];
+
+  return (hostRadio().network >= 0) ? hostRadio().networks[hostRadio().network].bssid : none;
+}
+
+String ESP8266WiFiClass::BSSIDstr()
+{
+  return hostMACString(BSSID());
+}
+
+int32_t ESP8266WiFiClass::RSSI()
+{
+  hostRadioUpdate();
+
+  return (hostRadio().network >= 0) ? hostRSSIAt(hostRadio().networks[hostRadio().network], millis()) : 31;
+}
+
+bool ESP8266WiFiClass::beginWPSConfig(void)
+{
+  // No push button on the host
+  return false;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Soft AP
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool ESP8266WiFiClass::softAP(const char *ssid, const char *passphrase, int channel, int ssid_hidden, int max_connection)
+{
+  (void) ssid_hidden;
+  (void) max_connection;
+
+  hostRadioInit();
+
+  if (!enableAP(true))
+    return false;
+
+  if (!ssid || !*ssid || strlen(ssid) > 31)
+    return false;
+
+  // WPA2 needs 8 characters, an empty passphrase is an open AP
+  if (passphrase && *passphrase && (strlen(passphrase) < 8 || strlen(passphrase) > 63))
+    return false;
+
+  hostRadio().apSSID    = ssid;
+  hostRadio().apPSK     = passphrase ? passphrase : "";
+  hostRadio().apChannel = (channel > 0 && channel <= 13) ? channel : 1;
+  hostRadio().apUpAt    = millis() + hostRadio().apStartMs;
+
+  return true;
+}
+
+bool ESP8266WiFiClass::softAP(const String &ssid, const String &passphrase, int channel, int ssid_hidden, int max_connection)
+{
+  return softAP(ssid.c_str(), passphrase.c_str(), channel, ssid_hidden, max_connection);
+}
+
+bool ESP8266WiFiClass::softAPConfig(IPAddress local_ip, IPAddress gateway, IPAddress subnet)
+{
+  hostRadioInit();
+
+  if (!enableAP(true))
+    return false;
+
+  hostRadio().apIP = local_ip;
+  hostRadio().apGW = gateway;
+  hostRadio().apSN = subnet;
+  hostRadio().apUpAt = millis() + hostRadio().apStartMs;
+
+  return true;
+}
+
+bool ESP8266WiFiClass::softAPdisconnect(bool wifioff)
+{
+  hostRadioInit();
+
+  hostRadio().apSSID = "";
+  hostRadio().apPSK  = "";
+
+  if (wifioff)
+    enableAP(false);
+
+  return true;
+}
+
+uint8_t ESP8266WiFiClass::softAPgetStationNum()
+{
+  return wifi_softap_get_station_num();
+}
+
+IPAddress ESP8266WiFiClass::softAPIP()
+{
+  hostRadioInit();
+
+  if ((int32_t) (millis() - hostRadio().apUpAt) < 0)
+    return IPAddress();
+
+  return hostRadio().apIP;
+}
+
+uint8_t* ESP8266WiFiClass::softAPmacAddress(uint8_t *mac)
+{
+  memcpy(mac, hostAPMAC, 6);
+  return mac;
+}
+
+String ESP8266WiFiClass::softAPmacAddress(void)
+{
+  return hostMACString(hostAPMAC);
+}
+
+String ESP8266WiFiClass::softAPSSID() const
+{
+  return hostRadio().apSSID;
+}
+
+String ESP8266WiFiClass::softAPPSK() const
+{
+  return hostRadio().apPSK;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Scan
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// What the radio hears at millis() now
+static void hostScanCollect(bool showHidden, uint8_t channel, const uint8_t *ssid, uint32_t now)
+{
+  hostRadio().results.clear();
+  hostRadio().stats.scans++;
+
+  for (size_t i = 0; i < hostRadio().networks.size(); i++)
+  {
+    const HostNetwork &n    = hostRadio().networks[i];
+    int32_t           rssi  = hostRSSIAt(n, now);
+
+    if ((n.hidden && !showHidden) || (channel && n.channel != channel) || (ssid && n.ssid != (const char *) ssid))
+      continue;
+
+    if (rssi <= HOST_RSSI_OUT_OF_RANGE)
+      continue;
+
+    HostScanResult r;
+
+    r.ssid    = n.hidden ? "" : n.ssid.c_str();
+    r.enc     = n.enc;
+    r.rssi    = std::min(rssi + hostJitter(), (int32_t) -1);
+    r.channel = n.channel;
+    r.hidden  = n.hidden;
+    memcpy(r.bssid, n.bssid, 6);
+
+    hostRadio().results.push_back(r);
+  }
+}
+
+int8_t ESP8266WiFiClass::scanNetworks(bool async, bool show_hidden, uint8_t channel, uint8_t *ssid)
+{
+  hostRadioInit();
+
+  if (hostRadio().scanRunning)
+    return WIFI_SCAN_RUNNING;
+
+  if (!enableSTA(true))
+    return WIFI_SCAN_FAILED;
+
+  scanDelete();
+
+  if (async)
+  {
+    hostRadio().scanRunning = true;
+    hostRadio().scanDoneAt  = millis() + hostRadio().scanMs;
+    hostScanCollect(show_hidden, channel, ssid, hostRadio().scanDoneAt);
+
+    return WIFI_SCAN_RUNNING;
+  }
+
+  // The SDK keeps servicing the network while a synchronous scan blocks the sketch
+  delay(hostRadio().scanMs);
+  hostScanCollect(show_hidden, channel, ssid, millis());
+
+  return hostRadio().results.size();
+}
+
+int8_t ESP8266WiFiClass::scanComplete()
+{
+  hostRadioInit();
+
+  if (hostRadio().scanRunning)
+  {
+    if ((int32_t) (millis() - hostRadio().scanDoneAt) < 0)
+      return WIFI_SCAN_RUNNING;
+
+    hostRadio().scanRunning = false;
+  }
+
+  return hostRadio().results.size();
+}
+
+void ESP8266WiFiClass::scanDelete()
+{
+  hostRadio().results.clear();
+  hostRadio().scanRunning = false;
+}
+
+bool ESP8266WiFiClass::getNetworkInfo(uint8_t i, String &ssid, uint8_t &encType, int32_t &rssi, uint8_t* &bssid,
+                                      int32_t &channel, bool &isHidden)
+{
+  if (i >= hostRadio().results.size())
+    return false;
+
+  HostScanResult &r = hostRadio().results[i];
+
+  ssid      = r.ssid;
+  encType   = r.enc;
+  rssi      = r.rssi;
+  bssid     = r.bssid;
+  channel   = r.channel;
+  isHidden  = r.hidden;
+
+  return true;
+}
+
+String ESP8266WiFiClass::SSID(uint8_t i)
+{
+  return (i < hostRadio().results.size()) ? hostRadio().results[i].ssid : String();
+}
+
+uint8_t ESP8266WiFiClass::encryptionType(uint8_t i)
+{
+  return (i < hostRadio().results.size()) ? hostRadio().results[i].enc : -1;
+}
+
+int32_t ESP8266WiFiClass::RSSI(uint8_t i)
+{
+  return (i < hostRadio().results.size()) ? hostRadio().results[i].rssi : 0;
+}
+
+uint8_t* ESP8266WiFiClass::BSSID(uint8_t i)
+{
+  return (i < hostRadio().results.size()) ? hostRadio().results[i].bssid : NULL;
+}
+
+String ESP8266WiFiClass::BSSIDstr(uint8_t i)
+{
+  return (i < hostRadio().results.size()) ? hostMACString(hostRadio().results[i].bssid) : String();
+}
+
+int32_t ESP8266WiFiClass::channel(uint8_t i)
+{
+  return (i < hostRadio().results.size()) ? hostRadio().results[i].channel : 0;
+}
+
+bool ESP8266WiFiClass::isHidden(uint8_t i)
+{
+  return (i < hostRadio().results.size()) ? hostRadio().results[i].hidden : false;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Host only
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+HostAPConfig::HostAPConfig()
+{
+  ssid          = "";
+  passphrase    = NULL;
+  channel       = 1;
+  encryption    = 0;
+  hidden        = false;
+  rssi          = -60;
+  connectMs     = -1;
+  dhcpMs        = 0;
+  authFailures  = 0;
+  dhcpFails     = false;
+
+  memset(bssid, 0, sizeof(bssid));
+}
+
+void ESP8266WiFiClass::hostResetRadio(uint32_t seed)
+{
+  hostRadio() = HostRadio();
+  hostRadioDefaults(seed);
+}
+
+void ESP8266WiFiClass::hostClearNetworks()
+{
+  hostRadioInit();
+
+  // Indices into the list are gone, so is anything connected through them
+  hostRadio().networks.clear();
+  wifi_station_disconnect();
+}
+
+int ESP8266WiFiClass::hostAddNetwork(const char *ssid, const char *passphrase, int32_t rssi, uint8_t channel, bool hidden)
+{
+  HostAPConfig ap;
+
+  ap.ssid       = ssid;
+  ap.passphrase = passphrase;
+  ap.rssi       = rssi;
+  ap.channel    = channel;
+  ap.hidden     = hidden;
+
+  return hostAddAP(ap);
+}
+
+int ESP8266WiFiClass::hostAddAP(const HostAPConfig &ap)
+{
+  hostRadioInit();
+
+  HostNetwork   n;
+  HostRSSIPoint start = { 0, ap.rssi };
+  uint8_t       index = hostRadio().networks.size();
+
+  n.ssid          = ap.ssid ? ap.ssid : "";
+  n.passphrase    = ap.passphrase ? ap.passphrase : "";
+  n.enc           = ap.encryption ? ap.encryption : (n.passphrase.empty() ? ENC_TYPE_NONE : ENC_TYPE_CCMP);
+  n.channel       = ap.channel;
+  n.hidden        = ap.hidden;
+  n.connectMs     = ap.connectMs;
+  n.dhcpMs        = ap.dhcpMs;
+  n.authFailures  = ap.authFailures;
+  n.dhcpFails     = ap.dhcpFails;
+
+  n.rssi.push_back(start);
+
+  static const uint8_t none[6] = { 0 };
+
+  if (memcmp(ap.bssid, none, 6) != 0)
+  {
+    memcpy(n.bssid, ap.bssid, 6);
+  }
+  else
+  {
+    // Locally administered, unique per entry
+    n.bssid[0] = 0x02;
+    n.bssid[1] = 0x00;
+    n.bssid[2] = 0x5E;
+    n.bssid[3] = 0x10;
+    n.bssid[4] = ap.channel;
+    n.bssid[5] = index;
+  }
+
+  hostRadio().networks.push_back(n);
+
+  return index;
+}
+
+void ESP8266WiFiClass::hostAddRSSIPoint(int ap, uint32_t atMs, int32_t rssi)
+{
+  hostRadioInit();
+
+  if (ap < 0 || ap >= (int) hostRadio().networks.size())
+    return;
+
+  std::vector<HostRSSIPoint>  &points = hostRadio().networks[ap].rssi;
+  HostRSSIPoint               point   = { atMs, rssi };
+  size_t                      i       = points.size();
+
+  // A point at time 0 replaces the starting RSSI
+  while (i > 0 && points[i - 1].atMs > atMs)
+    i--;
+
+  if (i > 0 && points[i - 1].atMs == atMs)
+    points[i - 1] = point;
+  else
+    points.insert(points.begin() + i, point);
+}
+
+void ESP8266WiFiClass::hostSetTiming(uint32_t scanMs, uint32_t connectMs)
+{
+  hostRadioInit();
+
+  hostRadio().scanMs    = scanMs;
+  hostRadio().connectMs = connectMs;
+}
+
+void ESP8266WiFiClass::hostSetRSSIJitter(uint8_t dB)
+{
+  hostRadioInit();
+  hostRadio().jitter = dB;
+}
+
+void ESP8266WiFiClass::hostRadioStats(HostRadioStats &stats)
+{
+  hostRadioUpdate();
+  stats = hostRadio().stats;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// SDK
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool wifi_station_get_config(struct station_config *config)
+{
+  hostRadioInit();
+  memcpy(config, &hostRadio().current, sizeof(*config));
+  return true;
+}
+
+bool wifi_station_get_config_default(struct station_config *config)
+{
+  hostRadioInit();
+  memcpy(config, &hostRadio().saved, sizeof(*config));
+  return true;
+}
+
+bool wifi_station_set_config(struct station_config *config)
+{
+  hostRadioInit();
+
+  memcpy(&hostRadio().current, config, sizeof(*config));
+  memcpy(&hostRadio().saved, config, sizeof(*config));
+  hostFlashSave();
+
+  return true;
+}
+
+bool wifi_station_set_config_current(struct station_config *config)
+{
+  hostRadioInit();
+  memcpy(&hostRadio().current, config, sizeof(*config));
+  return true;
+}
+
+bool wifi_station_connect(void)
+{
+  hostRadioInit();
+  hostStartConnect(millis());
+  return true;
+}
+
+bool wifi_station_disconnect(void)
+{
+  hostRadioInit();
+
+  hostRadio().sdkStatus = STATION_IDLE;
+  hostRadio().target    = -1;
+  hostRadio().network   = -1;
+  hostRadio().ip        = (uint32_t) 0;
+
+  return true;
+}
+
+uint8 wifi_station_get_connect_status(void)
+{
+  hostRadioUpdate();
+
+  return (hostRadio().mode & WIFI_STA) ? hostRadio().sdkStatus : (uint8) STATION_IDLE;
+}
+
+uint8 wifi_softap_get_station_num(void)
+{
+  hostRadioInit();
+
+  // The developer's browser
+  return (hostRadio().mode & WIFI_AP) ? 1 : 0;
+}
+
+bool wifi_get_ip_info(uint8 if_index, struct ip_info *info)
+{
+  hostRadioUpdate();
+
+  memset(info, 0, sizeof(*info));
+
+  if (if_index == SOFTAP_IF)
+  {
+    // Like the TCP connections (see ESPAsyncWebServer.h), datagrams from loopback are taken to come over the soft AP
+    if (!(hostRadio().mode & WIFI_AP) || !WiFi.softAPIP().isSet())
+      return false;
+
+    info->ip.addr       = IPAddress(127, 0, 0, 1);
+    info->netmask.addr  = IPAddress(255, 0, 0, 0);
+
+    return true;
+  }
+
+  if (if_index != STATION_IF || !(hostRadio().mode & WIFI_STA))
+    return false;
+
+  info->ip.addr       = hostRadio().ip;
+  info->netmask.addr  = hostRadio().sn;
+  info->gw.addr       = hostRadio().gw;
+
+  return true;
+}
+
+uint8 wifi_get_channel(void)
+{
+  return WiFi.channel();
+}
+
+uint32 system_get_time(void)
+{
+  return micros();
+}
+
+uint32 system_get_free_heap_size(void)
+{
+  return ESP.getFreeHeap();
+}
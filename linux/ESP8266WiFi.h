@@ -0,0 +1,192 @@
+/*
+  ESP8266WiFi.h
+  Host (Linux) build
+
+  Simulated radio behind the ESP8266WiFi API. Scans return a configurable set of networks (with some RSSI jitter)
+  after a scan time, connects resolve after a connect time against the same set, and the station config is kept
+  in "flash" - in memory, or in the file named by ENCOMPASS_HOST_FLASH so it survives a restart.
+
+  hostAddAP() scripts an AP further: RSSI over time (hostAddRSSIPoint(), out of range at HOST_RSSI_OUT_OF_RANGE),
+  its own association and DHCP times, rejected associations and a DHCP server that never answers. Everything runs
+  off millis() and a seeded jitter, so with hostUseVirtualClock() a scenario plays out the same way every time
+  (extras/wifisim runs them).
+
+  Environment:
+    ENCOMPASS_HOST_NETWORKS     "ssid:password:rssi:channel;..." (empty password - open network)
+    ENCOMPASS_HOST_SCAN_MS      Blocking scan time, default 2100 (a full ESP8266 active scan)
+    ENCOMPASS_HOST_CONNECT_MS   Association + DHCP time, default 3000
+    ENCOMPASS_HOST_FLASH        File for the persistent station config
+    ENCOMPASS_HOST_AP_START_MS  Time softAP() / softAPConfig() leave the soft AP without an address, default 0 (the
+                                ESP8266 has it when they return)
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#pragma once
+
+#include "Arduino.h"
+
+typedef enum WiFiMode
+{
+  WIFI_OFF    = 0,
+  WIFI_STA    = 1,
+  WIFI_AP     = 2,
+  WIFI_AP_STA = 3
+} WiFiMode_t;
+
+typedef enum
+{
+  WL_NO_SHIELD        = 255,
+  WL_IDLE_STATUS      = 0,
+  WL_NO_SSID_AVAIL    = 1,
+  WL_SCAN_COMPLETED   = 2,
+  WL_CONNECTED        = 3,
+  WL_CONNECT_FAILED   = 4,
+  WL_CONNECTION_LOST  = 5,
+  WL_WRONG_PASSWORD   = 6,
+  WL_DISCONNECTED     = 7
+} wl_status_t;
+
+enum wl_enc_type
+{
+  ENC_TYPE_WEP  = 5,
+  ENC_TYPE_TKIP = 2,
+  ENC_TYPE_CCMP = 4,
+  ENC_TYPE_NONE = 7,
+  ENC_TYPE_AUTO = 8
+};
+
+#define WIFI_SCAN_RUNNING     (-1)
+#define WIFI_SCAN_FAILED      (-2)
+
+#define WL_SSID_MAX_LENGTH    32
+#define WL_WPA_KEY_MAX_LENGTH 63
+
+// Host only - an AP at or below this RSSI is not heard at all
+#define HOST_RSSI_OUT_OF_RANGE  (-100)
+
+// Host only - one simulated access point, for hostAddAP()
+struct HostAPConfig
+{
+  HostAPConfig();
+
+  const char  *ssid;
+  const char  *passphrase;      // NULL or "" - open
+  uint8_t     bssid[6];         // All zero - one is made up
+  uint8_t     channel;
+  uint8_t     encryption;       // 0 - ENC_TYPE_NONE or ENC_TYPE_CCMP, from the passphrase
+  bool        hidden;
+  int32_t     rssi;             // From hostResetRadio() on, until a hostAddRSSIPoint()
+  int32_t     connectMs;        // Association and authentication, -1 - the radio's (hostSetTiming())
+  uint32_t    dhcpMs;           // Getting an address, after associating
+  uint8_t     authFailures;     // This many associations are rejected (STATION_CONNECT_FAIL) before one gets in
+  bool        dhcpFails;        // Associates, but never gets an address
+};
+
+// Host only - what the simulated radio has done since hostResetRadio()
+struct HostRadioStats
+{
+  uint32_t    scans;
+  uint32_t    connects;         // Connection attempts
+  uint32_t    authFailures;     // Attempts rejected by an AP's authFailures
+  uint32_t    linkLosses;       // Connections dropped because the AP went out of range
+};
+
+class ESP8266WiFiClass
+{
+  public:
+
+    ESP8266WiFiClass();
+
+    // Generic
+    bool          mode(WiFiMode_t m);
+    WiFiMode_t    getMode();
+    bool          enableSTA(bool enable);
+    bool          enableAP(bool enable);
+    void          persistent(bool persistent);
+    bool          getPersistent();
+    bool          setSleepMode(int type, uint8_t listenInterval = 0);
+    void          setOutputPower(float dBm);
+    int           hostByName(const char *hostname, IPAddress &result);
+    int32_t       channel();
+
+    // Station
+    wl_status_t   begin(const char *ssid, const char *passphrase = NULL, int32_t channel = 0, const uint8_t *bssid = NULL,
+                        bool connect = true);
+    wl_status_t   begin(const String &ssid, const String &passphrase = String(), int32_t channel = 0,
+                        const uint8_t *bssid = NULL, bool connect = true);
+    wl_status_t   begin();
+
+    bool          config(IPAddress local_ip, IPAddress gateway, IPAddress subnet, IPAddress dns1 = (uint32_t) 0,
+                         IPAddress dns2 = (uint32_t) 0);
+    bool          reconnect();
+    bool          disconnect(bool wifioff = false);
+    bool          isConnected();
+    bool          setAutoConnect(bool autoConnect);
+    bool          getAutoConnect();
+    bool          setAutoReconnect(bool autoReconnect);
+    bool          getAutoReconnect();
+    int8_t        waitForConnectResult(unsigned long timeoutLength = 60000);
+
+    IPAddress     localIP();
+    uint8_t*      macAddress(uint8_t *mac);
+    String        macAddress();
+    IPAddress     subnetMask();
+    IPAddress     gatewayIP();
+    IPAddress     dnsIP(uint8_t dns_no = 0);
+    String        hostname();
+    bool          hostname(const char *aHostname);
+    bool          hostname(const String &aHostname);
+    wl_status_t   status();
+    String        SSID() const;
+    String        psk() const;
+    uint8_t*      BSSID();
+    String        BSSIDstr();
+    int32_t       RSSI();
+    bool          beginWPSConfig(void);
+
+    // Soft AP
+    bool          softAP(const char *ssid, const char *passphrase = NULL, int channel = 1, int ssid_hidden = 0,
+                         int max_connection = 4);
+    bool          softAP(const String &ssid, const String &passphrase = String(), int channel = 1, int ssid_hidden = 0,
+                         int max_connection = 4);
+    bool          softAPConfig(IPAddress local_ip, IPAddress gateway, IPAddress subnet);
+    bool          softAPdisconnect(bool wifioff = false);
+    uint8_t       softAPgetStationNum();
+    IPAddress     softAPIP();
+    uint8_t*      softAPmacAddress(uint8_t *mac);
+    String        softAPmacAddress(void);
+    String        softAPSSID() const;
+    String        softAPPSK() const;
+
+    // Scan
+    int8_t        scanNetworks(bool async = false, bool show_hidden = false, uint8_t channel = 0, uint8_t *ssid = NULL);
+    int8_t        scanComplete();
+    void          scanDelete();
+    bool          getNetworkInfo(uint8_t networkItem, String &ssid, uint8_t &encryptionType, int32_t &RSSI,
+                                 uint8_t* &BSSID, int32_t &channel, bool &isHidden);
+    String        SSID(uint8_t networkItem);
+    uint8_t       encryptionType(uint8_t networkItem);
+    int32_t       RSSI(uint8_t networkItem);
+    uint8_t*      BSSID(uint8_t networkItem);
+    String        BSSIDstr(uint8_t networkItem);
+    int32_t       channel(uint8_t networkItem);
+    bool          isHidden(uint8_t networkItem);
+
+    // Host only - the simulated radio. hostResetRadio() forgets the networks, the station config and the statistics,
+    // and restarts the RSSI timelines (and the jitter sequence, from seed) at the current millis().
+    void          hostResetRadio(uint32_t seed = 1);
+    void          hostClearNetworks();
+    int           hostAddNetwork(const char *ssid, const char *passphrase, int32_t rssi, uint8_t channel, bool hidden = false);
+    int           hostAddAP(const HostAPConfig &ap);
+    // The AP's RSSI is atMs after hostResetRadio(), linear between points
+    void          hostAddRSSIPoint(int ap, uint32_t atMs, int32_t rssi);
+    void          hostSetTiming(uint32_t scanMs, uint32_t connectMs);
+    // Scan results are off by up to +-dB (default 3)
+    void          hostSetRSSIJitter(uint8_t dB);
+    void          hostRadioStats(HostRadioStats &stats);
+};
+
+extern ESP8266WiFiClass WiFi;
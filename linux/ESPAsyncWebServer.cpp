@@ -0,0 +1,1488 @@
+/*
+  ESPAsyncWebServer.cpp
+  Host (Linux) build
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#include "ESPAsyncWebServer.h"
+
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+// Like AsyncTCP: one segment's worth of body per fill, a bounded request head, form bodies kept whole. Multipart
+// bodies are parsed as they arrive like the library does: file parts stream to handleUpload(), the rest become params.
+#define HOST_HTTP_SEGMENT       1460
+#define HOST_HTTP_MAX_HEAD      8192
+#define HOST_HTTP_MAX_FORM      16384
+#define HOST_HTTP_CONNECTIONS   16
+
+static const String hostEmptyString;
+
+bool ON_STA_FILTER(AsyncWebServerRequest *request)
+{
+  return WiFi.localIP() == request->client()->localIP();
+}
+
+bool ON_AP_FILTER(AsyncWebServerRequest *request)
+{
+  return WiFi.localIP() != request->client()->localIP();
+}
+
+static String hostUrlDecode(const String &text)
+{
+  String  decoded;
+  size_t  len = text.length();
+
+  decoded.reserve(len);
+
+  for (size_t i = 0; i < len; i++)
+  {
+    char c = text[i];
+
+    if (c == '+')
+    {
+      decoded += ' ';
+    }
+    else if (c == '%' && i + 2 < len && isxdigit((unsigned char) text[i + 1]) && isxdigit((unsigned char) text[i + 2]))
+    {
+      char hex[3] = { text[i + 1], text[i + 2], 0 };
+
+      decoded += (char) strtoul(hex, NULL, 16);
+      i       += 2;
+    }
+    else
+    {
+      decoded += c;
+    }
+  }
+
+  return decoded;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// A connection - the AsyncTCP client plus the request parser state
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class AsyncHostConnection
+{
+  public:
+
+    enum E_State
+    {
+      STATE_HEAD,
+      STATE_BODY,
+      STATE_WAIT,
+      STATE_SEND,
+      STATE_CLOSED
+    };
+
+    enum E_Part
+    {
+      PART_PREAMBLE,
+      PART_HEAD,
+      PART_DATA,
+      PART_END
+    };
+
+    AsyncHostConnection(AsyncWebServer *server, int fd, const struct sockaddr_in &peer)
+      : fd(fd), state(STATE_HEAD), request(NULL), response(NULL), bodyIndex(0), bodyDone(false),
+        received(0), remoteIP(peer.sin_addr.s_addr), remotePort(ntohs(peer.sin_port)), localPort(server->_port), server(server),
+        part(PART_PREAMBLE), partIsFile(false), partIndex(0)
+    {
+    }
+
+    ~AsyncHostConnection()
+    {
+      if (fd >= 0)
+        ::close(fd);
+    }
+
+    void readable();
+    void feed(const uint8_t *buffer, size_t n);
+    void pump();
+    void start(AsyncWebServerResponse *response);
+    void close();
+
+    int                       fd;
+    E_State                   state;
+    AsyncWebServerRequest     *request;
+    AsyncWebServerResponse    *response;
+    std::string               in;
+    std::string               out;
+    size_t                    bodyIndex;
+    bool                      bodyDone;
+    size_t                    received;
+    uint32_t                  remoteIP;
+    uint16_t                  remotePort;
+    uint16_t                  localPort;
+    AsyncWebServer            *server;
+
+    // Multipart parser - what has not been matched against the boundary yet, and the part being read
+    E_Part                    part;
+    std::string               partBuffer;
+    String                    partName;
+    String                    partFilename;
+    bool                      partIsFile;
+    size_t                    partIndex;
+
+  private:
+
+    void body(const uint8_t *data, size_t len);
+    void multipart(const uint8_t *data, size_t len);
+    void partData(const char *data, size_t len, bool final);
+    void fail(int code);
+};
+
+void AsyncHostConnection::fail(int code)
+{
+  char head[96];
+
+  snprintf(head, sizeof(head), "HTTP/1.0 %d %s\r\nConnection: close\r\nContent-Length: 0\r\n\r\n", code,
+           (const char *) AsyncWebServerResponse::responseCodeToString(code));
+
+  out   = head;
+  state = STATE_SEND;
+
+  // No request to hand to a handler, nothing after the head
+  bodyDone = true;
+}
+
+void AsyncHostConnection::readable()
+{
+  uint8_t buffer[HOST_HTTP_SEGMENT];
+  ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+
+  if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+  {
+    close();
+    return;
+  }
+
+  if (n > 0)
+    feed(buffer, n);
+}
+
+void AsyncHostConnection::feed(const uint8_t *buffer, size_t n)
+{
+  if (state == STATE_HEAD)
+  {
+    in.append((const char *) buffer, n);
+
+    size_t end = in.find("\r\n\r\n");
+
+    if (end == std::string::npos)
+    {
+      if (in.size() > HOST_HTTP_MAX_HEAD)
+        fail(431);
+
+      return;
+    }
+
+    std::string rest = in.substr(end + 4);
+
+    in.resize(end);
+
+    request = new AsyncWebServerRequest(server, this);
+
+    if (!request->parseHead(in))
+    {
+      fail(400);
+      return;
+    }
+
+    in.clear();
+    server->attachHandler(request);
+
+    if (request->_contentLength == 0)
+    {
+      request->handle();
+      return;
+    }
+
+    state = STATE_BODY;
+    body((const uint8_t *) rest.data(), rest.size());
+  }
+  else if (state == STATE_BODY)
+  {
+    body(buffer, n);
+  }
+  // Anything after the request (pipelining) is ignored, the connection closes after the response
+}
+
+void AsyncHostConnection::body(const uint8_t *data, size_t len)
+{
+  len = std::min(len, request->_contentLength - received);
+
+  // As the library's needParse: a trivial handler (or none) gets no args from a form and no uploads
+  bool parse = request->_handler && !request->_handler->isRequestHandlerTrivial();
+
+  if (request->_isPlainPost)
+  {
+    if (parse)
+      in.append((const char *) data, len);
+
+    if (in.size() > HOST_HTTP_MAX_FORM)
+    {
+      fail(413);
+      return;
+    }
+  }
+  else if (request->_isMultipart)
+  {
+    if (parse)
+      multipart(data, len);
+
+    if (state != STATE_BODY)
+      return;
+  }
+  else if (len && request->_handler)
+  {
+    request->_handler->handleBody(request, (uint8_t *) data, len, received, request->_contentLength);
+  }
+
+  received += len;
+
+  if (received < request->_contentLength)
+    return;
+
+  if (request->_isPlainPost)
+  {
+    request->addParams(String(in.c_str()), true);
+    in.clear();
+  }
+
+  request->handle();
+}
+
+void AsyncHostConnection::multipart(const uint8_t *data, size_t len)
+{
+  std::string delimiter = std::string("\r\n--") + request->_boundary.c_str();
+
+  // The body starts right at the first boundary, without the CRLF in front of it
+  if (part == PART_PREAMBLE && partBuffer.empty())
+    partBuffer = "\r\n";
+
+  partBuffer.append((const char *) data, len);
+
+  while (part != PART_END)
+  {
+    if (part == PART_PREAMBLE)
+    {
+      size_t at = partBuffer.find(delimiter);
+
+      if (at == std::string::npos)
+      {
+        // Only what could still turn into the boundary is kept
+        if (partBuffer.size() > delimiter.size())
+          partBuffer.erase(0, partBuffer.size() - delimiter.size());
+
+        return;
+      }
+
+      partBuffer.erase(0, at + delimiter.size());
+      part = PART_HEAD;
+    }
+    else if (part == PART_HEAD)
+    {
+      // "--" after a boundary ends the body, CRLF starts a part
+      if (partBuffer.size() < 2)
+        return;
+
+      if (partBuffer.compare(0, 2, "--") == 0)
+      {
+        part = PART_END;
+        partBuffer.clear();
+        return;
+      }
+
+      size_t end = partBuffer.find("\r\n\r\n");
+
+      if (end == std::string::npos)
+      {
+        if (partBuffer.size() > HOST_HTTP_MAX_HEAD)
+          fail(431);
+
+        return;
+      }
+
+      String head(partBuffer.substr(0, end).c_str());
+
+      partBuffer.erase(0, end + 4);
+
+      partName      = String();
+      partFilename  = String();
+      partIsFile    = false;
+      partIndex     = 0;
+
+      int name = head.indexOf("name=\"");
+
+      if (name >= 0)
+        partName = head.substring(name + 6, head.indexOf('"', name + 6));
+
+      int filename = head.indexOf("filename=\"");
+
+      if (filename >= 0)
+      {
+        partFilename  = head.substring(filename + 10, head.indexOf('"', filename + 10));
+        partIsFile    = true;
+      }
+
+      in.clear();
+      part = PART_DATA;
+    }
+    else
+    {
+      size_t at = partBuffer.find(delimiter);
+
+      if (at == std::string::npos)
+      {
+        // Everything that cannot be the start of the boundary goes out now
+        if (partBuffer.size() > delimiter.size())
+        {
+          size_t n = partBuffer.size() - delimiter.size();
+
+          partData(partBuffer.data(), n, false);
+          partBuffer.erase(0, n);
+        }
+
+        return;
+      }
+
+      partData(partBuffer.data(), at, true);
+      partBuffer.erase(0, at + delimiter.size());
+
+      if (state != STATE_BODY)
+        return;
+
+      part = PART_HEAD;
+    }
+  }
+}
+
+void AsyncHostConnection::partData(const char *data, size_t len, bool final)
+{
+  if (partIsFile)
+  {
+    if (request->_handler)
+      request->_handler->handleUpload(request, partFilename, partIndex, (uint8_t *) data, len, final);
+
+    partIndex += len;
+
+    if (final)
+      request->_params.push_back(new AsyncWebParameter(partName, partFilename, true, true, partIndex));
+
+    return;
+  }
+
+  in.append(data, len);
+
+  if (in.size() > HOST_HTTP_MAX_FORM)
+  {
+    fail(413);
+    return;
+  }
+
+  if (final)
+  {
+    request->_params.push_back(new AsyncWebParameter(partName, String(in.c_str()), true));
+    in.clear();
+  }
+}
+
+void AsyncHostConnection::start(AsyncWebServerResponse *resp)
+{
+  response  = resp;
+  state     = STATE_SEND;
+  out       = std::string(response->assembleHead(request->_version).c_str());
+  bodyIndex = 0;
+  bodyDone  = (request->_method == HTTP_HEAD) || (response->_sendContentLength && response->_contentLength == 0);
+
+  pump();
+}
+
+void AsyncHostConnection::pump()
+{
+  if (state != STATE_SEND)
+    return;
+
+  // Fill while the "TCP window" (a segment) has room, like the library's _ack() path
+  while (!bodyDone && out.size() < HOST_HTTP_SEGMENT)
+  {
+    uint8_t buffer[HOST_HTTP_SEGMENT];
+    bool    framed  = response->_chunked && request->_version == 1;
+    size_t  room    = HOST_HTTP_SEGMENT - (framed ? 8 : 0);
+
+    if (response->_sendContentLength)
+      room = std::min(room, response->_contentLength - bodyIndex);
+
+    size_t n = response->fill(buffer, room, bodyIndex);
+
+    if (n == RESPONSE_TRY_AGAIN)
+      break;
+
+    n = std::min(n, room);
+
+    if (framed)
+    {
+      char size[12];
+
+      snprintf(size, sizeof(size), "%x\r\n", (unsigned) n);
+      out += size;
+      out.append((const char *) buffer, n);
+      out += "\r\n";
+    }
+    else
+    {
+      out.append((const char *) buffer, n);
+    }
+
+    bodyIndex += n;
+
+    if (n == 0 || (response->_sendContentLength && bodyIndex >= response->_contentLength))
+      bodyDone = true;
+  }
+
+  // In-process (hostExchange()) - the caller takes the output
+  while (!out.empty() && fd >= 0)
+  {
+    ssize_t n = send(fd, out.data(), out.size(), MSG_NOSIGNAL);
+
+    if (n < 0)
+    {
+      if (errno != EAGAIN && errno != EWOULDBLOCK)
+        close();
+
+      return;
+    }
+
+    out.erase(0, n);
+  }
+
+  if (bodyDone)
+    close();
+}
+
+void AsyncHostConnection::close()
+{
+  if (state == STATE_CLOSED)
+    return;
+
+  state = STATE_CLOSED;
+
+  if (fd >= 0)
+  {
+    ::close(fd);
+    fd = -1;
+  }
+
+  if (request)
+  {
+    request->disconnected();
+    delete request;
+    request = NULL;
+  }
+}
+
+String hostExchange(AsyncWebServer &server, const String &raw)
+{
+  struct sockaddr_in peer;
+
+  memset(&peer, 0, sizeof(peer));
+  peer.sin_addr.s_addr  = htonl(INADDR_LOOPBACK);
+  peer.sin_port         = htons(49152);
+
+  AsyncHostConnection conn(&server, -1, peer);
+  std::string         response;
+
+  conn.feed((const uint8_t *) raw.c_str(), raw.length());
+
+  while (conn.state == AsyncHostConnection::STATE_SEND)
+  {
+    response += conn.out;
+    conn.out.clear();
+    conn.pump();
+
+    // A filler waiting on something (RESPONSE_TRY_AGAIN) gets the loop run meanwhile
+    if (conn.out.empty() && conn.state == AsyncHostConnection::STATE_SEND)
+      yield();
+  }
+
+  response += conn.out;
+
+  // A handler that never answered, or a request still waiting for its body
+  conn.close();
+
+  String result;
+
+  result.concat(response.data(), response.size());
+
+  return result;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// AsyncClient
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+IPAddress AsyncClient::remoteIP()
+{
+  return IPAddress(_conn->remoteIP);
+}
+
+uint16_t AsyncClient::remotePort()
+{
+  return _conn->remotePort;
+}
+
+IPAddress AsyncClient::localIP()
+{
+  return WiFi.softAPIP();
+}
+
+uint16_t AsyncClient::localPort()
+{
+  return _conn->localPort;
+}
+
+bool AsyncClient::connected()
+{
+  return _conn->state != AsyncHostConnection::STATE_CLOSED;
+}
+
+void AsyncClient::close(bool now)
+{
+  (void) now;
+  _conn->close();
+}
+
+size_t AsyncClient::space()
+{
+  return (_conn->out.size() < HOST_HTTP_SEGMENT) ? HOST_HTTP_SEGMENT - _conn->out.size() : 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// AsyncWebServerRequest
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+AsyncWebServerRequest::AsyncWebServerRequest(AsyncWebServer *server, AsyncHostConnection *conn)
+  : _tempObject(NULL), _server(server), _conn(conn), _client(conn), _handler(NULL), _response(NULL), _version(0),
+    _method(HTTP_ANY), _contentLength(0), _isMultipart(false), _isPlainPost(false)
+{
+}
+
+AsyncWebServerRequest::~AsyncWebServerRequest()
+{
+  for (size_t i = 0; i < _headers.size(); i++)
+    delete _headers[i];
+
+  for (size_t i = 0; i < _params.size(); i++)
+    delete _params[i];
+
+  delete _response;
+
+  if (_tempObject)
+    free(_tempObject);
+}
+
+bool AsyncWebServerRequest::parseHead(const std::string &head)
+{
+  size_t lineEnd = head.find("\r\n");
+  String line    = String(head.substr(0, lineEnd).c_str());
+
+  int methodEnd = line.indexOf(' ');
+  int urlEnd    = line.indexOf(' ', methodEnd + 1);
+
+  if (methodEnd < 0 || urlEnd < 0)
+    return false;
+
+  String method   = line.substring(0, methodEnd);
+  String url      = line.substring(methodEnd + 1, urlEnd);
+  String version  = line.substring(urlEnd + 1);
+
+  if      (method == "GET")     _method = HTTP_GET;
+  else if (method == "POST")    _method = HTTP_POST;
+  else if (method == "DELETE")  _method = HTTP_DELETE;
+  else if (method == "PUT")     _method = HTTP_PUT;
+  else if (method == "PATCH")   _method = HTTP_PATCH;
+  else if (method == "HEAD")    _method = HTTP_HEAD;
+  else if (method == "OPTIONS") _method = HTTP_OPTIONS;
+  else
+    return false;
+
+  _version = version.startsWith("HTTP/1.1") ? 1 : 0;
+
+  int query = url.indexOf('?');
+
+  if (query >= 0)
+  {
+    addParams(url.substring(query + 1), false);
+    url = url.substring(0, query);
+  }
+
+  _url = hostUrlDecode(url);
+
+  while (lineEnd != std::string::npos)
+  {
+    size_t start = lineEnd + 2;
+
+    lineEnd = head.find("\r\n", start);
+    line    = String(head.substr(start, (lineEnd == std::string::npos) ? std::string::npos : lineEnd - start).c_str());
+
+    int colon = line.indexOf(':');
+
+    if (colon <= 0)
+      continue;
+
+    String name   = line.substring(0, colon);
+    String value  = line.substring(colon + 1);
+
+    value.trim();
+
+    if (name.equalsIgnoreCase("Host"))
+    {
+      _host = value;
+    }
+    else if (name.equalsIgnoreCase("Content-Type"))
+    {
+      _contentType = value;
+
+      int semicolon = value.indexOf(';');
+
+      if (semicolon >= 0)
+        _contentType = value.substring(0, semicolon);
+
+      _contentType.trim();
+
+      if (_contentType.equalsIgnoreCase("multipart/form-data"))
+      {
+        int boundary = value.indexOf("boundary=");
+
+        _isMultipart = true;
+
+        if (boundary >= 0)
+          _boundary = value.substring(boundary + 9);
+
+        if (_boundary.length() >= 2 && _boundary[0] == '"')
+          _boundary = _boundary.substring(1, _boundary.length() - 1);
+      }
+      else if (_contentType.equalsIgnoreCase("application/x-www-form-urlencoded"))
+      {
+        _isPlainPost = true;
+      }
+    }
+    else if (name.equalsIgnoreCase("Content-Length"))
+    {
+      _contentLength = strtoul(value.c_str(), NULL, 10);
+    }
+
+    _headers.push_back(new AsyncWebHeader(name, value));
+  }
+
+  return true;
+}
+
+void AsyncWebServerRequest::addParams(const String &query, bool form)
+{
+  int start = 0;
+
+  while (start < (int) query.length())
+  {
+    int end = query.indexOf('&', start);
+
+    if (end < 0)
+      end = query.length();
+
+    String  pair  = query.substring(start, end);
+    int     equal = pair.indexOf('=');
+
+    if (pair.length())
+    {
+      if (equal < 0)
+        _params.push_back(new AsyncWebParameter(hostUrlDecode(pair), String(), form));
+      else
+        _params.push_back(new AsyncWebParameter(hostUrlDecode(pair.substring(0, equal)), hostUrlDecode(pair.substring(equal + 1)), form));
+    }
+
+    start = end + 1;
+  }
+}
+
+void AsyncWebServerRequest::handle()
+{
+  _conn->state = AsyncHostConnection::STATE_WAIT;
+
+  if (_handler)
+    _handler->handleRequest(this);
+  else if (_server->_notFound)
+    _server->_notFound(this);
+  else
+    send(404);
+}
+
+void AsyncWebServerRequest::disconnected()
+{
+  if (_onDisconnectfn)
+    _onDisconnectfn();
+}
+
+const char* AsyncWebServerRequest::methodToString() const
+{
+  switch (_method)
+  {
+    case HTTP_GET:      return "GET";
+    case HTTP_POST:     return "POST";
+    case HTTP_DELETE:   return "DELETE";
+    case HTTP_PUT:      return "PUT";
+    case HTTP_PATCH:    return "PATCH";
+    case HTTP_HEAD:     return "HEAD";
+    case HTTP_OPTIONS:  return "OPTIONS";
+    default:            return "UNKNOWN";
+  }
+}
+
+void AsyncWebServerRequest::onDisconnect(ArDisconnectHandler fn)
+{
+  _onDisconnectfn = fn;
+}
+
+void AsyncWebServerRequest::redirect(const String &url)
+{
+  AsyncWebServerResponse *response = beginResponse(302);
+
+  response->addHeader("Location", url);
+  send(response);
+}
+
+bool AsyncWebServerRequest::authenticate(const char *username, const char *password, const char *realm,
+                                         bool passwordIsHash)
+{
+  (void) realm;
+
+  const String &auth = header("Authorization");
+
+  if (passwordIsHash || !auth.startsWith("Basic "))
+    return false;
+
+  static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string       decoded;
+  uint32_t          bits  = 0;
+  int               count = 0;
+
+  for (unsigned int i = 6; i < auth.length() && auth[i] != '='; i++)
+  {
+    const char *at = strchr(alphabet, auth[i]);
+
+    if (at == NULL || *at == 0)
+      return false;
+
+    bits = (bits << 6) | (at - alphabet);
+
+    if (++count == 4)
+    {
+      decoded += (char) (bits >> 16);
+      decoded += (char) (bits >> 8);
+      decoded += (char) bits;
+      bits  = 0;
+      count = 0;
+    }
+  }
+
+  if (count == 2)
+    decoded += (char) (bits >> 4);
+  else if (count == 3)
+  {
+    decoded += (char) (bits >> 10);
+    decoded += (char) (bits >> 2);
+  }
+
+  return decoded == std::string(username) + ":" + password;
+}
+
+void AsyncWebServerRequest::requestAuthentication(const char *realm, bool isDigest)
+{
+  (void) isDigest;
+
+  AsyncWebServerResponse *response = beginResponse(401);
+
+  response->addHeader("WWW-Authenticate", String("Basic realm=\"") + (realm ? realm : "Login Required") + "\"");
+  send(response);
+}
+
+void AsyncWebServerRequest::send(AsyncWebServerResponse *response)
+{
+  // One response per request. The library does not refuse a second one - it leaks the first and writes both to the
+  // socket - so a handler that sends twice is a bug to stop at, not to smooth over.
+  if (_response || _conn->state == AsyncHostConnection::STATE_SEND)
+  {
+    fprintf(stderr, "AsyncWebServerRequest: second response to %s\n", _url.c_str());
+    abort();
+  }
+
+  // The client is gone already
+  if (_conn->state == AsyncHostConnection::STATE_CLOSED)
+  {
+    delete response;
+    return;
+  }
+
+  _response = response;
+  _conn->start(response);
+}
+
+void AsyncWebServerRequest::send(int code, const String &contentType, const String &content)
+{
+  send(beginResponse(code, contentType, content));
+}
+
+void AsyncWebServerRequest::send_P(int code, const String &contentType, const uint8_t *content, size_t len)
+{
+  send(beginResponse_P(code, contentType, content, len));
+}
+
+void AsyncWebServerRequest::send_P(int code, const String &contentType, PGM_P content)
+{
+  send(beginResponse_P(code, contentType, content));
+}
+
+AsyncWebServerResponse* AsyncWebServerRequest::beginResponse(int code, const String &contentType, const String &content)
+{
+  return new AsyncBasicResponse(code, contentType, content);
+}
+
+AsyncWebServerResponse* AsyncWebServerRequest::beginResponse(const String &contentType, size_t len, AwsResponseFiller callback,
+                                                             AwsTemplateProcessor templateCallback)
+{
+  (void) templateCallback;
+  return new AsyncCallbackResponse(contentType, len, callback);
+}
+
+AsyncWebServerResponse* AsyncWebServerRequest::beginChunkedResponse(const String &contentType, AwsResponseFiller callback,
+                                                                    AwsTemplateProcessor templateCallback)
+{
+  (void) templateCallback;
+
+  // HTTP/1.0 has no chunked encoding, the body then ends when the connection does
+  if (_version)
+    return new AsyncChunkedResponse(contentType, callback);
+
+  return new AsyncCallbackResponse(contentType, 0, callback);
+}
+
+AsyncResponseStream* AsyncWebServerRequest::beginResponseStream(const String &contentType, size_t bufferSize)
+{
+  return new AsyncResponseStream(contentType, bufferSize);
+}
+
+AsyncWebServerResponse* AsyncWebServerRequest::beginResponse_P(int code, const String &contentType, const uint8_t *content, size_t len,
+                                                               AwsTemplateProcessor callback)
+{
+  (void) callback;
+  return new AsyncProgmemResponse(code, contentType, content, len);
+}
+
+AsyncWebServerResponse* AsyncWebServerRequest::beginResponse_P(int code, const String &contentType, PGM_P content,
+                                                               AwsTemplateProcessor callback)
+{
+  return beginResponse_P(code, contentType, (const uint8_t *) content, strlen_P(content), callback);
+}
+
+size_t AsyncWebServerRequest::headers() const
+{
+  return _headers.size();
+}
+
+bool AsyncWebServerRequest::hasHeader(const String &name) const
+{
+  return getHeader(name) != NULL;
+}
+
+bool AsyncWebServerRequest::hasHeader(const __FlashStringHelper *data) const
+{
+  return hasHeader(String(data));
+}
+
+AsyncWebHeader* AsyncWebServerRequest::getHeader(const String &name) const
+{
+  for (size_t i = 0; i < _headers.size(); i++)
+  {
+    if (_headers[i]->name().equalsIgnoreCase(name))
+      return _headers[i];
+  }
+
+  return NULL;
+}
+
+AsyncWebHeader* AsyncWebServerRequest::getHeader(const __FlashStringHelper *data) const
+{
+  return getHeader(String(data));
+}
+
+AsyncWebHeader* AsyncWebServerRequest::getHeader(size_t num) const
+{
+  return (num < _headers.size()) ? _headers[num] : NULL;
+}
+
+const String& AsyncWebServerRequest::header(const char *name) const
+{
+  AsyncWebHeader *h = getHeader(String(name));
+
+  return h ? h->value() : hostEmptyString;
+}
+
+const String& AsyncWebServerRequest::header(size_t i) const
+{
+  AsyncWebHeader *h = getHeader(i);
+
+  return h ? h->value() : hostEmptyString;
+}
+
+const String& AsyncWebServerRequest::headerName(size_t i) const
+{
+  AsyncWebHeader *h = getHeader(i);
+
+  return h ? h->name() : hostEmptyString;
+}
+
+size_t AsyncWebServerRequest::params() const
+{
+  return _params.size();
+}
+
+bool AsyncWebServerRequest::hasParam(const String &name, bool post, bool file) const
+{
+  return getParam(name, post, file) != NULL;
+}
+
+bool AsyncWebServerRequest::hasParam(const __FlashStringHelper *data, bool post, bool file) const
+{
+  return hasParam(String(data), post, file);
+}
+
+AsyncWebParameter* AsyncWebServerRequest::getParam(const String &name, bool post, bool file) const
+{
+  for (size_t i = 0; i < _params.size(); i++)
+  {
+    if (_params[i]->name() == name && _params[i]->isPost() == post && _params[i]->isFile() == file)
+      return _params[i];
+  }
+
+  return NULL;
+}
+
+AsyncWebParameter* AsyncWebServerRequest::getParam(const __FlashStringHelper *data, bool post, bool file) const
+{
+  return getParam(String(data), post, file);
+}
+
+AsyncWebParameter* AsyncWebServerRequest::getParam(size_t num) const
+{
+  return (num < _params.size()) ? _params[num] : NULL;
+}
+
+const String& AsyncWebServerRequest::arg(const String &name) const
+{
+  for (size_t i = 0; i < _params.size(); i++)
+  {
+    if (_params[i]->name() == name)
+      return _params[i]->value();
+  }
+
+  return hostEmptyString;
+}
+
+const String& AsyncWebServerRequest::arg(const __FlashStringHelper *data) const
+{
+  return arg(String(data));
+}
+
+const String& AsyncWebServerRequest::arg(size_t i) const
+{
+  return (i < _params.size()) ? _params[i]->value() : hostEmptyString;
+}
+
+const String& AsyncWebServerRequest::argName(size_t i) const
+{
+  return (i < _params.size()) ? _params[i]->name() : hostEmptyString;
+}
+
+bool AsyncWebServerRequest::hasArg(const char *name) const
+{
+  for (size_t i = 0; i < _params.size(); i++)
+  {
+    if (_params[i]->name() == name)
+      return true;
+  }
+
+  return false;
+}
+
+bool AsyncWebServerRequest::hasArg(const __FlashStringHelper *data) const
+{
+  return hasArg(String(data).c_str());
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Responses
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+AsyncWebServerResponse::AsyncWebServerResponse()
+  : _code(0), _contentLength(0), _sendContentLength(true), _chunked(false)
+{
+}
+
+AsyncWebServerResponse::~AsyncWebServerResponse()
+{
+  for (size_t i = 0; i < _headers.size(); i++)
+    delete _headers[i];
+}
+
+void AsyncWebServerResponse::setCode(int code)
+{
+  _code = code;
+}
+
+void AsyncWebServerResponse::setContentLength(size_t len)
+{
+  _contentLength = len;
+}
+
+void AsyncWebServerResponse::setContentType(const String &type)
+{
+  _contentType = type;
+}
+
+void AsyncWebServerResponse::addHeader(const String &name, const String &value)
+{
+  _headers.push_back(new AsyncWebHeader(name, value));
+}
+
+const __FlashStringHelper* AsyncWebServerResponse::responseCodeToString(int code)
+{
+  switch (code)
+  {
+    case 100: return F("Continue");
+    case 200: return F("OK");
+    case 201: return F("Created");
+    case 202: return F("Accepted");
+    case 204: return F("No Content");
+    case 301: return F("Moved Permanently");
+    case 302: return F("Found");
+    case 304: return F("Not Modified");
+    case 307: return F("Temporary Redirect");
+    case 400: return F("Bad Request");
+    case 401: return F("Unauthorized");
+    case 403: return F("Forbidden");
+    case 404: return F("Not Found");
+    case 405: return F("Method Not Allowed");
+    case 408: return F("Request Time-out");
+    case 409: return F("Conflict");
+    case 411: return F("Length Required");
+    case 413: return F("Request Entity Too Large");
+    case 415: return F("Unsupported Media Type");
+    case 429: return F("Too Many Requests");
+    case 431: return F("Request Header Fields Too Large");
+    case 500: return F("Internal Server Error");
+    case 501: return F("Not Implemented");
+    case 503: return F("Service Unavailable");
+    default:  return F("");
+  }
+}
+
+String AsyncWebServerResponse::assembleHead(uint8_t version)
+{
+  char line[64];
+
+  snprintf(line, sizeof(line), "HTTP/1.%d %d %s\r\n", version, _code, (const char *) responseCodeToString(_code));
+
+  String head = line;
+
+  head += F("Connection: close\r\nAccept-Ranges: none\r\n");
+
+  if (_sendContentLength)
+  {
+    snprintf(line, sizeof(line), "Content-Length: %u\r\n", (unsigned) _contentLength);
+    head += line;
+  }
+
+  if (_chunked && version)
+    head += F("Transfer-Encoding: chunked\r\n");
+
+  if (_contentType.length())
+    head += String(F("Content-Type: ")) + _contentType + F("\r\n");
+
+  for (size_t i = 0; i < _headers.size(); i++)
+    head += _headers[i]->toString();
+
+  head += F("\r\n");
+
+  return head;
+}
+
+size_t AsyncWebServerResponse::fill(uint8_t *buffer, size_t maxLen, size_t index)
+{
+  (void) buffer;
+  (void) maxLen;
+  (void) index;
+
+  return 0;
+}
+
+AsyncBasicResponse::AsyncBasicResponse(int code, const String &contentType, const String &content) : _content(content)
+{
+  _code           = code;
+  _contentType    = contentType;
+  _contentLength  = _content.length();
+
+  if (_contentLength && !_contentType.length())
+    _contentType = F("text/plain");
+}
+
+size_t AsyncBasicResponse::fill(uint8_t *buffer, size_t maxLen, size_t index)
+{
+  size_t n = (index < _content.length()) ? std::min(maxLen, _content.length() - index) : 0;
+
+  memcpy(buffer, _content.c_str() + index, n);
+
+  return n;
+}
+
+AsyncProgmemResponse::AsyncProgmemResponse(int code, const String &contentType, const uint8_t *content, size_t len)
+  : _content(content)
+{
+  _code           = code;
+  _contentType    = contentType;
+  _contentLength  = len;
+}
+
+size_t AsyncProgmemResponse::fill(uint8_t *buffer, size_t maxLen, size_t index)
+{
+  size_t n = (index < _contentLength) ? std::min(maxLen, _contentLength - index) : 0;
+
+  memcpy_P(buffer, _content + index, n);
+
+  return n;
+}
+
+AsyncCallbackResponse::AsyncCallbackResponse(const String &contentType, size_t len, AwsResponseFiller callback)
+  : _content(callback)
+{
+  _code           = 200;
+  _contentType    = contentType;
+  _contentLength  = len;
+
+  // Length 0 - unknown, sent until the filler returns 0 and the connection closes
+  if (len == 0)
+    _sendContentLength = false;
+}
+
+size_t AsyncCallbackResponse::fill(uint8_t *buffer, size_t maxLen, size_t index)
+{
+  return _content(buffer, maxLen, index);
+}
+
+AsyncChunkedResponse::AsyncChunkedResponse(const String &contentType, AwsResponseFiller callback) : _content(callback)
+{
+  _code               = 200;
+  _contentType        = contentType;
+  _sendContentLength  = false;
+  _chunked            = true;
+}
+
+size_t AsyncChunkedResponse::fill(uint8_t *buffer, size_t maxLen, size_t index)
+{
+  return _content(buffer, maxLen, index);
+}
+
+AsyncResponseStream::AsyncResponseStream(const String &contentType, size_t bufferSize)
+{
+  _code         = 200;
+  _contentType  = contentType;
+
+  _content.reserve(bufferSize);
+}
+
+size_t AsyncResponseStream::write(const uint8_t *data, size_t len)
+{
+  _content.append((const char *) data, len);
+  _contentLength = _content.size();
+
+  return len;
+}
+
+size_t AsyncResponseStream::write(uint8_t data)
+{
+  return write(&data, 1);
+}
+
+size_t AsyncResponseStream::fill(uint8_t *buffer, size_t maxLen, size_t index)
+{
+  size_t n = (index < _content.size()) ? std::min(maxLen, _content.size() - index) : 0;
+
+  memcpy(buffer, _content.data() + index, n);
+
+  return n;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// AsyncCallbackWebHandler
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool AsyncCallbackWebHandler::canHandle(AsyncWebServerRequest *request)
+{
+  if (!_onRequest || !(_method & request->method()))
+    return false;
+
+  if (_uri.length() && _uri.endsWith("*"))
+    return request->url().startsWith(_uri.substring(0, _uri.length() - 1));
+
+  return !_uri.length() || _uri == request->url() || request->url().startsWith(_uri + "/");
+}
+
+void AsyncCallbackWebHandler::handleRequest(AsyncWebServerRequest *request)
+{
+  if (_onRequest)
+    _onRequest(request);
+  else
+    request->send(500);
+}
+
+void AsyncCallbackWebHandler::handleUpload(AsyncWebServerRequest *request, const String &filename, size_t index, uint8_t *data,
+                                           size_t len, bool final)
+{
+  if (_onUpload)
+    _onUpload(request, filename, index, data, len, final);
+}
+
+void AsyncCallbackWebHandler::handleBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total)
+{
+  if (_onBody)
+    _onBody(request, data, len, index, total);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// AsyncWebServer
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+AsyncWebServer::AsyncWebServer(uint16_t port) : _port(port), _fd(-1)
+{
+}
+
+AsyncWebServer::~AsyncWebServer()
+{
+  end();
+  reset();
+}
+
+void AsyncWebServer::begin()
+{
+  // Already listening - the library's begin() is idempotent too
+  if (_fd >= 0)
+    return;
+
+  _fd = socket(AF_INET, SOCK_STREAM, 0);
+
+  if (_fd < 0)
+    return;
+
+  int one = 1;
+
+  setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL) | O_NONBLOCK);
+
+  struct sockaddr_in addr;
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family       = AF_INET;
+  addr.sin_port         = htons(hostPort(_port));
+  addr.sin_addr.s_addr  = htonl(INADDR_LOOPBACK);
+
+  if (bind(_fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 || listen(_fd, HOST_HTTP_CONNECTIONS) < 0)
+  {
+    fprintf(stderr, "AsyncWebServer: can't listen on 127.0.0.1:%u (%s)\n", hostPort(_port), strerror(errno));
+    ::close(_fd);
+    _fd = -1;
+    return;
+  }
+
+  hostRegisterPollable(this);
+}
+
+void AsyncWebServer::end()
+{
+  if (_fd < 0)
+    return;
+
+  hostUnregisterPollable(this);
+  ::close(_fd);
+  _fd = -1;
+
+  for (size_t i = 0; i < _connections.size(); i++)
+  {
+    _connections[i]->close();
+    delete _connections[i];
+  }
+
+  _connections.clear();
+}
+
+AsyncWebHandler& AsyncWebServer::addHandler(AsyncWebHandler *handler)
+{
+  _handlers.push_back(handler);
+  return *handler;
+}
+
+bool AsyncWebServer::removeHandler(AsyncWebHandler *handler)
+{
+  std::vector<AsyncWebHandler *>::iterator it = std::find(_handlers.begin(), _handlers.end(), handler);
+
+  if (it == _handlers.end())
+    return false;
+
+  _handlers.erase(it);
+  return true;
+}
+
+AsyncCallbackWebHandler& AsyncWebServer::on(const char *uri, ArRequestHandlerFunction onRequest)
+{
+  return on(uri, HTTP_ANY, onRequest);
+}
+
+AsyncCallbackWebHandler& AsyncWebServer::on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest)
+{
+  return on(uri, method, onRequest, nullptr, nullptr);
+}
+
+AsyncCallbackWebHandler& AsyncWebServer::on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest,
+                                            ArUploadHandlerFunction onUpload, ArBodyHandlerFunction onBody)
+{
+  AsyncCallbackWebHandler *handler = new AsyncCallbackWebHandler();
+
+  handler->setUri(uri);
+  handler->setMethod(method);
+  handler->onRequest(onRequest);
+  handler->onUpload(onUpload);
+  handler->onBody(onBody);
+  addHandler(handler);
+
+  return *handler;
+}
+
+void AsyncWebServer::onNotFound(ArRequestHandlerFunction fn)
+{
+  _notFound = fn;
+}
+
+void AsyncWebServer::reset()
+{
+  for (size_t i = 0; i < _handlers.size(); i++)
+    delete _handlers[i];
+
+  _handlers.clear();
+  _notFound = nullptr;
+}
+
+void AsyncWebServer::attachHandler(AsyncWebServerRequest *request)
+{
+  for (size_t i = 0; i < _handlers.size(); i++)
+  {
+    if (_handlers[i]->filter(request) && _handlers[i]->canHandle(request))
+    {
+      request->_handler = _handlers[i];
+      return;
+    }
+  }
+}
+
+int AsyncWebServer::pollFds(struct pollfd *fds, int room)
+{
+  int used = 0;
+
+  if (_fd < 0 || room < 1)
+    return 0;
+
+  fds[used].fd      = _fd;
+  fds[used].events  = POLLIN;
+  fds[used].revents = 0;
+  used++;
+
+  for (size_t i = 0; i < _connections.size() && used < room; i++)
+  {
+    AsyncHostConnection *conn = _connections[i];
+
+    fds[used].fd      = conn->fd;
+    fds[used].events  = (conn->state == AsyncHostConnection::STATE_SEND && !conn->out.empty()) ? POLLOUT : POLLIN;
+    fds[used].revents = 0;
+    used++;
+  }
+
+  return used;
+}
+
+void AsyncWebServer::pollDone(struct pollfd *fds, int count)
+{
+  if (count < 1)
+    return;
+
+  // Existing connections first, by descriptor - a handler may open or close others meanwhile
+  for (int i = 1; i < count; i++)
+  {
+    for (size_t c = 0; c < _connections.size(); c++)
+    {
+      AsyncHostConnection *conn = _connections[c];
+
+      if (conn->fd != fds[i].fd)
+        continue;
+
+      if (fds[i].revents & (POLLERR | POLLHUP | POLLNVAL))
+        conn->close();
+      else if (fds[i].revents & POLLIN)
+        conn->readable();
+
+      break;
+    }
+  }
+
+  // Responses that were waiting on a filler (RESPONSE_TRY_AGAIN) or the socket
+  for (size_t c = 0; c < _connections.size(); c++)
+    _connections[c]->pump();
+
+  for (size_t c = 0; c < _connections.size();)
+  {
+    if (_connections[c]->state == AsyncHostConnection::STATE_CLOSED)
+    {
+      delete _connections[c];
+      _connections.erase(_connections.begin() + c);
+    }
+    else
+    {
+      c++;
+    }
+  }
+
+  if (!(fds[0].revents & POLLIN))
+    return;
+
+  while (_connections.size() < HOST_HTTP_CONNECTIONS)
+  {
+    struct sockaddr_in  peer;
+    socklen_t           peerLen = sizeof(peer);
+    int                 fd      = accept(_fd, (struct sockaddr *) &peer, &peerLen);
+
+    if (fd < 0)
+      break;
+
+    int one = 1;
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    _connections.push_back(new AsyncHostConnection(this, fd, peer));
+  }
+}
@@ -0,0 +1,561 @@
+/*
+  ESPAsyncWebServer.h
+  Host (Linux) build
+
+  ESPAsyncWebServer on a non-blocking listening socket on 127.0.0.1 (port 80 -> 8080, see hostPort()).
+  Requests are parsed, handed to the first handler whose filter and canHandle() accept them once the headers
+  (and any url-encoded form body) are in, and the response is streamed out as the socket takes it, then the
+  connection is closed - the same life cycle as the library on AsyncTCP. As in the library, form and multipart bodies
+  are only parsed for a handler that is not isRequestHandlerTrivial(). A second send() on a request aborts, where the
+  library would write a second response. Connections are taken to arrive on the soft AP interface,
+  client()->localIP() is WiFi.softAPIP().
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#pragma once
+
+#include "Arduino.h"
+#include "ESP8266WiFi.h"
+
+#include <functional>
+#include <vector>
+#include <string>
+
+#define RESPONSE_TRY_AGAIN          0xFFFFFFFF
+
+typedef enum
+{
+  HTTP_GET     = 0b00000001,
+  HTTP_POST    = 0b00000010,
+  HTTP_DELETE  = 0b00000100,
+  HTTP_PUT     = 0b00001000,
+  HTTP_PATCH   = 0b00010000,
+  HTTP_HEAD    = 0b00100000,
+  HTTP_OPTIONS = 0b01000000,
+  HTTP_ANY     = 0b01111111
+} WebRequestMethod;
+
+typedef uint8_t WebRequestMethodComposite;
+
+class AsyncWebServer;
+class AsyncWebServerRequest;
+class AsyncWebServerResponse;
+class AsyncWebHandler;
+class AsyncHostConnection;
+
+typedef std::function<void(void)>                                     ArDisconnectHandler;
+typedef std::function<bool(AsyncWebServerRequest *request)>           ArRequestFilterFunction;
+typedef std::function<void(AsyncWebServerRequest *request)>           ArRequestHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest *request, const String &filename, size_t index, uint8_t *data,
+                           size_t len, bool final)>                   ArUploadHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index,
+                           size_t total)>                             ArBodyHandlerFunction;
+typedef std::function<size_t(uint8_t *buffer, size_t maxLen, size_t index)> AwsResponseFiller;
+typedef std::function<String(const String &)>                         AwsTemplateProcessor;
+
+bool ON_STA_FILTER(AsyncWebServerRequest *request);
+bool ON_AP_FILTER(AsyncWebServerRequest *request);
+
+// Host tools - runs one raw HTTP request ("GET / HTTP/1.1\r\n...\r\n\r\nbody") through the server's handlers in-process,
+// without a socket, and returns the raw response
+String hostExchange(AsyncWebServer &server, const String &raw);
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// The TCP connection, as far as handlers get to see it
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class AsyncClient
+{
+  public:
+
+    AsyncClient(AsyncHostConnection *conn) : _conn(conn) {}
+
+    IPAddress     remoteIP();
+    uint16_t      remotePort();
+    IPAddress     localIP();
+    uint16_t      localPort();
+    bool          connected();
+    void          close(bool now = false);
+    size_t        space();
+
+  private:
+
+    AsyncHostConnection *_conn;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Parameters and headers
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class AsyncWebParameter
+{
+  public:
+
+    AsyncWebParameter(const String &name, const String &value, bool form = false, bool file = false, size_t size = 0)
+      : _name(name), _value(value), _size(size), _isForm(form), _isFile(file)
+    {
+    }
+
+    const String& name() const
+    {
+      return _name;
+    }
+
+    const String& value() const
+    {
+      return _value;
+    }
+
+    size_t size() const
+    {
+      return _size;
+    }
+
+    bool isPost() const
+    {
+      return _isForm;
+    }
+
+    bool isFile() const
+    {
+      return _isFile;
+    }
+
+  private:
+
+    String  _name;
+    String  _value;
+    size_t  _size;
+    bool    _isForm;
+    bool    _isFile;
+};
+
+class AsyncWebHeader
+{
+  public:
+
+    AsyncWebHeader(const String &name, const String &value) : _name(name), _value(value) {}
+
+    const String& name() const
+    {
+      return _name;
+    }
+
+    const String& value() const
+    {
+      return _value;
+    }
+
+    String toString() const
+    {
+      return _name + F(": ") + _value + F("\r\n");
+    }
+
+  private:
+
+    String  _name;
+    String  _value;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Request
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class AsyncWebServerRequest
+{
+  friend class AsyncWebServer;
+  friend class AsyncHostConnection;
+
+  public:
+
+    AsyncWebServerRequest(AsyncWebServer *server, AsyncHostConnection *conn);
+    ~AsyncWebServerRequest();
+
+    AsyncClient*        client()
+    {
+      return &_client;
+    }
+
+    uint8_t             version() const
+    {
+      return _version;
+    }
+
+    WebRequestMethodComposite method() const
+    {
+      return _method;
+    }
+
+    const String&       url() const
+    {
+      return _url;
+    }
+
+    const String&       host() const
+    {
+      return _host;
+    }
+
+    const String&       contentType() const
+    {
+      return _contentType;
+    }
+
+    size_t              contentLength() const
+    {
+      return _contentLength;
+    }
+
+    bool                multipart() const
+    {
+      return _isMultipart;
+    }
+
+    const char*         methodToString() const;
+
+    void                onDisconnect(ArDisconnectHandler fn);
+
+    void                redirect(const String &url);
+
+    // HTTP Basic only on the host, requestAuthentication() asks for it whatever isDigest says
+    bool                authenticate(const char *username, const char *password, const char *realm = NULL,
+                                     bool passwordIsHash = false);
+    void                requestAuthentication(const char *realm = NULL, bool isDigest = true);
+
+    void                send(AsyncWebServerResponse *response);
+    void                send(int code, const String &contentType = String(), const String &content = String());
+    void                send_P(int code, const String &contentType, const uint8_t *content, size_t len);
+    void                send_P(int code, const String &contentType, PGM_P content);
+
+    AsyncWebServerResponse* beginResponse(int code, const String &contentType = String(), const String &content = String());
+    AsyncWebServerResponse* beginResponse(const String &contentType, size_t len, AwsResponseFiller callback,
+                                          AwsTemplateProcessor templateCallback = nullptr);
+    AsyncWebServerResponse* beginChunkedResponse(const String &contentType, AwsResponseFiller callback,
+                                                 AwsTemplateProcessor templateCallback = nullptr);
+    class AsyncResponseStream* beginResponseStream(const String &contentType, size_t bufferSize = 1460);
+    AsyncWebServerResponse* beginResponse_P(int code, const String &contentType, const uint8_t *content, size_t len,
+                                            AwsTemplateProcessor callback = nullptr);
+    AsyncWebServerResponse* beginResponse_P(int code, const String &contentType, PGM_P content,
+                                            AwsTemplateProcessor callback = nullptr);
+
+    size_t              headers() const;
+    bool                hasHeader(const String &name) const;
+    bool                hasHeader(const __FlashStringHelper *data) const;
+    AsyncWebHeader*     getHeader(const String &name) const;
+    AsyncWebHeader*     getHeader(const __FlashStringHelper *data) const;
+    AsyncWebHeader*     getHeader(size_t num) const;
+    const String&       header(const char *name) const;
+    const String&       header(size_t i) const;
+    const String&       headerName(size_t i) const;
+
+    size_t              params() const;
+    bool                hasParam(const String &name, bool post = false, bool file = false) const;
+    bool                hasParam(const __FlashStringHelper *data, bool post = false, bool file = false) const;
+    AsyncWebParameter*  getParam(const String &name, bool post = false, bool file = false) const;
+    AsyncWebParameter*  getParam(const __FlashStringHelper *data, bool post, bool file) const;
+    AsyncWebParameter*  getParam(size_t num) const;
+
+    size_t              args() const
+    {
+      return params();
+    }
+
+    const String&       arg(const String &name) const;
+    const String&       arg(const __FlashStringHelper *data) const;
+    const String&       arg(size_t i) const;
+    const String&       argName(size_t i) const;
+    bool                hasArg(const char *name) const;
+    bool                hasArg(const __FlashStringHelper *data) const;
+
+    // Per request storage for handlers (upload state etc.), freed with the request
+    void                *_tempObject;
+
+  private:
+
+    bool                parseHead(const std::string &head);
+    void                addParams(const String &query, bool form);
+    void                handle();
+    void                disconnected();
+
+    AsyncWebServer      *_server;
+    AsyncHostConnection *_conn;
+    AsyncClient         _client;
+    AsyncWebHandler     *_handler;
+    AsyncWebServerResponse *_response;
+    ArDisconnectHandler _onDisconnectfn;
+
+    uint8_t             _version;
+    WebRequestMethodComposite _method;
+    String              _url;
+    String              _host;
+    String              _contentType;
+    String              _boundary;
+    size_t              _contentLength;
+    bool                _isMultipart;
+    bool                _isPlainPost;
+
+    std::vector<AsyncWebHeader *>     _headers;
+    std::vector<AsyncWebParameter *>  _params;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Responses
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class AsyncWebServerResponse
+{
+  friend class AsyncHostConnection;
+
+  public:
+
+    AsyncWebServerResponse();
+    virtual ~AsyncWebServerResponse();
+
+    void                setCode(int code);
+    void                setContentLength(size_t len);
+    void                setContentType(const String &type);
+    void                addHeader(const String &name, const String &value);
+
+    static const __FlashStringHelper* responseCodeToString(int code);
+
+  protected:
+
+    // Head for the request's HTTP version, body bytes [index, index + maxLen), 0 - done, RESPONSE_TRY_AGAIN - later
+    String              assembleHead(uint8_t version);
+    virtual size_t      fill(uint8_t *buffer, size_t maxLen, size_t index);
+
+    int                 _code;
+    String              _contentType;
+    size_t              _contentLength;
+    bool                _sendContentLength;
+    bool                _chunked;
+    std::vector<AsyncWebHeader *> _headers;
+};
+
+class AsyncBasicResponse : public AsyncWebServerResponse
+{
+  public:
+
+    AsyncBasicResponse(int code, const String &contentType = String(), const String &content = String());
+
+  protected:
+
+    virtual size_t      fill(uint8_t *buffer, size_t maxLen, size_t index) override;
+
+  private:
+
+    String              _content;
+};
+
+class AsyncProgmemResponse : public AsyncWebServerResponse
+{
+  public:
+
+    AsyncProgmemResponse(int code, const String &contentType, const uint8_t *content, size_t len);
+
+  protected:
+
+    virtual size_t      fill(uint8_t *buffer, size_t maxLen, size_t index) override;
+
+  private:
+
+    const uint8_t       *_content;
+};
+
+class AsyncCallbackResponse : public AsyncWebServerResponse
+{
+  public:
+
+    AsyncCallbackResponse(const String &contentType, size_t len, AwsResponseFiller callback);
+
+  protected:
+
+    virtual size_t      fill(uint8_t *buffer, size_t maxLen, size_t index) override;
+
+  private:
+
+    AwsResponseFiller   _content;
+};
+
+class AsyncChunkedResponse : public AsyncWebServerResponse
+{
+  public:
+
+    AsyncChunkedResponse(const String &contentType, AwsResponseFiller callback);
+
+  protected:
+
+    virtual size_t      fill(uint8_t *buffer, size_t maxLen, size_t index) override;
+
+  private:
+
+    AwsResponseFiller   _content;
+};
+
+class AsyncResponseStream : public AsyncWebServerResponse, public Print
+{
+  public:
+
+    AsyncResponseStream(const String &contentType, size_t bufferSize);
+
+    size_t              write(const uint8_t *data, size_t len) override;
+    size_t              write(uint8_t data) override;
+
+    using Print::write;
+
+  protected:
+
+    virtual size_t      fill(uint8_t *buffer, size_t maxLen, size_t index) override;
+
+  private:
+
+    std::string         _content;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Handlers
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class AsyncWebHandler
+{
+  public:
+
+    AsyncWebHandler() {}
+    virtual ~AsyncWebHandler() {}
+
+    AsyncWebHandler& setFilter(ArRequestFilterFunction fn)
+    {
+      _filter = fn;
+      return *this;
+    }
+
+    bool filter(AsyncWebServerRequest *request)
+    {
+      return _filter == NULL || _filter(request);
+    }
+
+    virtual bool canHandle(AsyncWebServerRequest *request)
+    {
+      (void) request;
+      return false;
+    }
+
+    virtual void handleRequest(AsyncWebServerRequest *request)
+    {
+      (void) request;
+    }
+
+    virtual void handleUpload(AsyncWebServerRequest *request, const String &filename, size_t index, uint8_t *data, size_t len,
+                              bool final)
+    {
+      (void) request; (void) filename; (void) index; (void) data; (void) len; (void) final;
+    }
+
+    virtual void handleBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total)
+    {
+      (void) request; (void) data; (void) len; (void) index; (void) total;
+    }
+
+    virtual bool isRequestHandlerTrivial()
+    {
+      return true;
+    }
+
+  protected:
+
+    ArRequestFilterFunction _filter;
+};
+
+class AsyncCallbackWebHandler : public AsyncWebHandler
+{
+  public:
+
+    AsyncCallbackWebHandler() : _method(HTTP_ANY) {}
+
+    void setUri(const String &uri)
+    {
+      _uri = uri;
+    }
+
+    void setMethod(WebRequestMethodComposite method)
+    {
+      _method = method;
+    }
+
+    void onRequest(ArRequestHandlerFunction fn)
+    {
+      _onRequest = fn;
+    }
+
+    void onUpload(ArUploadHandlerFunction fn)
+    {
+      _onUpload = fn;
+    }
+
+    void onBody(ArBodyHandlerFunction fn)
+    {
+      _onBody = fn;
+    }
+
+    virtual bool canHandle(AsyncWebServerRequest *request) override;
+    virtual void handleRequest(AsyncWebServerRequest *request) override;
+    virtual void handleUpload(AsyncWebServerRequest *request, const String &filename, size_t index, uint8_t *data, size_t len,
+                              bool final) override;
+    virtual void handleBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) override;
+
+    virtual bool isRequestHandlerTrivial() override
+    {
+      return _onRequest ? false : true;
+    }
+
+  private:
+
+    String                    _uri;
+    WebRequestMethodComposite _method;
+    ArRequestHandlerFunction  _onRequest;
+    ArUploadHandlerFunction   _onUpload;
+    ArBodyHandlerFunction     _onBody;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Server
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class AsyncWebServer : public HostPollable
+{
+  friend class AsyncWebServerRequest;
+  friend class AsyncHostConnection;
+
+  public:
+
+    AsyncWebServer(uint16_t port);
+    ~AsyncWebServer();
+
+    void                begin();
+    void                end();
+
+    AsyncWebHandler&    addHandler(AsyncWebHandler *handler);
+    bool                removeHandler(AsyncWebHandler *handler);
+
+    AsyncCallbackWebHandler& on(const char *uri, ArRequestHandlerFunction onRequest);
+    AsyncCallbackWebHandler& on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest);
+    AsyncCallbackWebHandler& on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest,
+                                ArUploadHandlerFunction onUpload, ArBodyHandlerFunction onBody = nullptr);
+
+    void                onNotFound(ArRequestHandlerFunction fn);
+
+    // Removes (and deletes) every handler
+    void                reset();
+
+    virtual int         pollFds(struct pollfd *fds, int room) override;
+    virtual void        pollDone(struct pollfd *fds, int count) override;
+
+  private:
+
+    void                attachHandler(AsyncWebServerRequest *request);
+
+    uint16_t            _port;
+    int                 _fd;
+    std::vector<AsyncWebHandler *>      _handlers;
+    std::vector<AsyncHostConnection *>  _connections;
+    ArRequestHandlerFunction            _notFound;
+};
+
+#include "AsyncEventSource.h"
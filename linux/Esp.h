@@ -0,0 +1,71 @@
+/*
+  Esp.h
+  Host (Linux) build
+
+  EspClass with a simulated chip: fixed IDs and flash sizes, and a heap the size of the ESP8266's user heap
+  (ENCOMPASS_HOST_HEAP bytes, default 51200) that shrinks with every byte the process has allocated since start.
+  The process's malloc / calloc / realloc / free are counted for it; the peak is printed to stderr on exit.
+
+  RTC user memory (512 bytes) and the reset reason live in the file named by ENCOMPASS_HOST_RTC, when set, so they
+  outlast the process the way the chip's outlast a reset: restart() and reset() come back as a soft restart,
+  deepSleep() as a deep sleep wake, a process killed from outside as an external reset and a run without the file
+  as a power on. The RTC counter runs on the wall clock, it keeps counting while no process does.
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include "WString.h"
+
+struct rst_info;
+
+class EspClass
+{
+  public:
+
+    uint32_t    getChipId();
+    uint32_t    getFlashChipId();
+    uint32_t    getFlashChipSize();
+    uint32_t    getFlashChipRealSize();
+    uint32_t    getFlashChipSpeed();
+    uint8_t     getCpuFreqMHz();
+    uint32_t    getCycleCount();
+    uint32_t    getSketchSize();
+    uint32_t    getFreeSketchSpace();
+    const char* getSdkVersion();
+    String      getCoreVersion();
+    String      getResetReason();
+    struct rst_info*  getResetInfoPtr();
+
+    // offset in 4-byte blocks, size in bytes
+    bool        rtcUserMemoryRead(uint32_t offset, uint32_t *data, size_t size);
+    bool        rtcUserMemoryWrite(uint32_t offset, uint32_t *data, size_t size);
+
+    uint32_t    getFreeHeap();
+    uint32_t    getMaxFreeBlockSize();
+    uint8_t     getHeapFragmentation();
+    void        getHeapStats(uint32_t *free, uint16_t *max, uint8_t *frag);
+
+    // All three end the process - a supervisor (or the developer) starts it again
+    void        reset() __attribute__ ((noreturn));
+    void        restart() __attribute__ ((noreturn));
+    void        deepSleep(uint64_t time_us) __attribute__ ((noreturn));
+};
+
+extern EspClass ESP;
+
+// Host heap accounting - not under AddressSanitizer, which owns malloc (everything reads 0 there)
+struct HostHeapStats
+{
+  uint64_t    allocs;     // allocations since start
+  uint64_t    bytes;      // bytes requested since start
+  uint32_t    used;       // in use now by the sketch (allocated after setup() started)
+  uint32_t    peak;       // most the sketch ever had in use
+};
+
+void  hostHeapStats(HostHeapStats &stats);
@@ -0,0 +1,122 @@
+/*
+  HostLoop.cpp
+  Host (Linux) build
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#include "Arduino.h"
+
+#include <poll.h>
+#include <signal.h>
+#include <vector>
+
+#define HOST_POLL_FDS     64
+
+static volatile sig_atomic_t        hostStop    = 0;
+static bool                         hostPolling = false;
+
+static std::vector<HostPollable *>& hostPollables()
+{
+  static std::vector<HostPollable *> pollables;
+  return pollables;
+}
+
+static void hostSignal(int sig)
+{
+  (void) sig;
+  hostStop = 1;
+}
+
+static void hostInstallSignals()
+{
+  static bool installed = false;
+
+  if (installed)
+    return;
+
+  installed = true;
+
+  signal(SIGINT,  hostSignal);
+  signal(SIGTERM, hostSignal);
+  // A client that goes away mid response must not take the process with it
+  signal(SIGPIPE, SIG_IGN);
+}
+
+void hostRegisterPollable(HostPollable *p)
+{
+  hostInstallSignals();
+  hostPollables().push_back(p);
+}
+
+void hostUnregisterPollable(HostPollable *p)
+{
+  hostPollables().erase(std::remove(hostPollables().begin(), hostPollables().end(), p), hostPollables().end());
+}
+
+void hostPoll(int timeoutMs)
+{
+  struct pollfd   fds[HOST_POLL_FDS];
+  int             counts[HOST_POLL_FDS];
+  HostPollable    *owners[HOST_POLL_FDS];
+  int             used    = 0;
+  int             owned   = 0;
+
+  hostInstallSignals();
+
+  if (hostStop)
+    exit(0);
+
+  for (size_t i = 0; i < hostPollables().size() && used < HOST_POLL_FDS; i++)
+  {
+    int n = hostPollables()[i]->pollFds(&fds[used], HOST_POLL_FDS - used);
+
+    owners[owned]   = hostPollables()[i];
+    counts[owned++] = n;
+    used           += n;
+  }
+
+  // delay() / yield() from inside a callback only waits, callbacks never nest (on the chip delay() there panics)
+  if (used == 0 || hostPolling)
+  {
+    if (timeoutMs > 0)
+      poll(NULL, 0, timeoutMs);
+
+    return;
+  }
+
+  if (poll(fds, used, timeoutMs) < 0)
+    return;
+
+  hostPolling = true;
+
+  // A poller may unregister itself (or another one) from pollDone(), walk the snapshot
+  int base = 0;
+
+  for (int i = 0; i < owned; i++)
+  {
+    if (std::find(hostPollables().begin(), hostPollables().end(), owners[i]) != hostPollables().end())
+      owners[i]->pollDone(&fds[base], counts[i]);
+
+    base += counts[i];
+  }
+
+  hostPolling = false;
+}
+
+uint16_t hostPort(uint16_t port)
+{
+  static int offset = -1;
+
+  if (offset < 0)
+  {
+    const char *env = getenv("ENCOMPASS_HOST_PORT_OFFSET");
+
+    offset = env ? atoi(env) : 8000;
+  }
+
+  // 0 asks for an ephemeral port, as it does of lwIP
+  return (port && port < 1024) ? port + offset : port;
+}
@@ -0,0 +1,38 @@
+/*
+  HostLoop.h
+  Host (Linux) build
+
+  Stands in for the ESP8266 system task. Sockets (HTTP, UDP) register a poller; the pollers run from yield(),
+  delay() and between loop() calls, which is where the ESP8266 runs its lwIP and AsyncTCP callbacks.
+  Everything stays on one thread, so handlers and loop() never run concurrently - same as on the chip.
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+class HostPollable
+{
+  public:
+
+    virtual ~HostPollable() {}
+
+    // Adds this object's descriptors to the poll set (fds[0..room)), returns how many
+    virtual int     pollFds(struct pollfd *fds, int room) = 0;
+
+    // Called after poll() with the same entries
+    virtual void    pollDone(struct pollfd *fds, int count) = 0;
+};
+
+void      hostRegisterPollable(HostPollable *p);
+void      hostUnregisterPollable(HostPollable *p);
+
+// Services every registered socket, waiting up to timeoutMs for activity. Exits the process after SIGINT / SIGTERM.
+void      hostPoll(int timeoutMs);
+
+// Host ports - privileged ports (below 1024) are moved up by ENCOMPASS_HOST_PORT_OFFSET (default 8000), 80 -> 8080
+uint16_t  hostPort(uint16_t port);
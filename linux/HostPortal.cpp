@@ -0,0 +1,99 @@
+/*
+  HostPortal.cpp
+  Host (Linux) build
+
+  The config portal as a sketch would run it - modeless, serviced from loop() - for running the library on a
+  workstation against the simulated radio (see ESP8266WiFi.h for the ENCOMPASS_HOST_* environment).
+
+  ENCOMPASS_HOST_AP_CHANNEL sets the portal's channel, "auto" for AUTO_WIFI_CHANNEL. ENCOMPASS_HOST_NTP names the time
+  service's SNTP server, "host" or "host:port".
+
+  SIGUSR1 stands in for a portal button: it closes the portal, the next one warm-restarts it.
+
+  Built with ENCOMPASS_PROVISIONING, ENCOMPASS_HOST_PROVISION_KEY starts the UDP provisioning listener
+  (extras/provision sends to it). Built with ENCOMPASS_UPDATE, ENCOMPASS_HOST_UPDATE_AUTH="user:pass" opens /update
+  to that user.
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#include "Encompass.h"
+
+#include <signal.h>
+
+AsyncWebServer  webServer(80);
+DNSServer       dnsServer;
+
+Encompass       *encompass;
+
+static volatile sig_atomic_t  buttonPressed = 0;
+static bool                   portalOpen    = true;
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial.println(F("\nEncompass host portal"));
+
+  encompass = new Encompass(&webServer, &dnsServer, "encompass-host");
+
+  encompass->setDebugOutput(true);
+
+  if (getenv("ENCOMPASS_HOST_AP_CHANNEL"))
+  {
+    const char *channel = getenv("ENCOMPASS_HOST_AP_CHANNEL");
+
+    encompass->setConfigPortalChannel(strcmp(channel, "auto") == 0 ? AUTO_WIFI_CHANNEL : atoi(channel));
+  }
+
+#if ENCOMPASS_TIME
+  if (getenv("ENCOMPASS_HOST_NTP"))
+  {
+    String      server(getenv("ENCOMPASS_HOST_NTP"));
+    int         colon = server.indexOf(':');
+    uint16_t    port  = (colon < 0) ? SNTP_PORT : server.substring(colon + 1).toInt();
+
+    encompass->setTimeServer(server.substring(0, colon < 0 ? server.length() : colon).c_str(), port);
+  }
+#endif
+
+#if ENCOMPASS_PROVISIONING
+  if (getenv("ENCOMPASS_HOST_PROVISION_KEY"))
+    encompass->setProvisioningKey(getenv("ENCOMPASS_HOST_PROVISION_KEY"));
+#endif
+
+#if ENCOMPASS_UPDATE
+  if (getenv("ENCOMPASS_HOST_UPDATE_AUTH"))
+  {
+    String  auth(getenv("ENCOMPASS_HOST_UPDATE_AUTH"));
+    int     colon = auth.indexOf(':');
+
+    if (colon > 0)
+      encompass->setUpdateCredentials(auth.substring(0, colon).c_str(), auth.substring(colon + 1).c_str());
+  }
+#endif
+
+  encompass->startConfigPortalModeless("Encompass_Host", "encompass");
+
+  signal(SIGUSR1, [](int) { buttonPressed = 1; });
+
+  Serial.print(F("Portal on http://127.0.0.1:"));
+  Serial.println(hostPort(80));
+}
+
+void loop()
+{
+  if (buttonPressed)
+  {
+    buttonPressed = 0;
+    portalOpen    = !portalOpen;
+
+    if (portalOpen)
+      encompass->restartConfigPortal();
+    else
+      encompass->closeConfigPortal();
+  }
+
+  encompass->loop();
+}
@@ -0,0 +1,103 @@
+/*
+  IPAddress.h
+  Host (Linux) build
+
+  IPv4 only, octets kept in network order in memory like the ESP8266 core (uint32_t conversion is lwIP's ip4_addr).
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#pragma once
+
+#include "Print.h"
+
+class IPAddress : public Printable
+{
+  public:
+
+    IPAddress()
+    {
+      _address.dword = 0;
+    }
+
+    IPAddress(uint8_t first, uint8_t second, uint8_t third, uint8_t fourth)
+    {
+      _address.bytes[0] = first;
+      _address.bytes[1] = second;
+      _address.bytes[2] = third;
+      _address.bytes[3] = fourth;
+    }
+
+    IPAddress(uint32_t address)
+    {
+      _address.dword = address;
+    }
+
+    IPAddress(const uint8_t *address)
+    {
+      memcpy(_address.bytes, address, 4);
+    }
+
+    bool fromString(const char *address);
+
+    bool fromString(const String &address)
+    {
+      return fromString(address.c_str());
+    }
+
+    operator uint32_t() const
+    {
+      return _address.dword;
+    }
+
+    bool operator ==(const IPAddress &addr) const
+    {
+      return _address.dword == addr._address.dword;
+    }
+
+    bool operator !=(const IPAddress &addr) const
+    {
+      return _address.dword != addr._address.dword;
+    }
+
+    bool operator ==(uint32_t addr) const
+    {
+      return _address.dword == addr;
+    }
+
+    bool operator !=(uint32_t addr) const
+    {
+      return _address.dword != addr;
+    }
+
+    uint8_t operator [](int index) const
+    {
+      return _address.bytes[index];
+    }
+
+    uint8_t& operator [](int index)
+    {
+      return _address.bytes[index];
+    }
+
+    bool isSet() const
+    {
+      return _address.dword != 0;
+    }
+
+    String toString() const;
+
+    virtual size_t printTo(Print &p) const override;
+
+  private:
+
+    union
+    {
+      uint8_t   bytes[4];
+      uint32_t  dword;
+    } _address;
+};
+
+extern const IPAddress INADDR_NONE;
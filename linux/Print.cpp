@@ -0,0 +1,256 @@
+/*
+  Print.cpp
+  Host (Linux) build
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#include "Arduino.h"
+
+#include <stdarg.h>
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+  size_t n = 0;
+
+  while (size--)
+  {
+    size_t ret = write(*buffer++);
+
+    if (ret == 0)
+      break;
+
+    n += ret;
+  }
+
+  return n;
+}
+
+static size_t hostVPrintf(Print &out, const char *format, va_list arg)
+{
+  char    buf[64];
+  va_list copy;
+
+  va_copy(copy, arg);
+  int len = vsnprintf(buf, sizeof(buf), format, copy);
+  va_end(copy);
+
+  if (len < 0)
+    return 0;
+
+  if ((size_t) len < sizeof(buf))
+    return out.write((const uint8_t *) buf, len);
+
+  char *p = new char[len + 1];
+  vsnprintf(p, len + 1, format, arg);
+
+  size_t n = out.write((const uint8_t *) p, len);
+
+  delete [] p;
+
+  return n;
+}
+
+size_t Print::printf(const char *format, ...)
+{
+  va_list arg;
+
+  va_start(arg, format);
+  size_t n = hostVPrintf(*this, format, arg);
+  va_end(arg);
+
+  return n;
+}
+
+size_t Print::printf_P(PGM_P format, ...)
+{
+  va_list arg;
+
+  va_start(arg, format);
+  size_t n = hostVPrintf(*this, format, arg);
+  va_end(arg);
+
+  return n;
+}
+
+size_t Print::print(const __FlashStringHelper *ifsh)
+{
+  return write(reinterpret_cast<const char *>(ifsh));
+}
+
+size_t Print::print(const String &s)
+{
+  return write((const uint8_t *) s.c_str(), s.length());
+}
+
+size_t Print::print(const char str[])
+{
+  return write(str);
+}
+
+size_t Print::print(char c)
+{
+  return write((uint8_t) c);
+}
+
+size_t Print::print(unsigned char b, int base)
+{
+  return print((unsigned long) b, base);
+}
+
+size_t Print::print(int n, int base)
+{
+  return print((long) n, base);
+}
+
+size_t Print::print(unsigned int n, int base)
+{
+  return print((unsigned long) n, base);
+}
+
+size_t Print::print(long n, int base)
+{
+  return print(String(n, (unsigned char) base));
+}
+
+size_t Print::print(unsigned long n, int base)
+{
+  return print(String(n, (unsigned char) base));
+}
+
+size_t Print::print(long long n, int base)
+{
+  return print(String(n, (unsigned char) base));
+}
+
+size_t Print::print(unsigned long long n, int base)
+{
+  return print(String(n, (unsigned char) base));
+}
+
+size_t Print::print(double n, int digits)
+{
+  return print(String(n, (unsigned char) digits));
+}
+
+size_t Print::print(const Printable &x)
+{
+  return x.printTo(*this);
+}
+
+size_t Print::println(void)
+{
+  return print("\r\n");
+}
+
+size_t Print::println(const __FlashStringHelper *ifsh)
+{
+  size_t n = print(ifsh);
+  return n + println();
+}
+
+size_t Print::println(const String &s)
+{
+  size_t n = print(s);
+  return n + println();
+}
+
+size_t Print::println(const char c[])
+{
+  size_t n = print(c);
+  return n + println();
+}
+
+size_t Print::println(char c)
+{
+  size_t n = print(c);
+  return n + println();
+}
+
+size_t Print::println(unsigned char b, int base)
+{
+  size_t n = print(b, base);
+  return n + println();
+}
+
+size_t Print::println(int num, int base)
+{
+  size_t n = print(num, base);
+  return n + println();
+}
+
+size_t Print::println(unsigned int num, int base)
+{
+  size_t n = print(num, base);
+  return n + println();
+}
+
+size_t Print::println(long num, int base)
+{
+  size_t n = print(num, base);
+  return n + println();
+}
+
+size_t Print::println(unsigned long num, int base)
+{
+  size_t n = print(num, base);
+  return n + println();
+}
+
+size_t Print::println(long long num, int base)
+{
+  size_t n = print(num, base);
+  return n + println();
+}
+
+size_t Print::println(unsigned long long num, int base)
+{
+  size_t n = print(num, base);
+  return n + println();
+}
+
+size_t Print::println(double num, int digits)
+{
+  size_t n = print(num, digits);
+  return n + println();
+}
+
+size_t Print::println(const Printable &x)
+{
+  size_t n = print(x);
+  return n + println();
+}
+
+size_t Stream::readBytes(char *buffer, size_t length)
+{
+  size_t        count = 0;
+  unsigned long start = millis();
+
+  while (count < length && (millis() - start) < _timeout)
+  {
+    int c = read();
+
+    if (c < 0)
+    {
+      yield();
+      continue;
+    }
+
+    buffer[count++] = (char) c;
+  }
+
+  return count;
+}
+
+String Stream::readString()
+{
+  String  ret;
+  int     c;
+
+  while ((c = read()) >= 0)
+    ret += (char) c;
+
+  return ret;
+}
@@ -0,0 +1,150 @@
+/*
+  Print.h
+  Host (Linux) build
+
+  Arduino Print, Printable and Stream, as in the ESP8266 core.
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "pgmspace.h"
+#include "WString.h"
+
+#define DEC     10
+#define HEX     16
+#define OCT     8
+#define BIN     2
+
+class Print;
+
+class Printable
+{
+  public:
+
+    virtual ~Printable() {}
+    virtual size_t printTo(Print &p) const = 0;
+};
+
+class Print
+{
+  public:
+
+    Print() : _writeError(0) {}
+    virtual ~Print() {}
+
+    int getWriteError()
+    {
+      return _writeError;
+    }
+
+    void clearWriteError()
+    {
+      _writeError = 0;
+    }
+
+    virtual size_t write(uint8_t) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size);
+
+    size_t write(const char *str)
+    {
+      return str ? write((const uint8_t *) str, strlen(str)) : 0;
+    }
+
+    size_t write(const char *buffer, size_t size)
+    {
+      return write((const uint8_t *) buffer, size);
+    }
+
+    // Room left before a write would block, 0 means unknown
+    virtual int availableForWrite()
+    {
+      return 0;
+    }
+
+    virtual void flush() {}
+
+    size_t printf(const char *format, ...) __attribute__ ((format (printf, 2, 3)));
+    size_t printf_P(PGM_P format, ...) __attribute__ ((format (printf, 2, 3)));
+
+    size_t print(const __FlashStringHelper *);
+    size_t print(const String &);
+    size_t print(const char[]);
+    size_t print(char);
+    size_t print(unsigned char, int = DEC);
+    size_t print(int, int = DEC);
+    size_t print(unsigned int, int = DEC);
+    size_t print(long, int = DEC);
+    size_t print(unsigned long, int = DEC);
+    size_t print(long long, int = DEC);
+    size_t print(unsigned long long, int = DEC);
+    size_t print(double, int = 2);
+    size_t print(const Printable &);
+
+    size_t println(const __FlashStringHelper *);
+    size_t println(const String &s);
+    size_t println(const char[]);
+    size_t println(char);
+    size_t println(unsigned char, int = DEC);
+    size_t println(int, int = DEC);
+    size_t println(unsigned int, int = DEC);
+    size_t println(long, int = DEC);
+    size_t println(unsigned long, int = DEC);
+    size_t println(long long, int = DEC);
+    size_t println(unsigned long long, int = DEC);
+    size_t println(double, int = 2);
+    size_t println(const Printable &);
+    size_t println(void);
+
+  protected:
+
+    void setWriteError(int err = 1)
+    {
+      _writeError = err;
+    }
+
+  private:
+
+    int _writeError;
+};
+
+class Stream : public Print
+{
+  public:
+
+    Stream() : _timeout(1000) {}
+
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long timeout)
+    {
+      _timeout = timeout;
+    }
+
+    unsigned long getTimeout() const
+    {
+      return _timeout;
+    }
+
+    virtual size_t readBytes(char *buffer, size_t length);
+
+    size_t readBytes(uint8_t *buffer, size_t length)
+    {
+      return readBytes((char *) buffer, length);
+    }
+
+    virtual String readString();
+
+  protected:
+
+    unsigned long _timeout;
+};
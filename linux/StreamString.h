@@ -0,0 +1,52 @@
+/*
+  StreamString.h
+  Host (Linux) build
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#pragma once
+
+#include "Arduino.h"
+
+class StreamString : public Stream, public String
+{
+  public:
+
+    virtual size_t write(const uint8_t *buffer, size_t size) override
+    {
+      concat((const char *) buffer, size);
+      return size;
+    }
+
+    virtual size_t write(uint8_t data) override
+    {
+      concat((char) data);
+      return 1;
+    }
+
+    using Print::write;
+
+    virtual int available() override
+    {
+      return length();
+    }
+
+    virtual int read() override
+    {
+      if (length() == 0)
+        return -1;
+
+      char c = charAt(0);
+      remove(0, 1);
+
+      return (uint8_t) c;
+    }
+
+    virtual int peek() override
+    {
+      return length() ? (uint8_t) charAt(0) : -1;
+    }
+};
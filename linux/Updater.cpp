@@ -0,0 +1,342 @@
+/*
+  Updater.cpp
+  Host (Linux) build
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#include "Updater.h"
+#include "Esp.h"
+
+UpdaterClass Update;
+
+UpdaterClass::UpdaterClass() : _async(false), _error(UPDATE_ERROR_OK), _size(0), _written(0), _staged(0), _file(NULL),
+                               _bufferLen(0), _md5Bytes(0)
+{
+}
+
+void UpdaterClass::reset()
+{
+  if (_file)
+  {
+    fclose(_file);
+    _file = NULL;
+  }
+
+  _size       = 0;
+  _written    = 0;
+  _bufferLen  = 0;
+  _targetMD5  = String();
+}
+
+bool UpdaterClass::begin(size_t size, int command, int ledPin, uint8_t ledOn)
+{
+  (void) ledPin;
+  (void) ledOn;
+
+  if (_size > 0)
+  {
+    fprintf(stderr, "Update: already running\n");
+    return false;
+  }
+
+  _error = UPDATE_ERROR_OK;
+
+  if (size == 0)
+  {
+    _error = UPDATE_ERROR_SIZE;
+    return false;
+  }
+
+  // The new sketch goes in the free space, one sector is kept back like the core does
+  if (command == U_FLASH && size > ESP.getFreeSketchSpace() - FLASH_SECTOR_SIZE)
+  {
+    _error = UPDATE_ERROR_SPACE;
+    return false;
+  }
+
+  const char *path = getenv("ENCOMPASS_HOST_OTA_FILE");
+
+  if (path && (_file = fopen(path, "wb")) == NULL)
+  {
+    _error = UPDATE_ERROR_ERASE;
+    return false;
+  }
+
+  _size       = size;
+  _written    = 0;
+  _bufferLen  = 0;
+  _staged     = 0;
+
+  md5Begin();
+
+  return true;
+}
+
+bool UpdaterClass::setMD5(const char *expected_md5)
+{
+  if (strlen(expected_md5) != 32)
+    return false;
+
+  _targetMD5 = expected_md5;
+  _targetMD5.toLowerCase();
+
+  return true;
+}
+
+bool UpdaterClass::writeBuffer()
+{
+  if (_file && fwrite(_buffer, 1, _bufferLen, _file) != _bufferLen)
+  {
+    _error = UPDATE_ERROR_WRITE;
+    reset();
+    return false;
+  }
+
+  md5Update(_buffer, _bufferLen);
+
+  _written    += _bufferLen;
+  _bufferLen  = 0;
+
+  return true;
+}
+
+size_t UpdaterClass::write(uint8_t *data, size_t len)
+{
+  if (hasError() || !isRunning())
+    return 0;
+
+  if (len > remaining())
+  {
+    _error = UPDATE_ERROR_SPACE;
+    reset();
+    return 0;
+  }
+
+  // An ESP8266 image starts with 0xE9
+  if (_written == 0 && _bufferLen == 0 && len && data[0] != 0xE9)
+  {
+    _error = UPDATE_ERROR_MAGIC_BYTE;
+    reset();
+    return 0;
+  }
+
+  size_t left = len;
+
+  while (left)
+  {
+    size_t n = std::min(left, (size_t) FLASH_SECTOR_SIZE - _bufferLen);
+
+    memcpy(&_buffer[_bufferLen], data + (len - left), n);
+    _bufferLen  += n;
+    left        -= n;
+
+    if ((_bufferLen == FLASH_SECTOR_SIZE || _written + _bufferLen == _size) && !writeBuffer())
+      return len - left - n;
+  }
+
+  return len;
+}
+
+bool UpdaterClass::end(bool evenIfRemaining)
+{
+  if (_size == 0)
+    return false;
+
+  if (hasError() || (!evenIfRemaining && _written + _bufferLen != _size))
+  {
+    if (!hasError())
+      _error = UPDATE_ERROR_SIZE;
+
+    reset();
+    return false;
+  }
+
+  if (_bufferLen && !writeBuffer())
+    return false;
+
+  if (_written == 0)
+  {
+    _error = UPDATE_ERROR_NO_DATA;
+    reset();
+    return false;
+  }
+
+  if (_targetMD5.length() && _targetMD5 != md5String())
+  {
+    _error = UPDATE_ERROR_MD5;
+    reset();
+    return false;
+  }
+
+  _staged = _written;
+
+  fprintf(stderr, "Update: %u bytes staged for the next restart\n", (unsigned) _staged);
+
+  reset();
+
+  return true;
+}
+
+String UpdaterClass::getErrorString() const
+{
+  switch (_error)
+  {
+    case UPDATE_ERROR_OK:         return F("No Error");
+    case UPDATE_ERROR_WRITE:      return F("Flash Write Failed");
+    case UPDATE_ERROR_ERASE:      return F("Flash Erase Failed");
+    case UPDATE_ERROR_READ:       return F("Flash Read Failed");
+    case UPDATE_ERROR_SPACE:      return F("Not Enough Space");
+    case UPDATE_ERROR_SIZE:       return F("Bad Size Given");
+    case UPDATE_ERROR_STREAM:     return F("Stream Read Timeout");
+    case UPDATE_ERROR_MD5:        return F("MD5 Check Failed");
+    case UPDATE_ERROR_MAGIC_BYTE: return F("Magic byte is wrong, not 0xE9");
+    case UPDATE_ERROR_NO_DATA:    return F("No data supplied");
+    default:                      return F("UNKNOWN");
+  }
+}
+
+void UpdaterClass::printError(Print &out)
+{
+  out.println(getErrorString());
+}
+
+String UpdaterClass::md5String()
+{
+  // Of what has been written so far, the running state is left alone
+  uint32_t  state[4];
+  uint8_t   block[64];
+  uint64_t  bytes = _md5Bytes;
+  uint8_t   digest[16];
+  char      hex[33];
+
+  memcpy(state, _md5State, sizeof(state));
+  memcpy(block, _md5Block, sizeof(block));
+
+  md5Finish(digest);
+
+  memcpy(_md5State, state, sizeof(state));
+  memcpy(_md5Block, block, sizeof(block));
+  _md5Bytes = bytes;
+
+  for (int i = 0; i < 16; i++)
+    snprintf(&hex[2 * i], 3, "%02x", digest[i]);
+
+  return String(hex);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// MD5
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void UpdaterClass::md5Begin()
+{
+  _md5State[0]  = 0x67452301;
+  _md5State[1]  = 0xefcdab89;
+  _md5State[2]  = 0x98badcfe;
+  _md5State[3]  = 0x10325476;
+  _md5Bytes     = 0;
+}
+
+void UpdaterClass::md5Update(const uint8_t *data, size_t len)
+{
+  while (len)
+  {
+    size_t used = _md5Bytes % 64;
+    size_t n    = std::min(len, 64 - used);
+
+    memcpy(&_md5Block[used], data, n);
+    _md5Bytes += n;
+    data      += n;
+    len       -= n;
+
+    if (used + n == 64)
+      md5Transform(_md5Block);
+  }
+}
+
+void UpdaterClass::md5Finish(uint8_t digest[16])
+{
+  uint64_t  bits  = _md5Bytes * 8;
+  uint8_t   pad   = 0x80;
+  uint8_t   zero  = 0;
+  uint8_t   length[8];
+
+  for (int i = 0; i < 8; i++)
+    length[i] = (uint8_t) (bits >> (8 * i));
+
+  md5Update(&pad, 1);
+
+  while (_md5Bytes % 64 != 56)
+    md5Update(&zero, 1);
+
+  md5Update(length, 8);
+
+  for (int i = 0; i < 16; i++)
+    digest[i] = (uint8_t) (_md5State[i / 4] >> (8 * (i % 4)));
+}
+
+void UpdaterClass::md5Transform(const uint8_t *block)
+{
+  static const uint32_t K[64] =
+  {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+  };
+
+  static const uint8_t S[16] = { 7, 12, 17, 22, 5, 9, 14, 20, 4, 11, 16, 23, 6, 10, 15, 21 };
+
+  uint32_t m[16];
+  uint32_t a = _md5State[0], b = _md5State[1], c = _md5State[2], d = _md5State[3];
+
+  for (int i = 0; i < 16; i++)
+    m[i] = block[4 * i] | (block[4 * i + 1] << 8) | (block[4 * i + 2] << 16) | ((uint32_t) block[4 * i + 3] << 24);
+
+  for (int i = 0; i < 64; i++)
+  {
+    uint32_t f;
+    int      g;
+
+    if (i < 16)
+    {
+      f = (b & c) | (~b & d);
+      g = i;
+    }
+    else if (i < 32)
+    {
+      f = (d & b) | (~d & c);
+      g = (5 * i + 1) % 16;
+    }
+    else if (i < 48)
+    {
+      f = b ^ c ^ d;
+      g = (3 * i + 5) % 16;
+    }
+    else
+    {
+      f = c ^ (b | ~d);
+      g = (7 * i) % 16;
+    }
+
+    uint8_t  s    = S[(i / 16) * 4 + i % 4];
+    uint32_t sum  = a + f + K[i] + m[g];
+
+    a = d;
+    d = c;
+    c = b;
+    b = b + ((sum << s) | (sum >> (32 - s)));
+  }
+
+  _md5State[0] += a;
+  _md5State[1] += b;
+  _md5State[2] += c;
+  _md5State[3] += d;
+}
@@ -0,0 +1,135 @@
+/*
+  Updater.h
+  Host (Linux) build
+
+  The core's UpdaterClass against a simulated flash. Like the real one it checks the image's magic byte, buffers one
+  flash sector and writes it out when full, keeps an MD5 of what it wrote for setMD5(), and only stages the image
+  (end()) when all of that holds. Sectors go to the file named by ENCOMPASS_HOST_OTA_FILE, or nowhere.
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#pragma once
+
+#include "Arduino.h"
+
+#include <stdio.h>
+
+#define UPDATE_ERROR_OK                 (0)
+#define UPDATE_ERROR_WRITE              (1)
+#define UPDATE_ERROR_ERASE              (2)
+#define UPDATE_ERROR_READ               (3)
+#define UPDATE_ERROR_SPACE              (4)
+#define UPDATE_ERROR_SIZE               (5)
+#define UPDATE_ERROR_STREAM             (6)
+#define UPDATE_ERROR_MD5                (7)
+#define UPDATE_ERROR_FLASH_CONFIG       (8)
+#define UPDATE_ERROR_NEW_FLASH_CONFIG   (9)
+#define UPDATE_ERROR_MAGIC_BYTE         (10)
+#define UPDATE_ERROR_BOOTSTRAP          (11)
+#define UPDATE_ERROR_SIGN               (12)
+#define UPDATE_ERROR_NO_DATA            (13)
+
+#define U_FLASH                         0
+#define U_FS                            100
+
+#define FLASH_SECTOR_SIZE               0x1000
+
+class UpdaterClass
+{
+  public:
+
+    UpdaterClass();
+
+    // The core needs this from an async (TCP callback) context, the host only records it
+    void          runAsync(bool async)
+    {
+      _async = async;
+    }
+
+    bool          begin(size_t size, int command = U_FLASH, int ledPin = -1, uint8_t ledOn = LOW);
+    bool          setMD5(const char *expected_md5);
+    size_t        write(uint8_t *data, size_t len);
+    bool          end(bool evenIfRemaining = false);
+
+    void          printError(Print &out);
+    String        getErrorString() const;
+
+    bool          hasError()
+    {
+      return _error != UPDATE_ERROR_OK;
+    }
+
+    uint8_t       getError()
+    {
+      return _error;
+    }
+
+    void          clearError()
+    {
+      _error = UPDATE_ERROR_OK;
+    }
+
+    bool          isRunning()
+    {
+      return _size > 0;
+    }
+
+    bool          isFinished()
+    {
+      return _size > 0 && _written == _size;
+    }
+
+    size_t        size()
+    {
+      return _size;
+    }
+
+    size_t        progress()
+    {
+      return _written;
+    }
+
+    size_t        remaining()
+    {
+      return _size - _written;
+    }
+
+    String        md5String();
+
+    // Host only - bytes of the last image end() staged, 0 for none
+    size_t        hostStaged()
+    {
+      return _staged;
+    }
+
+  private:
+
+    void          reset();
+    bool          writeBuffer();
+
+    bool          _async;
+    uint8_t       _error;
+    size_t        _size;
+    size_t        _written;
+    size_t        _staged;
+    FILE          *_file;
+
+    uint8_t       _buffer[FLASH_SECTOR_SIZE];
+    size_t        _bufferLen;
+
+    // MD5 of the image so far (RFC 1321)
+    uint32_t      _md5State[4];
+    uint8_t       _md5Block[64];
+    uint64_t      _md5Bytes;
+    String        _targetMD5;
+
+    void          md5Begin();
+    void          md5Update(const uint8_t *data, size_t len);
+    void          md5Finish(uint8_t digest[16]);
+    void          md5Transform(const uint8_t *block);
+};
+
+extern UpdaterClass Update;
@@ -0,0 +1,447 @@
+/*
+  WString.cpp
+  Host (Linux) build
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#include "Arduino.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <algorithm>
+
+static std::string hostNumber(unsigned long long value, bool negative, unsigned char base)
+{
+  char  buf[66];
+  char  *p = &buf[sizeof(buf) - 1];
+
+  if (base < 2)
+    base = 10;
+
+  *p = 0;
+
+  do
+  {
+    unsigned digit = value % base;
+
+    *--p  = (digit < 10) ? '0' + digit : 'a' + digit - 10;
+    value /= base;
+  } while (value);
+
+  if (negative)
+    *--p = '-';
+
+  return std::string(p);
+}
+
+static std::string hostSigned(long long value, unsigned char base)
+{
+  // Like the core, only base 10 is signed, other bases print the two's complement
+  if (base == 10 && value < 0)
+    return hostNumber(0ULL - (unsigned long long) value, true, base);
+
+  return hostNumber((unsigned long long) value, false, base);
+}
+
+static std::string hostFloat(double value, unsigned char decimalPlaces)
+{
+  char buf[64];
+
+  snprintf(buf, sizeof(buf), "%.*f", decimalPlaces, value);
+
+  return std::string(buf);
+}
+
+String::String(const char *cstr) : _s(cstr ? cstr : "")
+{
+}
+
+String::String(const char *cstr, size_t length) : _s(cstr ? std::string(cstr, length) : std::string())
+{
+}
+
+String::String(const String &str) : _s(str._s)
+{
+}
+
+String::String(String &&str) : _s(std::move(str._s))
+{
+}
+
+String::String(StringSumHelper &&rval) : _s(std::move(rval._s))
+{
+}
+
+String::String(const __FlashStringHelper *str) : _s(str ? reinterpret_cast<const char *>(str) : "")
+{
+}
+
+String::String(char c) : _s(1, c)
+{
+}
+
+String::String(unsigned char value, unsigned char base) : _s(hostNumber(value, false, base))
+{
+}
+
+String::String(int value, unsigned char base) : _s(hostSigned(value, base))
+{
+}
+
+String::String(unsigned int value, unsigned char base) : _s(hostNumber(value, false, base))
+{
+}
+
+String::String(long value, unsigned char base) : _s(hostSigned(value, base))
+{
+}
+
+String::String(unsigned long value, unsigned char base) : _s(hostNumber(value, false, base))
+{
+}
+
+String::String(long long value, unsigned char base) : _s(hostSigned(value, base))
+{
+}
+
+String::String(unsigned long long value, unsigned char base) : _s(hostNumber(value, false, base))
+{
+}
+
+String::String(float value, unsigned char decimalPlaces) : _s(hostFloat(value, decimalPlaces))
+{
+}
+
+String::String(double value, unsigned char decimalPlaces) : _s(hostFloat(value, decimalPlaces))
+{
+}
+
+String& String::operator =(const String &rhs)
+{
+  _s = rhs._s;
+  return *this;
+}
+
+String& String::operator =(String &&rval)
+{
+  _s = std::move(rval._s);
+  return *this;
+}
+
+String& String::operator =(const char *cstr)
+{
+  _s = cstr ? cstr : "";
+  return *this;
+}
+
+String& String::operator =(const __FlashStringHelper *str)
+{
+  _s = str ? reinterpret_cast<const char *>(str) : "";
+  return *this;
+}
+
+String& String::operator =(char c)
+{
+  _s.assign(1, c);
+  return *this;
+}
+
+unsigned char String::reserve(unsigned int size)
+{
+  _s.reserve(size);
+  return 1;
+}
+
+unsigned char String::concat(const String &str)
+{
+  _s += str._s;
+  return 1;
+}
+
+unsigned char String::concat(const char *cstr)
+{
+  if (cstr == NULL)
+    return 0;
+
+  _s += cstr;
+  return 1;
+}
+
+unsigned char String::concat(const char *cstr, unsigned int length)
+{
+  if (cstr == NULL)
+    return 0;
+
+  _s.append(cstr, length);
+  return 1;
+}
+
+unsigned char String::concat(const __FlashStringHelper *str)
+{
+  return concat(reinterpret_cast<const char *>(str));
+}
+
+unsigned char String::concat(char c)
+{
+  _s += c;
+  return 1;
+}
+
+unsigned char String::concat(unsigned char num)
+{
+  _s += hostNumber(num, false, 10);
+  return 1;
+}
+
+unsigned char String::concat(int num)
+{
+  _s += hostSigned(num, 10);
+  return 1;
+}
+
+unsigned char String::concat(unsigned int num)
+{
+  _s += hostNumber(num, false, 10);
+  return 1;
+}
+
+unsigned char String::concat(long num)
+{
+  _s += hostSigned(num, 10);
+  return 1;
+}
+
+unsigned char String::concat(unsigned long num)
+{
+  _s += hostNumber(num, false, 10);
+  return 1;
+}
+
+unsigned char String::concat(long long num)
+{
+  _s += hostSigned(num, 10);
+  return 1;
+}
+
+unsigned char String::concat(unsigned long long num)
+{
+  _s += hostNumber(num, false, 10);
+  return 1;
+}
+
+unsigned char String::concat(float num)
+{
+  _s += hostFloat(num, 2);
+  return 1;
+}
+
+unsigned char String::concat(double num)
+{
+  _s += hostFloat(num, 2);
+  return 1;
+}
+
+int String::compareTo(const String &s) const
+{
+  return strcmp(c_str(), s.c_str());
+}
+
+unsigned char String::equals(const String &s) const
+{
+  return _s == s._s;
+}
+
+unsigned char String::equals(const char *cstr) const
+{
+  return _s == (cstr ? cstr : "");
+}
+
+unsigned char String::equalsIgnoreCase(const String &s) const
+{
+  return (length() == s.length()) && (strcasecmp(c_str(), s.c_str()) == 0);
+}
+
+unsigned char String::startsWith(const String &prefix) const
+{
+  return startsWith(prefix, 0);
+}
+
+unsigned char String::startsWith(const String &prefix, unsigned int offset) const
+{
+  return (offset + prefix.length() <= length()) && (_s.compare(offset, prefix.length(), prefix._s) == 0);
+}
+
+unsigned char String::endsWith(const String &suffix) const
+{
+  return (suffix.length() <= length()) && (_s.compare(length() - suffix.length(), suffix.length(), suffix._s) == 0);
+}
+
+char String::charAt(unsigned int index) const
+{
+  return (index < length()) ? _s[index] : 0;
+}
+
+void String::setCharAt(unsigned int index, char c)
+{
+  if (index < length())
+    _s[index] = c;
+}
+
+char String::operator [](unsigned int index) const
+{
+  return charAt(index);
+}
+
+char& String::operator [](unsigned int index)
+{
+  static char dummy;
+
+  if (index >= length())
+  {
+    dummy = 0;
+    return dummy;
+  }
+
+  return _s[index];
+}
+
+void String::getBytes(unsigned char *buf, unsigned int bufsize, unsigned int index) const
+{
+  if (bufsize == 0 || buf == NULL)
+    return;
+
+  if (index >= length())
+  {
+    buf[0] = 0;
+    return;
+  }
+
+  unsigned int n = std::min<unsigned int>(bufsize - 1, length() - index);
+
+  memcpy(buf, c_str() + index, n);
+  buf[n] = 0;
+}
+
+int String::indexOf(char ch, unsigned int fromIndex) const
+{
+  size_t pos = _s.find(ch, fromIndex);
+
+  return (pos == std::string::npos) ? -1 : (int) pos;
+}
+
+int String::indexOf(const String &str, unsigned int fromIndex) const
+{
+  size_t pos = _s.find(str._s, fromIndex);
+
+  return (pos == std::string::npos) ? -1 : (int) pos;
+}
+
+int String::lastIndexOf(char ch) const
+{
+  return lastIndexOf(ch, length() - 1);
+}
+
+int String::lastIndexOf(char ch, unsigned int fromIndex) const
+{
+  size_t pos = _s.rfind(ch, fromIndex);
+
+  return (pos == std::string::npos) ? -1 : (int) pos;
+}
+
+int String::lastIndexOf(const String &str) const
+{
+  return lastIndexOf(str, length() - str.length());
+}
+
+int String::lastIndexOf(const String &str, unsigned int fromIndex) const
+{
+  size_t pos = _s.rfind(str._s, fromIndex);
+
+  return (pos == std::string::npos) ? -1 : (int) pos;
+}
+
+String String::substring(unsigned int beginIndex, unsigned int endIndex) const
+{
+  if (beginIndex > endIndex)
+    std::swap(beginIndex, endIndex);
+
+  if (beginIndex >= length())
+    return String();
+
+  endIndex = std::min(endIndex, length());
+
+  return String(c_str() + beginIndex, endIndex - beginIndex);
+}
+
+void String::replace(char find, char replace)
+{
+  std::replace(_s.begin(), _s.end(), find, replace);
+}
+
+void String::replace(const String &find, const String &replace)
+{
+  if (find.length() == 0)
+    return;
+
+  size_t pos = 0;
+
+  while ((pos = _s.find(find._s, pos)) != std::string::npos)
+  {
+    _s.replace(pos, find.length(), replace._s);
+    pos += replace.length();
+  }
+}
+
+void String::remove(unsigned int index)
+{
+  remove(index, (unsigned int) -1);
+}
+
+void String::remove(unsigned int index, unsigned int count)
+{
+  if (index < length())
+    _s.erase(index, std::min(count, length() - index));
+}
+
+void String::toLowerCase(void)
+{
+  for (size_t i = 0; i < _s.length(); i++)
+    _s[i] = tolower((unsigned char) _s[i]);
+}
+
+void String::toUpperCase(void)
+{
+  for (size_t i = 0; i < _s.length(); i++)
+    _s[i] = toupper((unsigned char) _s[i]);
+}
+
+void String::trim(void)
+{
+  size_t first = _s.find_first_not_of(" \t\r\n\f\v");
+
+  if (first == std::string::npos)
+  {
+    _s.clear();
+    return;
+  }
+
+  _s = _s.substr(first, _s.find_last_not_of(" \t\r\n\f\v") - first + 1);
+}
+
+long String::toInt(void) const
+{
+  return atol(c_str());
+}
+
+float String::toFloat(void) const
+{
+  return atof(c_str());
+}
+
+double String::toDouble(void) const
+{
+  return atof(c_str());
+}
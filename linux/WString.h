@@ -0,0 +1,264 @@
+/*
+  WString.h
+  Host (Linux) build
+
+  Arduino String on top of std::string, with the ESP8266 core's interface and conversions.
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <utility>
+
+class __FlashStringHelper;
+
+#define FPSTR(pstr_pointer)   (reinterpret_cast<const __FlashStringHelper *>(pstr_pointer))
+#define F(string_literal)     (FPSTR(PSTR(string_literal)))
+
+class StringSumHelper;
+
+class String
+{
+  public:
+
+    String(const char *cstr = "");
+    String(const char *cstr, size_t length);
+    String(const String &str);
+    String(String &&str);
+    String(StringSumHelper &&rval);
+    String(const __FlashStringHelper *str);
+    explicit String(char c);
+    explicit String(unsigned char value, unsigned char base = 10);
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(long long value, unsigned char base = 10);
+    explicit String(unsigned long long value, unsigned char base = 10);
+    explicit String(float value, unsigned char decimalPlaces = 2);
+    explicit String(double value, unsigned char decimalPlaces = 2);
+
+    String& operator =(const String &rhs);
+    String& operator =(String &&rval);
+    String& operator =(const char *cstr);
+    String& operator =(const __FlashStringHelper *str);
+    String& operator =(char c);
+
+    unsigned char reserve(unsigned int size);
+
+    unsigned int length() const
+    {
+      return _s.length();
+    }
+
+    bool isEmpty() const
+    {
+      return _s.empty();
+    }
+
+    const char* c_str() const
+    {
+      return _s.c_str();
+    }
+
+    char* begin()
+    {
+      return &_s[0];
+    }
+
+    char* end()
+    {
+      return &_s[0] + _s.length();
+    }
+
+    const char* begin() const
+    {
+      return c_str();
+    }
+
+    const char* end() const
+    {
+      return c_str() + length();
+    }
+
+    unsigned char concat(const String &str);
+    unsigned char concat(const char *cstr);
+    unsigned char concat(const char *cstr, unsigned int length);
+    unsigned char concat(const __FlashStringHelper *str);
+    unsigned char concat(char c);
+    unsigned char concat(unsigned char c);
+    unsigned char concat(int num);
+    unsigned char concat(unsigned int num);
+    unsigned char concat(long num);
+    unsigned char concat(unsigned long num);
+    unsigned char concat(long long num);
+    unsigned char concat(unsigned long long num);
+    unsigned char concat(float num);
+    unsigned char concat(double num);
+
+    template <typename T>
+    String& operator +=(const T &rhs)
+    {
+      concat(rhs);
+      return *this;
+    }
+
+    int compareTo(const String &s) const;
+    unsigned char equals(const String &s) const;
+    unsigned char equals(const char *cstr) const;
+    unsigned char equalsIgnoreCase(const String &s) const;
+    unsigned char startsWith(const String &prefix) const;
+    unsigned char startsWith(const String &prefix, unsigned int offset) const;
+    unsigned char endsWith(const String &suffix) const;
+
+    unsigned char operator ==(const String &rhs) const
+    {
+      return equals(rhs);
+    }
+
+    unsigned char operator ==(const char *cstr) const
+    {
+      return equals(cstr);
+    }
+
+    unsigned char operator !=(const String &rhs) const
+    {
+      return !equals(rhs);
+    }
+
+    unsigned char operator !=(const char *cstr) const
+    {
+      return !equals(cstr);
+    }
+
+    unsigned char operator <(const String &rhs) const
+    {
+      return compareTo(rhs) < 0;
+    }
+
+    unsigned char operator >(const String &rhs) const
+    {
+      return compareTo(rhs) > 0;
+    }
+
+    char charAt(unsigned int index) const;
+    void setCharAt(unsigned int index, char c);
+    char operator [](unsigned int index) const;
+    char& operator [](unsigned int index);
+
+    void getBytes(unsigned char *buf, unsigned int bufsize, unsigned int index = 0) const;
+
+    void toCharArray(char *buf, unsigned int bufsize, unsigned int index = 0) const
+    {
+      getBytes((unsigned char *) buf, bufsize, index);
+    }
+
+    int indexOf(char ch, unsigned int fromIndex = 0) const;
+    int indexOf(const String &str, unsigned int fromIndex = 0) const;
+    int lastIndexOf(char ch) const;
+    int lastIndexOf(char ch, unsigned int fromIndex) const;
+    int lastIndexOf(const String &str) const;
+    int lastIndexOf(const String &str, unsigned int fromIndex) const;
+
+    String substring(unsigned int beginIndex) const
+    {
+      return substring(beginIndex, length());
+    }
+
+    String substring(unsigned int beginIndex, unsigned int endIndex) const;
+
+    void replace(char find, char replace);
+    void replace(const String &find, const String &replace);
+    void remove(unsigned int index);
+    void remove(unsigned int index, unsigned int count);
+    void toLowerCase(void);
+    void toUpperCase(void);
+    void trim(void);
+
+    long toInt(void) const;
+    float toFloat(void) const;
+    double toDouble(void) const;
+
+  protected:
+
+    std::string _s;
+};
+
+class StringSumHelper : public String
+{
+  public:
+
+    StringSumHelper(const String &s) : String(s) {}
+    StringSumHelper(const char *p) : String(p) {}
+    StringSumHelper(const __FlashStringHelper *p) : String(p) {}
+    StringSumHelper(char c) : String(c) {}
+    StringSumHelper(unsigned char num) : String(num) {}
+    StringSumHelper(int num) : String(num) {}
+    StringSumHelper(unsigned int num) : String(num) {}
+    StringSumHelper(long num) : String(num) {}
+    StringSumHelper(unsigned long num) : String(num) {}
+    StringSumHelper(long long num) : String(num) {}
+    StringSumHelper(unsigned long long num) : String(num) {}
+    StringSumHelper(float num) : String(num) {}
+    StringSumHelper(double num) : String(num) {}
+};
+
+inline bool operator ==(const char *lhs, const String &rhs)
+{
+  return rhs.equals(lhs);
+}
+
+inline bool operator !=(const char *lhs, const String &rhs)
+{
+  return !rhs.equals(lhs);
+}
+
+// "literal" + String, the core's operator + on a StringSumHelper temporary
+inline StringSumHelper operator +(const char *lhs, const String &rhs)
+{
+  StringSumHelper s(lhs);
+  s.concat(rhs);
+  return s;
+}
+
+inline StringSumHelper operator +(const __FlashStringHelper *lhs, const String &rhs)
+{
+  StringSumHelper s(lhs);
+  s.concat(rhs);
+  return s;
+}
+
+inline StringSumHelper operator +(char lhs, const String &rhs)
+{
+  StringSumHelper s(lhs);
+  s.concat(rhs);
+  return s;
+}
+
+inline StringSumHelper operator +(const String &lhs, const String &rhs)
+{
+  StringSumHelper s(lhs);
+  s.concat(rhs);
+  return s;
+}
+
+template <typename T>
+inline StringSumHelper operator +(const String &lhs, const T &rhs)
+{
+  StringSumHelper s(lhs);
+  s.concat(rhs);
+  return s;
+}
+
+template <typename T>
+inline StringSumHelper operator +(StringSumHelper &&lhs, const T &rhs)
+{
+  lhs.concat(rhs);
+  return std::move(lhs);
+}
@@ -0,0 +1,229 @@
+/*
+  WiFiUdp.cpp
+  Host (Linux) build
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#include "WiFiUdp.h"
+#include "ESP8266WiFi.h"
+
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+WiFiUDP::WiFiUDP() : _fd(-1), _localPort(0), _rxLen(0), _rxPos(0), _remoteIP(0), _remotePort(0), _txLen(0), _txOpen(false),
+                     _txIP(0), _txPort(0)
+{
+}
+
+WiFiUDP::~WiFiUDP()
+{
+  stop();
+}
+
+uint8_t WiFiUDP::begin(uint16_t port)
+{
+  stop();
+
+  _fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+  if (_fd < 0)
+    return 0;
+
+  int one = 1;
+
+  setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL) | O_NONBLOCK);
+
+  struct sockaddr_in addr;
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family       = AF_INET;
+  addr.sin_port         = htons(hostPort(port));
+  addr.sin_addr.s_addr  = htonl(INADDR_LOOPBACK);
+
+  if (bind(_fd, (struct sockaddr *) &addr, sizeof(addr)) < 0)
+  {
+    close(_fd);
+    _fd = -1;
+    return 0;
+  }
+
+  _localPort = port;
+  hostRegisterPollable(this);
+
+  return 1;
+}
+
+void WiFiUDP::stop()
+{
+  if (_fd >= 0)
+  {
+    hostUnregisterPollable(this);
+    close(_fd);
+    _fd = -1;
+  }
+
+  _rxLen  = 0;
+  _rxPos  = 0;
+  _txOpen = false;
+}
+
+int WiFiUDP::beginPacket(IPAddress ip, uint16_t port)
+{
+  // Sending without begin() uses an ephemeral socket, like lwIP
+  if (_fd < 0)
+  {
+    _fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+    if (_fd < 0)
+      return 0;
+
+    fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL) | O_NONBLOCK);
+    hostRegisterPollable(this);
+  }
+
+  _txIP   = ip;
+  _txPort = port;
+  _txLen  = 0;
+  _txOpen = true;
+
+  return 1;
+}
+
+int WiFiUDP::beginPacket(const char *host, uint16_t port)
+{
+  IPAddress ip;
+
+  if (!ip.fromString(host) && !WiFi.hostByName(host, ip))
+    return 0;
+
+  return beginPacket(ip, port);
+}
+
+int WiFiUDP::endPacket()
+{
+  if (!_txOpen)
+    return 0;
+
+  _txOpen = false;
+
+  struct sockaddr_in addr;
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family       = AF_INET;
+  addr.sin_port         = htons(_txPort);
+  addr.sin_addr.s_addr  = _txIP;
+
+  return sendto(_fd, _tx, _txLen, 0, (struct sockaddr *) &addr, sizeof(addr)) == (ssize_t) _txLen;
+}
+
+size_t WiFiUDP::write(uint8_t c)
+{
+  return write(&c, 1);
+}
+
+size_t WiFiUDP::write(const uint8_t *buffer, size_t size)
+{
+  if (!_txOpen)
+    return 0;
+
+  size_t n = std::min(size, sizeof(_tx) - _txLen);
+
+  memcpy(&_tx[_txLen], buffer, n);
+  _txLen += n;
+
+  return n;
+}
+
+int WiFiUDP::parsePacket()
+{
+  _rxLen = 0;
+  _rxPos = 0;
+
+  if (_fd < 0)
+    return 0;
+
+  struct sockaddr_in  from;
+  socklen_t           fromLen = sizeof(from);
+  ssize_t             n       = recvfrom(_fd, _rx, sizeof(_rx), 0, (struct sockaddr *) &from, &fromLen);
+
+  if (n <= 0)
+    return 0;
+
+  _rxLen      = n;
+  _remoteIP   = from.sin_addr.s_addr;
+  _remotePort = ntohs(from.sin_port);
+
+  return n;
+}
+
+int WiFiUDP::available()
+{
+  return _rxLen - _rxPos;
+}
+
+int WiFiUDP::read()
+{
+  return (_rxPos < _rxLen) ? _rx[_rxPos++] : -1;
+}
+
+int WiFiUDP::read(unsigned char *buffer, size_t len)
+{
+  size_t n = std::min(len, _rxLen - _rxPos);
+
+  memcpy(buffer, &_rx[_rxPos], n);
+  _rxPos += n;
+
+  return n;
+}
+
+int WiFiUDP::peek()
+{
+  return (_rxPos < _rxLen) ? _rx[_rxPos] : -1;
+}
+
+void WiFiUDP::flush()
+{
+  // The core's flush() ends the packet being written
+  endPacket();
+}
+
+IPAddress WiFiUDP::remoteIP()
+{
+  return IPAddress(_remoteIP);
+}
+
+uint16_t WiFiUDP::remotePort()
+{
+  return _remotePort;
+}
+
+uint16_t WiFiUDP::localPort()
+{
+  return _localPort;
+}
+
+int WiFiUDP::pollFds(struct pollfd *fds, int room)
+{
+  if (_fd < 0 || room < 1)
+    return 0;
+
+  fds[0].fd       = _fd;
+  fds[0].events   = POLLIN;
+  fds[0].revents  = 0;
+
+  return 1;
+}
+
+void WiFiUDP::pollDone(struct pollfd *fds, int count)
+{
+  (void) fds;
+  (void) count;
+}
@@ -0,0 +1,74 @@
+/*
+  WiFiUdp.h
+  Host (Linux) build
+
+  WiFiUDP on a non-blocking UDP socket bound to 127.0.0.1 (see hostPort() for privileged ports). Like lwIP,
+  parsePacket() takes one datagram at a time and drops whatever the previous one had left unread.
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#pragma once
+
+#include "Arduino.h"
+
+#define HOST_UDP_MAX_PACKET   1500
+
+class WiFiUDP : public Stream, public HostPollable
+{
+  public:
+
+    WiFiUDP();
+    virtual ~WiFiUDP();
+
+    uint8_t       begin(uint16_t port);
+    void          stop();
+
+    int           beginPacket(IPAddress ip, uint16_t port);
+    int           beginPacket(const char *host, uint16_t port);
+    int           endPacket();
+    virtual size_t write(uint8_t c) override;
+    virtual size_t write(const uint8_t *buffer, size_t size) override;
+
+    using Print::write;
+
+    int           parsePacket();
+    virtual int   available() override;
+    virtual int   read() override;
+    int           read(unsigned char *buffer, size_t len);
+
+    int read(char *buffer, size_t len)
+    {
+      return read((unsigned char *) buffer, len);
+    }
+
+    virtual int   peek() override;
+    virtual void  flush() override;
+
+    IPAddress     remoteIP();
+    uint16_t      remotePort();
+    uint16_t      localPort();
+
+    // HostPollable - only wakes the loop up, datagrams stay queued in the socket until parsePacket()
+    virtual int   pollFds(struct pollfd *fds, int room) override;
+    virtual void  pollDone(struct pollfd *fds, int count) override;
+
+  private:
+
+    int           _fd;
+    uint16_t      _localPort;
+
+    uint8_t       _rx[HOST_UDP_MAX_PACKET];
+    size_t        _rxLen;
+    size_t        _rxPos;
+    uint32_t      _remoteIP;
+    uint16_t      _remotePort;
+
+    uint8_t       _tx[HOST_UDP_MAX_PACKET];
+    size_t        _txLen;
+    bool          _txOpen;
+    uint32_t      _txIP;
+    uint16_t      _txPort;
+};
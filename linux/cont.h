@@ -0,0 +1,21 @@
+/*
+  cont.h
+  Host (Linux) build
+
+  The core's loop() continuation. The host runs loop() on the process stack, g_pcont describes that one - the same
+  stack bounds without the chip's fixed-size array.
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#pragma once
+
+typedef struct cont_
+{
+  unsigned  *stack_end;
+  unsigned  *stack;
+} cont_t;
+
+extern "C" cont_t *g_pcont;
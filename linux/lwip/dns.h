@@ -0,0 +1,35 @@
+/*
+  lwip/dns.h
+  Host (Linux) build
+
+  lwIP's non-blocking resolver, the one call Encompass makes: dns_gethostbyname() answers an IP literal at once,
+  anything else through the callback from the next hostPoll() - where the chip's lwIP would call it from its own
+  context. The lookup itself is getaddrinfo(), quick enough on a workstation to run in place.
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+typedef int8_t    err_t;
+
+#define ERR_OK          0
+#define ERR_INPROGRESS  -5
+#define ERR_ARG         -16
+
+// IPv4 only, network order
+typedef struct
+{
+  uint32_t  addr;
+} ip_addr_t;
+
+#define ip_addr_get_ip4_u32(ipaddr)   ((ipaddr)->addr)
+
+// ipaddr NULL when the name did not resolve
+typedef void (*dns_found_callback)(const char *name, const ip_addr_t *ipaddr, void *callback_arg);
+
+err_t     dns_gethostbyname(const char *hostname, ip_addr_t *addr, dns_found_callback found, void *callback_arg);
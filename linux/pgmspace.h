@@ -0,0 +1,55 @@
+/*
+  pgmspace.h
+  Host (Linux) build
+
+  Flash access on the host - there is only one address space, so PROGMEM is plain const data and the _P
+  functions are the regular C library ones.
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+
+#define PROGMEM
+#define ICACHE_FLASH_ATTR
+#define ICACHE_RAM_ATTR
+#define IRAM_ATTR
+
+typedef const char *PGM_P;
+typedef const void *PGM_VOID_P;
+
+#define PSTR(s)                       (s)
+
+#define pgm_read_byte(addr)           (*(const uint8_t *) (addr))
+#define pgm_read_word(addr)           (*(const uint16_t *) (addr))
+#define pgm_read_dword(addr)          (*(const uint32_t *) (addr))
+#define pgm_read_float(addr)          (*(const float *) (addr))
+#define pgm_read_ptr(addr)            (*(const void * const *) (addr))
+
+#define pgm_read_byte_near(addr)      pgm_read_byte(addr)
+#define pgm_read_word_near(addr)      pgm_read_word(addr)
+#define pgm_read_dword_near(addr)     pgm_read_dword(addr)
+
+#define memcpy_P                      memcpy
+#define memcmp_P                      memcmp
+#define memchr_P                      memchr
+#define strlen_P                      strlen
+#define strnlen_P                     strnlen
+#define strcpy_P                      strcpy
+#define strncpy_P                     strncpy
+#define strcat_P                      strcat
+#define strncat_P                     strncat
+#define strcmp_P                      strcmp
+#define strncmp_P                     strncmp
+#define strcasecmp_P                  strcasecmp
+#define strncasecmp_P                 strncasecmp
+#define strstr_P                      strstr
+#define sprintf_P                     sprintf
+#define snprintf_P                    snprintf
+#define vsnprintf_P                   vsnprintf
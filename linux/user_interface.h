@@ -0,0 +1,98 @@
+/*
+  user_interface.h
+  Host (Linux) build
+
+  The NONOS SDK station calls Encompass makes, answered by the simulated radio in ESP8266WiFi.cpp, and the system
+  calls for the RTC and the reset reason, answered by Arduino.cpp.
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef uint8_t   uint8;
+typedef uint16_t  uint16;
+typedef uint32_t  uint32;
+typedef int8_t    sint8;
+typedef int16_t   sint16;
+typedef int32_t   sint32;
+
+struct station_config
+{
+  uint8   ssid[32];
+  uint8   password[64];
+  uint8   bssid_set;
+  uint8   bssid[6];
+};
+
+enum
+{
+  STATION_IDLE = 0,
+  STATION_CONNECTING,
+  STATION_WRONG_PASSWORD,
+  STATION_NO_AP_FOUND,
+  STATION_CONNECT_FAIL,
+  STATION_GOT_IP
+};
+
+#define STATION_IF      0
+#define SOFTAP_IF       1
+
+// Network order, as lwIP keeps it
+struct ipv4_addr
+{
+  uint32  addr;
+};
+
+struct ip_info
+{
+  struct ipv4_addr  ip;
+  struct ipv4_addr  netmask;
+  struct ipv4_addr  gw;
+};
+
+bool    wifi_station_get_config(struct station_config *config);
+bool    wifi_station_get_config_default(struct station_config *config);
+bool    wifi_station_set_config(struct station_config *config);
+bool    wifi_station_set_config_current(struct station_config *config);
+bool    wifi_station_connect(void);
+bool    wifi_station_disconnect(void);
+uint8   wifi_station_get_connect_status(void);
+uint8   wifi_softap_get_station_num(void);
+// The soft AP's clients are processes on this host, so SOFTAP_IF reports the loopback network 127.0.0.1/8
+bool    wifi_get_ip_info(uint8 if_index, struct ip_info *info);
+uint8   wifi_get_channel(void);
+uint32  system_get_time(void);
+
+enum rst_reason
+{
+  REASON_DEFAULT_RST = 0,
+  REASON_WDT_RST,
+  REASON_EXCEPTION_RST,
+  REASON_SOFT_WDT_RST,
+  REASON_SOFT_RESTART,
+  REASON_DEEP_SLEEP_AWAKE,
+  REASON_EXT_SYS_RST
+};
+
+struct rst_info
+{
+  uint32  reason;
+  uint32  exccause;
+  uint32  epc1;
+  uint32  epc2;
+  uint32  epc3;
+  uint32  excvaddr;
+  uint32  depc;
+};
+
+struct rst_info*  system_get_rst_info(void);
+// RTC clock periods, and the period in us as Q12 fixed point
+uint32  system_get_rtc_time(void);
+uint32  system_rtc_clock_cali_proc(void);
+uint32  system_get_free_heap_size(void);
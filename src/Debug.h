@@ -26,10 +26,14 @@
                                                   These twin libraries will be to each their own compatability.
 
   1.0.1     A. K. N.                12/13/2020    Renamed (shortened) contsants
+                                                  Optional asynchronous ring buffer logging (ENCOMPASS_ASYNC_LOG),
+                                                  disabled levels compile away
 */
 
 #pragma once
 
+#include <Arduino.h>
+
 #ifdef ENCOMPASS_DEBUG_PORT
   #define DBG_PORT      ENCOMPASS_DEBUG_PORT
 #else
@@ -47,27 +51,99 @@
   #define _ENCOMPASS_LOGLEVEL_       0
 #endif
 
-#define LOGERROR(x)         if(_ENCOMPASS_LOGLEVEL_>0) { DBG_PORT.print("[WM] "); DBG_PORT.println(x); }
-#define LOGERROR0(x)        if(_ENCOMPASS_LOGLEVEL_>0) { DBG_PORT.print(x); }
-#define LOGERROR1(x,y)      if(_ENCOMPASS_LOGLEVEL_>0) { DBG_PORT.print("[WM] "); DBG_PORT.print(x); DBG_PORT.print(" "); DBG_PORT.println(y); }
-#define LOGERROR2(x,y,z)    if(_ENCOMPASS_LOGLEVEL_>0) { DBG_PORT.print("[WM] "); DBG_PORT.print(x); DBG_PORT.print(" "); DBG_PORT.print(y); DBG_PORT.print(" "); DBG_PORT.println(z); }
-#define LOGERROR3(x,y,z,w)  if(_ENCOMPASS_LOGLEVEL_>0) { DBG_PORT.print("[WM] "); DBG_PORT.print(x); DBG_PORT.print(" "); DBG_PORT.print(y); DBG_PORT.print(" "); DBG_PORT.print(z); DBG_PORT.print(" "); DBG_PORT.println(w); }
-
-#define LOGWARN(x)          if(_ENCOMPASS_LOGLEVEL_>1) { DBG_PORT.print("[WM] "); DBG_PORT.println(x); }
-#define LOGWARN0(x)         if(_ENCOMPASS_LOGLEVEL_>1) { DBG_PORT.print(x); }
-#define LOGWARN1(x,y)       if(_ENCOMPASS_LOGLEVEL_>1) { DBG_PORT.print("[WM] "); DBG_PORT.print(x); DBG_PORT.print(" "); DBG_PORT.println(y); }
-#define LOGWARN2(x,y,z)     if(_ENCOMPASS_LOGLEVEL_>1) { DBG_PORT.print("[WM] "); DBG_PORT.print(x); DBG_PORT.print(" "); DBG_PORT.print(y); DBG_PORT.print(" "); DBG_PORT.println(z); }
-#define LOGWARN3(x,y,z,w)   if(_ENCOMPASS_LOGLEVEL_>1) { DBG_PORT.print("[WM] "); DBG_PORT.print(x); DBG_PORT.print(" "); DBG_PORT.print(y); DBG_PORT.print(" "); DBG_PORT.print(z); DBG_PORT.print(" "); DBG_PORT.println(w); }
-
-#define LOGINFO(x)          if(_ENCOMPASS_LOGLEVEL_>2) { DBG_PORT.print("[WM] "); DBG_PORT.println(x); }
-#define LOGINFO0(x)         if(_ENCOMPASS_LOGLEVEL_>2) { DBG_PORT.print(x); }
-#define LOGINFO1(x,y)       if(_ENCOMPASS_LOGLEVEL_>2) { DBG_PORT.print("[WM] "); DBG_PORT.print(x); DBG_PORT.print(" "); DBG_PORT.println(y); }
-#define LOGINFO2(x,y,z)     if(_ENCOMPASS_LOGLEVEL_>2) { DBG_PORT.print("[WM] "); DBG_PORT.print(x); DBG_PORT.print(" "); DBG_PORT.print(y); DBG_PORT.print(" "); DBG_PORT.println(z); }
-#define LOGINFO3(x,y,z,w)   if(_ENCOMPASS_LOGLEVEL_>2) { DBG_PORT.print("[WM] "); DBG_PORT.print(x); DBG_PORT.print(" "); DBG_PORT.print(y); DBG_PORT.print(" "); DBG_PORT.print(z); DBG_PORT.print(" "); DBG_PORT.println(w); }
-
-#define LOGDEBUG(x)         if(_ENCOMPASS_LOGLEVEL_>3) { DBG_PORT.print("[WM] "); DBG_PORT.println(x); }
-#define LOGDEBUG0(x)        if(_ENCOMPASS_LOGLEVEL_>3) { DBG_PORT.print(x); }
-#define LOGDEBUG1(x,y)      if(_ENCOMPASS_LOGLEVEL_>3) { DBG_PORT.print("[WM] "); DBG_PORT.print(x); DBG_PORT.print(" "); DBG_PORT.println(y); }
-#define LOGDEBUG2(x,y,z)    if(_ENCOMPASS_LOGLEVEL_>3) { DBG_PORT.print("[WM] "); DBG_PORT.print(x); DBG_PORT.print(" "); DBG_PORT.print(y); DBG_PORT.print(" "); DBG_PORT.println(z); }
-#define LOGDEBUG3(x,y,z,w)  if(_ENCOMPASS_LOGLEVEL_>3) { DBG_PORT.print("[WM] "); DBG_PORT.print(x); DBG_PORT.print(" "); DBG_PORT.print(y); DBG_PORT.print(" "); DBG_PORT.print(z); DBG_PORT.print(" "); DBG_PORT.println(w); }
+// Set ENCOMPASS_ASYNC_LOG to record log calls into a RAM ring buffer instead of printing them on the spot.
+// Entries are written out by Encompass::loop() within ENCOMPASS_LOG_DRAIN_US and can be read from /log.
+#ifndef ENCOMPASS_ASYNC_LOG
+  #define ENCOMPASS_ASYNC_LOG        false
+#endif
+
+#ifndef ENCOMPASS_LOG_DRAIN_US
+  #define ENCOMPASS_LOG_DRAIN_US     1000
+#endif
+
+#if ENCOMPASS_ASYNC_LOG
+
+  #include "EncompassLog.h"
+
+  #define ENCOMPASS_LOG(l, ...)      EncompassLog::record(l, LOG_FLAG_LINE, __VA_ARGS__)
+  #define ENCOMPASS_LOG0(l, x)       EncompassLog::record(l, 0, x)
+
+#else
+
+  template <typename T>
+  inline void encompassPrintArgs(const T &x)
+  {
+    DBG_PORT.println(x);
+  }
+
+  template <typename T, typename... Rest>
+  inline void encompassPrintArgs(const T &x, const Rest&... rest)
+  {
+    DBG_PORT.print(x);
+    DBG_PORT.print(" ");
+    encompassPrintArgs(rest...);
+  }
+
+  #define ENCOMPASS_LOG(l, ...)      do { DBG_PORT.print("[WM] "); encompassPrintArgs(__VA_ARGS__); } while (0)
+  #define ENCOMPASS_LOG0(l, x)       do { DBG_PORT.print(x); } while (0)
+
+#endif
+
+// Disabled levels compile to nothing, their arguments are never evaluated
+#define ENCOMPASS_NO_LOG             do {} while (0)
 
+#if (_ENCOMPASS_LOGLEVEL_ > 0)
+  #define LOGERROR(x)               ENCOMPASS_LOG(1, x)
+  #define LOGERROR0(x)              ENCOMPASS_LOG0(1, x)
+  #define LOGERROR1(x,y)            ENCOMPASS_LOG(1, x, y)
+  #define LOGERROR2(x,y,z)          ENCOMPASS_LOG(1, x, y, z)
+  #define LOGERROR3(x,y,z,w)        ENCOMPASS_LOG(1, x, y, z, w)
+#else
+  #define LOGERROR(x)               ENCOMPASS_NO_LOG
+  #define LOGERROR0(x)              ENCOMPASS_NO_LOG
+  #define LOGERROR1(x,y)            ENCOMPASS_NO_LOG
+  #define LOGERROR2(x,y,z)          ENCOMPASS_NO_LOG
+  #define LOGERROR3(x,y,z,w)        ENCOMPASS_NO_LOG
+#endif
+
+#if (_ENCOMPASS_LOGLEVEL_ > 1)
+  #define LOGWARN(x)                ENCOMPASS_LOG(2, x)
+  #define LOGWARN0(x)               ENCOMPASS_LOG0(2, x)
+  #define LOGWARN1(x,y)             ENCOMPASS_LOG(2, x, y)
+  #define LOGWARN2(x,y,z)           ENCOMPASS_LOG(2, x, y, z)
+  #define LOGWARN3(x,y,z,w)         ENCOMPASS_LOG(2, x, y, z, w)
+#else
+  #define LOGWARN(x)                ENCOMPASS_NO_LOG
+  #define LOGWARN0(x)               ENCOMPASS_NO_LOG
+  #define LOGWARN1(x,y)             ENCOMPASS_NO_LOG
+  #define LOGWARN2(x,y,z)           ENCOMPASS_NO_LOG
+  #define LOGWARN3(x,y,z,w)         ENCOMPASS_NO_LOG
+#endif
+
+#if (_ENCOMPASS_LOGLEVEL_ > 2)
+  #define LOGINFO(x)                ENCOMPASS_LOG(3, x)
+  #define LOGINFO0(x)               ENCOMPASS_LOG0(3, x)
+  #define LOGINFO1(x,y)             ENCOMPASS_LOG(3, x, y)
+  #define LOGINFO2(x,y,z)           ENCOMPASS_LOG(3, x, y, z)
+  #define LOGINFO3(x,y,z,w)         ENCOMPASS_LOG(3, x, y, z, w)
+#else
+  #define LOGINFO(x)                ENCOMPASS_NO_LOG
+  #define LOGINFO0(x)               ENCOMPASS_NO_LOG
+  #define LOGINFO1(x,y)             ENCOMPASS_NO_LOG
+  #define LOGINFO2(x,y,z)           ENCOMPASS_NO_LOG
+  #define LOGINFO3(x,y,z,w)         ENCOMPASS_NO_LOG
+#endif
+
+#if (_ENCOMPASS_LOGLEVEL_ > 3)
+  #define LOGDEBUG(x)               ENCOMPASS_LOG(4, x)
+  #define LOGDEBUG0(x)              ENCOMPASS_LOG0(4, x)
+  #define LOGDEBUG1(x,y)            ENCOMPASS_LOG(4, x, y)
+  #define LOGDEBUG2(x,y,z)          ENCOMPASS_LOG(4, x, y, z)
+  #define LOGDEBUG3(x,y,z,w)        ENCOMPASS_LOG(4, x, y, z, w)
+#else
+  #define LOGDEBUG(x)               ENCOMPASS_NO_LOG
+  #define LOGDEBUG0(x)              ENCOMPASS_NO_LOG
+  #define LOGDEBUG1(x,y)            ENCOMPASS_NO_LOG
+  #define LOGDEBUG2(x,y,z)          ENCOMPASS_NO_LOG
+  #define LOGDEBUG3(x,y,z,w)        ENCOMPASS_NO_LOG
+#endif
@@ -39,6 +39,13 @@
 #include    <ESP8266WiFi.h>
 #include    <ESPAsyncWebServer.h>
 #include    <DNSServer.h>
+#include    <WiFiUdp.h>
+#include    <lwip/dns.h>
+#include    <StreamString.h>
+#include    <Updater.h>
+#include    "EncompassProvision.h"
+#include    "EncompassClock.h"
+#include    <time.h>
 #include    <memory>
 #undef      min
 #undef      max
@@ -53,6 +60,284 @@ extern "C"
 
 #define ESP_getChipId()   (ESP.getChipId())
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Feature Switches - define before including Encompass.h to override
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Use the built-in captive DNS responder instead of the DNSServer passed to the constructor
+#ifndef USE_ENCOMPASS_DNS
+  #define USE_ENCOMPASS_DNS               true
+#endif
+
+// Longest time (us) spent answering queued DNS queries per loop
+#ifndef ENCOMPASS_DNS_BUDGET_US
+  #define ENCOMPASS_DNS_BUDGET_US         2000
+#endif
+
+// Server-Sent Events on /events - WiFi status, station IP and RSSI pushed to the info page as they change, checked
+// every ENCOMPASS_EVENT_POLL_MS while anyone listens. RSSI moves of less than ENCOMPASS_EVENT_RSSI_STEP dBm are not news.
+#ifndef ENCOMPASS_EVENTS
+  #define ENCOMPASS_EVENTS                true
+#endif
+
+// Event streams held open at once, each one keeps a connection
+#ifndef ENCOMPASS_EVENT_CLIENTS
+  #define ENCOMPASS_EVENT_CLIENTS         2
+#endif
+
+#ifndef ENCOMPASS_EVENT_POLL_MS
+  #define ENCOMPASS_EVENT_POLL_MS         500
+#endif
+
+#ifndef ENCOMPASS_EVENT_RSSI_STEP
+  #define ENCOMPASS_EVENT_RSSI_STEP       3
+#endif
+
+// URI of the device settings page
+#ifndef DEVICE_SETUP_URI
+  #define DEVICE_SETUP_URI                "/device-setup"
+#endif
+
+// Routes a sketch can add with addRoute()
+#ifndef ENCOMPASS_MAX_CUSTOM_ROUTES
+  #define ENCOMPASS_MAX_CUSTOM_ROUTES     8
+#endif
+
+// Custom data fields the portal form starts with room for, addDataField() grows it by as many again
+#ifndef ENCOMPASS_MAX_DATA_FIELDS
+  #define ENCOMPASS_MAX_DATA_FIELDS       10
+#endif
+
+// Portal timeout (ms) restored after the credentials are saved or the portal is closed
+#ifndef DEFAULT_PORTAL_TIMEOUT
+  #define DEFAULT_PORTAL_TIMEOUT          60000L
+#endif
+
+// Time (ms) between network scans while the portal is up
+#ifndef TIME_BETWEEN_MODAL_SCANS
+  #define TIME_BETWEEN_MODAL_SCANS        60000
+#endif
+
+#ifndef TIME_BETWEEN_MODELESS_SCANS
+  #define TIME_BETWEEN_MODELESS_SCANS     600000
+#endif
+
+// Pages a sketch can add with addPage(), each one also takes a custom route
+#ifndef ENCOMPASS_MAX_PAGES
+  #define ENCOMPASS_MAX_PAGES             4
+#endif
+
+// Longest {token} name in a page template
+#ifndef ENCOMPASS_PAGE_TOKEN_LEN
+  #define ENCOMPASS_PAGE_TOKEN_LEN        24
+#endif
+
+// Gap (us) between Encompass::loop() calls counted as a stall, setStallThreshold() changes it at run time
+#ifndef ENCOMPASS_STALL_THRESHOLD_US
+  #define ENCOMPASS_STALL_THRESHOLD_US    50000
+#endif
+
+// Free heap / largest free block (bytes) below which the portal degrades, setMemoryThresholds() changes them at run time.
+// Heavy pages give way first, admission control lets fewer render at once as the level rises (see E_MemoryPressure).
+// Low: network lists cut short. High: pages without the network list. Critical: 503 Retry-After, captive probes shed.
+#ifndef ENCOMPASS_HEAP_LOW
+  #define ENCOMPASS_HEAP_LOW              16384
+#endif
+
+#ifndef ENCOMPASS_HEAP_HIGH
+  #define ENCOMPASS_HEAP_HIGH             12288
+#endif
+
+#ifndef ENCOMPASS_HEAP_CRITICAL
+  #define ENCOMPASS_HEAP_CRITICAL         8192
+#endif
+
+#ifndef ENCOMPASS_BLOCK_LOW
+  #define ENCOMPASS_BLOCK_LOW             8192
+#endif
+
+#ifndef ENCOMPASS_BLOCK_HIGH
+  #define ENCOMPASS_BLOCK_HIGH            6144
+#endif
+
+#ifndef ENCOMPASS_BLOCK_CRITICAL
+  #define ENCOMPASS_BLOCK_CRITICAL        3072
+#endif
+
+// Heavy page renders (ROUTE_FLAG_HEAVY) in flight at once, setMaxHeavyRequests() changes it at run time. Memory pressure
+// lowers it, see E_MemoryPressure. Past it they wait in a queue of ENCOMPASS_ADMISSION_QUEUE for up to
+// ENCOMPASS_ADMISSION_WAIT_MS, then get a 503.
+#ifndef ENCOMPASS_MAX_HEAVY
+  #define ENCOMPASS_MAX_HEAVY             2
+#endif
+
+#ifndef ENCOMPASS_ADMISSION_QUEUE
+  #define ENCOMPASS_ADMISSION_QUEUE       4
+#endif
+
+#ifndef ENCOMPASS_ADMISSION_WAIT_MS
+  #define ENCOMPASS_ADMISSION_WAIT_MS     3000
+#endif
+
+// UDP provisioning listener on the soft AP, see EncompassProvision.h - only runs once setProvisioningKey() has been
+// called, and only takes datagrams from the AP's subnet. The last ENCOMPASS_PROVISION_NONCES requests are remembered so
+// a repeated one is answered, not applied again; the highest request counter taken goes to RTC memory at block
+// ENCOMPASS_PROVISION_RTC_BLOCK (4 taken) so older requests stay refused after a reset.
+#ifndef ENCOMPASS_PROVISIONING
+  #define ENCOMPASS_PROVISIONING          false
+#endif
+
+#ifndef ENCOMPASS_PROVISION_PORT
+  #define ENCOMPASS_PROVISION_PORT        4210
+#endif
+
+#ifndef ENCOMPASS_PROVISION_NONCES
+  #define ENCOMPASS_PROVISION_NONCES      8
+#endif
+
+#ifndef ENCOMPASS_PROVISION_RTC_BLOCK
+  #define ENCOMPASS_PROVISION_RTC_BLOCK   104
+#endif
+
+// Jobs the request handlers can have waiting for loop() (a power of 2), and finished ones /job still knows about
+#ifndef ENCOMPASS_JOB_QUEUE
+  #define ENCOMPASS_JOB_QUEUE             4
+#endif
+
+#ifndef ENCOMPASS_JOB_HISTORY
+  #define ENCOMPASS_JOB_HISTORY           8
+#endif
+
+// Scheduler - tasks loop() can run (the library's take 5 to 11), and the time (us) one loop() spends on them
+// before leaving the rest for the next. DNS, admission and jobs are polled every ENCOMPASS_POLL_MS.
+#ifndef ENCOMPASS_MAX_TASKS
+  #define ENCOMPASS_MAX_TASKS             12
+#endif
+
+#ifndef ENCOMPASS_TICK_BUDGET_US
+  #define ENCOMPASS_TICK_BUDGET_US        20000
+#endif
+
+#ifndef ENCOMPASS_POLL_MS
+  #define ENCOMPASS_POLL_MS               10
+#endif
+
+// Firmware upload on /update, streamed into the updater as it arrives and checked against the SHA-256 sent with it.
+// Progress goes out as "update" events on /events. Off unless asked for, and even then /update refuses everyone until
+// setUpdateCredentials() has been called.
+#ifndef ENCOMPASS_UPDATE
+  #define ENCOMPASS_UPDATE                false
+#endif
+
+// Roaming between the APs of the network the station is on, see processRoaming(). Every ENCOMPASS_ROAM_SAMPLE_MS the
+// link's RSSI is sampled; below ENCOMPASS_ROAM_RSSI (setRoamingThreshold()) a scan looks for another AP of the network
+// at least ENCOMPASS_ROAM_HYSTERESIS dB stronger, at most once every ENCOMPASS_ROAM_HOLDOFF_MS. A move that has not
+// connected after ENCOMPASS_ROAM_TIMEOUT_MS goes back to letting the SDK pick the AP.
+#ifndef ENCOMPASS_ROAMING
+  #define ENCOMPASS_ROAMING               true
+#endif
+
+#ifndef ENCOMPASS_ROAM_RSSI
+  #define ENCOMPASS_ROAM_RSSI             -75
+#endif
+
+#ifndef ENCOMPASS_ROAM_HYSTERESIS
+  #define ENCOMPASS_ROAM_HYSTERESIS       8
+#endif
+
+#ifndef ENCOMPASS_ROAM_SAMPLE_MS
+  #define ENCOMPASS_ROAM_SAMPLE_MS        2000
+#endif
+
+#ifndef ENCOMPASS_ROAM_HOLDOFF_MS
+  #define ENCOMPASS_ROAM_HOLDOFF_MS       30000
+#endif
+
+#ifndef ENCOMPASS_ROAM_TIMEOUT_MS
+  #define ENCOMPASS_ROAM_TIMEOUT_MS       10000
+#endif
+
+// Time service, see ImplTime.h. Once the station is up, SNTP asks the server setTimeServer() named (none by default),
+// again every ENCOMPASS_NTP_INTERVAL_MS; a request with no answer after ENCOMPASS_NTP_TIMEOUT_MS is tried again after
+// ENCOMPASS_NTP_RETRY_MS, doubling up to the interval. Differences up to ENCOMPASS_TIME_STEP_MS are slewed at
+// ENCOMPASS_TIME_SLEW_PPM, larger ones step. Every ENCOMPASS_TIME_SAVE_MS the time goes to RTC memory at block
+// ENCOMPASS_TIME_RTC_BLOCK (of 128, 4 bytes each, 8 taken), so a reset or a deep sleep wakes up with it.
+#ifndef ENCOMPASS_TIME
+  #define ENCOMPASS_TIME                  true
+#endif
+
+#ifndef ENCOMPASS_NTP_INTERVAL_MS
+  #define ENCOMPASS_NTP_INTERVAL_MS       3600000
+#endif
+
+#ifndef ENCOMPASS_NTP_TIMEOUT_MS
+  #define ENCOMPASS_NTP_TIMEOUT_MS        1500
+#endif
+
+#ifndef ENCOMPASS_NTP_RETRY_MS
+  #define ENCOMPASS_NTP_RETRY_MS          2000
+#endif
+
+#ifndef ENCOMPASS_TIME_SLEW_PPM
+  #define ENCOMPASS_TIME_SLEW_PPM         5000
+#endif
+
+#ifndef ENCOMPASS_TIME_STEP_MS
+  #define ENCOMPASS_TIME_STEP_MS          1000
+#endif
+
+#ifndef ENCOMPASS_TIME_SAVE_MS
+  #define ENCOMPASS_TIME_SAVE_MS          1000
+#endif
+
+#ifndef ENCOMPASS_TIME_RTC_BLOCK
+  #define ENCOMPASS_TIME_RTC_BLOCK        96
+#endif
+
+// Derive each network's WPA2 PSK once when its credentials are saved and connect with that, instead of the SDK running
+// 4096 PBKDF2 iterations on every WiFi.begin(). The SDK also stores the PSK, so reconnects after a boot skip them too.
+// The "psk" task runs ENCOMPASS_PSK_SLICE iterations per loop(), a few ms on the chip - a PSK takes 8192.
+#ifndef ENCOMPASS_PRECOMPUTE_PSK
+  #define ENCOMPASS_PRECOMPUTE_PSK        true
+#endif
+
+#ifndef ENCOMPASS_PSK_SLICE
+  #define ENCOMPASS_PSK_SLICE             64
+#endif
+
+// Most time (ms) the portal waits for the soft AP to be up with its address before starting DNS and the routes
+#ifndef ENCOMPASS_AP_START_TIMEOUT_MS
+  #define ENCOMPASS_AP_START_TIMEOUT_MS   1000
+#endif
+
+// Time (ms) /reset and a finished update leave for their page to get out before the restart
+#ifndef ENCOMPASS_RESET_DELAY_MS
+  #define ENCOMPASS_RESET_DELAY_MS        2000
+#endif
+
+// Networks listed under low memory
+#ifndef ENCOMPASS_LOW_MEMORY_NETWORKS
+  #define ENCOMPASS_LOW_MEMORY_NETWORKS   5
+#endif
+
+// Retry-After (s) sent with a 503 under critical memory
+#ifndef ENCOMPASS_RETRY_AFTER
+  #define ENCOMPASS_RETRY_AFTER           5
+#endif
+
+// Stack and heap high-water marks per operation and route, served by /profile and /metrics, printProfile() for serial.
+// Every handler, scan and connect paints the stack and walks the heap twice - for finding what crashed, not for shipping.
+#ifndef ENCOMPASS_PROFILE
+  #define ENCOMPASS_PROFILE               false
+#endif
+
+// Stack painted below each profiled operation, deeper use reads as this much. Keep it under the free stack of the
+// deepest operation: the loop() stack is 4 KB, the network callbacks' SYS stack has no bound to check against.
+#ifndef ENCOMPASS_PROFILE_STACK_BYTES
+  #define ENCOMPASS_PROFILE_STACK_BYTES   1024
+#endif
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // HTML Page Static Constants
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -67,6 +352,16 @@ const char HTML_PAGE_DIV_OPEN[]   PROGMEM   = "<div class=\"page\">";
 const char HTML_DIV_CLOSE[]       PROGMEM   = "</div>";
 const char HTML_BODY_CLOSE[]      PROGMEM   = "</body>";
 const char HTML_CLOSE[]           PROGMEM   = "</html>";
+// Page Head Open - {v} = title text
+const char HTML_HEAD_START[]      PROGMEM   = "<!DOCTYPE html><html lang=\"en\"><head><meta name=\"viewport\" content=\"width=device-width, initial-scale=1, user-scalable=no\"/><title>{v}</title>";
+// Network list click - copies the SSID into the form and moves to the password
+const char HTML_SCRIPT[]          PROGMEM   = "<script>function c(l){document.getElementById('s').value=l.innerText||l.textContent;document.getElementById('p').focus();}</script>";
+// Browser timezone, read by HTML_SCRIPT_NTP_MSG
+const char HTML_SCRIPT_NTP[]      PROGMEM   = "<script>var timezone={name:function(){try{return Intl.DateTimeFormat().resolvedOptions().timeZone;}catch(e){return '';}}};</script>";
+// Info page updates from /events - h() escapes the SSID
+const char HTML_SCRIPT_EVENTS[]   PROGMEM   = "<script>if(window.EventSource){var es=new EventSource('/events');function h(s){var d=document.createElement('i');d.textContent=s;return d.innerHTML;}function g(i){return document.getElementById(i)||{};}es.addEventListener('status',function(e){var d=JSON.parse(e.data);g('wc').innerHTML=d.status;g('wi').innerHTML=d.ip;g('ws').innerHTML=d.ssid?'Configured to connect to AP <b>'+h(d.ssid)+(d.connected?' and connected</b> on IP <a href=\"http://'+d.ip+'/\">'+d.ip+'</a>, RSSI '+d.rssi+' dBm':' but not connected.</b>'):'No network configured.';});}</script>";
+const char HTML_SCRIPT_NTP_MSG[]  PROGMEM   = "<p>Your Timezone is : <b><label id=\"timezone\"></label></b><script>document.getElementById('timezone').innerHTML=timezone.name();</script></p>";
+const char HTML_STYLE[]           PROGMEM   = "<style>div{padding:2px;font-size:1em}body,textarea,input,select{background:0;border-radius:0;font:16px sans-serif;margin:0}textarea,input,select{outline:0;font-size:14px;border:1px solid #ccc;padding:8px;width:90%}.container{margin:auto;width:90%}@media(min-width:1200px){.container{width:30%}}@media(min-width:768px) and (max-width:1200px){.container{width:50%}}.btn,h2{font-size:2em}h1{font-size:3em}.btn{background:#0ae;border-radius:4px;border:0;color:#fff;cursor:pointer;display:inline-block;margin:2px 0;padding:10px 14px 11px;width:100%}.btn:hover{background:#09d}.btn:active,.btn:focus{background:#08b}label>*{display:inline}form>*{display:block;margin-bottom:10px}textarea:focus,input:focus,select:focus{border-color:#5ab}.msg{background:#def;border-left:5px solid #59d;padding:1.5em}.q{float:right;width:64px;text-align:right}input[type='checkbox']{float:left;width:20px}fieldset{border-radius:0.5rem;margin:0px}</style>";
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -110,6 +405,16 @@ const char HTML_ELEMENT_END[]     PROGMEM = "</{e}>";
 const char HTML_OPTION[]          PROGMEM = "<option value=\"{v}\"{s}{d}>{t}</option>";
 const char HTML_INPUT[]           PROGMEM = "<input type=\"{t}\" id=\"{i}\" name=\"{n}\" value=\"{v}\"{c}{s}>";
 const char HTML_BUTTON[]          PROGMEM = "<button class=\"btn\" type=\"{t}\">Save</button>";
+// Text Field - {i} = id, {n} = name, {l} = max length, {p} = placeholder, {v} = value, {c} = custom attributes
+const char HTML_FORM_FIELD[]      PROGMEM = "<input id=\"{i}\" name=\"{n}\" maxlength=\"{l}\" placeholder=\"{p}\" value=\"{v}\"{c}>";
+// Labelled Text Field - as HTML_FORM_FIELD, labelled with the placeholder
+const char HTML_FORM_LABEL_BEFORE[] PROGMEM = "<div><label for=\"{i}\">{p}</label><input id=\"{i}\" name=\"{n}\" maxlength=\"{l}\" placeholder=\"{p}\" value=\"{v}\"{c}></div>";
+const char HTML_FORM_LABEL_AFTER[] PROGMEM = "<div><input id=\"{i}\" name=\"{n}\" maxlength=\"{l}\" placeholder=\"{p}\" value=\"{v}\"{c}><label for=\"{i}\">{p}</label></div>";
+// Firmware upload - the hash field comes first so it is in by the time the image has been written
+const char HTML_UPDATE_FORM[]     PROGMEM = "<form method=\"post\" action=\"/update\" enctype=\"multipart/form-data\"><div><label for=\"h\">SHA-256</label><input id=\"h\" name=\"sha256\" maxlength=\"64\"></div><input type=\"file\" name=\"firmware\" accept=\".bin\"><button class=\"btn\" type=\"submit\">Update</button></form><p id=\"up\"></p>";
+const char HTML_SCRIPT_UPDATE[]   PROGMEM = "<script>if(window.EventSource){new EventSource('/events').addEventListener('update',function(e){var d=JSON.parse(e.data);document.getElementById('up').innerHTML=d.state+(d.total?' '+Math.floor(100*d.written/d.total)+'%':'');});}</script>";
+// Portal Menu
+const char HTML_PORTAL[]          PROGMEM = "<form action=\"/wifi-setup\" method=\"get\"><button class=\"btn\">Configuration</button></form><br><form action=\"/info\" method=\"get\"><button class=\"btn\">Information</button></form><br><form action=\"/close\" method=\"get\"><button class=\"btn\">Exit Portal</button></form><br>";
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -125,6 +430,11 @@ const char JSON_SSID_ITEM[]       PROGMEM = "{\"SSID\":\"{v}\", \"Encryption\":{
 const char HTTP_HEAD_CL[]         PROGMEM = "Content-Length";
 const char HTTP_HEAD_CT[]         PROGMEM = "text/html";
 const char HTTP_HEAD_CT2[]        PROGMEM = "text/plain";
+const char HTTP_HEAD_JSON[]       PROGMEM = "application/json";
+const char HTTP_HEAD_CBOR[]       PROGMEM = "application/cbor";
+const char HTTP_HEAD_METRICS[]    PROGMEM = "text/plain; version=0.0.4";
+const char HTTP_ACCEPT[]          PROGMEM = "Accept";
+const char HTTP_LOCATION[]        PROGMEM = "Location";
 const char HTTP_CACHE_CONTROL[]   PROGMEM = "Cache-Control";
 const char HTTP_NO_STORE[]        PROGMEM = "no-cache, no-store, must-revalidate";
 const char HTTP_PRAGMA[]          PROGMEM = "Pragma";
@@ -132,10 +442,253 @@ const char HTTP_NO_CACHE[]        PROGMEM = "no-cache";
 const char HTTP_EXPIRES[]         PROGMEM = "Expires";
 const char HTTP_CORS[]            PROGMEM = "Access-Control-Allow-Origin";
 const char HTTP_CORS_ALLOW_ALL[]  PROGMEM = "*";
+const char HTTP_RETRY_AFTER[]     PROGMEM = "Retry-After";
+// Id of the job a request posted, see /job
+const char HTTP_JOB[]             PROGMEM = "X-Encompass-Job";
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Memory Pressure - the worst of free heap and largest free block against ENCOMPASS_HEAP_* / ENCOMPASS_BLOCK_*
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+enum E_MemoryPressure
+{
+  PRESSURE_NONE,
+  PRESSURE_LOW,         // Network lists cut to ENCOMPASS_LOW_MEMORY_NETWORKS, half the heavy renders at once
+  PRESSURE_HIGH,        // No network list or device table, one heavy render at a time
+  PRESSURE_CRITICAL,    // Pages answered with 503 and Retry-After, captive probes shed
+  PRESSURE_LEVELS
+};
+
+const char HTML_LOW_MEMORY_LIST[] PROGMEM = "<small>Low memory, only the strongest networks are listed</small><br/>";
+const char HTML_LOW_MEMORY_PAGE[] PROGMEM = "<small>Low memory, part of this page was left out. Refresh to try again.</small><br/>";
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Captive Portal Probes - OS connectivity checks, answered with a redirect to the portal so the sign-in sheet opens at once
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+enum E_ProbeType
+{
+  PROBE_ANDROID,
+  PROBE_APPLE,
+  PROBE_WINDOWS,
+  PROBE_FIREFOX,
+  PROBE_TYPES
+};
+
+struct CaptiveProbe
+{
+  const char  *path;
+  uint8_t     type;
+};
+
+const char PROBE_GENERATE_204[]   PROGMEM = "/generate_204";
+const char PROBE_GEN_204[]        PROGMEM = "/gen_204";
+const char PROBE_HOTSPOT[]        PROGMEM = "/hotspot-detect.html";
+const char PROBE_APPLE_SUCCESS[]  PROGMEM = "/library/test/success.html";
+const char PROBE_CONNECTTEST[]    PROGMEM = "/connecttest.txt";
+const char PROBE_NCSI[]           PROGMEM = "/ncsi.txt";
+const char PROBE_FWLINK[]         PROGMEM = "/fwlink";
+const char PROBE_REDIRECT[]       PROGMEM = "/redirect";
+const char PROBE_SUCCESS_TXT[]    PROGMEM = "/success.txt";
+const char PROBE_CANONICAL[]      PROGMEM = "/canonical.html";
+
+const CaptiveProbe CAPTIVE_PROBES[] PROGMEM =
+{
+  { PROBE_GENERATE_204,   PROBE_ANDROID },
+  { PROBE_GEN_204,        PROBE_ANDROID },
+  { PROBE_HOTSPOT,        PROBE_APPLE   },
+  { PROBE_APPLE_SUCCESS,  PROBE_APPLE   },
+  { PROBE_CONNECTTEST,    PROBE_WINDOWS },
+  { PROBE_NCSI,           PROBE_WINDOWS },
+  { PROBE_FWLINK,         PROBE_WINDOWS },
+  { PROBE_REDIRECT,       PROBE_WINDOWS },
+  { PROBE_SUCCESS_TXT,    PROBE_FIREFOX },
+  { PROBE_CANONICAL,      PROBE_FIREFOX }
+};
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Portal Routes - dispatched by one catch-all handler through a perfect hash table built at compile time
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// X(id, path, handler, flags) - ROUTE_FLAG_AP routes only answer on the soft AP interface, like ON_AP_FILTER.
+// ROUTE_FLAG_HEAVY routes hold a whole page, list or metrics copy in RAM and go through admission control (ENCOMPASS_MAX_HEAVY).
+#define ROUTE_FLAG_AP             0x01
+#define ROUTE_FLAG_HEAVY          0x02
+
+#define ROUTE_AP_HEAVY            (ROUTE_FLAG_AP | ROUTE_FLAG_HEAVY)
+
+#define ENCOMPASS_ROUTES(X)                                                       \
+  X(ROUTE_ROOT,         "/",                handleRoot,         ROUTE_AP_HEAVY)   \
+  X(ROUTE_WIFI,         "/wifi-setup",      handleWifi,         ROUTE_AP_HEAVY)   \
+  X(ROUTE_DNS,          "/dns-setup",       handleWifi,         ROUTE_AP_HEAVY)   \
+  X(ROUTE_DEVICE,       DEVICE_SETUP_URI,   handleWifi,         ROUTE_AP_HEAVY)   \
+  X(ROUTE_SAVE,         "/save",            handleSave,         ROUTE_FLAG_AP)    \
+  X(ROUTE_CLOSE,        "/close",           handleServerClose,  ROUTE_FLAG_AP)    \
+  X(ROUTE_INFO,         "/info",            handleInfo,         ROUTE_AP_HEAVY)   \
+  X(ROUTE_RESET,        "/reset",           handleReset,        ROUTE_FLAG_AP)    \
+  X(ROUTE_STATE,        "/state",           handleState,        ROUTE_AP_HEAVY)   \
+  X(ROUTE_NETWORKS,     "/networks",        handleNetworks,     ROUTE_AP_HEAVY)   \
+  X(ROUTE_CONFIG,       "/config",          handleConfig,       ROUTE_FLAG_AP)    \
+  X(ROUTE_METRICS,      "/metrics",         handleMetrics,      ROUTE_FLAG_HEAVY) \
+  X(ROUTE_JOB,          "/job",             handleJob,          ROUTE_FLAG_AP)    \
+  ENCOMPASS_LOG_ROUTE(X)                                                          \
+  ENCOMPASS_PROFILE_ROUTE(X)                                                      \
+  ENCOMPASS_UPDATE_ROUTE(X)
+
+// The log buffer is only there with ENCOMPASS_ASYNC_LOG
+#if ENCOMPASS_ASYNC_LOG
+  #define ENCOMPASS_LOG_ROUTE(X)                                                  \
+  X(ROUTE_LOG,          "/log",             handleLog,          ROUTE_FLAG_AP)
+#else
+  #define ENCOMPASS_LOG_ROUTE(X)
+#endif
+
+#if ENCOMPASS_PROFILE
+  #define ENCOMPASS_PROFILE_ROUTE(X)                                              \
+  X(ROUTE_PROFILE,      "/profile",         handleProfile,      ROUTE_FLAG_AP)
+#else
+  #define ENCOMPASS_PROFILE_ROUTE(X)
+#endif
+
+#if ENCOMPASS_UPDATE
+  #define ENCOMPASS_UPDATE_ROUTE(X)                                               \
+  X(ROUTE_UPDATE,       "/update",          handleUpdate,       ROUTE_FLAG_AP)
+#else
+  #define ENCOMPASS_UPDATE_ROUTE(X)
+#endif
+
+// Where a firmware upload has got to, named in the "update" event
+enum E_UpdateState
+{
+  UPDATE_IDLE,
+  UPDATE_WRITING,
+  UPDATE_DONE,
+  UPDATE_FAILED
+};
+
+const char UPDATE_NAME_IDLE[]       PROGMEM = "idle";
+const char UPDATE_NAME_WRITING[]    PROGMEM = "writing";
+const char UPDATE_NAME_DONE[]       PROGMEM = "done";
+const char UPDATE_NAME_FAILED[]     PROGMEM = "failed";
+
+const char * const UPDATE_STATE_NAMES[] PROGMEM =
+{
+  UPDATE_NAME_IDLE,
+  UPDATE_NAME_WRITING,
+  UPDATE_NAME_DONE,
+  UPDATE_NAME_FAILED
+};
+
+// Where the time service's time came from
+enum E_TimeSource
+{
+  TIME_NONE,
+  TIME_SAVED,                         // RTC memory, carried over a reset or a deep sleep
+  TIME_SNTP
+};
+
+const char TIME_NAME_NONE[]         PROGMEM = "none";
+const char TIME_NAME_SAVED[]        PROGMEM = "saved";
+const char TIME_NAME_SNTP[]         PROGMEM = "SNTP";
+
+const char * const TIME_SOURCE_NAMES[] PROGMEM =
+{
+  TIME_NAME_NONE,
+  TIME_NAME_SAVED,
+  TIME_NAME_SNTP
+};
+
+#define ROUTE_ENUM(id, path, handler, flags)    id,
+#define ROUTE_PATH(id, path, handler, flags)    const char id##_PATH[] PROGMEM = path;
+
+enum E_Route
+{
+  ENCOMPASS_ROUTES(ROUTE_ENUM)
+  ROUTE_COUNT,
+  ROUTE_NONE = 0xFF
+};
+
+ENCOMPASS_ROUTES(ROUTE_PATH)
+
+class Encompass;
+
+typedef void (*EncompassRoute)(Encompass *wm, AsyncWebServerRequest *request);
+
+struct EncompassRouteEntry
+{
+  PGM_P           path;
+  EncompassRoute  fn;
+  uint8_t         flags;
+};
+
+// 32 slots, change the seed if a new route collides (the static_assert in ImplRoutes.h will say so)
+#define ROUTE_SLOT_BITS           5
+#define ROUTE_SLOTS               (1 << ROUTE_SLOT_BITS)
+
+#ifndef ENCOMPASS_ROUTE_SEED
+  #define ENCOMPASS_ROUTE_SEED    0x9E377C43UL
+#endif
+
+// FNV-1a at compile time, for the route table
+constexpr uint32_t encompassRouteHash(const char *s, uint32_t h = 2166136261UL)
+{
+  return *s ? encompassRouteHash(s + 1, (h ^ (uint8_t) *s) * 16777619UL) : h;
+}
+
+// The same hash at run time - a loop, the recursion above would go as deep as the request URL is long
+inline uint32_t encompassRouteHash(const char *s, const char *end)
+{
+  uint32_t h = 2166136261UL;
+
+  while (s < end)
+    h = (h ^ (uint8_t) *s++) * 16777619UL;
+
+  return h;
+}
+
+// The same hash over everything before a record's check, for what is kept in RTC memory (the time service's
+// TimeRecord, provisioning's ProvisionRecord) - it holds noise after a power on
+template <typename Record>
+inline uint32_t encompassRecordCheck(const Record &record)
+{
+  const char *p = (const char *) &record;
+
+  return encompassRouteHash(p, p + offsetof(Record, check));
+}
+
+constexpr uint8_t encompassRouteSlot(uint32_t hash)
+{
+  return (uint32_t) (hash * ENCOMPASS_ROUTE_SEED) >> (32 - ROUTE_SLOT_BITS);
+}
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 #include "include/class/DataField.cls"
 #include "include/class/WiFiResult.cls"
+#include "include/class/CBORWriter.cls"
+#include "include/class/StateSnapshot.cls"
+#include "include/class/CaptiveDNS.cls"
+#include "include/class/EncompassRequestHandler.cls"
+#include "include/class/EncompassPage.cls"
+#include "include/class/EncompassMetrics.cls"
+#include "include/class/EncompassOps.cls"
+#include "include/class/EncompassJobs.cls"
+#include "include/class/EncompassScheduler.cls"
 #include "include/class/Encompass.cls"
-#include "include/class/Impl.h"
\ No newline at end of file
+#include "Impl.h"
+#include "ImplCBOR.h"
+#include "ImplDNS.h"
+#include "ImplRoutes.h"
+#include "ImplPages.h"
+#include "ImplMetrics.h"
+#include "ImplOps.h"
+#include "ImplJobs.h"
+#include "ImplScheduler.h"
+#include "ImplEvents.h"
+#include "ImplProvision.h"
+#include "ImplUpdate.h"
+#include "ImplRoam.h"
+#include "ImplTime.h"
\ No newline at end of file
@@ -0,0 +1,206 @@
+/*
+  EncompassClock.h
+  For ESP8266 boards
+
+  Wall clock for the time service (ImplTime.h) and the SNTP (RFC 4330) wire format it speaks. Plain C++ like
+  EncompassCrypto.h, the clock is driven by whatever free-running microsecond counter the caller passes in.
+
+  The clock is a line through the last correction: Unix time = base + elapsed counter time, scaled by the drift
+  estimate. A new measurement does not move it at once - the difference is paid off at up to slewPpm of the elapsed
+  time, so the clock never runs backwards and never skips. Only a difference larger than stepUs, or the very first
+  measurement, sets it outright. The part of a difference that slewing had not caught up with is not the counter's
+  fault; the rest, spread over the time since the last measurement, refines the drift.
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define SNTP_PACKET_SIZE                48
+#define SNTP_PORT                       123
+// 1900-01-01 to 1970-01-01
+#define SNTP_UNIX_OFFSET                2208988800UL
+
+// Measurements closer together say too little about the drift
+#define CLOCK_MIN_DRIFT_INTERVAL_US     60000000LL
+#define CLOCK_MAX_DRIFT_PPB             500000
+
+class EncompassClock
+{
+  public:
+
+    EncompassClock(uint32_t slewPpm, uint32_t stepUs) : _slewPpm(slewPpm), _stepUs(stepUs)
+    {
+    }
+
+    bool valid() const
+    {
+      return _valid;
+    }
+
+    // Unix time in us at counter time mono, 0 before the clock has been set
+    int64_t at(uint64_t mono) const
+    {
+      if (!_valid)
+        return 0;
+
+      int64_t dt      = (int64_t) (mono - _mono);
+      int64_t applied = scale(dt, _slewPpm * 1000);
+
+      if (applied > abs64(_slew))
+        applied = abs64(_slew);
+
+      return _unix + dt + scale(dt, _drift) + (_slew < 0 ? -applied : applied);
+    }
+
+    // Sets the clock outright, e.g. from a saved time. drift in ppb, the counter's rate error.
+    void set(uint64_t mono, int64_t unixUs, int32_t drift)
+    {
+      _mono     = mono;
+      _unix     = unixUs;
+      _drift    = drift;
+      _slew     = 0;
+      _valid    = true;
+      _measured = false;
+    }
+
+    // A measurement of the time at mono. Returns the difference to the clock in us, 0 for the first one.
+    int64_t correct(uint64_t mono, int64_t unixUs)
+    {
+      if (!_valid)
+      {
+        set(mono, unixUs, _drift);
+        _measured   = true;
+        _measuredAt = mono;
+        return 0;
+      }
+
+      int64_t clock = at(mono);
+      int64_t error = unixUs - clock;
+      int64_t since = (int64_t) (mono - _measuredAt);
+
+      if (_measured && since >= CLOCK_MIN_DRIFT_INTERVAL_US && abs64(error) <= (int64_t) _stepUs)
+      {
+        // Half of what this interval shows, one noisy round trip should not swing the rate
+        int64_t drift = _drift + (error - owed(mono)) * 500000000LL / since;
+
+        if (drift > CLOCK_MAX_DRIFT_PPB)
+          drift = CLOCK_MAX_DRIFT_PPB;
+        else if (drift < -CLOCK_MAX_DRIFT_PPB)
+          drift = -CLOCK_MAX_DRIFT_PPB;
+
+        _drift = (int32_t) drift;
+      }
+
+      _mono = mono;
+
+      if (abs64(error) > (int64_t) _stepUs)
+      {
+        _unix = unixUs;
+        _slew = 0;
+      }
+      else
+      {
+        _unix = clock;
+        _slew = error;
+      }
+
+      _measured   = true;
+      _measuredAt = mono;
+
+      return error;
+    }
+
+    int32_t drift() const
+    {
+      return _drift;
+    }
+
+    // What slewing has yet to pay off at counter time mono
+    int64_t owed(uint64_t mono) const
+    {
+      int64_t applied = scale((int64_t) (mono - _mono), _slewPpm * 1000);
+
+      if (applied >= abs64(_slew))
+        return 0;
+
+      return _slew < 0 ? _slew + applied : _slew - applied;
+    }
+
+    // SNTP - a client request. nonce goes out as the transmit timestamp, a genuine reply echoes it as its originate.
+    static void sntpRequest(uint8_t packet[SNTP_PACKET_SIZE], const uint8_t nonce[8])
+    {
+      memset(packet, 0, SNTP_PACKET_SIZE);
+
+      packet[0] = 0x23;                   // LI 0, version 4, mode 3 (client)
+      memcpy(&packet[40], nonce, 8);
+    }
+
+    // Server receive and transmit times of a reply, in Unix us. False for anything but a usable answer to nonce.
+    static bool sntpReply(const uint8_t *packet, size_t len, const uint8_t nonce[8], int64_t &received,
+                          int64_t &transmitted)
+    {
+      if (len < SNTP_PACKET_SIZE)
+        return false;
+
+      uint8_t leap    = packet[0] >> 6;
+      uint8_t mode    = packet[0] & 0x07;
+      uint8_t stratum = packet[1];
+
+      // Stratum 0 is a kiss-o'-death, leap 3 an unsynchronised server
+      if (mode != 4 || leap == 3 || stratum == 0 || stratum > 15 || memcmp(&packet[24], nonce, 8) != 0)
+        return false;
+
+      received    = unixUs(&packet[32]);
+      transmitted = unixUs(&packet[40]);
+
+      return transmitted != 0 && transmitted >= received;
+    }
+
+  private:
+
+    uint32_t  _slewPpm;
+    uint32_t  _stepUs;
+
+    bool      _valid      = false;
+    bool      _measured   = false;  // Set by a measurement rather than a saved time
+    uint64_t  _mono       = 0;      // Counter time of the last correction
+    int64_t   _unix       = 0;      // The clock's time then
+    int64_t   _slew       = 0;      // Correction being paid off from then
+    int32_t   _drift      = 0;
+    uint64_t  _measuredAt = 0;
+
+    static int64_t abs64(int64_t x)
+    {
+      return x < 0 ? -x : x;
+    }
+
+    // x * ppb / 10^9, in two parts so years of x do not overflow
+    static int64_t scale(int64_t x, int64_t ppb)
+    {
+      return (x / 1000000) * ppb / 1000 + (x % 1000000) * ppb / 1000000000;
+    }
+
+    // NTP timestamp to Unix us. Era 1 starts in 2036, seconds from before 1970 + 2^31 belong to it.
+    static int64_t unixUs(const uint8_t *ts)
+    {
+      uint32_t seconds  = ((uint32_t) ts[0] << 24) | ((uint32_t) ts[1] << 16) | ((uint32_t) ts[2] << 8) | ts[3];
+      uint32_t fraction = ((uint32_t) ts[4] << 24) | ((uint32_t) ts[5] << 16) | ((uint32_t) ts[6] << 8) | ts[7];
+
+      if (seconds == 0 && fraction == 0)
+        return 0;
+
+      int64_t sinceEpoch = (int64_t) seconds - SNTP_UNIX_OFFSET;
+
+      if (seconds < 0x80000000UL)
+        sinceEpoch += 0x100000000LL;
+
+      return sinceEpoch * 1000000 + (int64_t) (((uint64_t) fraction * 1000000) >> 32);
+    }
+};
@@ -0,0 +1,555 @@
+/*
+  EncompassCrypto.h
+  For ESP8266 boards
+
+  SHA-256 (FIPS 180-4) and HMAC-SHA256 (RFC 2104) for the provisioning protocol, SHA-1 and PBKDF2-HMAC-SHA1
+  (RFC 8018) for deriving WPA2 PSKs. Plain C++ with no Arduino dependency, so the host tools in extras/ build against
+  the same code as the firmware. Incremental: begin(), any number of update() calls, finish().
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifndef PROGMEM
+  #define PROGMEM
+#endif
+
+#ifndef pgm_read_dword
+  #define pgm_read_dword(addr)          (*(const uint32_t *) (addr))
+#endif
+
+#define SHA256_BLOCK_SIZE               64
+#define SHA256_DIGEST_SIZE              32
+
+#define SHA1_BLOCK_SIZE                 64
+#define SHA1_DIGEST_SIZE                20
+
+// PBKDF2 output is made of SHA-1 sized blocks, a WPA2 PSK takes 2
+#define PBKDF2_MAX_BLOCKS               2
+#define PBKDF2_MAX_KEY_SIZE             (PBKDF2_MAX_BLOCKS * SHA1_DIGEST_SIZE)
+
+#define WPA_PSK_SIZE                    32
+#define WPA_PSK_ITERATIONS              4096
+
+class EncompassSHA256
+{
+  public:
+
+    EncompassSHA256()
+    {
+      begin();
+    }
+
+    void begin()
+    {
+      static const uint32_t init[8] =
+      {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+      };
+
+      memcpy(_h, init, sizeof(_h));
+      _bytes  = 0;
+      _used   = 0;
+    }
+
+    void update(const void *data, size_t len)
+    {
+      const uint8_t *p = (const uint8_t *) data;
+
+      _bytes += len;
+
+      // Whole blocks straight from the input once the buffer is empty
+      while (len)
+      {
+        if (_used == 0 && len >= SHA256_BLOCK_SIZE)
+        {
+          transform(p);
+          p   += SHA256_BLOCK_SIZE;
+          len -= SHA256_BLOCK_SIZE;
+          continue;
+        }
+
+        size_t n = SHA256_BLOCK_SIZE - _used;
+
+        if (n > len)
+          n = len;
+
+        memcpy(&_block[_used], p, n);
+        _used += n;
+        p     += n;
+        len   -= n;
+
+        if (_used == SHA256_BLOCK_SIZE)
+        {
+          transform(_block);
+          _used = 0;
+        }
+      }
+    }
+
+    void finish(uint8_t digest[SHA256_DIGEST_SIZE])
+    {
+      uint64_t bits = _bytes * 8;
+
+      _block[_used++] = 0x80;
+
+      if (_used > SHA256_BLOCK_SIZE - 8)
+      {
+        memset(&_block[_used], 0, SHA256_BLOCK_SIZE - _used);
+        transform(_block);
+        _used = 0;
+      }
+
+      memset(&_block[_used], 0, SHA256_BLOCK_SIZE - 8 - _used);
+
+      for (int i = 0; i < 8; i++)
+        _block[SHA256_BLOCK_SIZE - 1 - i] = (uint8_t) (bits >> (8 * i));
+
+      transform(_block);
+
+      for (int i = 0; i < 8; i++)
+      {
+        digest[4 * i]     = (uint8_t) (_h[i] >> 24);
+        digest[4 * i + 1] = (uint8_t) (_h[i] >> 16);
+        digest[4 * i + 2] = (uint8_t) (_h[i] >> 8);
+        digest[4 * i + 3] = (uint8_t) _h[i];
+      }
+    }
+
+    static void hash(const void *data, size_t len, uint8_t digest[SHA256_DIGEST_SIZE])
+    {
+      EncompassSHA256 sha;
+
+      sha.update(data, len);
+      sha.finish(digest);
+    }
+
+  private:
+
+    static uint32_t ror(uint32_t x, uint8_t n)
+    {
+      return (x >> n) | (x << (32 - n));
+    }
+
+    void transform(const uint8_t *block)
+    {
+      static const uint32_t K[64] PROGMEM =
+      {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+      };
+
+      // 16 word schedule window instead of 64, the ESP8266 stack is small
+      uint32_t w[16];
+      uint32_t a = _h[0], b = _h[1], c = _h[2], d = _h[3], e = _h[4], f = _h[5], g = _h[6], h = _h[7];
+
+      for (int i = 0; i < 64; i++)
+      {
+        if (i < 16)
+        {
+          w[i] = ((uint32_t) block[4 * i] << 24) | ((uint32_t) block[4 * i + 1] << 16) |
+                 ((uint32_t) block[4 * i + 2] << 8) | block[4 * i + 3];
+        }
+        else
+        {
+          uint32_t w15 = w[(i - 15) & 15];
+          uint32_t w2  = w[(i - 2) & 15];
+          uint32_t s0  = ror(w15, 7) ^ ror(w15, 18) ^ (w15 >> 3);
+          uint32_t s1  = ror(w2, 17) ^ ror(w2, 19) ^ (w2 >> 10);
+
+          w[i & 15] += s0 + w[(i - 7) & 15] + s1;
+        }
+
+        uint32_t t1 = h + (ror(e, 6) ^ ror(e, 11) ^ ror(e, 25)) + ((e & f) ^ (~e & g)) + pgm_read_dword(&K[i]) + w[i & 15];
+        uint32_t t2 = (ror(a, 2) ^ ror(a, 13) ^ ror(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+      }
+
+      _h[0] += a;
+      _h[1] += b;
+      _h[2] += c;
+      _h[3] += d;
+      _h[4] += e;
+      _h[5] += f;
+      _h[6] += g;
+      _h[7] += h;
+    }
+
+    uint32_t      _h[8];
+    uint64_t      _bytes;
+    uint8_t       _block[SHA256_BLOCK_SIZE];
+    size_t        _used;
+};
+
+class EncompassHMAC
+{
+  public:
+
+    // Keys longer than a block are hashed first, as RFC 2104 says
+    void begin(const void *key, size_t keyLen)
+    {
+      uint8_t pad[SHA256_BLOCK_SIZE];
+
+      memset(_key, 0, sizeof(_key));
+
+      if (keyLen > SHA256_BLOCK_SIZE)
+        EncompassSHA256::hash(key, keyLen, _key);
+      else
+        memcpy(_key, key, keyLen);
+
+      for (int i = 0; i < SHA256_BLOCK_SIZE; i++)
+        pad[i] = _key[i] ^ 0x36;
+
+      _inner.begin();
+      _inner.update(pad, sizeof(pad));
+    }
+
+    void update(const void *data, size_t len)
+    {
+      _inner.update(data, len);
+    }
+
+    void finish(uint8_t mac[SHA256_DIGEST_SIZE])
+    {
+      uint8_t         pad[SHA256_BLOCK_SIZE];
+      EncompassSHA256 outer;
+
+      _inner.finish(mac);
+
+      for (int i = 0; i < SHA256_BLOCK_SIZE; i++)
+        pad[i] = _key[i] ^ 0x5c;
+
+      outer.update(pad, sizeof(pad));
+      outer.update(mac, SHA256_DIGEST_SIZE);
+      outer.finish(mac);
+
+      memset(_key, 0, sizeof(_key));
+    }
+
+    static void mac(const void *key, size_t keyLen, const void *data, size_t len, uint8_t out[SHA256_DIGEST_SIZE])
+    {
+      EncompassHMAC hmac;
+
+      hmac.begin(key, keyLen);
+      hmac.update(data, len);
+      hmac.finish(out);
+    }
+
+    // Compares in the same time wherever the first difference is, for checking a received MAC
+    static bool equal(const uint8_t *a, const uint8_t *b, size_t len)
+    {
+      uint8_t diff = 0;
+
+      for (size_t i = 0; i < len; i++)
+        diff |= a[i] ^ b[i];
+
+      return diff == 0;
+    }
+
+  private:
+
+    EncompassSHA256 _inner;
+    uint8_t         _key[SHA256_BLOCK_SIZE];
+};
+
+class EncompassSHA1
+{
+  public:
+
+    EncompassSHA1()
+    {
+      begin();
+    }
+
+    void begin()
+    {
+      _h[0]   = 0x67452301;
+      _h[1]   = 0xefcdab89;
+      _h[2]   = 0x98badcfe;
+      _h[3]   = 0x10325476;
+      _h[4]   = 0xc3d2e1f0;
+      _bytes  = 0;
+      _used   = 0;
+    }
+
+    void update(const void *data, size_t len)
+    {
+      const uint8_t *p = (const uint8_t *) data;
+
+      _bytes += len;
+
+      while (len)
+      {
+        if (_used == 0 && len >= SHA1_BLOCK_SIZE)
+        {
+          transform(p);
+          p   += SHA1_BLOCK_SIZE;
+          len -= SHA1_BLOCK_SIZE;
+          continue;
+        }
+
+        size_t n = SHA1_BLOCK_SIZE - _used;
+
+        if (n > len)
+          n = len;
+
+        memcpy(&_block[_used], p, n);
+        _used += n;
+        p     += n;
+        len   -= n;
+
+        if (_used == SHA1_BLOCK_SIZE)
+        {
+          transform(_block);
+          _used = 0;
+        }
+      }
+    }
+
+    void finish(uint8_t digest[SHA1_DIGEST_SIZE])
+    {
+      uint64_t bits = _bytes * 8;
+
+      _block[_used++] = 0x80;
+
+      if (_used > SHA1_BLOCK_SIZE - 8)
+      {
+        memset(&_block[_used], 0, SHA1_BLOCK_SIZE - _used);
+        transform(_block);
+        _used = 0;
+      }
+
+      memset(&_block[_used], 0, SHA1_BLOCK_SIZE - 8 - _used);
+
+      for (int i = 0; i < 8; i++)
+        _block[SHA1_BLOCK_SIZE - 1 - i] = (uint8_t) (bits >> (8 * i));
+
+      transform(_block);
+
+      for (int i = 0; i < 5; i++)
+      {
+        digest[4 * i]     = (uint8_t) (_h[i] >> 24);
+        digest[4 * i + 1] = (uint8_t) (_h[i] >> 16);
+        digest[4 * i + 2] = (uint8_t) (_h[i] >> 8);
+        digest[4 * i + 3] = (uint8_t) _h[i];
+      }
+    }
+
+    static void hash(const void *data, size_t len, uint8_t digest[SHA1_DIGEST_SIZE])
+    {
+      EncompassSHA1 sha;
+
+      sha.update(data, len);
+      sha.finish(digest);
+    }
+
+  private:
+
+    static uint32_t rol(uint32_t x, uint8_t n)
+    {
+      return (x << n) | (x >> (32 - n));
+    }
+
+    void transform(const uint8_t *block)
+    {
+      uint32_t w[16];
+      uint32_t a = _h[0], b = _h[1], c = _h[2], d = _h[3], e = _h[4];
+
+      for (int i = 0; i < 80; i++)
+      {
+        if (i < 16)
+        {
+          w[i] = ((uint32_t) block[4 * i] << 24) | ((uint32_t) block[4 * i + 1] << 16) |
+                 ((uint32_t) block[4 * i + 2] << 8) | block[4 * i + 3];
+        }
+        else
+        {
+          w[i & 15] = rol(w[(i - 3) & 15] ^ w[(i - 8) & 15] ^ w[(i - 14) & 15] ^ w[i & 15], 1);
+        }
+
+        uint32_t f;
+
+        if (i < 20)
+          f = ((b & c) | (~b & d)) + 0x5a827999;
+        else if (i < 40)
+          f = (b ^ c ^ d) + 0x6ed9eba1;
+        else if (i < 60)
+          f = ((b & c) | (b & d) | (c & d)) + 0x8f1bbcdc;
+        else
+          f = (b ^ c ^ d) + 0xca62c1d6;
+
+        uint32_t t = rol(a, 5) + f + e + w[i & 15];
+
+        e = d;
+        d = c;
+        c = rol(b, 30);
+        b = a;
+        a = t;
+      }
+
+      _h[0] += a;
+      _h[1] += b;
+      _h[2] += c;
+      _h[3] += d;
+      _h[4] += e;
+    }
+
+    uint32_t      _h[5];
+    uint64_t      _bytes;
+    uint8_t       _block[SHA1_BLOCK_SIZE];
+    size_t        _used;
+};
+
+// PBKDF2-HMAC-SHA1 (RFC 8018), in slices: begin(), run() until it returns true, then key(). The HMAC pads are hashed
+// once in begin() and their states copied for every iteration, which halves the SHA-1 blocks an iteration costs.
+class EncompassPBKDF2
+{
+  public:
+
+    // keyLen up to PBKDF2_MAX_KEY_SIZE
+    bool begin(const void *pass, size_t passLen, const void *salt, size_t saltLen, uint32_t iterations, size_t keyLen)
+    {
+      uint8_t key[SHA1_BLOCK_SIZE];
+      uint8_t pad[SHA1_BLOCK_SIZE];
+
+      if (keyLen == 0 || keyLen > PBKDF2_MAX_KEY_SIZE || iterations == 0)
+        return false;
+
+      memset(key, 0, sizeof(key));
+
+      if (passLen > SHA1_BLOCK_SIZE)
+        EncompassSHA1::hash(pass, passLen, key);
+      else
+        memcpy(key, pass, passLen);
+
+      for (int i = 0; i < SHA1_BLOCK_SIZE; i++)
+        pad[i] = key[i] ^ 0x36;
+
+      _inner.begin();
+      _inner.update(pad, sizeof(pad));
+
+      for (int i = 0; i < SHA1_BLOCK_SIZE; i++)
+        pad[i] = key[i] ^ 0x5c;
+
+      _outer.begin();
+      _outer.update(pad, sizeof(pad));
+
+      memset(key, 0, sizeof(key));
+
+      _keyLen     = keyLen;
+      _blocks     = (keyLen + SHA1_DIGEST_SIZE - 1) / SHA1_DIGEST_SIZE;
+      _iterations = iterations;
+      _block      = 0;
+      _round      = 1;
+
+      // U1 of every block now, the salt is not needed after this
+      for (uint8_t b = 0; b < _blocks; b++)
+      {
+        uint8_t       index[4] = { 0, 0, 0, (uint8_t) (b + 1) };
+        EncompassSHA1 inner    = _inner;
+
+        inner.update(salt, saltLen);
+        inner.update(index, sizeof(index));
+        finishMAC(inner, _u[b]);
+
+        memcpy(_t[b], _u[b], SHA1_DIGEST_SIZE);
+      }
+
+      return true;
+    }
+
+    // Up to rounds more iterations, true once the key is complete
+    bool run(uint32_t rounds)
+    {
+      while (_block < _blocks && rounds)
+      {
+        if (_round == _iterations)
+        {
+          _block++;
+          _round = 1;
+          continue;
+        }
+
+        EncompassSHA1 inner = _inner;
+
+        inner.update(_u[_block], SHA1_DIGEST_SIZE);
+        finishMAC(inner, _u[_block]);
+
+        for (int i = 0; i < SHA1_DIGEST_SIZE; i++)
+          _t[_block][i] ^= _u[_block][i];
+
+        _round++;
+        rounds--;
+      }
+
+      return done();
+    }
+
+    bool done() const
+    {
+      return _block >= _blocks || (_block == _blocks - 1 && _round == _iterations);
+    }
+
+    void key(uint8_t *out)
+    {
+      memcpy(out, _t, _keyLen);
+      memset(_t, 0, sizeof(_t));
+      memset(_u, 0, sizeof(_u));
+    }
+
+    static bool derive(const void *pass, size_t passLen, const void *salt, size_t saltLen, uint32_t iterations,
+                       uint8_t *out, size_t keyLen)
+    {
+      EncompassPBKDF2 pbkdf2;
+
+      if (!pbkdf2.begin(pass, passLen, salt, saltLen, iterations, keyLen))
+        return false;
+
+      pbkdf2.run(PBKDF2_MAX_BLOCKS * iterations);
+      pbkdf2.key(out);
+
+      return true;
+    }
+
+  private:
+
+    void finishMAC(EncompassSHA1 &inner, uint8_t mac[SHA1_DIGEST_SIZE])
+    {
+      EncompassSHA1 outer = _outer;
+
+      inner.finish(mac);
+      outer.update(mac, SHA1_DIGEST_SIZE);
+      outer.finish(mac);
+    }
+
+    EncompassSHA1 _inner;
+    EncompassSHA1 _outer;
+    uint8_t       _u[PBKDF2_MAX_BLOCKS][SHA1_DIGEST_SIZE];
+    uint8_t       _t[PBKDF2_MAX_BLOCKS][SHA1_DIGEST_SIZE];
+    size_t        _keyLen;
+    uint8_t       _blocks;
+    uint8_t       _block;
+    uint32_t      _iterations;
+    uint32_t      _round;
+};
@@ -0,0 +1,328 @@
+/*
+  EncompassLog.h
+  For ESP8266 boards
+
+  Asynchronous logger behind the LOGxxx macros when ENCOMPASS_ASYNC_LOG is set.
+
+  A log call only copies a compact binary entry (timestamp, level, raw arguments - F() strings by their flash address)
+  into a RAM ring buffer. Entries are formatted later: drain() writes them to the debug port, never more than the port
+  can take without blocking and never for longer than its time budget, and printTo() dumps the buffer for /log.
+
+  The ring never blocks the writer. When it wraps, drain() skips ahead and reports how many entries it lost.
+  Writers are the main loop and the AsyncTCP callbacks, which never run concurrently on the ESP8266.
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <IPAddress.h>
+#include <type_traits>
+
+#ifndef ENCOMPASS_LOG_ENTRIES
+  #define ENCOMPASS_LOG_ENTRIES         32
+#endif
+
+// RAM strings (String, char*) are copied into the entry, up to this many bytes per entry
+#ifndef ENCOMPASS_LOG_TEXT
+  #define ENCOMPASS_LOG_TEXT            20
+#endif
+
+// Longest formatted line, anything beyond is cut
+#ifndef ENCOMPASS_LOG_LINE
+  #define ENCOMPASS_LOG_LINE            128
+#endif
+
+#define ENCOMPASS_LOG_ARGS              4
+
+// Entry flags
+#define LOG_FLAG_LINE                   0x01      // "[WM] " prefix and newline, LOGxxx0 fragments have neither
+
+enum E_LogArg
+{
+  LOG_ARG_NONE,
+  LOG_ARG_INT,
+  LOG_ARG_UINT,
+  LOG_ARG_CHAR,
+  LOG_ARG_FLOAT,
+  LOG_ARG_FLASH,
+  LOG_ARG_TEXT,
+  LOG_ARG_IP
+};
+
+struct EncompassLogEntry
+{
+  uint32_t  ms;
+  uint8_t   level;
+  uint8_t   flags;
+  uint8_t   argc;
+  uint8_t   textUsed;
+  uint8_t   types[ENCOMPASS_LOG_ARGS];
+  uintptr_t args[ENCOMPASS_LOG_ARGS];
+  char      text[ENCOMPASS_LOG_TEXT];
+};
+
+// Fixed size line, so an entry can be measured before it goes to the port
+class EncompassLogLine : public Print
+{
+  public:
+
+    EncompassLogLine() : len(0)
+    {
+    }
+
+    size_t write(uint8_t c) override
+    {
+      if (len >= sizeof(buf))
+        return 0;
+
+      buf[len++] = c;
+      return 1;
+    }
+
+    char      buf[ENCOMPASS_LOG_LINE];
+    size_t    len;
+};
+
+class EncompassLog
+{
+  public:
+
+    template <typename... Args>
+    static void record(uint8_t level, uint8_t flags, const Args&... args)
+    {
+      static_assert(sizeof...(Args) <= ENCOMPASS_LOG_ARGS, "Too many log arguments");
+
+      State             &s  = state();
+      uint32_t          seq = s.head;
+      EncompassLogEntry &e  = s.entries[seq % ENCOMPASS_LOG_ENTRIES];
+
+      e.ms        = s.clock ? s.clock() : millis();
+      e.level     = level;
+      e.flags     = flags;
+      e.argc      = 0;
+      e.textUsed  = 0;
+
+      captureAll(e, args...);
+
+      // Published only once complete
+      s.head  = seq + 1;
+    }
+
+    // Writes pending entries to port while it has room and budgetUs lasts, returns the number written
+    template <typename Port>
+    static uint16_t drain(Port &port, uint32_t budgetUs)
+    {
+      State     &s      = state();
+      uint32_t  start   = micros();
+      uint16_t  written = 0;
+
+      while (s.drained != s.head && (micros() - start) < budgetUs)
+      {
+        EncompassLogLine line;
+
+        // The writer lapped us, say so and carry on from the oldest entry. With the port full the skip waits too, it is
+        // worked out again (over however many more were lost) on the next drain().
+        if (s.head - s.drained > ENCOMPASS_LOG_ENTRIES)
+        {
+          uint32_t skipped = s.head - ENCOMPASS_LOG_ENTRIES - s.drained;
+
+          line.print(F("[WM] "));
+          line.print(skipped);
+          line.println(F(" log entries lost"));
+
+          if (port.availableForWrite() < (int) line.len)
+            break;
+
+          port.write((const uint8_t *) line.buf, line.len);
+
+          s.lost    += skipped;
+          s.drained += skipped;
+
+          continue;
+        }
+
+        format(s.entries[s.drained % ENCOMPASS_LOG_ENTRIES], line, false);
+
+        if (port.availableForWrite() < (int) line.len)
+          break;
+
+        port.write((const uint8_t *) line.buf, line.len);
+        s.drained++;
+        written++;
+      }
+
+      return written;
+    }
+
+    // Everything still in the buffer, oldest first, with timestamps and levels
+    static void printTo(Print &out)
+    {
+      State     &s      = state();
+      uint32_t  cursor  = (s.head > ENCOMPASS_LOG_ENTRIES) ? s.head - ENCOMPASS_LOG_ENTRIES : 0;
+
+      for (; cursor != s.head; cursor++)
+      {
+        EncompassLogLine line;
+
+        format(s.entries[cursor % ENCOMPASS_LOG_ENTRIES], line, true);
+        out.write((const uint8_t *) line.buf, line.len);
+      }
+    }
+
+    // Time source for entry timestamps, millis() by default
+    static void setClock(uint32_t (*clock)(void))
+    {
+      state().clock = clock;
+    }
+
+    static uint32_t recorded()
+    {
+      return state().head;
+    }
+
+    static uint32_t lost()
+    {
+      return state().lost;
+    }
+
+  private:
+
+    struct State
+    {
+      EncompassLogEntry entries[ENCOMPASS_LOG_ENTRIES];
+      volatile uint32_t head;
+      uint32_t          drained;
+      uint32_t          lost;
+      uint32_t          (*clock)(void);
+    };
+
+    static State& state()
+    {
+      static State s;
+      return s;
+    }
+
+    static void format(const EncompassLogEntry &e, EncompassLogLine &line, bool stamped)
+    {
+      if (stamped)
+      {
+        line.print(e.ms);
+        line.print(' ');
+        line.print("?EWID"[(e.level < 5) ? e.level : 0]);
+        line.print(' ');
+      }
+      else if (e.flags & LOG_FLAG_LINE)
+      {
+        line.print(F("[WM] "));
+      }
+
+      for (uint8_t i = 0; i < e.argc; i++)
+      {
+        if (i)
+          line.print(' ');
+
+        switch (e.types[i])
+        {
+          case LOG_ARG_INT:
+            line.print((int32_t) e.args[i]);
+            break;
+          case LOG_ARG_UINT:
+            line.print((uint32_t) e.args[i]);
+            break;
+          case LOG_ARG_CHAR:
+            line.print((char) e.args[i]);
+            break;
+          case LOG_ARG_FLOAT:
+          {
+            float f;
+            memcpy(&f, &e.args[i], sizeof(f));
+            line.print(f);
+            break;
+          }
+          case LOG_ARG_FLASH:
+            line.print(reinterpret_cast<const __FlashStringHelper *>(e.args[i]));
+            break;
+          case LOG_ARG_TEXT:
+            line.print(&e.text[e.args[i]]);
+            break;
+          case LOG_ARG_IP:
+            line.print(IPAddress((uint32_t) e.args[i]));
+            break;
+          default:
+            line.print('~');
+            break;
+        }
+      }
+
+      if ((e.flags & LOG_FLAG_LINE) || stamped)
+        line.println();
+    }
+
+    static void captureAll(EncompassLogEntry &e)
+    {
+    }
+
+    template <typename T, typename... Rest>
+    static void captureAll(EncompassLogEntry &e, const T &first, const Rest&... rest)
+    {
+      capture(e, first);
+      e.argc++;
+      captureAll(e, rest...);
+    }
+
+    static void set(EncompassLogEntry &e, uint8_t type, uintptr_t value)
+    {
+      e.types[e.argc] = type;
+      e.args[e.argc]  = value;
+    }
+
+    static void captureText(EncompassLogEntry &e, const char *str)
+    {
+      size_t room = sizeof(e.text) - e.textUsed;
+
+      if (str == NULL || room == 0)
+      {
+        set(e, LOG_ARG_NONE, 0);
+        return;
+      }
+
+      size_t len = strnlen(str, room - 1);
+
+      memcpy(&e.text[e.textUsed], str, len);
+      e.text[e.textUsed + len] = 0;
+
+      set(e, LOG_ARG_TEXT, e.textUsed);
+      e.textUsed += len + 1;
+    }
+
+    static void capture(EncompassLogEntry &e, const __FlashStringHelper *v)   { set(e, LOG_ARG_FLASH, (uintptr_t) v); }
+    static void capture(EncompassLogEntry &e, const char *v)                  { captureText(e, v); }
+    static void capture(EncompassLogEntry &e, char *v)                        { captureText(e, v); }
+    static void capture(EncompassLogEntry &e, const String &v)                { captureText(e, v.c_str()); }
+    static void capture(EncompassLogEntry &e, const IPAddress &v)             { IPAddress ip = v; set(e, LOG_ARG_IP, (uint32_t) ip); }
+    static void capture(EncompassLogEntry &e, char v)                         { set(e, LOG_ARG_CHAR, (uint8_t) v); }
+    static void capture(EncompassLogEntry &e, float v)                        { uintptr_t u = 0; memcpy(&u, &v, sizeof(v)); set(e, LOG_ARG_FLOAT, u); }
+    static void capture(EncompassLogEntry &e, double v)                       { capture(e, (float) v); }
+    static void capture(EncompassLogEntry &e, bool v)                         { set(e, LOG_ARG_UINT, v); }
+    static void capture(EncompassLogEntry &e, unsigned char v)                { set(e, LOG_ARG_UINT, v); }
+    static void capture(EncompassLogEntry &e, unsigned short v)               { set(e, LOG_ARG_UINT, v); }
+    static void capture(EncompassLogEntry &e, unsigned int v)                 { set(e, LOG_ARG_UINT, v); }
+    static void capture(EncompassLogEntry &e, unsigned long v)                { set(e, LOG_ARG_UINT, v); }
+
+    // int, long, enums... and String temporaries (StringSumHelper)
+    template <typename T>
+    static void capture(EncompassLogEntry &e, const T &v)
+    {
+      captureOther(e, v, std::is_convertible<const T&, const String&>());
+    }
+
+    template <typename T>
+    static void captureOther(EncompassLogEntry &e, const T &v, std::true_type)  { captureText(e, static_cast<const String &>(v).c_str()); }
+
+    template <typename T>
+    static void captureOther(EncompassLogEntry &e, const T &v, std::false_type) { set(e, LOG_ARG_INT, (uintptr_t) (int32_t) v); }
+};
@@ -0,0 +1,298 @@
+/*
+  EncompassProvision.h
+  For ESP8266 boards
+
+  Wire format of the UDP provisioning protocol, shared by the portal's listener (ImplProvision.h) and the host sender
+  (extras/provision). Plain C++ like EncompassCrypto.h.
+
+  One datagram each way, multi-byte numbers in network order:
+
+    header    magic "ENCP", version, type, flags, reserved, nonce (8), target station MAC (6), reserved (2),
+              counter (8)
+    body      TLVs - tag (1), length (1), value - encrypted
+    trailer   HMAC-SHA256 of header and encrypted body
+
+  Two keys are derived from the shared provisioning key, one for the MAC and one for the body: the body is XORed with
+  HMAC-SHA256(stream key, header, block number), so the password never crosses the air in the clear. The header goes
+  into every keystream block and two different bodies never go out under the same one - a request's counter is the
+  sender's clock in us, an ACK's the device's uptime in us.
+
+  A PROVISION carries the SSID, password, static IPs and DataField values ("id\0value") and is addressed to one
+  station MAC, or to every device when the target is all zeros. The device answers with an ACK echoing the nonce and
+  carrying its own MAC in the target field. Datagrams that fail the MAC or are for another device get no answer; a
+  nonce seen before gets the same ACK again without being applied twice, so a sender can simply repeat until it has
+  heard from every device. Any other request must carry a higher counter than the last one the device took, a
+  recorded request played back later is answered PROVISION_STALE.
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#pragma once
+
+#include "EncompassCrypto.h"
+
+#define PROVISION_MAGIC                 "ENCP"
+#define PROVISION_VERSION               2
+#define PROVISION_HEADER_SIZE           32
+#define PROVISION_MAC_SIZE              SHA256_DIGEST_SIZE
+#define PROVISION_NONCE_SIZE            8
+#define PROVISION_MAX_PACKET            512
+
+// Header offsets
+#define PROVISION_OFS_VERSION           4
+#define PROVISION_OFS_TYPE              5
+#define PROVISION_OFS_NONCE             8
+#define PROVISION_OFS_TARGET            16
+#define PROVISION_OFS_COUNTER           24
+
+enum E_ProvisionType
+{
+  PROVISION_REQUEST  = 1,
+  PROVISION_ACK      = 2
+};
+
+enum E_ProvisionTag
+{
+  PTAG_SSID          = 0x01,
+  PTAG_PASS          = 0x02,
+  PTAG_IP            = 0x03,              // PTAG_IP to PTAG_DNS2 follow E_JobIP, 4 bytes each
+  PTAG_GW            = 0x04,
+  PTAG_SN            = 0x05,
+  PTAG_DNS1          = 0x06,
+  PTAG_DNS2          = 0x07,
+  PTAG_FIELD         = 0x10,              // DataField id, a 0, its value
+
+  // ACK
+  PTAG_STATUS        = 0x80,              // E_ProvisionStatus, 1 byte
+  PTAG_JOB           = 0x81,              // Credentials job id, 2 bytes - follow it on /job
+  PTAG_CHIP_ID       = 0x82,              // 4 bytes
+  PTAG_AP_NAME       = 0x83
+};
+
+enum E_ProvisionStatus
+{
+  PROVISION_OK          = 0,              // Queued as a credentials job
+  PROVISION_MALFORMED   = 1,
+  PROVISION_BUSY        = 2,              // Job queue full or out of memory, try again
+  PROVISION_UNSUPPORTED = 3,              // Newer version, unknown tag
+  PROVISION_STALE       = 4               // Counter not above the last request taken - a replay, or the sender's
+                                          // clock is behind
+};
+
+// The two keys derived from the shared one, derive() once per key rather than per datagram
+class ProvisionKeys
+{
+  public:
+
+    void derive(const void *key, size_t keyLen)
+    {
+      EncompassHMAC::mac(key, keyLen, "ENCP mac", 8, mac);
+      EncompassHMAC::mac(key, keyLen, "ENCP stream", 11, stream);
+    }
+
+    // Encrypts or decrypts a body in place under its header
+    void crypt(const uint8_t *header, uint8_t *body, size_t len) const
+    {
+      uint8_t block[SHA256_DIGEST_SIZE];
+
+      for (uint8_t n = 0; len; n++)
+      {
+        EncompassHMAC hmac;
+        size_t        take = (len < sizeof(block)) ? len : sizeof(block);
+
+        hmac.begin(stream, sizeof(stream));
+        hmac.update(header, PROVISION_HEADER_SIZE);
+        hmac.update(&n, 1);
+        hmac.finish(block);
+
+        for (size_t i = 0; i < take; i++)
+          body[i] ^= block[i];
+
+        body += take;
+        len  -= take;
+      }
+    }
+
+    uint8_t       mac[SHA256_DIGEST_SIZE];
+    uint8_t       stream[SHA256_DIGEST_SIZE];
+};
+
+// Builds a datagram in a caller's buffer: header(), any number of add(), then seal()
+class ProvisionWriter
+{
+  public:
+
+    ProvisionWriter(uint8_t *buf, size_t size) : _buf(buf), _size(size), _len(0), _overflow(false)
+    {
+    }
+
+    void header(uint8_t type, const uint8_t nonce[PROVISION_NONCE_SIZE], const uint8_t target[6], uint64_t counter)
+    {
+      memset(_buf, 0, PROVISION_HEADER_SIZE);
+      memcpy(_buf, PROVISION_MAGIC, 4);
+      _buf[PROVISION_OFS_VERSION] = PROVISION_VERSION;
+      _buf[PROVISION_OFS_TYPE]    = type;
+      memcpy(&_buf[PROVISION_OFS_NONCE], nonce, PROVISION_NONCE_SIZE);
+
+      if (target)
+        memcpy(&_buf[PROVISION_OFS_TARGET], target, 6);
+
+      for (uint8_t i = 0; i < 8; i++)
+        _buf[PROVISION_OFS_COUNTER + i] = (uint8_t) (counter >> (56 - 8 * i));
+
+      _len = PROVISION_HEADER_SIZE;
+    }
+
+    void add(uint8_t tag, const void *value, size_t len)
+    {
+      if (len > 255 || _len + 2 + len + PROVISION_MAC_SIZE > _size)
+      {
+        _overflow = true;
+        return;
+      }
+
+      _buf[_len++] = tag;
+      _buf[_len++] = (uint8_t) len;
+      memcpy(&_buf[_len], value, len);
+      _len += len;
+    }
+
+    void addString(uint8_t tag, const char *value)
+    {
+      add(tag, value, strlen(value));
+    }
+
+    void addU8(uint8_t tag, uint8_t value)
+    {
+      add(tag, &value, 1);
+    }
+
+    void addU16(uint8_t tag, uint16_t value)
+    {
+      uint8_t b[2] = { (uint8_t) (value >> 8), (uint8_t) value };
+
+      add(tag, b, 2);
+    }
+
+    void addU32(uint8_t tag, uint32_t value)
+    {
+      uint8_t b[4] = { (uint8_t) (value >> 24), (uint8_t) (value >> 16), (uint8_t) (value >> 8), (uint8_t) value };
+
+      add(tag, b, 4);
+    }
+
+    // Encrypts the body and appends the MAC, returns the datagram length - 0 when something did not fit
+    size_t seal(const ProvisionKeys &keys)
+    {
+      if (_overflow)
+        return 0;
+
+      keys.crypt(_buf, &_buf[PROVISION_HEADER_SIZE], _len - PROVISION_HEADER_SIZE);
+      EncompassHMAC::mac(keys.mac, sizeof(keys.mac), _buf, _len, &_buf[_len]);
+
+      return _len + PROVISION_MAC_SIZE;
+    }
+
+  private:
+
+    uint8_t       *_buf;
+    size_t        _size;
+    size_t        _len;
+    bool          _overflow;
+};
+
+// Walks a received datagram once open() has checked and decrypted it
+class ProvisionReader
+{
+  public:
+
+    ProvisionReader(uint8_t *buf, size_t len) : _buf(buf), _len(len), _pos(PROVISION_HEADER_SIZE)
+    {
+    }
+
+    // Header and MAC check, then the body - everything up to the MAC - is decrypted in place
+    bool open(const ProvisionKeys &keys)
+    {
+      uint8_t mac[PROVISION_MAC_SIZE];
+
+      if (_len < PROVISION_HEADER_SIZE + PROVISION_MAC_SIZE || memcmp(_buf, PROVISION_MAGIC, 4) != 0)
+        return false;
+
+      _len -= PROVISION_MAC_SIZE;
+
+      EncompassHMAC::mac(keys.mac, sizeof(keys.mac), _buf, _len, mac);
+
+      if (!EncompassHMAC::equal(mac, &_buf[_len], PROVISION_MAC_SIZE))
+        return false;
+
+      keys.crypt(_buf, &_buf[PROVISION_HEADER_SIZE], _len - PROVISION_HEADER_SIZE);
+
+      return true;
+    }
+
+    uint8_t version() const
+    {
+      return _buf[PROVISION_OFS_VERSION];
+    }
+
+    uint8_t type() const
+    {
+      return _buf[PROVISION_OFS_TYPE];
+    }
+
+    const uint8_t* nonce() const
+    {
+      return &_buf[PROVISION_OFS_NONCE];
+    }
+
+    const uint8_t* target() const
+    {
+      return &_buf[PROVISION_OFS_TARGET];
+    }
+
+    uint64_t counter() const
+    {
+      return ((uint64_t) u32(&_buf[PROVISION_OFS_COUNTER]) << 32) | u32(&_buf[PROVISION_OFS_COUNTER + 4]);
+    }
+
+    // Next TLV, false at the end of the body or when a TLV runs past it (malformed() tells which)
+    bool next(uint8_t &tag, const uint8_t *&value, uint8_t &len)
+    {
+      if (_pos + 2 > _len)
+        return false;
+
+      tag   = _buf[_pos];
+      len   = _buf[_pos + 1];
+      value = &_buf[_pos + 2];
+
+      if (_pos + 2 + len > _len)
+        return false;
+
+      _pos += 2 + len;
+
+      return true;
+    }
+
+    bool malformed() const
+    {
+      return _pos != _len;
+    }
+
+    static uint32_t u32(const uint8_t *b)
+    {
+      return ((uint32_t) b[0] << 24) | ((uint32_t) b[1] << 16) | ((uint32_t) b[2] << 8) | b[3];
+    }
+
+    static uint16_t u16(const uint8_t *b)
+    {
+      return (uint16_t) ((b[0] << 8) | b[1]);
+    }
+
+  private:
+
+    uint8_t       *_buf;
+    size_t        _len;
+    size_t        _pos;
+};
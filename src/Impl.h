@@ -55,7 +55,7 @@ char* Encompass::getRFC952_hostname(const char* iHostname)
   return RFC952_hostname;
 }
 
-Encompass::Encompass(AsyncWebServer * webserver, DNSServer *dnsserver, const char *iHostname)
+Encompass::Encompass(AsyncWebServer * webserver, DNSServer *dnsserver, const char *iHostname) : _ops(_metrics)
 //Encompass::Encompass(const char *iHostname)
 {
 
@@ -66,12 +66,23 @@ Encompass::Encompass(AsyncWebServer * webserver, DNSServer *dnsserver, const cha
   wifiSSIDscan  = true;
   _modeless     = false;
   shouldscan    = true;
-  
-#if USE_DYNAMIC_DataFields
-  _max_DataFields = WIFI_MANAGER_MAX_DataFields;
-  _DataFields = (Encompass_DataFields)malloc(_max_DataFields * sizeof(Encompass_DataFields*));
+
+  setMemoryThresholds(PRESSURE_LOW,       ENCOMPASS_HEAP_LOW,       ENCOMPASS_BLOCK_LOW);
+  setMemoryThresholds(PRESSURE_HIGH,      ENCOMPASS_HEAP_HIGH,      ENCOMPASS_BLOCK_HIGH);
+  setMemoryThresholds(PRESSURE_CRITICAL,  ENCOMPASS_HEAP_CRITICAL,  ENCOMPASS_BLOCK_CRITICAL);
+
+  addLibraryTasks();
+
+#if ENCOMPASS_TIME
+  // The time a reset or deep sleep carried over, see ImplTime.h
+  restoreTime();
 #endif
 
+#if ENCOMPASS_PROVISIONING
+  // The last provisioning counter taken, see ImplProvision.h
+  restoreProvisionCounter();
+#endif
+  
   //WiFi not yet started here, must call WiFi.mode(WIFI_STA) and modify function WiFiGenericClass::mode(wifi_mode_t m) !!!
 
   WiFi.mode(WIFI_STA);
@@ -101,17 +112,130 @@ Encompass::~Encompass()
   {
     free(networkIndices); //indices array no longer required so free memory
   }
+
+  if (_DataFields)
+  {
+    free(_DataFields);
+  }
+
+  if (wifiSSIDs)
+  {
+    delete [] wifiSSIDs;
+  }
 }
 
-int _max_DataFields;
+DataField::DataField(const char *custom)
+{
+  init(NULL, NULL, NULL, 0, custom, E_NO_LABEL);
+}
 
-bool Encompass::addDataField(DataFields *p)
+DataField::DataField(const char *id, const char *placeholder, const char *defaultValue, int length, const char *custom, int labelPlacement)
 {
-  
+  init(id, placeholder, defaultValue, length, custom, labelPlacement);
+}
+
+void DataField::init(const char *id, const char *placeholder, const char *defaultValue, int length, const char *custom, int labelPlacement)
+{
+  _id             = id;
+  _placeholder    = placeholder;
+  _length         = length;
+  _labelPlacement = labelPlacement;
+  _customHTML     = custom;
+  _value          = NULL;
+
+  if (_id == NULL)
+    return;
+
+  _value = new char[_length + 1];
+
+  memset(_value, 0, _length + 1);
+
+  if (defaultValue != NULL)
+  {
+    strncpy(_value, defaultValue, _length);
+  }
+}
+
+DataField::~DataField()
+{
+  delete[] _value;
+}
+
+const char* DataField::getID()
+{
+  return _id;
+}
+
+const char* DataField::getName()
+{
+  return _id;
+}
+
+const char* DataField::getValue()
+{
+  return _value;
+}
+
+const char* DataField::getPlaceholder()
+{
+  return _placeholder;
+}
+
+int DataField::getValueLength()
+{
+  return _length;
+}
+
+int DataField::getLabelPlacement()
+{
+  return _labelPlacement;
+}
+
+const char* DataField::getCustomHTML()
+{
+  return _customHTML;
+}
+
+bool Encompass::addDataField(DataField *p)
+{
+  if (_DataFieldsCount == _max_DataFields)
+  {
+    // Grow the list, the fields themselves stay the sketch's
+    int         grown   = _max_DataFields + ENCOMPASS_MAX_DATA_FIELDS;
+    DataField   **list  = (DataField **) realloc(_DataFields, grown * sizeof(DataField *));
+
+    if (list == NULL)
+    {
+      LOGERROR(F("ERROR: failed to realloc DataFields, size not increased!"));
+      return false;
+    }
+
+    _DataFields     = list;
+    _max_DataFields = grown;
+  }
+
+  _DataFields[_DataFieldsCount++] = p;
+
+  LOGINFO1(F("Adding DataField"), p->getID());
+
+  return true;
+}
+
+DataField** Encompass::getDataFields()
+{
+  return _DataFields;
+}
+
+int Encompass::getDataFieldsCount()
+{
+  return _DataFieldsCount;
 }
 
 void Encompass::setupConfigPortal()
 {
+  EncompassOp op(_ops, OP_PORTAL);
+  uint32_t    bringUpStart = micros();
+
   stopConfigPortal = false; //Signal not to close config portal
 
   /*This library assumes autoconnect is set to 1. It usually is
@@ -120,15 +244,6 @@ void Encompass::setupConfigPortal()
   if (WiFi.getAutoConnect() == 0)
     WiFi.setAutoConnect(1);
 
-  server->reset();
-
-  /* Setup the DNS server redirecting all the domains to the apIP */
-  if (dnsServer)
-  {
-    dnsServer->setErrorReplyCode(DNSReplyCode::NoError);
-    dnsServer->start(DNS_PORT, "*", WiFi.softAPIP());
-  }
-
   _configPortalStart = millis();
 
   LOGWARN1(F("\nConfiguring AP SSID ="), _apName);
@@ -148,62 +263,161 @@ void Encompass::setupConfigPortal()
   
   // KH, To enable dynamic/random channel
   static int channel;
+
+  _apChannelScore = -1;
+
+  // The soft AP shares the radio with the station, so it follows a connected station's channel whatever was asked for
+  if (_WiFiAPChannel == AUTO_WIFI_CHANNEL && WiFi.status() == WL_CONNECTED)
+    channel = WiFi.channel();
+  else if (_WiFiAPChannel == AUTO_WIFI_CHANNEL)
+    channel = pickAPChannel(_apChannelScore);
   // Use random channel if  _WiFiAPChannel == 0
-  if (_WiFiAPChannel == 0)
+  else if (_WiFiAPChannel == 0)
     channel = (_configPortalStart % MAX_WIFI_CHANNEL) + 1;
   else
     channel = _WiFiAPChannel;
-  
-  if (_apPassword != NULL)
-  {
-    LOGWARN1(F("AP Channel ="), channel);
-    
-    //WiFi.softAP(_apName, _apPassword);//password option
-    WiFi.softAP(_apName, _apPassword, channel);
-  }
-  else
-  {
-    // Can't use channel here
-    WiFi.softAP(_apName);
-  }
-  //////
-  
-  // Contributed by AlesSt (https://github.com/AlesSt) to solve issue softAP with custom IP sometimes not working
-  // See https://github.com/thewhiterabbit/Encompass/issues/26 and https://github.com/espressif/arduino-esp32/issues/985
-  // delay 100ms to wait for SYSTEM_EVENT_AP_START
-  delay(100);
+
+  _apChannel = channel;
+
+  LOGWARN1(F("AP Channel ="), channel);
+
+  // NULL opens the AP, the channel is used either way
+  WiFi.softAP(_apName, _apPassword, channel);
   //////
   
   //optional soft ip config
   if (_ap_static_ip)
   {
     LOGWARN3(F("Custom AP IP/GW/Subnet = "), _ap_static_ip, _ap_static_gw, _ap_static_sn);
-    WiFi.softAPConfig(_ap_static_ip, _ap_static_gw, _ap_static_sn);
+
+    // softAPConfig() fails while the AP is still coming up (see issue #26)
+    if (!waitForAPMode() || !WiFi.softAPConfig(_ap_static_ip, _ap_static_gw, _ap_static_sn))
+      LOGERROR(F("Custom AP IP not applied"));
   }
 
-  delay(500); // Without delay I've seen the IP address blank
+  // Instead of sleeping 600 ms in case the address was still blank (see issue #26)
+  if (!waitForSoftAP())
+    LOGERROR(F("Soft AP not up, its address may be blank"));
   
   LOGWARN1(F("AP IP address ="), WiFi.softAPIP());
 
-  /* Setup web pages: root, wifi config pages, SO captive portal detectors and not found. */
-  
-  server->on("/",               std::bind(&Encompass::handleRoot,         this, std::placeholders::_1)).setFilter(ON_AP_FILTER);
-  server->on("/wifi-setup",     std::bind(&Encompass::handleWifi,         this, std::placeholders::_1)).setFilter(ON_AP_FILTER);
-  server->on("/dns-setup",      std::bind(&Encompass::handleWifi,         this, std::placeholders::_1)).setFilter(ON_AP_FILTER);
-  server->on(DEVICE_SETUP_URI,  std::bind(&Encompass::handleWifi,         this, std::placeholders::_1)).setFilter(ON_AP_FILTER);
-  server->on("/save",           std::bind(&Encompass::handleSave,         this, std::placeholders::_1)).setFilter(ON_AP_FILTER);
-  server->on("/close",          std::bind(&Encompass::handleServerClose,  this, std::placeholders::_1)).setFilter(ON_AP_FILTER);
-  server->on("/info",           std::bind(&Encompass::handleInfo,         this, std::placeholders::_1)).setFilter(ON_AP_FILTER);
-  server->on("/reset",          std::bind(&Encompass::handleReset,        this, std::placeholders::_1)).setFilter(ON_AP_FILTER);
-  server->on("/state",          std::bind(&Encompass::handleState,        this, std::placeholders::_1)).setFilter(ON_AP_FILTER);
-  // Microsoft captive portal. Maybe not needed. Might be handled by notFound handler.
-  // Ask about this - may need it for higher compatibility.
-  server->on("/fwlink",         std::bind(&Encompass::handleRoot,         this, std::placeholders::_1)).setFilter(ON_AP_FILTER);  
-  server->onNotFound(           std::bind(&Encompass::handleNotFound,     this, std::placeholders::_1));
+  IPAddress apIP = WiFi.softAPIP();
+  snprintf(_portalURL, sizeof(_portalURL), "http://%u.%u.%u.%u/", apIP[0], apIP[1], apIP[2], apIP[3]);
+
+  /* Setup the DNS server redirecting all the domains to the apIP */
+  // Started once the AP has its address, otherwise every query would be answered with 0.0.0.0
+#if USE_ENCOMPASS_DNS
+  _captiveDNS.start(DNS_PORT, WiFi.softAPIP());
+#else
+  if (dnsServer)
+  {
+    dnsServer->setErrorReplyCode(DNSReplyCode::NoError);
+    dnsServer->start(DNS_PORT, "*", WiFi.softAPIP());
+  }
+#endif
+
+#if ENCOMPASS_PROVISIONING
+  startProvisioning();
+#endif
+
+  if (!_portalRoutes)
+  {
+    _portalRoutes = true;
+
+#if ENCOMPASS_EVENTS
+    // Ahead of the catch-all handler below, which would take /events too
+    setupEvents();
+#endif
+
+    /* Setup web pages: root, wifi config pages, SO captive portal detectors and not found. */
+    // One handler for everything, routes are looked up in ENCOMPASS_ROUTES (and addRoute()) by Encompass::dispatch()
+    server->addHandler(new EncompassRequestHandler(this));
   
-  server->begin(); // Web server start
+    server->begin(); // Web server start
   
-  LOGWARN(F("HTTP server started"));
+    LOGWARN(F("HTTP server started"));
+  }
+
+  _portalOpen       = true;
+  _portalBringUpUs  = micros() - bringUpStart;
+
+  LOGWARN1(F("Portal up, us ="), _portalBringUpUs);
+}
+
+// The ESP8266 has no event for the soft AP starting, and softAP() / softAPConfig() only return once the interface is
+// configured - so this normally sees it up on the first look. It still looks rather than assumes, yielding meanwhile.
+// With a custom AP IP it waits for that address, the default 192.168.4.1 showing first is not up yet.
+bool Encompass::waitForSoftAP()
+{
+  unsigned long start = millis();
+
+  while (!(WiFi.getMode() & WIFI_AP) || (uint32_t) WiFi.softAPIP() == 0 ||
+         (_ap_static_ip && (uint32_t) WiFi.softAPIP() != (uint32_t) _ap_static_ip))
+  {
+    if (millis() - start >= ENCOMPASS_AP_START_TIMEOUT_MS)
+      return false;
+
+    delay(1);
+  }
+
+  return true;
+}
+
+// The part of waitForSoftAP() softAPConfig() needs, the AP interface being on
+bool Encompass::waitForAPMode()
+{
+  unsigned long start = millis();
+
+  while (!(WiFi.getMode() & WIFI_AP))
+  {
+    if (millis() - start >= ENCOMPASS_AP_START_TIMEOUT_MS)
+      return false;
+
+    delay(1);
+  }
+
+  return true;
+}
+
+// Turns the portal off and stops what serves it, the routes and the soft AP stay as they are
+void Encompass::shutdownConfigPortal()
+{
+  _portalOpen = false;
+
+#if ENCOMPASS_EVENTS
+  if (_events)
+    _events->close();
+#endif
+
+#if USE_ENCOMPASS_DNS
+  _captiveDNS.stop();
+#else
+  if (dnsServer)
+    dnsServer->stop();
+#endif
+
+#if ENCOMPASS_PROVISIONING
+  stopProvisioning();
+#endif
+}
+
+void Encompass::closeConfigPortal()
+{
+  shutdownConfigPortal();
+
+  _modeless = false;
+
+  // The station stays, with whatever it is connected to
+  WiFi.softAPdisconnect(true);
+
+  LOGWARN(F("Portal closed"));
+}
+
+void Encompass::restartConfigPortal()
+{
+  _modeless = true;
+
+  setupConfigPortal();
 }
 
 boolean Encompass::autoConnect()
@@ -254,7 +468,7 @@ boolean Encompass::autoConnect(char const *apName, char const *apPassword)
 /////////////////////////
 // NEW
 
-String Encompass::networkListAsString()
+String Encompass::networkListAsString(int limit)
 {
   String pager ;
   
@@ -268,6 +482,14 @@ String Encompass::networkListAsString()
 
     if (_minimumQuality == -1 || _minimumQuality < quality) 
     {
+      // Sorted by RSSI, the ones left out are the weakest
+      if (limit-- == 0)
+      {
+        _metrics.observeDegraded(DEGRADE_TRUNCATED);
+        pager += FPSTR(HTML_LOW_MEMORY_LIST);
+        break;
+      }
+
       String item = FPSTR(WIFI_LIST_ITEM);
       String rssiQ;
       
@@ -303,14 +525,38 @@ String Encompass::scanModal()
   scan();
   
   String pager = networkListAsString();
-  
+
   return pager;
 }
 
+// Connection details for the info page, closes the <dl> handleInfo() opens
+String Encompass::infoAsString()
+{
+  String page;
+
+  page += F("<dt>Chip ID</dt><dd>");
+  page += String(ESP.getChipId(), HEX);
+  page += F("</dd><dt>Soft AP IP</dt><dd>");
+  page += WiFi.softAPIP().toString();
+  page += F("</dd><dt>Soft AP MAC</dt><dd>");
+  page += WiFi.softAPmacAddress();
+  page += F("</dd><dt>Station SSID</dt><dd>");
+  page += WiFi_SSID();
+  page += F("</dd><dt>Station IP</dt><dd>");
+  page += WiFi.localIP().toString();
+  page += F("</dd><dt>Station MAC</dt><dd>");
+  page += WiFi.macAddress();
+  page += F("</dd></dl>");
+
+  return page;
+}
+
 void Encompass::scan()
 {
   if (!shouldscan) 
     return;
+
+  EncompassOp op(_ops, OP_SCAN);
   
   LOGDEBUG(F("scan: About to scan()"));
   
@@ -321,7 +567,10 @@ void Encompass::scan()
 
   if (wifiSSIDscan)
   {
+    uint32_t scanStart = micros();
+
     wifi_ssid_count_t n = WiFi.scanNetworks();
+    _metrics.observeScan(micros() - scanStart, n);
     LOGDEBUG(F("scan: Scan done"));
     
     if (n == WIFI_SCAN_FAILED) 
@@ -346,56 +595,70 @@ void Encompass::scan()
       if (wifiSSIDscan)
       {
         /* WE SHOULD MOVE THIS IN PLACE ATOMICALLY */
-        if (wifiSSIDs) 
-          delete [] wifiSSIDs;
-          
-        wifiSSIDs     = new WiFiResult[n];
-        wifiSSIDCount = n;
+        storeScanResults(n);
+      }
+    }
+  }
+}
 
-        if (n > 0)
-          shouldscan = false;
+// Copies the radio's scan results into wifiSSIDs, sorted by RSSI with duplicates marked
 
-        for (wifi_ssid_count_t i = 0; i < n; i++)
-        {
-          wifiSSIDs[i].duplicate=false;
-          bool res=WiFi.getNetworkInfo(i, wifiSSIDs[i].SSID, wifiSSIDs[i].encryptionType, wifiSSIDs[i].RSSI, wifiSSIDs[i].BSSID, wifiSSIDs[i].channel, wifiSSIDs[i].isHidden);
-        }
+void Encompass::storeScanResults(wifi_ssid_count_t n)
+{
+  if (wifiSSIDs) 
+    delete [] wifiSSIDs;
+    
+  wifiSSIDs     = new WiFiResult[n];
+  wifiSSIDCount = n;
 
-        // RSSI SORT
-        // old sort
-        for (int i = 0; i < n; i++) 
-        {
-          for (int j = i + 1; j < n; j++) 
-          {
-            if (wifiSSIDs[j].RSSI > wifiSSIDs[i].RSSI) 
-            {
-              std::swap(wifiSSIDs[i], wifiSSIDs[j]);
-            }
-          }
-        }
+  if (n > 0)
+    shouldscan = false;
 
-        // remove duplicates ( must be RSSI sorted )
-        if (_removeDuplicateAPs) 
-        {
-        String cssid;
+  for (wifi_ssid_count_t i = 0; i < n; i++)
+  {
+    uint8_t *bssid = NULL;
+
+    wifiSSIDs[i].duplicate=false;
+    WiFi.getNetworkInfo(i, wifiSSIDs[i].SSID, wifiSSIDs[i].encryptionType, wifiSSIDs[i].RSSI, bssid, wifiSSIDs[i].channel, wifiSSIDs[i].isHidden);
+
+    if (bssid)
+      memcpy(wifiSSIDs[i].BSSID, bssid, 6);
+    else
+      memset(wifiSSIDs[i].BSSID, 0, 6);
+  }
+
+  // RSSI SORT
+  // old sort
+  for (int i = 0; i < n; i++) 
+  {
+    for (int j = i + 1; j < n; j++) 
+    {
+      if (wifiSSIDs[j].RSSI > wifiSSIDs[i].RSSI) 
+      {
+        std::swap(wifiSSIDs[i], wifiSSIDs[j]);
+      }
+    }
+  }
+
+  // remove duplicates ( must be RSSI sorted )
+  if (_removeDuplicateAPs) 
+  {
+    String cssid;
+    
+    for (int i = 0; i < n; i++) 
+    {
+      if (wifiSSIDs[i].duplicate == true) 
+        continue;
         
-        for (int i = 0; i < n; i++) 
+      cssid = wifiSSIDs[i].SSID;
+      
+      for (int j = i + 1; j < n; j++) 
+      {
+        if (cssid == wifiSSIDs[j].SSID) 
         {
-          if (wifiSSIDs[i].duplicate == true) 
-            continue;
-            
-          cssid = wifiSSIDs[i].SSID;
-          
-          for (int j = i + 1; j < n; j++) 
-          {
-            if (cssid == wifiSSIDs[j].SSID) 
-            {
-              LOGDEBUG("scan: DUP AP: " +wifiSSIDs[j].SSID);
-              // set dup aps to NULL
-              wifiSSIDs[j].duplicate = true; 
-            }
-          }
-        }
+          LOGDEBUG("scan: DUP AP: " +wifiSSIDs[j].SSID);
+          // set dup aps to NULL
+          wifiSSIDs[j].duplicate = true; 
         }
       }
     }
@@ -432,12 +695,18 @@ void Encompass::startConfigPortalModeless(char const *apName, char const *apPass
   connect = false;
   setupConfigPortal();
   scannow = -1 ;
+  _scheduler.trigger(TASK_SCAN);
 }
 
+// Runs whatever has fallen due, nextDeadline() says when the next thing will
+
 void Encompass::loop()
 {
-	safeLoop();
-	criticalLoop();
+  _ops.loopEntry();
+
+  EncompassOp op(_ops, OP_LOOP);
+
+  _scheduler.run();
 }
 
 void Encompass::setInfo() 
@@ -451,58 +720,70 @@ void Encompass::setInfo()
 }
 
 // Anything that accesses WiFi, ESP or EEPROM goes here
+// safeLoop() and criticalLoop() are both the scheduler now, kept for sketches that call them instead of loop()
 
 void Encompass::criticalLoop()
 {
-  LOGDEBUG(F("criticalLoop: Enter"));
-  
-  if (_modeless)
-  {
-    if (scannow == -1 || millis() > scannow + TIME_BETWEEN_MODELESS_SCANS)
-    {
-      LOGDEBUG(F("criticalLoop: modeless scan"));
+  _scheduler.run();
+}
+
+// Scan task, every TIME_BETWEEN_MODELESS_SCANS and straight away when the portal starts
+
+void Encompass::modelessScan()
+{
+  if (!_modeless)
+    return;
+
+  LOGDEBUG(F("modelessScan: scan"));
       
-      scan();
-      scannow = millis();
-    }
-    
-    if (connect) 
-    {
-      connect = false;
+  scan();
+  scannow = millis();
+}
 
-      LOGDEBUG(F("criticalLoop: Connecting to new AP"));
+// Connect task, triggered once a credentials job has been applied
 
-      // using user-provided  _ssid, _pass in place of system-stored ssid and pass
-      //////
-      if (connectWifi(_ssid, _pass) != WL_CONNECTED)
-      {
-        LOGDEBUG(F("criticalLoop: Failed to connect."));
-      } 
-      else 
-      {
-        //connected
-        // alanswx - should we have a config to decide if we should shut down AP?
-        // WiFi.mode(WIFI_STA);
-        //notify that configuration has changed and any optional parameters should be saved
-        if ( _savecallback != NULL) 
-        {
-          //todo: check if any custom parameters actually exist, and check if they really changed maybe
-          _savecallback();
-        }
+void Encompass::modelessConnect()
+{
+  if (!_modeless || !connect)
+    return;
 
-        return;
-      }
+  connect = false;
 
-      if (_shouldBreakAfterConfig) 
-      {
-        //flag set to exit after config after trying to connect
-        //notify that configuration has changed and any optional parameters should be saved
-        if ( _savecallback != NULL) 
-        {
-          //todo: check if any custom parameters actually exist, and check if they really changed maybe
-          _savecallback();
-        }
-      }
+  LOGDEBUG(F("modelessConnect: Connecting to new AP"));
+
+  // using user-provided  _ssid, _pass in place of system-stored ssid and pass
+  //////
+  int status = connectWifi(_ssid[0], _pass[0]);
+
+  connectJobDone(status);
+
+  if (status != WL_CONNECTED)
+  {
+    LOGDEBUG(F("modelessConnect: Failed to connect."));
+  } 
+  else 
+  {
+    //connected
+    // alanswx - should we have a config to decide if we should shut down AP?
+    // WiFi.mode(WIFI_STA);
+    //notify that configuration has changed and any optional parameters should be saved
+    if ( _savecallback != NULL) 
+    {
+      //todo: check if any custom parameters actually exist, and check if they really changed maybe
+      _savecallback();
+    }
+
+    return;
+  }
+
+  if (_shouldBreakAfterConfig) 
+  {
+    //flag set to exit after config after trying to connect
+    //notify that configuration has changed and any optional parameters should be saved
+    if ( _savecallback != NULL) 
+    {
+      //todo: check if any custom parameters actually exist, and check if they really changed maybe
+      _savecallback();
     }
   }
 }
@@ -511,9 +792,21 @@ void Encompass::criticalLoop()
 
 void Encompass::safeLoop()
 {
-  #ifndef USE_EADNS	
-  dnsServer->processNextRequest();
-  #endif
+  _scheduler.run();
+}
+
+// Answer pending captive portal DNS queries
+
+void Encompass::processDNS()
+{
+  EncompassOp op(_ops, OP_DNS);
+
+#if USE_ENCOMPASS_DNS
+  _captiveDNS.processPending(ENCOMPASS_DNS_BUDGET_US);
+#elif !defined(USE_EADNS)
+  if (dnsServer)
+    dnsServer->processNextRequest();
+#endif
 }/////////////////
 
 boolean  Encompass::startConfigPortal()
@@ -569,8 +862,8 @@ boolean  Encompass::startConfigPortal(char const *apName, char const *apPassword
 
   while (_configPortalTimeout == 0 || millis() < _configPortalStart + _configPortalTimeout)
   {
-    //DNS
-    dnsServer->processNextRequest();
+    //DNS, jobs, log and the sketch's tasks
+    _scheduler.run();
     //HTTP
     //server->handleClient();
     
@@ -595,6 +888,9 @@ boolean  Encompass::startConfigPortal(char const *apName, char const *apPassword
 #endif
 
       scan();
+
+      // Answer whatever queued up while the radio was busy scanning
+      processDNS();
       
       //if (_tryConnectDuringConfigPortal) 
       //  WiFi.begin(); // try to reconnect to AP
@@ -633,7 +929,11 @@ boolean  Encompass::startConfigPortal(char const *apName, char const *apPassword
 
       // using user-provided  _ssid, _pass in place of system-stored ssid and pass
       //////
-      if (connectWifi(_ssid, _pass) != WL_CONNECTED)
+      int status = connectWifi(_ssid[0], _pass[0]);
+
+      connectJobDone(status);
+
+      if (status != WL_CONNECTED)
       {  
         LOGERROR(F("Failed to connect"));
     
@@ -690,8 +990,7 @@ boolean  Encompass::startConfigPortal(char const *apName, char const *apPassword
     LOGERROR1("Timed out connection result:", getStatus(connRes));
   }
 
-  server->reset();
-  *dnsServer = DNSServer();
+  shutdownConfigPortal();
 
   return  WiFi.status() == WL_CONNECTED;
 }
@@ -767,6 +1066,9 @@ int Encompass::reconnectWifi(void)
 
 int Encompass::connectWifi(String ssid, String pass)
 {
+  EncompassOp op(_ops, OP_CONNECT);
+  uint32_t    connectStart = micros();
+
   // Add option if didn't input/update SSID/PW => Use the previous saved Credentials. \
   // But update the Static/DHCP options if changed.
   if ( (ssid != "") || ( (ssid == "") && (WiFi_SSID() != "") ) )
@@ -792,7 +1094,11 @@ int Encompass::connectWifi(String ssid, String pass)
       // Start Wifi with new values.
       LOGWARN(F("Connect to new WiFi using new IP parameters"));
       
+#if ENCOMPASS_PRECOMPUTE_PSK
+      WiFi.begin(ssid.c_str(), pskFor(ssid, pass));
+#else
       WiFi.begin(ssid.c_str(), pass.c_str());
+#endif
     }
     else
     {
@@ -810,6 +1116,10 @@ int Encompass::connectWifi(String ssid, String pass)
   int connRes = waitForConnectResult();
   LOGWARN1("Connection result: ", getStatus(connRes));
 
+  _metrics.observeConnect(connRes, micros() - connectStart);
+
+  _stateDirty = true;
+
   //not connected, WPS enabled, no pass - first attempt
   if (_tryWPS && connRes != WL_CONNECTED && pass == "")
   {
@@ -821,6 +1131,112 @@ int Encompass::connectWifi(String ssid, String pass)
   return connRes;
 }
 
+#if ENCOMPASS_PRECOMPUTE_PSK
+// From slot from on: true while one is being derived - processPSK() carries on with it and posts the connect once
+// every slot has its PSK - false when there is nothing left to derive
+bool Encompass::derivePSKs(uint8_t from)
+{
+  // Newer credentials, what was under way is for the old ones
+  delete _pskRun;
+  _pskRun = NULL;
+
+  for (uint8_t i = from; i < MAX_WIFI_CREDENTIALS; i++)
+  {
+    if (beginPSK(i))
+    {
+      _pskSlot = i;
+      _scheduler.trigger(TASK_PSK);
+
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// True when slot i needs the iterations run, the once - unchanged credentials and the second slot (a copy of the
+// first) reuse what is there
+bool Encompass::beginPSK(uint8_t i)
+{
+  SavedPSK &psk = _psk[i];
+
+  if (psk.hex[0] && psk.ssid == _ssid[i] && psk.pass == _pass[i])
+    return false;
+
+  psk.ssid    = _ssid[i];
+  psk.pass    = _pass[i];
+  psk.hex[0]  = 0;
+
+  // Open networks and PSKs given as 64 hex digits go to the SDK as they are
+  if (psk.ssid == "" || psk.pass.length() < 8 || psk.pass.length() > 63)
+    return false;
+
+  for (uint8_t j = 0; j < MAX_WIFI_CREDENTIALS; j++)
+  {
+    if (j != i && _psk[j].hex[0] && _psk[j].ssid == psk.ssid && _psk[j].pass == psk.pass)
+    {
+      memcpy(psk.hex, _psk[j].hex, sizeof(psk.hex));
+      return false;
+    }
+  }
+
+  _pskRun = new (std::nothrow) EncompassPBKDF2;
+
+  // The SDK derives it in WiFi.begin() instead
+  if (_pskRun == NULL)
+    return false;
+
+  _pskRun->begin(psk.pass.c_str(), psk.pass.length(), psk.ssid.c_str(), psk.ssid.length(), WPA_PSK_ITERATIONS,
+                 WPA_PSK_SIZE);
+  _pskStartedAt = millis();
+
+  return true;
+}
+
+// The "psk" task - ENCOMPASS_PSK_SLICE iterations, then back to loop() until the next run
+void Encompass::processPSK()
+{
+  if (_pskRun == NULL)
+    return;
+
+  if (!_pskRun->run(ENCOMPASS_PSK_SLICE))
+  {
+    _scheduler.trigger(TASK_PSK);
+    return;
+  }
+
+  SavedPSK  &psk = _psk[_pskSlot];
+  uint8_t   key[WPA_PSK_SIZE];
+
+  _pskRun->key(key);
+
+  for (uint8_t b = 0; b < WPA_PSK_SIZE; b++)
+    snprintf(&psk.hex[2 * b], 3, "%02x", key[b]);
+
+  memset(key, 0, sizeof(key));
+
+  LOGWARN1(F("PSK derived, ms ="), millis() - _pskStartedAt);
+
+  if (derivePSKs(_pskSlot + 1))
+    return;
+
+  connect = true;
+  _scheduler.trigger(TASK_CONNECT);
+}
+
+// What WiFi.begin() gets for these credentials - the saved PSK when there is one
+const char* Encompass::pskFor(const String &ssid, const String &pass)
+{
+  for (uint8_t i = 0; i < MAX_WIFI_CREDENTIALS; i++)
+  {
+    if (_psk[i].hex[0] && _psk[i].ssid == ssid && _psk[i].pass == pass)
+      return _psk[i].hex;
+  }
+
+  return pass.c_str();
+}
+#endif
+
 wl_status_t Encompass::waitForConnectResult()
 {
   if (_connectTimeout == 0)
@@ -862,6 +1278,9 @@ wl_status_t Encompass::waitForConnectResult()
       {
         keepConnecting = false;
       }
+
+      // Keep captive portal clients resolving while we wait
+      processDNS();
       delay(100);
     }
     
@@ -911,6 +1330,7 @@ void Encompass::resetSettings()
 {
   LOGINFO(F("Previous settings invalidated"));
   WiFi.disconnect(true);
+  _stateDirty = true;
   delay(200);
   return;
 }
@@ -938,10 +1358,13 @@ void Encompass::setDebugOutput(boolean debug)
 // KH, To enable dynamic/random channel
 int Encompass::setConfigPortalChannel(int channel)
 {
+  // If channel == AUTO_WIFI_CHANNEL => will use the least congested channel, see pickAPChannel()
   // If channel < MIN_WIFI_CHANNEL - 1 or channel > MAX_WIFI_CHANNEL => channel = 1
   // If channel == 0 => will use random channel from MIN_WIFI_CHANNEL to MAX_WIFI_CHANNEL
   // If (MIN_WIFI_CHANNEL <= channel <= MAX_WIFI_CHANNEL) => use it
-  if ( (channel < MIN_WIFI_CHANNEL - 1) || (channel > MAX_WIFI_CHANNEL) )
+  if (channel == AUTO_WIFI_CHANNEL)
+    _WiFiAPChannel = AUTO_WIFI_CHANNEL;
+  else if ( (channel < MIN_WIFI_CHANNEL - 1) || (channel > MAX_WIFI_CHANNEL) )
     _WiFiAPChannel = 1;
   else if ( (channel >= MIN_WIFI_CHANNEL - 1) && (channel <= MAX_WIFI_CHANNEL) )
     _WiFiAPChannel = channel;
@@ -949,6 +1372,68 @@ int Encompass::setConfigPortalChannel(int channel)
   return _WiFiAPChannel;
 }
 
+// Scores every channel from the scan results, quietest wins. Each AP costs a fixed share for the airtime its beacons and
+// clients take plus its strength above the noise floor, in full on its own channel and less the further away it is -
+// 20 MHz channels 5 MHz apart overlap up to 4 channels away. 1, 6 and 11 win ties, they overlap nothing of each other.
+// With no scan yet the portal's first one is done here, storeScanResults() keeps it for the network list.
+uint8_t Encompass::pickAPChannel(int32_t &score)
+{
+  static const uint8_t overlap[5]   = { 8, 6, 4, 2, 1 };
+  static const uint8_t preferred[3] = { 1, 6, 11 };
+
+  if (wifiSSIDs == NULL || wifiSSIDCount <= 0)
+  {
+    WiFiMode_t  mode      = WiFi.getMode();
+    uint32_t    scanStart = micros();
+
+    wifi_ssid_count_t n = WiFi.scanNetworks();
+    _metrics.observeScan(micros() - scanStart, n);
+
+    if (n > 0)
+      storeScanResults(n);
+
+    // scanNetworks() turns the station on, leave the mode as startConfigPortal() chose it
+    if (!(mode & WIFI_STA))
+      WiFi.enableSTA(false);
+  }
+
+  int32_t scores[MAX_WIFI_CHANNEL + 1] = { 0 };
+
+  for (int i = 0; wifiSSIDs && i < wifiSSIDCount; i++)
+  {
+    int32_t weight = 16 + constrain(wifiSSIDs[i].RSSI + 95, 0, 60);
+
+    for (uint8_t c = MIN_WIFI_CHANNEL; c <= MAX_WIFI_CHANNEL; c++)
+    {
+      int32_t distance = abs((int32_t) c - wifiSSIDs[i].channel);
+
+      if (distance < 5)
+        scores[c] += weight * overlap[distance];
+    }
+  }
+
+  // Preferred ones first, any other has to be strictly quieter
+  uint8_t best = preferred[0];
+
+  for (uint8_t p = 1; p < sizeof(preferred); p++)
+  {
+    if (scores[preferred[p]] < scores[best])
+      best = preferred[p];
+  }
+
+  for (uint8_t c = MIN_WIFI_CHANNEL; c <= MAX_WIFI_CHANNEL; c++)
+  {
+    if (scores[c] < scores[best])
+      best = c;
+  }
+
+  score = scores[best] / 8;
+
+  LOGWARN2(F("AP Channel picked ="), best, score);
+
+  return best;
+}
+
 void Encompass::setAPStaticIPConfig(IPAddress ip, IPAddress gw, IPAddress sn)
 {
   LOGINFO(F("setAPStaticIPConfig"));
@@ -990,6 +1475,7 @@ void Encompass::setBreakAfterConfig(boolean shouldBreak)
 void Encompass::reportStatus(String &page)
 {
   page += FPSTR(HTML_SCRIPT_NTP_MSG);
+  page += F("<span id=\"ws\">");
 
   if (WiFi_SSID() != "")
   {
@@ -1013,6 +1499,59 @@ void Encompass::reportStatus(String &page)
   {
     page += F("No network configured.");
   }
+
+  page += F("</span>");
+}
+
+void Encompass::setNoCacheHeaders(AsyncWebServerResponse *response)
+{
+  response->addHeader(FPSTR(HTTP_CACHE_CONTROL), FPSTR(HTTP_NO_STORE));
+
+#if USING_CORS_FEATURE
+  response->addHeader(FPSTR(HTTP_CORS), _CORS_Header);
+#endif
+
+  response->addHeader(FPSTR(HTTP_PRAGMA), FPSTR(HTTP_NO_CACHE));
+  response->addHeader(FPSTR(HTTP_EXPIRES), "-1");
+}
+
+boolean Encompass::wantsCBOR(AsyncWebServerRequest *request)
+{
+  if (request->hasParam("format"))
+    return request->getParam("format")->value() == "cbor";
+
+  AsyncWebHeader *accept = request->getHeader(FPSTR(HTTP_ACCEPT));
+
+  return accept && (accept->value().indexOf(String(FPSTR(HTTP_HEAD_CBOR))) >= 0);
+}
+
+void Encompass::refreshStateSnapshot()
+{
+  if (!_state.valid)
+  {
+    // MAC addresses never change, read them once
+    WiFi.softAPmacAddress(_state.softAPMAC);
+    WiFi.macAddress(_state.stationMAC);
+    _state.valid = true;
+  }
+
+  if (_stateDirty)
+  {
+    // Read the stored config directly, WiFi.SSID()/WiFi.psk() build a String each call
+    struct station_config conf;
+
+    wifi_station_get_config(&conf);
+
+    size_t len = strnlen((const char *) conf.ssid, sizeof(conf.ssid));
+
+    memcpy(_state.ssid, conf.ssid, len);
+    _state.ssid[len]    = 0;
+    _state.hasPassword  = (conf.password[0] != 0);
+    _stateDirty         = false;
+  }
+
+  _state.softAPIP  = WiFi.softAPIP();
+  _state.stationIP = WiFi.localIP();
 }
 
 // Handle root or redirect to captive portal
@@ -1063,7 +1602,7 @@ void Encompass::handleRoot(AsyncWebServerRequest *request)
   reportStatus(page);
   page += F("</div>");
   
-  page += FPSTR(FLDSET_CLOSE);
+  page += FPSTR(FLDSET_END);
     
   page += FPSTR(HTML_CLOSE);
  
@@ -1088,6 +1627,15 @@ void Encompass::handleWifi(AsyncWebServerRequest *request)
 
   // Disable _configPortalTimeout when someone accessing Portal to give some time to config
   _configPortalTimeout = 0;
+
+  uint8_t pressure = getMemoryPressure();
+
+  if (pressure == PRESSURE_CRITICAL)
+  {
+    _metrics.observeDegraded(DEGRADE_REFUSED);
+    sendRetryLater(request);
+    return;
+  }
    
   String page = FPSTR(HTML_HEAD_START);
   page.replace("{v}", "Config ESP");
@@ -1106,16 +1654,22 @@ void Encompass::handleWifi(AsyncWebServerRequest *request)
     LOGDEBUG(F("handleWifi: No networks found"));
     page += F("No networks found. Refresh to scan again.");
   } 
+  else if (pressure == PRESSURE_HIGH)
+  {
+    // The list is the biggest part of the page, the SSID can still be typed in
+    _metrics.observeDegraded(DEGRADE_MINIMAL);
+    page += FPSTR(HTML_LOW_MEMORY_PAGE);
+  }
   else 
   {
     page += FPSTR(FLDSET_START);
     
     //display networks in page
-    String pager = networkListAsString();
+    String pager = networkListAsString(pressure == PRESSURE_LOW ? ENCOMPASS_LOW_MEMORY_NETWORKS : -1);
     
     page += pager;
     
-    page += FPSTR(FLDSET_CLOSE);
+    page += FPSTR(FLDSET_END);
    
     page += "<br/>";
   }
@@ -1124,11 +1678,36 @@ void Encompass::handleWifi(AsyncWebServerRequest *request)
   
   page += "<small>To reuse already connected AP, leave SSID & password fields empty</small>";
   
-  page += FPSTR(HTML_FORM_START);
-  char parLength[2];
+  String form = FPSTR(HTML_FORM_START);
+  form.replace("{m}", "post");
+  form.replace("{a}", FPSTR(ROUTE_SAVE_PATH));
+
+  page += form;
+  char parLength[6];
   
   page += FPSTR(FLDSET_START);
 
+  // Credentials - "s" / "p", filled in by the network list's c()
+  String item = FPSTR(HTML_FORM_LABEL_BEFORE);
+  item.replace("{i}", "s");
+  item.replace("{n}", "s");
+  item.replace("{p}", "SSID");
+  item.replace("{l}", "32");
+  item.replace("{v}", "");
+  item.replace("{c}", "");
+
+  page += item;
+
+  item = FPSTR(HTML_FORM_LABEL_BEFORE);
+  item.replace("{i}", "p");
+  item.replace("{n}", "p");
+  item.replace("{p}", "Password");
+  item.replace("{l}", "64");
+  item.replace("{v}", "");
+  item.replace("{c}", " type=\"password\"");
+
+  page += item;
+
   //
   //
   // This needs a lot of editing
@@ -1163,7 +1742,7 @@ void Encompass::handleWifi(AsyncWebServerRequest *request)
       dField.replace("{i}", _DataFields[i]->getID());
       dField.replace("{n}", _DataFields[i]->getName());
       dField.replace("{p}", _DataFields[i]->getPlaceholder());
-      snprintf(parLength, 2, "%d", _DataFields[i]->getValueLength());
+      snprintf(parLength, sizeof(parLength), "%d", _DataFields[i]->getValueLength());
       dField.replace("{l}", parLength);
       dField.replace("{v}", _DataFields[i]->getValue());
       dField.replace("{c}", _DataFields[i]->getCustomHTML());
@@ -1181,12 +1760,9 @@ void Encompass::handleWifi(AsyncWebServerRequest *request)
   //
   //
 
-  if (_DataFieldsCount > 0)
-  {
-    page += FPSTR(FLDSET_CLOSE);
-  }
+  page += FPSTR(FLDSET_END);
 
-  if (_DataFields[0] != NULL)
+  if (_DataFieldsCount > 0)
   {
     page += "<br/>";
   }
@@ -1206,66 +1782,70 @@ void Encompass::handleWifi(AsyncWebServerRequest *request)
   {
     page += FPSTR(FLDSET_START);
     
-    String item = FPSTR(HTML_FORM_LABEL);
-    item += FPSTR(HTML_FORM_FIELD);
+    item = FPSTR(HTML_FORM_LABEL_BEFORE);
     item.replace("{i}", "ip");
     item.replace("{n}", "ip");
     item.replace("{p}", "Static IP");
     item.replace("{l}", "15");
     item.replace("{v}", _sta_static_ip.toString());
+    item.replace("{c}", "");
 
     page += item;
 
-    item = FPSTR(HTML_FORM_LABEL);
-    item += FPSTR(HTML_FORM_FIELD);
+    item = FPSTR(HTML_FORM_LABEL_BEFORE);
     item.replace("{i}", "gw");
     item.replace("{n}", "gw");
     item.replace("{p}", "Gateway IP");
     item.replace("{l}", "15");
     item.replace("{v}", _sta_static_gw.toString());
+    item.replace("{c}", "");
 
     page += item;
 
-    item = FPSTR(HTML_FORM_LABEL);
-    item += FPSTR(HTML_FORM_FIELD);
+    item = FPSTR(HTML_FORM_LABEL_BEFORE);
     item.replace("{i}", "sn");
     item.replace("{n}", "sn");
     item.replace("{p}", "Subnet");
     item.replace("{l}", "15");
     item.replace("{v}", _sta_static_sn.toString());
+    item.replace("{c}", "");
 
   #if USE_CONFIGURABLE_DNS
     //* Added for DNS address options *
     page += item;
 
-    item = FPSTR(HTML_FORM_LABEL);
-    item += FPSTR(HTML_FORM_FIELD);
+    item = FPSTR(HTML_FORM_LABEL_BEFORE);
     item.replace("{i}", "dns1");
     item.replace("{n}", "dns1");
     item.replace("{p}", "DNS1 IP");
     item.replace("{l}", "15");
     item.replace("{v}", _sta_static_dns1.toString());
+    item.replace("{c}", "");
 
     page += item;
 
-    item = FPSTR(HTML_FORM_LABEL);
-    item += FPSTR(HTML_FORM_FIELD);
+    item = FPSTR(HTML_FORM_LABEL_BEFORE);
     item.replace("{i}", "dns2");
     item.replace("{n}", "dns2");
     item.replace("{p}", "DNS2 IP");
     item.replace("{l}", "15");
     item.replace("{v}", _sta_static_dns2.toString());
+    item.replace("{c}", "");
     //* End added for DNS address options *
   #endif
 
     page += item;
     
-    page += FPSTR(FLDSET_CLOSE);
+    page += FPSTR(FLDSET_END);
 
     page += "<br/>";
   }
 
-  page += FPSTR(HTML_FORM_CLOSE);
+  String button = FPSTR(HTML_BUTTON);
+  button.replace("{t}", "submit");
+
+  page += button;
+  page += FPSTR(HTML_FORM_END);
 
   page += FPSTR(HTML_CLOSE);
 
@@ -1290,17 +1870,20 @@ void Encompass::handleSave(AsyncWebServerRequest *request)
 {
   LOGDEBUG(F("Save"));
 
+  // Copied into a job for loop(), which applies it before it connects - nothing the loop reads is touched from here
+  EncompassJob *job = reserveJob(JOB_CREDENTIALS, request);
+
+  if (job == NULL)
+    return;
+
   //SAVE access points here
   //
   //
   //
   //////
   
-  for (int i = 0; i < 2; i++)
-  {
-    _ssid[i] = request->arg("s").c_str();
-    _pass[i] = request->arg("p").c_str();
-  }
+  strncpy(job->ssid, request->arg("s").c_str(), JOB_SSID_LEN);
+  strncpy(job->pass, request->arg("p").c_str(), JOB_PASS_LEN);
   //
   //
   //
@@ -1311,6 +1894,25 @@ void Encompass::handleSave(AsyncWebServerRequest *request)
   //
   // DataFields
   //////
+  size_t fieldsLen = 0;
+
+  for (int i = 0; i < _DataFieldsCount && _DataFields[i] != NULL; i++)
+    fieldsLen += _DataFields[i]->_length;
+
+  if (fieldsLen)
+  {
+    job->fields = (char *) malloc(fieldsLen);
+
+    // Not posted, the slot is reused
+    if (job->fields == NULL)
+    {
+      sendRetryLater(request);
+      return;
+    }
+  }
+
+  char *field = job->fields;
+
   for (int i = 0; i < _DataFieldsCount; i++)
   {
     if (_DataFields[i] == NULL)
@@ -1318,58 +1920,42 @@ void Encompass::handleSave(AsyncWebServerRequest *request)
       break;
     }
 
+    if (_DataFields[i]->_id == NULL || _DataFields[i]->_length <= 0)
+      continue;
+
     //read parameter
     String value = request->arg(_DataFields[i]->getID()).c_str();
     
-    //store it in array
-    value.toCharArray(_DataFields[i]->_value, _DataFields[i]->_length);
+    //store it in the job
+    value.toCharArray(field, _DataFields[i]->_length);
+    field += _DataFields[i]->_length;
     
     LOGDEBUG2(F("Parameter and value :"), _DataFields[i]->getID(), value);
   }
 
-  if (request->hasArg("ip"))
-  {
-    String ip = request->arg("ip");
-    optionalIPFromString(&_sta_static_ip, ip.c_str());
-    
-    LOGDEBUG1(F("New Static IP ="), _sta_static_ip.toString());
-  }
-
-  if (request->hasArg("gw"))
-  {
-    String gw = request->arg("gw");
-    optionalIPFromString(&_sta_static_gw, gw.c_str());
-    
-    LOGDEBUG1(F("New Static Gateway ="), _sta_static_gw.toString());
-  }
-
-  if (request->hasArg("sn"))
-  {
-    String sn = request->arg("sn");
-    optionalIPFromString(&_sta_static_sn, sn.c_str());
-    
-    LOGDEBUG1(F("New Static Netmask ="), _sta_static_sn.toString());
-  }
+  const char * const ipArgs[JOB_IPS] = { "ip", "gw", "sn", "dns1", "dns2" };
 
 #if USE_CONFIGURABLE_DNS
   //*  Added for DNS Options *
-  if (request->hasArg("dns1"))
-  {
-    String dns1 = request->arg("dns1");
-    optionalIPFromString(&_sta_static_dns1, dns1.c_str());
-    
-    LOGDEBUG1(F("New Static DNS1 ="), _sta_static_dns1.toString());
-  }
+  const uint8_t ipCount = JOB_IPS;
+#else
+  const uint8_t ipCount = JOB_DNS1;
+#endif
 
-  if (request->hasArg("dns2"))
+  for (uint8_t i = 0; i < ipCount; i++)
   {
-    String dns2 = request->arg("dns2");
-    optionalIPFromString(&_sta_static_dns2, dns2.c_str());
+    IPAddress ip;
+
+    if (request->hasArg(ipArgs[i]) && optionalIPFromString(&ip, request->arg(ipArgs[i]).c_str()))
+    {
+      job->ips[i]   = ip;
+      job->ipMask  |= 1 << i;
     
-    LOGDEBUG1(F("New Static DNS2 ="), _sta_static_dns2.toString());
+      LOGDEBUG2(F("New Static"), ipArgs[i], ip.toString());
+    }
   }
-  //*  End added for DNS Options *
-#endif
+
+  uint16_t id = _jobs.commit();
 
   String page = FPSTR(HTML_HEAD_START);
   page.replace("{v}", "Credentials Saved");
@@ -1381,15 +1967,14 @@ void Encompass::handleSave(AsyncWebServerRequest *request)
   page += FPSTR(HTML_SAVED);
   page.replace("{v}", _apName);
 
-  for (int i = 0; i < _APCount; i++)
-  {
-    page.replace("{x"+i+"}", _ssid[i]);
-  }
+  page.replace("{d}", _apName);
+  page.replace("{n}", job->ssid);
   
   page += FPSTR(HTML_CLOSE);
  
   AsyncWebServerResponse *response = request->beginResponse(200, "text/html", page);
   response->addHeader(FPSTR(HTTP_CACHE_CONTROL), FPSTR(HTTP_NO_STORE));
+  response->addHeader(FPSTR(HTTP_JOB), String(id));
   
 #if USING_CORS_FEATURE
   // New from v1.1.0, for configure CORS Header, default to E_HTTP_CORS_ALLOW_ALL = "*"
@@ -1401,17 +1986,17 @@ void Encompass::handleSave(AsyncWebServerRequest *request)
   request->send(response);
 
   LOGDEBUG(F("Sent wifi save page"));
-
-  connect = true; //signal ready to connect/reset
-
-  // Restore when Press Save WiFi
-  _configPortalTimeout = DEFAULT_PORTAL_TIMEOUT;
 }
 
 // Handle shut down the server page
 void Encompass::handleServerClose(AsyncWebServerRequest *request)
 {
   LOGDEBUG(F("Server Close"));
+
+  if (reserveJob(JOB_CLOSE_PORTAL, request) == NULL)
+    return;
+
+  uint16_t id = _jobs.commit();
    
   String page = FPSTR(HTML_HEAD_START);
   page.replace("{v}", "Close Server");
@@ -1444,14 +2029,11 @@ void Encompass::handleServerClose(AsyncWebServerRequest *request)
   response->addHeader(FPSTR(HTTP_PRAGMA), FPSTR(HTTP_NO_CACHE));
   response->addHeader(FPSTR(HTTP_EXPIRES), "-1");
   
-  request->send(response);
+  response->addHeader(FPSTR(HTTP_JOB), String(id));
   
-  stopConfigPortal = true; //signal ready to shutdown config portal
+  request->send(response);
   
   LOGDEBUG(F("Sent server close page"));
-
-  // Restore when Press Save WiFi
-  _configPortalTimeout = DEFAULT_PORTAL_TIMEOUT;
 }
 
 // Handle the info page
@@ -1461,6 +2043,15 @@ void Encompass::handleInfo(AsyncWebServerRequest *request)
 
   // Disable _configPortalTimeout when someone accessing Portal to give some time to config
   _configPortalTimeout = 0;
+
+  uint8_t pressure = getMemoryPressure();
+
+  if (pressure == PRESSURE_CRITICAL)
+  {
+    _metrics.observeDegraded(DEGRADE_REFUSED);
+    sendRetryLater(request);
+    return;
+  }
  
   String page = FPSTR(HTML_HEAD_START);
   page.replace("{v}", "Info");
@@ -1469,16 +2060,20 @@ void Encompass::handleInfo(AsyncWebServerRequest *request)
   page += FPSTR(HTML_STYLE);
   page += _customHeadElement;
   
+#if ENCOMPASS_EVENTS
+  page += FPSTR(HTML_SCRIPT_EVENTS);
+#else
   if (connect)
     page += F("<meta http-equiv=\"refresh\" content=\"5; url=/i\">");
+#endif
   
   page += FPSTR(HTML_HEAD_CLOSE);
   
   page += F("<dl>");
   
-  if (connect)
+  if (connect || _connectJob)
   {
-    page += F("<dt>Trying to connect</dt><dd>");
+    page += F("<dt>Trying to connect</dt><dd id=\"wc\">");
     page += wifiStatus;
     page += F("</dd>");
   }
@@ -1488,57 +2083,91 @@ void Encompass::handleInfo(AsyncWebServerRequest *request)
   page += F("<h2>WiFi Information</h2>");
   reportStatus(page);
   
-  page += FPSTR(FLDSET_START);
-  
-  page += F("<h3>Device Data</h3>");
-  
-  page += F("<table class=\"table\">");
-  page += F("<thead><tr><th>Name</th><th>Value</th></tr></thead><tbody><tr><td>Chip ID</td><td>");
+  if (pressure == PRESSURE_HIGH)
+  {
+    _metrics.observeDegraded(DEGRADE_MINIMAL);
+    page += FPSTR(HTML_LOW_MEMORY_PAGE);
+  }
+  else
+  {
+    page += FPSTR(FLDSET_START);
+
+    page += F("<h3>Device Data</h3>");
+
+    page += F("<table class=\"table\">");
+    page += F("<thead><tr><th>Name</th><th>Value</th></tr></thead><tbody><tr><td>Chip ID</td><td>");
+
+    page += String(ESP.getChipId(), HEX);		//ESP.getChipId();
 
-  page += String(ESP.getChipId(), HEX);		//ESP.getChipId();
+    page += F("</td></tr>");
+    page += F("<tr><td>Flash Chip ID</td><td>");
 
-  page += F("</td></tr>");
-  page += F("<tr><td>Flash Chip ID</td><td>");
+    page += String(ESP.getFlashChipId(), HEX);		//ESP.getFlashChipId();
 
-  page += String(ESP.getFlashChipId(), HEX);		//ESP.getFlashChipId();
+    page += F("</td></tr>");
+    page += F("<tr><td>IDE Flash Size</td><td>");
+    page += ESP.getFlashChipSize();
+    page += F(" bytes</td></tr>");
+    page += F("<tr><td>Real Flash Size</td><td>");
 
-  page += F("</td></tr>");
-  page += F("<tr><td>IDE Flash Size</td><td>");
-  page += ESP.getFlashChipSize();
-  page += F(" bytes</td></tr>");
-  page += F("<tr><td>Real Flash Size</td><td>");
+    page += ESP.getFlashChipRealSize();
 
-  page += ESP.getFlashChipRealSize();
+    page += F(" bytes</td></tr>");
+    page += F("<tr><td>Access Point IP</td><td>");
+    page += WiFi.softAPIP().toString();
+    page += F("</td></tr>");
+    page += F("<tr><td>Access Point MAC</td><td>");
+    page += WiFi.softAPmacAddress();
+    page += F("</td></tr>");
+    page += F("<tr><td>Access Point Channel</td><td>");
+    page += _apChannel;
 
-  page += F(" bytes</td></tr>");
-  page += F("<tr><td>Access Point IP</td><td>");
-  page += WiFi.softAPIP().toString();
-  page += F("</td></tr>");
-  page += F("<tr><td>Access Point MAC</td><td>");
-  page += WiFi.softAPmacAddress();
-  page += F("</td></tr>");
+    if (_apChannelScore >= 0)
+    {
+      page += F(" (auto, score ");
+      page += _apChannelScore;
+      page += ')';
+    }
 
-  page += F("<tr><td>SSID</td><td>");
-  page += WiFi_SSID();
-  page += F("</td></tr>");
+    page += F("</td></tr>");
 
-  page += F("<tr><td>Station IP</td><td>");
-  page += WiFi.localIP().toString();
-  page += F("</td></tr>");
+#if ENCOMPASS_TIME
+    if (_clock.valid())
+    {
+      char time[25];
 
-  page += F("<tr><td>Station MAC</td><td>");
-  page += WiFi.macAddress();
-  page += F("</td></tr>");
-  page += F("</tbody></table>");
+      formatTime(getTimeUs(), time);
 
-  page += FPSTR(FLDSET_CLOSE);
+      page += F("<tr><td>Time</td><td>");
+      page += time;
+      page += F(" (");
+      page += FPSTR((PGM_P) pgm_read_ptr(&TIME_SOURCE_NAMES[_timeSource]));
+      page += F(")</td></tr>");
+    }
+#endif
+
+    page += F("<tr><td>SSID</td><td>");
+    page += WiFi_SSID();
+    page += F("</td></tr>");
+
+    page += F("<tr><td>Station IP</td><td id=\"wi\">");
+    page += WiFi.localIP().toString();
+    page += F("</td></tr>");
+
+    page += F("<tr><td>Station MAC</td><td>");
+    page += WiFi.macAddress();
+    page += F("</td></tr>");
+    page += F("</tbody></table>");
+
+    page += FPSTR(FLDSET_END);
+  }
   
 #if USE_AVAILABLE_PAGES  
   page += FPSTR(FLDSET_START);
   
   page += FPSTR(HTTP_AVAILABLE_PAGES);
   
-  page += FPSTR(FLDSET_CLOSE);
+  page += FPSTR(FLDSET_END);
 #endif
 
 #ifdef SHOW_DEV_FOOTER
@@ -1564,53 +2193,421 @@ void Encompass::handleInfo(AsyncWebServerRequest *request)
 }
 
 // Handle the state page
+// JSON by default, CBOR when the client sends "Accept: application/cbor" (or ?format=cbor).
+// CBOR uses the same keys as the JSON document, IPs and MACs are sent as 4 and 6 byte byte strings, an SSID that is not
+// UTF-8 as a byte string too.
 void Encompass::handleState(AsyncWebServerRequest *request)
 {
-  LOGDEBUG(F("State - json"));
-   
-  String page = F("{\"Soft_AP_IP\":\"");
-  page += WiFi.softAPIP().toString();
-  page += F("\",\"Soft_AP_MAC\":\"");
-  page += WiFi.softAPmacAddress();
-  page += F("\",\"Station_IP\":\"");
-  page += WiFi.localIP().toString();
-  page += F("\",\"Station_MAC\":\"");
-  page += WiFi.macAddress();
-  page += F("\",");
+  LOGDEBUG(F("State"));
+
+  refreshStateSnapshot();
+
+  boolean cbor = wantsCBOR(request);
+
+  AsyncResponseStream *response = request->beginResponseStream(cbor ? FPSTR(HTTP_HEAD_CBOR) : FPSTR(HTTP_HEAD_JSON));
+  setNoCacheHeaders(response);
 
-  if (WiFi.psk() != "")
+  if (cbor)
   {
-    page += F("\"Password\":true,");
+    CBORWriter cw(*response);
+
+    // IPAddress keeps the octets in network order in memory
+    cw.beginMap(6);
+    cw.writeText(F("Soft_AP_IP"));
+    cw.writeBytes((const uint8_t *) &_state.softAPIP, 4);
+    cw.writeText(F("Soft_AP_MAC"));
+    cw.writeBytes(_state.softAPMAC, 6);
+    cw.writeText(F("Station_IP"));
+    cw.writeBytes((const uint8_t *) &_state.stationIP, 4);
+    cw.writeText(F("Station_MAC"));
+    cw.writeBytes(_state.stationMAC, 6);
+    cw.writeText(F("Password"));
+    cw.writeBool(_state.hasPassword);
+    cw.writeText(F("SSID"));
+    cw.writeTextOrBytes(_state.ssid, strlen(_state.ssid));
   }
   else
   {
-    page += F("\"Password\":false,");
+    response->print(F("{\"Soft_AP_IP\":\""));
+    printIp(*response, _state.softAPIP);
+    response->print(F("\",\"Soft_AP_MAC\":\""));
+    printMAC(*response, _state.softAPMAC);
+    response->print(F("\",\"Station_IP\":\""));
+    printIp(*response, _state.stationIP);
+    response->print(F("\",\"Station_MAC\":\""));
+    printMAC(*response, _state.stationMAC);
+    response->print(_state.hasPassword ? F("\",\"Password\":true,") : F("\",\"Password\":false,"));
+    response->print(F("\"SSID\":"));
+    printJSONString(*response, _state.ssid);
+    response->print(F("}"));
   }
 
-  page += F("\"SSID\":\"");
-  page += WiFi_SSID();
-  page += F("\"}");
-   
-  AsyncWebServerResponse *response = request->beginResponse(200, "application/json", page);
-  response->addHeader(FPSTR(HTTP_CACHE_CONTROL), FPSTR(HTTP_NO_STORE));
-  
-#if USING_CORS_FEATURE
-  // New from v1.1.0, for configure CORS Header, default to E_HTTP_CORS_ALLOW_ALL = "*"
-  response->addHeader(FPSTR(HTTP_CORS), _CORS_Header);
+  request->send(response);
+
+  LOGDEBUG1(F("Sent state page, CBOR ="), cbor);
+}
+
+#if ENCOMPASS_ASYNC_LOG
+// Handle the log page
+// Dumps the log ring buffer, oldest entry first, as "<ms> <level> <message>" lines.
+void Encompass::handleLog(AsyncWebServerRequest *request)
+{
+  AsyncResponseStream *response = request->beginResponseStream(FPSTR(HTTP_HEAD_CT2));
+  setNoCacheHeaders(response);
+
+#if ENCOMPASS_TIME
+  // Entries carry uptime ms, this line maps them to UTC
+  if (_clock.valid())
+  {
+    char time[25];
+
+    formatTime(getTimeUs(), time);
+
+    response->print(F("# "));
+    response->print(millis());
+    response->print(F(" ms = "));
+    response->println(time);
+  }
 #endif
-  
-  response->addHeader(FPSTR(HTTP_PRAGMA), FPSTR(HTTP_NO_CACHE));
-  response->addHeader(FPSTR(HTTP_EXPIRES), "-1");
-  
+
+  EncompassLog::printTo(*response);
+
   request->send(response);
-  
-  LOGDEBUG(F("Sent state page in json format"));
+}
+#endif
+
+#if ENCOMPASS_PROFILE
+// Handle the profile page
+// Stack and heap high-water marks per operation and route, the same table printProfile() writes to serial.
+void Encompass::handleProfile(AsyncWebServerRequest *request)
+{
+  AsyncResponseStream *response = request->beginResponseStream(FPSTR(HTTP_HEAD_CT2));
+  setNoCacheHeaders(response);
+
+  _metrics.printProfile(*response);
+
+  request->send(response);
+}
+#endif
+
+// Handle the metrics page
+// Prometheus text format, answers on both interfaces so a scraper can reach it through the station IP.
+// Rendered in chunks from a copy of the registry, so every chunk sees the same numbers and nothing is buffered whole.
+// The copy is a KB or more, so scrapes go through admission control like the heavy pages.
+void Encompass::handleMetrics(AsyncWebServerRequest *request)
+{
+  EncompassMetrics *scrape = new (std::nothrow) EncompassMetrics(_metrics);
+
+  if (scrape == NULL)
+  {
+    request->send(503);
+    return;
+  }
+
+  scrape->uptimeMs          = millis();
+  scrape->freeHeap          = ESP.getFreeHeap();
+  scrape->maxFreeBlock      = ESP.getMaxFreeBlockSize();
+  scrape->heapFragmentation = ESP.getHeapFragmentation();
+  scrape->memoryPressure    = memoryPressure(scrape->freeHeap, scrape->maxFreeBlock);
+  scrape->heavyInFlight     = _heavyInFlight;
+  scrape->heavyQueued       = _admissionCount;
+  scrape->jobsPosted        = _jobs.posted;
+  scrape->jobsRejected      = _jobs.rejected;
+  scrape->apChannel         = _apChannel;
+  scrape->apChannelScore    = _apChannelScore;
+  scrape->portalBringUpUs   = _portalBringUpUs;
+
+#if ENCOMPASS_TIME
+  scrape->timeSource        = _timeSource;
+  scrape->timeOffsetUs      = _timeOffsetUs;
+  scrape->timeDriftPpb      = _clock.drift();
+#endif
+
+#if USE_ENCOMPASS_DNS
+  scrape->dnsQueries          = _captiveDNS.queries;
+  scrape->dnsAnswered         = _captiveDNS.answered;
+  scrape->dnsDroppedRate      = _captiveDNS.droppedRate;
+  scrape->dnsDroppedMalformed = _captiveDNS.droppedMalformed;
+#endif
+
+  // Replaces the one startHeavy() set, the slot goes back here
+  request->onDisconnect([this, scrape]()
+  {
+    delete scrape;
+    endHeavy();
+  });
+
+  AsyncWebServerResponse *response = request->beginChunkedResponse(FPSTR(HTTP_HEAD_METRICS),
+                                       [scrape](uint8_t *buffer, size_t maxLen, size_t index) -> size_t
+  {
+    return scrape->render(buffer, maxLen, index);
+  });
+
+  setNoCacheHeaders(response);
+  request->send(response);
+}
+
+// Handle the job page
+// GET ?id=N - where a job a handler posted has got to, the id comes in the X-Encompass-Job header of the page that posted it.
+// POST type=rescan|close|reset|restart - posts one, 202 with its id.
+void Encompass::handleJob(AsyncWebServerRequest *request)
+{
+  if (request->method() == HTTP_POST)
+  {
+    String  name  = request->arg("type");
+    uint8_t type  = JOB_TYPES;
+
+    // Credentials only come with the /save form
+    for (uint8_t i = JOB_RESET; i < JOB_TYPES; i++)
+    {
+      if (strcmp_P(name.c_str(), (PGM_P) pgm_read_ptr(&JOB_TYPE_NAMES[i])) == 0)
+        type = i;
+    }
+
+    if (type == JOB_TYPES)
+    {
+      request->send(400);
+      return;
+    }
+
+    if (reserveJob(type, request) == NULL)
+      return;
+
+    uint16_t id = _jobs.commit();
+
+    AsyncResponseStream *response = request->beginResponseStream(FPSTR(HTTP_HEAD_JSON));
+    setNoCacheHeaders(response);
+    response->setCode(202);
+    response->addHeader(FPSTR(HTTP_JOB), String(id));
+    response->print(F("{\"id\":"));
+    response->print(id);
+    response->print('}');
+
+    request->send(response);
+    return;
+  }
+
+  uint16_t  id      = request->arg("id").toInt();
+  uint8_t   type    = JOB_TYPES;
+  int32_t   result  = 0;
+  uint8_t   status  = _jobs.status(id, type, result);
+
+  if (status == JOB_UNKNOWN)
+  {
+    request->send(404);
+    return;
+  }
+
+  AsyncResponseStream *response = request->beginResponseStream(FPSTR(HTTP_HEAD_JSON));
+  setNoCacheHeaders(response);
+
+  response->print(F("{\"id\":"));
+  response->print(id);
+  response->print(F(",\"type\":\""));
+  response->print(FPSTR((PGM_P) pgm_read_ptr(&JOB_TYPE_NAMES[type])));
+  response->print(F("\",\"status\":\""));
+  response->print(FPSTR((PGM_P) pgm_read_ptr(&JOB_STATUS_NAMES[status])));
+  response->print(F("\",\"result\":"));
+  response->print(result);
+  response->print('}');
+
+  request->send(response);
+}
+
+// Handle the network list
+// Same filtering as the config page (duplicates and low quality networks are skipped), JSON or CBOR array. In CBOR an
+// SSID that is not UTF-8 goes out as a byte string.
+void Encompass::handleNetworks(AsyncWebServerRequest *request)
+{
+  LOGDEBUG(F("Networks"));
+
+  uint8_t pressure = getMemoryPressure();
+
+  if (pressure == PRESSURE_CRITICAL)
+  {
+    _metrics.observeDegraded(DEGRADE_REFUSED);
+    sendRetryLater(request);
+    return;
+  }
+
+  boolean cbor  = wantsCBOR(request);
+  int     count = 0;
+
+  for (int i = 0; i < wifiSSIDCount; i++)
+  {
+    if (!wifiSSIDs[i].duplicate && (_minimumQuality == -1 || _minimumQuality < getRSSIasQuality(wifiSSIDs[i].RSSI)))
+      count++;
+  }
+
+  // The response is buffered whole, keep it to the strongest few
+  if (pressure != PRESSURE_NONE && count > ENCOMPASS_LOW_MEMORY_NETWORKS)
+  {
+    _metrics.observeDegraded(DEGRADE_TRUNCATED);
+    count = ENCOMPASS_LOW_MEMORY_NETWORKS;
+  }
+
+  AsyncResponseStream *response = request->beginResponseStream(cbor ? FPSTR(HTTP_HEAD_CBOR) : FPSTR(HTTP_HEAD_JSON));
+  setNoCacheHeaders(response);
+
+  CBORWriter cw(*response);
+
+  if (cbor)
+    cw.beginArray(count);
+  else
+    response->print('[');
+
+  boolean first  = true;
+  int     listed = 0;
+
+  for (int i = 0; i < wifiSSIDCount && listed < count; i++)
+  {
+    if (wifiSSIDs[i].duplicate)
+      continue;
+
+    int quality = getRSSIasQuality(wifiSSIDs[i].RSSI);
+
+    if (!(_minimumQuality == -1 || _minimumQuality < quality))
+      continue;
+
+    listed++;
+
+    if (cbor)
+    {
+      cw.beginMap(3);
+      cw.writeText(F("SSID"));
+      cw.writeTextOrBytes(wifiSSIDs[i].SSID.c_str(), wifiSSIDs[i].SSID.length());
+      cw.writeText(F("Encryption"));
+      cw.writeUInt(wifiSSIDs[i].encryptionType);
+      cw.writeText(F("Quality"));
+      cw.writeUInt(quality);
+    }
+    else
+    {
+      if (!first)
+        response->print(',');
+
+      response->print(F("{\"SSID\":"));
+      printJSONString(*response, wifiSSIDs[i].SSID.c_str());
+      response->print(F(",\"Encryption\":"));
+      response->print(wifiSSIDs[i].encryptionType);
+      response->print(F(",\"Quality\":"));
+      response->print(quality);
+      response->print('}');
+    }
+
+    first = false;
+  }
+
+  if (!cbor)
+    response->print(']');
+
+  request->send(response);
+
+  LOGDEBUG1(F("Sent network list, count ="), count);
+}
+
+// Handle the configuration page
+// Portal and station settings, never the AP password. JSON or CBOR map.
+void Encompass::handleConfig(AsyncWebServerRequest *request)
+{
+  LOGDEBUG(F("Config"));
+
+  boolean cbor = wantsCBOR(request);
+
+#if USE_CONFIGURABLE_DNS
+  const uint8_t pairs = 12;
+#else
+  const uint8_t pairs = 10;
+#endif
+
+  uint32_t ips[] =
+  {
+    _sta_static_ip, _sta_static_gw, _sta_static_sn,
+#if USE_CONFIGURABLE_DNS
+    _sta_static_dns1, _sta_static_dns2
+#endif
+  };
+
+  const __FlashStringHelper *ipKeys[] =
+  {
+    F("Static_IP"), F("Static_GW"), F("Static_SN"),
+#if USE_CONFIGURABLE_DNS
+    F("Static_DNS1"), F("Static_DNS2")
+#endif
+  };
+
+  AsyncResponseStream *response = request->beginResponseStream(cbor ? FPSTR(HTTP_HEAD_CBOR) : FPSTR(HTTP_HEAD_JSON));
+  setNoCacheHeaders(response);
+
+  if (cbor)
+  {
+    CBORWriter cw(*response);
+
+    cw.beginMap(pairs);
+    cw.writeText(F("AP_SSID"));
+    cw.writeTextOrBytes(_apName, _apName ? strlen(_apName) : 0);
+    cw.writeText(F("AP_Channel"));
+    cw.writeInt(_WiFiAPChannel);
+    cw.writeText(F("Hostname"));
+    cw.writeText(RFC952_hostname);
+    cw.writeText(F("Portal_Timeout"));
+    cw.writeUInt(_configPortalTimeout / 1000);
+    cw.writeText(F("Connect_Timeout"));
+    cw.writeUInt(_connectTimeout / 1000);
+    cw.writeText(F("Min_Quality"));
+    cw.writeInt(_minimumQuality);
+    cw.writeText(F("Remove_Duplicates"));
+    cw.writeBool(_removeDuplicateAPs);
+
+    for (uint8_t i = 0; i < sizeof(ips) / sizeof(ips[0]); i++)
+    {
+      cw.writeText(ipKeys[i]);
+      cw.writeBytes((const uint8_t *) &ips[i], 4);
+    }
+  }
+  else
+  {
+    response->print(F("{\"AP_SSID\":"));
+    printJSONString(*response, _apName);
+    response->print(F(",\"AP_Channel\":"));
+    response->print(_WiFiAPChannel);
+    response->print(F(",\"Hostname\":"));
+    printJSONString(*response, RFC952_hostname);
+    response->print(F(",\"Portal_Timeout\":"));
+    response->print(_configPortalTimeout / 1000);
+    response->print(F(",\"Connect_Timeout\":"));
+    response->print(_connectTimeout / 1000);
+    response->print(F(",\"Min_Quality\":"));
+    response->print(_minimumQuality);
+    response->print(_removeDuplicateAPs ? F(",\"Remove_Duplicates\":true") : F(",\"Remove_Duplicates\":false"));
+
+    for (uint8_t i = 0; i < sizeof(ips) / sizeof(ips[0]); i++)
+    {
+      response->print(F(",\""));
+      response->print(ipKeys[i]);
+      response->print(F("\":\""));
+      printIp(*response, ips[i]);
+      response->print('"');
+    }
+
+    response->print('}');
+  }
+
+  request->send(response);
+
+  LOGDEBUG1(F("Sent config, CBOR ="), cbor);
 }
 
 // Handle the reset page
 void Encompass::handleReset(AsyncWebServerRequest *request)
 {
   LOGDEBUG(F("Reset"));
+
+  // loop() resets once the page is out
+  if (reserveJob(JOB_RESET, request) == NULL)
+    return;
+
+  uint16_t id = _jobs.commit();
     
   String page = FPSTR(HTML_HEAD_START);
   page.replace("{v}", "WiFi Information");
@@ -1623,27 +2620,23 @@ void Encompass::handleReset(AsyncWebServerRequest *request)
   page += FPSTR(HTML_CLOSE);
     
   AsyncWebServerResponse *response = request->beginResponse(200, "text/html", page);
-  response->addHeader(HTTP_CACHE_CONTROL, E_HTTP_NO_STORE);
-  response->addHeader(HTTP_PRAGMA, E_HTTP_NO_CACHE);
+  response->addHeader(FPSTR(HTTP_CACHE_CONTROL), FPSTR(HTTP_NO_STORE));
+  response->addHeader(FPSTR(HTTP_PRAGMA), FPSTR(HTTP_NO_CACHE));
   response->addHeader(HTTP_EXPIRES, "-1");
+  response->addHeader(FPSTR(HTTP_JOB), String(id));
   
   request->send(response);
 
   LOGDEBUG(F("Sent reset page"));
-  delay(5000);
-  
-  // Temporary fix for issue of not clearing WiFi SSID/PW from flash of ESP32
-  // See https://github.com/thewhiterabbit/ESP_WiFiManager/issues/25 and https://github.com/espressif/arduino-esp32/issues/400
-  resetSettings();
-  //WiFi.disconnect(true); // Wipe out WiFi credentials.
-  //////
-
-  ESP.reset();
-  delay(2000);
 }
 
 void Encompass::handleNotFound(AsyncWebServerRequest *request)
 {
+  if (handleProbe(request))
+  {
+    return;
+  }
+
   if (captivePortal(request))
   {
     // If caprive portal redirect instead of displaying the error page.
@@ -1684,8 +2677,13 @@ boolean Encompass::captivePortal(AsyncWebServerRequest *request)
   {
     LOGDEBUG(F("Request redirected to captive portal"));
     
-    AsyncWebServerResponse *response = request->beginResponse(302, "text/plain", "");
-    response->addHeader("Location", String("http://") + toStringIp(request->client()->localIP()));
+    AsyncWebServerResponse *response = request->beginResponse(302);
+
+    if (_portalURL[0] && request->client()->localIP() == WiFi.softAPIP())
+      response->addHeader(FPSTR(HTTP_LOCATION), _portalURL);
+    else
+      response->addHeader(FPSTR(HTTP_LOCATION), String("http://") + toStringIp(request->client()->localIP()));
+
     request->send(response);
        
     return true;
@@ -1694,6 +2692,88 @@ boolean Encompass::captivePortal(AsyncWebServerRequest *request)
   return false;
 }
 
+/*
+   OS connectivity probes
+   Android, Apple, Windows and Firefox check a well known URL and open their sign-in sheet when the answer isn't the
+   expected one. A bare redirect to the portal does that straight away, without the host check or the 404 dump.
+*/
+boolean Encompass::handleProbe(AsyncWebServerRequest *request)
+{
+  const char *url = request->url().c_str();
+
+  for (uint8_t i = 0; i < sizeof(CAPTIVE_PROBES) / sizeof(CAPTIVE_PROBES[0]); i++)
+  {
+    CaptiveProbe probe;
+
+    memcpy_P(&probe, &CAPTIVE_PROBES[i], sizeof(probe));
+
+    if (strcmp_P(url, probe.path) == 0)
+    {
+      // A redirect costs next to no heap and heavy pages give way first (heavyLimit()), so probes are only put off
+      // when the heap is critical
+      if (getMemoryPressure() >= PRESSURE_CRITICAL)
+      {
+        _metrics.observeDegraded(DEGRADE_SHED_PROBE);
+        sendRetryLater(request);
+        return true;
+      }
+
+      _probeCount[probe.type]++;
+
+      LOGDEBUG1(F("Captive portal probe, type ="), probe.type);
+
+      AsyncWebServerResponse *response = request->beginResponse(302);
+      response->addHeader(FPSTR(HTTP_LOCATION), _portalURL[0] ? _portalURL : "/");
+      response->addHeader(FPSTR(HTTP_CACHE_CONTROL), FPSTR(HTTP_NO_STORE));
+      request->send(response);
+
+      return true;
+    }
+  }
+
+  return false;
+}
+
+uint8_t Encompass::getMemoryPressure()
+{
+  uint32_t free;
+  uint16_t block;
+
+  ESP.getHeapStats(&free, &block, NULL);
+
+  return memoryPressure(free, block);
+}
+
+uint8_t Encompass::memoryPressure(uint32_t freeHeap, uint32_t maxBlock)
+{
+  for (uint8_t level = PRESSURE_CRITICAL; level > PRESSURE_NONE; level--)
+  {
+    if (freeHeap < _heapThresholds[level] || maxBlock < _blockThresholds[level])
+      return level;
+  }
+
+  return PRESSURE_NONE;
+}
+
+void Encompass::setMemoryThresholds(uint8_t level, uint32_t freeHeap, uint32_t maxBlock)
+{
+  if (level > PRESSURE_NONE && level < PRESSURE_LEVELS)
+  {
+    _heapThresholds[level]  = freeHeap;
+    _blockThresholds[level] = maxBlock;
+  }
+}
+
+void Encompass::sendRetryLater(AsyncWebServerRequest *request)
+{
+  LOGINFO1(F("503 for"), request->url());
+
+  AsyncWebServerResponse *response = request->beginResponse(503);
+  response->addHeader(FPSTR(HTTP_RETRY_AFTER), String(ENCOMPASS_RETRY_AFTER));
+  response->addHeader(FPSTR(HTTP_CACHE_CONTROL), FPSTR(HTTP_NO_STORE));
+  request->send(response);
+}
+
 // start up config portal callback
 void Encompass::setAPCallback(void(*func)(Encompass* myWiFiManager))
 {
@@ -1709,6 +2789,7 @@ void Encompass::setSaveConfigCallback(void(*func)(void))
 // sets a custom element to add to head, like a new style tag
 void Encompass::setCustomHeadElement(const char* element) {
   _customHeadElement = element;
+  invalidatePages();
 }
 
 // if this is true, remove duplicated Access Points - defaut true
@@ -1719,11 +2800,15 @@ void Encompass::setRemoveDuplicateAPs(boolean removeDuplicates)
 
 // Scan for WiFiNetworks in range and sort by signal strength
 // space for indices array allocated on the heap and should be freed when no longer required
-int Encompass::scanWifiNetworks(int indicesptr)
+int Encompass::scanWifiNetworks(int **indicesptr)
 {
   LOGDEBUG(F("Scanning Network"));
-  
+
+  EncompassOp op(_ops, OP_SCAN);
+  uint32_t    scanStart = micros();
+
   int n = WiFi.scanNetworks();
+  _metrics.observeScan(micros() - scanStart, n);
 
   LOGDEBUG1(F("scanWifiNetworks: Done, Scanned Networks n ="), n); 
 
@@ -1853,7 +2938,7 @@ int Encompass::getRSSIasQuality(int RSSI)
 }
 
 // Is this an IP?
-boolean Encompass::isIp(String str)
+boolean Encompass::isIp(const String &str)
 {
   for (int i = 0; i < str.length(); i++)
   {
@@ -1881,6 +2966,61 @@ String Encompass::toStringIp(IPAddress ip)
   return res;
 }
 
+void Encompass::printIp(Print &out, uint32_t ip)
+{
+  for (int i = 0; i < 4; i++)
+  {
+    if (i)
+      out.print('.');
+
+    out.print((ip >> (8 * i)) & 0xFF);
+  }
+}
+
+void Encompass::printMAC(Print &out, const uint8_t *mac)
+{
+  static const char hex[] = "0123456789ABCDEF";
+
+  for (int i = 0; i < 6; i++)
+  {
+    if (i)
+      out.print(':');
+
+    out.print(hex[mac[i] >> 4]);
+    out.print(hex[mac[i] & 0x0F]);
+  }
+}
+
+// Quoted and escaped, SSIDs may contain anything
+void Encompass::printJSONString(Print &out, const char *str)
+{
+  out.print('"');
+
+  for (; str && *str; str++)
+  {
+    char c = *str;
+
+    if (c == '"' || c == '\\')
+    {
+      out.print('\\');
+      out.print(c);
+    }
+    else if ((uint8_t) c < 0x20)
+    {
+      char esc[7];
+
+      snprintf(esc, sizeof(esc), "\\u%04x", c);
+      out.print(esc);
+    }
+    else
+    {
+      out.print(c);
+    }
+  }
+
+  out.print('"');
+}
+
 /*#ifdef ESP32 // <-- Maybe remove this & all the contained lines within
 // We can't use WiFi.SSID() in ESP32 as it's only valid after connected.
 // SSID and Password stored in ESP32 wifi_ap_record_t and wifi_config_t are also cleared in reboot
@@ -0,0 +1,209 @@
+/*
+  ImplCBOR.h
+  For ESP8266 boards
+
+  CBOR encoder used by the content negotiated /state, /networks and /config endpoints.
+  Items are written straight to the response stream, nothing is staged in a String.
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#pragma once
+
+#define CBOR_MAJOR_UINT       0
+#define CBOR_MAJOR_NINT       1
+#define CBOR_MAJOR_BYTES      2
+#define CBOR_MAJOR_TEXT       3
+#define CBOR_MAJOR_ARRAY      4
+#define CBOR_MAJOR_MAP        5
+#define CBOR_SIMPLE_FALSE     0xF4
+#define CBOR_SIMPLE_TRUE      0xF5
+#define CBOR_SIMPLE_NULL      0xF6
+
+CBORWriter::CBORWriter(Print &out) : _out(out), _written(0)
+{
+}
+
+void CBORWriter::writeHead(uint8_t major, uint32_t value)
+{
+  uint8_t head[5];
+  size_t  len;
+
+  major <<= 5;
+
+  if (value < 24)
+  {
+    head[0] = major | value;
+    len     = 1;
+  }
+  else if (value <= 0xFF)
+  {
+    head[0] = major | 24;
+    head[1] = value;
+    len     = 2;
+  }
+  else if (value <= 0xFFFF)
+  {
+    head[0] = major | 25;
+    head[1] = value >> 8;
+    head[2] = value;
+    len     = 3;
+  }
+  else
+  {
+    head[0] = major | 26;
+    head[1] = value >> 24;
+    head[2] = value >> 16;
+    head[3] = value >> 8;
+    head[4] = value;
+    len     = 5;
+  }
+
+  _written += _out.write(head, len);
+}
+
+void CBORWriter::beginMap(size_t pairs)
+{
+  writeHead(CBOR_MAJOR_MAP, pairs);
+}
+
+void CBORWriter::beginArray(size_t items)
+{
+  writeHead(CBOR_MAJOR_ARRAY, items);
+}
+
+void CBORWriter::writeUInt(uint32_t value)
+{
+  writeHead(CBOR_MAJOR_UINT, value);
+}
+
+void CBORWriter::writeInt(int32_t value)
+{
+  if (value < 0)
+    writeHead(CBOR_MAJOR_NINT, (uint32_t) (-1 - value));
+  else
+    writeHead(CBOR_MAJOR_UINT, (uint32_t) value);
+}
+
+void CBORWriter::writeBool(bool value)
+{
+  _written += _out.write((uint8_t) (value ? CBOR_SIMPLE_TRUE : CBOR_SIMPLE_FALSE));
+}
+
+void CBORWriter::writeNull()
+{
+  _written += _out.write((uint8_t) CBOR_SIMPLE_NULL);
+}
+
+void CBORWriter::writeText(const char *text)
+{
+  writeText(text, text ? strlen(text) : 0);
+}
+
+void CBORWriter::writeText(const char *text, size_t len)
+{
+  writeHead(CBOR_MAJOR_TEXT, len);
+
+  if (len)
+    _written += _out.write((const uint8_t *) text, len);
+}
+
+void CBORWriter::writeText(const __FlashStringHelper *text)
+{
+  PGM_P   p   = reinterpret_cast<PGM_P>(text);
+  size_t  len = strlen_P(p);
+  char    chunk[32];
+
+  writeHead(CBOR_MAJOR_TEXT, len);
+
+  // Keys live in flash, copy them out in small pieces
+  while (len)
+  {
+    size_t n = (len < sizeof(chunk)) ? len : sizeof(chunk);
+
+    memcpy_P(chunk, p, n);
+    _written += _out.write((const uint8_t *) chunk, n);
+
+    p   += n;
+    len -= n;
+  }
+}
+
+void CBORWriter::writeBytes(const uint8_t *data, size_t len)
+{
+  writeHead(CBOR_MAJOR_BYTES, len);
+
+  if (len)
+    _written += _out.write(data, len);
+}
+
+void CBORWriter::writeTextOrBytes(const char *text, size_t len)
+{
+  if (validUTF8((const uint8_t *) text, len))
+    writeText(text, len);
+  else
+    writeBytes((const uint8_t *) text, len);
+}
+
+// RFC 3629: no overlong forms, no surrogates, nothing past U+10FFFF
+bool CBORWriter::validUTF8(const uint8_t *s, size_t len)
+{
+  size_t i = 0;
+
+  while (i < len)
+  {
+    uint8_t c = s[i];
+    uint8_t follow;
+    uint8_t lo = 0x80;
+    uint8_t hi = 0xBF;
+
+    if (c < 0x80)
+    {
+      i++;
+      continue;
+    }
+    else if (c >= 0xC2 && c <= 0xDF)
+      follow = 1;
+    else if (c >= 0xE0 && c <= 0xEF)
+    {
+      follow = 2;
+
+      if (c == 0xE0)
+        lo = 0xA0;
+      else if (c == 0xED)
+        hi = 0x9F;
+    }
+    else if (c >= 0xF0 && c <= 0xF4)
+    {
+      follow = 3;
+
+      if (c == 0xF0)
+        lo = 0x90;
+      else if (c == 0xF4)
+        hi = 0x8F;
+    }
+    else
+      return false;
+
+    if (len - i - 1 < follow)
+      return false;
+
+    // Only the first continuation byte has the narrower range
+    for (uint8_t k = 1; k <= follow; k++)
+    {
+      uint8_t b = s[i + k];
+
+      if (b < lo || b > hi)
+        return false;
+
+      lo = 0x80;
+      hi = 0xBF;
+    }
+
+    i += 1 + follow;
+  }
+
+  return true;
+}
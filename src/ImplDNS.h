@@ -0,0 +1,230 @@
+/*
+  ImplDNS.h
+  For ESP8266 boards
+
+  Captive DNS responder used by the config portal in place of DNSServer.
+  Drains every queued query per loop (up to a time budget) instead of one per processNextRequest() call.
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#pragma once
+
+#define DNS_HEADER_SIZE         12
+#define DNS_QTYPE_A             1
+#define DNS_QTYPE_ANY           255
+
+CaptiveDNS::CaptiveDNS()
+{
+  _running    = false;
+  _burst      = 32;
+  _perSecond  = 16;
+
+  queries           = 0;
+  answered          = 0;
+  droppedRate       = 0;
+  droppedMalformed  = 0;
+  budgetExhausted   = 0;
+
+  memset(_slots, 0, sizeof(_slots));
+}
+
+bool CaptiveDNS::start(uint16_t port, IPAddress resolvedIP)
+{
+  uint32_t ip = resolvedIP;
+
+  // QR, AA - RD is copied from the query. QDCOUNT 1, ANCOUNT 1 or 0, NSCOUNT 0, ARCOUNT 0
+  static const uint8_t headerA[10]      PROGMEM = { 0x84, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00 };
+  static const uint8_t headerEmpty[10]  PROGMEM = { 0x84, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+
+  memcpy_P(_headerA,     headerA,     sizeof(_headerA));
+  memcpy_P(_headerEmpty, headerEmpty, sizeof(_headerEmpty));
+
+  _answer[0]  = 0xC0;                         // Pointer to the name at offset 12
+  _answer[1]  = DNS_HEADER_SIZE;
+  _answer[2]  = 0x00;
+  _answer[3]  = DNS_QTYPE_A;
+  _answer[4]  = 0x00;
+  _answer[5]  = 0x01;                         // IN
+  _answer[6]  = (CAPTIVE_DNS_TTL >> 24) & 0xFF;
+  _answer[7]  = (CAPTIVE_DNS_TTL >> 16) & 0xFF;
+  _answer[8]  = (CAPTIVE_DNS_TTL >> 8) & 0xFF;
+  _answer[9]  = CAPTIVE_DNS_TTL & 0xFF;
+  _answer[10] = 0x00;
+  _answer[11] = 0x04;
+  memcpy(&_answer[12], &ip, 4);               // IPAddress keeps the octets in network order
+
+  queries           = 0;
+  answered          = 0;
+  droppedRate       = 0;
+  droppedMalformed  = 0;
+  budgetExhausted   = 0;
+
+  memset(_slots, 0, sizeof(_slots));
+
+  _running = (_udp.begin(port) == 1);
+
+  LOGWARN1(F("Captive DNS started ="), _running);
+
+  return _running;
+}
+
+void CaptiveDNS::stop()
+{
+  if (_running)
+  {
+    _udp.stop();
+    _running = false;
+  }
+}
+
+void CaptiveDNS::setRateLimit(uint8_t burst, uint8_t perSecond)
+{
+  _burst      = burst;
+  _perSecond  = perSecond;
+}
+
+bool CaptiveDNS::admit(uint32_t ip, uint32_t now)
+{
+  RateSlot *slot    = NULL;
+  RateSlot *oldest  = &_slots[0];
+
+  for (uint8_t i = 0; i < CAPTIVE_DNS_RATE_SLOTS; i++)
+  {
+    if (_slots[i].ip == ip)
+    {
+      slot = &_slots[i];
+      break;
+    }
+
+    if ((int32_t) (_slots[i].lastMs - oldest->lastMs) < 0)
+      oldest = &_slots[i];
+  }
+
+  if (slot == NULL)
+  {
+    // New client takes over the least recently seen slot with a full bucket
+    slot          = oldest;
+    slot->ip      = ip;
+    slot->lastMs  = now;
+    slot->tokens  = _burst << 4;
+  }
+  else
+  {
+    uint32_t refill = ((now - slot->lastMs) * _perSecond * 16) / 1000;
+
+    if (refill)
+    {
+      slot->tokens  = std::min<uint32_t>(slot->tokens + refill, _burst << 4);
+      slot->lastMs  = now;
+    }
+  }
+
+  if (slot->tokens < 16)
+    return false;
+
+  slot->tokens -= 16;
+
+  return true;
+}
+
+void CaptiveDNS::answer(size_t len)
+{
+  // Question section: QNAME labels, QTYPE, QCLASS - anything after it (EDNS etc.) is dropped
+  size_t p = DNS_HEADER_SIZE;
+
+  while (p < len && _buf[p] != 0)
+  {
+    if (_buf[p] & 0xC0)
+    {
+      // No compression in a question
+      droppedMalformed++;
+      return;
+    }
+
+    p += _buf[p] + 1;
+  }
+
+  p += 1 + 4;
+
+  if (p > len)
+  {
+    droppedMalformed++;
+    return;
+  }
+
+  uint16_t  qtype = (_buf[p - 4] << 8) | _buf[p - 3];
+  uint8_t   rd    = _buf[2] & 0x01;
+
+  // ID and question are already in place, patch the header and append the answer
+  if (qtype == DNS_QTYPE_A || qtype == DNS_QTYPE_ANY)
+  {
+    memcpy(&_buf[2], _headerA, sizeof(_headerA));
+    memcpy(&_buf[p], _answer, sizeof(_answer));
+    p += sizeof(_answer);
+  }
+  else
+  {
+    // AAAA and friends get an empty NOERROR so clients fall back to A straight away
+    memcpy(&_buf[2], _headerEmpty, sizeof(_headerEmpty));
+  }
+
+  _buf[2] |= rd;
+
+  _udp.beginPacket(_udp.remoteIP(), _udp.remotePort());
+  _udp.write(_buf, p);
+  _udp.endPacket();
+
+  answered++;
+}
+
+uint16_t CaptiveDNS::processPending(uint32_t budgetUs)
+{
+  if (!_running)
+    return 0;
+
+  uint32_t  start   = micros();
+  uint32_t  now     = millis();
+  uint32_t  before  = answered;
+
+  while (true)
+  {
+    int len = _udp.parsePacket();
+
+    if (len <= 0)
+      break;
+
+    queries++;
+
+    // Unread packets are discarded by the next parsePacket()
+    if (len < DNS_HEADER_SIZE || len > CAPTIVE_DNS_MAX_PACKET)
+    {
+      droppedMalformed++;
+    }
+    else if (!admit(_udp.remoteIP(), now))
+    {
+      droppedRate++;
+    }
+    else
+    {
+      _udp.read(_buf, len);
+
+      // Standard queries with a single question only
+      if ((_buf[2] & 0xF8) != 0 || _buf[4] != 0 || _buf[5] != 1)
+        droppedMalformed++;
+      else
+        answer(len);
+    }
+
+    if (micros() - start > budgetUs)
+    {
+      // Whatever is still queued is answered on the next loop
+      budgetExhausted++;
+      break;
+    }
+  }
+
+  return (uint16_t) (answered - before);
+}
@@ -0,0 +1,100 @@
+/*
+  ImplEvents.h
+  For ESP8266 boards
+
+  Status stream on /events. The info page listens for "status" events and updates itself in place, instead of
+  reloading every 5 seconds while a connect is under way. The update page follows "update" events the same way.
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#pragma once
+
+#if ENCOMPASS_EVENTS
+
+// With the first portal, the source stays with the server and only takes listeners while a portal is open
+void Encompass::setupEvents()
+{
+  _events = new AsyncEventSource("/events");
+  _events->setFilter([this](AsyncWebServerRequest *request)
+  {
+    return _portalOpen && ON_AP_FILTER(request);
+  });
+
+  // Runs in the TCP callback context - no sending from here, the loop sends the first event
+  _events->onConnect([this](AsyncEventSourceClient *client)
+  {
+    if (_events->count() > ENCOMPASS_EVENT_CLIENTS)
+    {
+      LOGDEBUG(F("Event stream refused, too many listeners"));
+      client->close();
+      return;
+    }
+
+    _eventStale = true;
+    _scheduler.trigger(TASK_EVENTS);
+  });
+
+  server->addHandler(_events);
+}
+
+// Sends a status event when the WiFi status, the station IP or (connected) the RSSI has moved since the last one, and
+// an update event while a firmware upload moves on
+void Encompass::processEvents()
+{
+  if (_events == NULL || _events->count() == 0)
+    return;
+
+#if ENCOMPASS_UPDATE
+  if (_updateState != _updateEventState || _updateWritten != _updateEventWritten)
+  {
+    _updateEventState   = _updateState;
+    _updateEventWritten = _updateWritten;
+
+    StreamString update;
+
+    update.print(F("{\"state\":\""));
+    update.print(FPSTR((PGM_P) pgm_read_ptr(&UPDATE_STATE_NAMES[_updateEventState])));
+    update.print(F("\",\"written\":"));
+    update.print(_updateEventWritten);
+    update.print(F(",\"total\":"));
+    update.print(_updateTotal);
+    update.print(F("}"));
+
+    _events->send(update.c_str(), "update", ++_eventId);
+  }
+#endif
+
+  uint8_t   status    = WiFi.status();
+  bool      connected = (status == WL_CONNECTED);
+  uint32_t  ip        = (uint32_t) WiFi.localIP();
+  int32_t   rssi      = connected ? WiFi.RSSI() : 0;
+
+  if (!_eventStale && status == _eventStatus && ip == _eventIP && abs(rssi - _eventRSSI) < ENCOMPASS_EVENT_RSSI_STEP)
+    return;
+
+  _eventStale   = false;
+  _eventStatus  = status;
+  _eventIP      = ip;
+  _eventRSSI    = rssi;
+
+  StreamString data;
+
+  data.print(F("{\"status\":"));
+  data.print(status);
+  data.print(connected ? F(",\"connected\":true,\"ssid\":") : F(",\"connected\":false,\"ssid\":"));
+  printJSONString(data, WiFi_SSID().c_str());
+  data.print(F(",\"ip\":\""));
+  printIp(data, ip);
+  data.print(F("\",\"rssi\":"));
+  data.print(rssi);
+  data.print(F("}"));
+
+  _events->send(data.c_str(), "status", ++_eventId);
+
+  LOGDEBUG1(F("Sent status event, status ="), status);
+}
+
+#endif
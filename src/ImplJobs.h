@@ -0,0 +1,298 @@
+/*
+  ImplJobs.h
+  For ESP8266 boards
+
+  Deferred work queue between the request handlers and Encompass::loop(), see EncompassJobs.cls.
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#pragma once
+
+static_assert((ENCOMPASS_JOB_QUEUE & (ENCOMPASS_JOB_QUEUE - 1)) == 0, "ENCOMPASS_JOB_QUEUE must be a power of 2");
+
+EncompassJobs::EncompassJobs() : posted(0), rejected(0), _head(0), _tail(0), _nextId(1)
+{
+  memset(_ring, 0, sizeof(_ring));
+  memset(_history, 0, sizeof(_history));
+}
+
+EncompassJob* EncompassJobs::reserve(uint8_t type)
+{
+  if (_head - _tail >= ENCOMPASS_JOB_QUEUE)
+  {
+    rejected++;
+    return NULL;
+  }
+
+  EncompassJob &job = _ring[_head % ENCOMPASS_JOB_QUEUE];
+
+  memset(&job, 0, sizeof(job));
+  job.type = type;
+
+  return &job;
+}
+
+uint16_t EncompassJobs::commit()
+{
+  EncompassJob &job = _ring[_head % ENCOMPASS_JOB_QUEUE];
+
+  job.id        = _nextId;
+  job.postedMs  = millis();
+
+  // 0 is never an id
+  if (++_nextId == 0)
+    _nextId = 1;
+
+  // The job is written before the consumer can see it
+  __sync_synchronize();
+  _head = _head + 1;
+  posted++;
+
+  return job.id;
+}
+
+EncompassJob* EncompassJobs::front()
+{
+  if (_tail == _head)
+    return NULL;
+
+  __sync_synchronize();
+
+  return &_ring[_tail % ENCOMPASS_JOB_QUEUE];
+}
+
+void EncompassJobs::pop()
+{
+  __sync_synchronize();
+  _tail = _tail + 1;
+}
+
+void EncompassJobs::finish(uint16_t id, uint8_t type, uint8_t status, int32_t result)
+{
+  Outcome &o = _history[id % ENCOMPASS_JOB_HISTORY];
+
+  // Readers check the id last, so it goes in last
+  o.id      = 0;
+  __sync_synchronize();
+  o.type    = type;
+  o.status  = status;
+  o.result  = result;
+  __sync_synchronize();
+  o.id      = id;
+}
+
+uint8_t EncompassJobs::status(uint16_t id, uint8_t &type, int32_t &result)
+{
+  if (id == 0)
+    return JOB_UNKNOWN;
+
+  const Outcome &o = _history[id % ENCOMPASS_JOB_HISTORY];
+
+  if (o.id == id)
+  {
+    uint8_t s = o.status;
+
+    type    = o.type;
+    result  = o.result;
+
+    // Still the same job once copied
+    if (o.id == id)
+      return s;
+  }
+
+  for (uint32_t i = _tail; i != _head; i++)
+  {
+    const EncompassJob &job = _ring[i % ENCOMPASS_JOB_QUEUE];
+
+    if (job.id == id)
+    {
+      type    = job.type;
+      result  = 0;
+
+      return JOB_QUEUED;
+    }
+  }
+
+  return JOB_UNKNOWN;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Handler side - NULL with a 503 sent when the queue is full
+
+EncompassJob* Encompass::reserveJob(uint8_t type, AsyncWebServerRequest *request)
+{
+  EncompassJob *job = _jobs.reserve(type);
+
+  if (job == NULL)
+  {
+    LOGERROR(F("Job queue full"));
+    sendRetryLater(request);
+  }
+
+  return job;
+}
+
+// Runs queued jobs, from loop() and the modal portal loop. A reset or restart waits ENCOMPASS_RESET_DELAY_MS so that its page gets
+// out first.
+
+void Encompass::processJobs()
+{
+  EncompassJob *job;
+
+  while ((job = _jobs.front()) != NULL)
+  {
+    if ((job->type == JOB_RESET || job->type == JOB_RESTART) && millis() - job->postedMs < ENCOMPASS_RESET_DELAY_MS)
+      return;
+
+    uint16_t  id    = job->id;
+    uint8_t   type  = job->type;
+
+    _jobs.finish(id, type, JOB_RUNNING, 0);
+
+    switch (type)
+    {
+      case JOB_CREDENTIALS:
+        applyCredentials(*job);
+        // Finished by connectJobDone() once the connect has been tried
+        break;
+
+      case JOB_RESET:
+        LOGDEBUG(F("Job: reset"));
+
+        // Temporary fix for issue of not clearing WiFi SSID/PW from flash of ESP32
+        // See https://github.com/thewhiterabbit/ESP_WiFiManager/issues/25 and https://github.com/espressif/arduino-esp32/issues/400
+        resetSettings();
+        //WiFi.disconnect(true); // Wipe out WiFi credentials.
+        //////
+
+#if ENCOMPASS_TIME
+        saveTime();
+#endif
+
+        ESP.reset();
+        delay(2000);
+        break;
+
+      case JOB_CLOSE_PORTAL:
+        LOGDEBUG(F("Job: close portal"));
+
+        stopConfigPortal = true; //signal ready to shutdown config portal
+
+        // Restore when Press Save WiFi
+        _configPortalTimeout = DEFAULT_PORTAL_TIMEOUT;
+
+        _jobs.finish(id, type, JOB_DONE, 0);
+        break;
+
+      case JOB_RESCAN:
+        LOGDEBUG(F("Job: rescan"));
+
+        shouldscan = true;
+        scan();
+        scannow = millis();
+
+        _jobs.finish(id, type, JOB_DONE, wifiSSIDCount);
+        break;
+
+      case JOB_RESTART:
+        LOGDEBUG(F("Job: restart"));
+
+#if ENCOMPASS_TIME
+        saveTime();
+#endif
+
+        ESP.restart();
+        delay(2000);
+        break;
+    }
+
+    _jobs.pop();
+  }
+}
+
+// The saved form, into the state the loop connects with
+
+void Encompass::applyCredentials(EncompassJob &job)
+{
+  LOGDEBUG1(F("Job: credentials for"), job.ssid);
+
+  // A connect still to come for an earlier save will use these instead
+  if (_connectJob)
+    _jobs.finish(_connectJob, JOB_CREDENTIALS, JOB_FAILED, WL_DISCONNECTED);
+
+  for (int i = 0; i < 2; i++)
+  {
+    _ssid[i] = job.ssid;
+    _pass[i] = job.pass;
+  }
+
+  if (job.fields)
+  {
+    const char *value = job.fields;
+
+    for (int i = 0; i < _DataFieldsCount && _DataFields[i] != NULL; i++)
+    {
+      // Custom HTML only, no value to hold
+      if (_DataFields[i]->_id == NULL || _DataFields[i]->_length <= 0)
+        continue;
+
+      strncpy(_DataFields[i]->_value, value, _DataFields[i]->_length);
+      _DataFields[i]->_value[_DataFields[i]->_length - 1] = 0;
+
+      value += _DataFields[i]->_length;
+    }
+
+    free(job.fields);
+    job.fields = NULL;
+  }
+
+  IPAddress *ips[JOB_IPS] =
+  {
+    &_sta_static_ip, &_sta_static_gw, &_sta_static_sn,
+#if USE_CONFIGURABLE_DNS
+    &_sta_static_dns1, &_sta_static_dns2
+#else
+    NULL, NULL
+#endif
+  };
+
+  for (uint8_t i = 0; i < JOB_IPS; i++)
+  {
+    if ((job.ipMask & (1 << i)) && ips[i])
+      *ips[i] = job.ips[i];
+  }
+
+  _connectJob = job.id;
+
+  // Restore when Press Save WiFi
+  _configPortalTimeout = DEFAULT_PORTAL_TIMEOUT;
+
+#if ENCOMPASS_PRECOMPUTE_PSK
+  // The connect waits for the PSK, processPSK() posts it
+  if (derivePSKs(0))
+    return;
+#endif
+
+  connect     = true; //signal ready to connect/reset
+
+  _scheduler.trigger(TASK_CONNECT);
+}
+
+// After the connect a credentials job asked for
+
+void Encompass::connectJobDone(int status)
+{
+  if (_connectJob == 0)
+    return;
+
+  _jobs.finish(_connectJob, JOB_CREDENTIALS, (status == WL_CONNECTED) ? JOB_DONE : JOB_FAILED, status);
+  _connectJob = 0;
+
+#if ENCOMPASS_EVENTS
+  _scheduler.trigger(TASK_EVENTS);
+#endif
+}
@@ -0,0 +1,668 @@
+/*
+  ImplMetrics.h
+  For ESP8266 boards
+
+  Metrics registry behind /metrics - per route handler latency, WiFi scans and connects, main loop gaps and stalls,
+  DNS and heap, in the Prometheus text exposition format.
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#pragma once
+
+#define ROUTE_LABEL(id, path, handler, flags)     id##_PATH,
+
+// Bucket upper bounds (us)
+const uint32_t METRIC_ROUTE_BOUNDS[METRIC_BUCKETS]    PROGMEM = { 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 1000000 };
+const uint32_t METRIC_SCAN_BOUNDS[METRIC_BUCKETS]     PROGMEM = { 250000, 500000, 1000000, 1500000, 2000000, 2500000, 3000000, 4000000, 5000000, 10000000 };
+const uint32_t METRIC_CONNECT_BOUNDS[METRIC_BUCKETS]  PROGMEM = { 250000, 500000, 1000000, 2000000, 3000000, 5000000, 8000000, 10000000, 15000000, 30000000 };
+const uint32_t METRIC_LOOP_BOUNDS[METRIC_BUCKETS]     PROGMEM = { 1000, 2000, 5000, 10000, 20000, 50000, 100000, 250000, 1000000, 5000000 };
+
+const char METRIC_LABEL_CUSTOM[]      PROGMEM = "custom";
+const char METRIC_LABEL_OTHER[]       PROGMEM = "other";
+const char METRIC_LABEL_OK[]          PROGMEM = "ok";
+const char METRIC_LABEL_FAILED[]      PROGMEM = "failed";
+const char METRIC_LABEL_TIMEOUT[]     PROGMEM = "timeout";
+const char METRIC_LABEL_TRUNCATED[]   PROGMEM = "truncated";
+const char METRIC_LABEL_MINIMAL[]     PROGMEM = "minimal";
+const char METRIC_LABEL_REFUSED[]     PROGMEM = "refused";
+const char METRIC_LABEL_SHED_PROBE[]  PROGMEM = "shed_probe";
+const char METRIC_LABEL_ADMITTED[]    PROGMEM = "admitted";
+const char METRIC_LABEL_QUEUED[]      PROGMEM = "queued";
+const char METRIC_LABEL_REJECTED[]    PROGMEM = "rejected";
+const char METRIC_LABEL_EXPIRED[]     PROGMEM = "expired";
+const char METRIC_LABEL_ABANDONED[]   PROGMEM = "abandoned";
+const char METRIC_LABEL_SKETCH[]      PROGMEM = "sketch";
+const char METRIC_LABEL_LOOP[]        PROGMEM = "loop";
+const char METRIC_LABEL_DNS[]         PROGMEM = "dns";
+const char METRIC_LABEL_SCAN[]        PROGMEM = "scan";
+const char METRIC_LABEL_CONNECT[]     PROGMEM = "connect";
+const char METRIC_LABEL_PORTAL[]      PROGMEM = "portal";
+const char METRIC_LABEL_REQUEST[]     PROGMEM = "request";
+
+const char * const METRIC_ROUTE_LABELS[METRIC_ROUTES] PROGMEM =
+{
+  ENCOMPASS_ROUTES(ROUTE_LABEL)
+  METRIC_LABEL_CUSTOM,
+  METRIC_LABEL_OTHER
+};
+
+const char * const METRIC_CONNECT_LABELS[CONNECT_OUTCOMES] PROGMEM =
+{
+  METRIC_LABEL_OK,
+  METRIC_LABEL_FAILED,
+  METRIC_LABEL_TIMEOUT
+};
+
+const char * const METRIC_DEGRADE_LABELS[DEGRADATIONS] PROGMEM =
+{
+  METRIC_LABEL_TRUNCATED,
+  METRIC_LABEL_MINIMAL,
+  METRIC_LABEL_REFUSED,
+  METRIC_LABEL_SHED_PROBE
+};
+
+const char * const METRIC_ADMISSION_LABELS[ADMISSION_OUTCOMES] PROGMEM =
+{
+  METRIC_LABEL_ADMITTED,
+  METRIC_LABEL_QUEUED,
+  METRIC_LABEL_REJECTED,
+  METRIC_LABEL_EXPIRED,
+  METRIC_LABEL_ABANDONED
+};
+
+const char * const METRIC_OP_LABELS[OP_COUNT] PROGMEM =
+{
+  METRIC_LABEL_SKETCH,
+  METRIC_LABEL_LOOP,
+  METRIC_LABEL_DNS,
+  METRIC_LABEL_SCAN,
+  METRIC_LABEL_CONNECT,
+  METRIC_LABEL_PORTAL,
+  METRIC_LABEL_REQUEST
+};
+
+void MetricHistogram::observe(uint32_t us, const uint32_t *bounds)
+{
+  uint8_t i = 0;
+
+  // Buckets are "less than or equal", anything past the last bound goes to +Inf
+  while (i < METRIC_BUCKETS && us > pgm_read_dword(&bounds[i]))
+    i++;
+
+  buckets[i]++;
+  sumUs += us;
+}
+
+uint32_t MetricHistogram::count() const
+{
+  uint32_t total = 0;
+
+  for (uint8_t i = 0; i <= METRIC_BUCKETS; i++)
+    total += buckets[i];
+
+  return total;
+}
+
+EncompassMetrics::EncompassMetrics()
+{
+  memset(this, 0, sizeof(*this));
+}
+
+void EncompassMetrics::observeRoute(uint8_t route, uint32_t us)
+{
+  if (route < METRIC_ROUTES)
+    routes[route].observe(us, METRIC_ROUTE_BOUNDS);
+}
+
+void EncompassMetrics::observeScan(uint32_t us, int networks)
+{
+  scan.observe(us, METRIC_SCAN_BOUNDS);
+  scanNetworks = networks;
+}
+
+void EncompassMetrics::observeConnect(int status, uint32_t us)
+{
+  uint8_t outcome;
+
+  if (status == WL_CONNECTED)
+    outcome = CONNECT_OK;
+  else if (status == WL_CONNECT_FAILED || status == WL_NO_SSID_AVAIL)
+    outcome = CONNECT_FAILED;
+  else
+    outcome = CONNECT_TIMEOUT;
+
+  connect[outcome].observe(us, METRIC_CONNECT_BOUNDS);
+}
+
+void EncompassMetrics::observeLoopGap(uint32_t us, uint32_t thresholdUs, const uint32_t *opUs, uint8_t route)
+{
+  loopGaps.observe(us, METRIC_LOOP_BOUNDS);
+  stallThresholdUs = thresholdUs;
+
+  if (us <= thresholdUs)
+    return;
+
+  uint8_t op = OP_SKETCH;
+
+  for (uint8_t i = OP_SKETCH + 1; i < OP_COUNT; i++)
+  {
+    if (opUs[i] > opUs[op])
+      op = i;
+  }
+
+  stalls[op]++;
+
+  if (us > stallMaxUs[op])
+    stallMaxUs[op] = us;
+
+  MetricStall &stall = recentStalls[stallCount % METRIC_RECENT_STALLS];
+
+  stall.atMs  = millis();
+  stall.gapUs = us;
+  stall.op    = op;
+  stall.route = (op == OP_REQUEST) ? route : ROUTE_NONE;
+
+  stallCount++;
+
+  LOGINFO3(F("Loop stall us ="), us, F(", op ="), FPSTR(pgm_read_ptr(&METRIC_OP_LABELS[op])));
+}
+
+const MetricStall& EncompassMetrics::recentStall(uint8_t i) const
+{
+  uint32_t first = (stallCount > METRIC_RECENT_STALLS) ? stallCount - METRIC_RECENT_STALLS : 0;
+
+  return recentStalls[(first + i) % METRIC_RECENT_STALLS];
+}
+
+#if ENCOMPASS_PROFILE
+static void observeMetricProfile(MetricProfile &p, uint32_t stack, uint32_t heapDrop, uint32_t heapMin, uint32_t blockMin,
+                                 int fragRise)
+{
+  if (p.runs == 0 || heapMin < p.heapMin)
+    p.heapMin = heapMin;
+
+  if (p.runs == 0 || blockMin < p.blockMin)
+    p.blockMin = blockMin;
+
+  p.stackMax    = std::max(p.stackMax, stack);
+  p.heapDropMax = std::max(p.heapDropMax, heapDrop);
+
+  if (fragRise > 0 && (uint32_t) fragRise > p.fragRiseMax)
+    p.fragRiseMax = fragRise;
+
+  p.runs++;
+}
+
+void EncompassMetrics::observeProfile(uint8_t op, uint8_t route, uint32_t stack, uint32_t heapStart, uint32_t heapMin,
+                                      uint32_t blockMin, int fragRise)
+{
+  uint32_t heapDrop = heapStart - heapMin;
+
+  observeMetricProfile(profileOps[op], stack, heapDrop, heapMin, blockMin, fragRise);
+
+  if (op == OP_REQUEST && route < METRIC_ROUTES)
+    observeMetricProfile(profileRoutes[route], stack, heapDrop, heapMin, blockMin, fragRise);
+}
+
+static void printProfileLine(Print &out, PGM_P label, const MetricProfile &p)
+{
+  char name[24];
+  char line[96];
+
+  strncpy_P(name, label, sizeof(name) - 1);
+  name[sizeof(name) - 1] = 0;
+
+  snprintf(line, sizeof(line), "%-20s %8lu %8lu %10lu %10lu %10lu %6lu", name, (unsigned long) p.runs,
+           (unsigned long) p.stackMax, (unsigned long) p.heapDropMax, (unsigned long) p.heapMin,
+           (unsigned long) p.blockMin, (unsigned long) p.fragRiseMax);
+
+  out.println(line);
+}
+
+void EncompassMetrics::printProfile(Print &out) const
+{
+  out.println(F("op / route               runs    stack  heap drop   heap min  block min  frag+"));
+
+  for (uint8_t i = 0; i < OP_COUNT; i++)
+  {
+    if (profileOps[i].runs)
+      printProfileLine(out, (PGM_P) pgm_read_ptr(&METRIC_OP_LABELS[i]), profileOps[i]);
+  }
+
+  for (uint8_t i = 0; i < METRIC_ROUTES; i++)
+  {
+    if (profileRoutes[i].runs)
+      printProfileLine(out, (PGM_P) pgm_read_ptr(&METRIC_ROUTE_LABELS[i]), profileRoutes[i]);
+  }
+}
+#endif
+
+static void printMetricSeconds(Print &out, uint64_t us)
+{
+  char frac[8];
+
+  snprintf(frac, sizeof(frac), ".%06lu", (unsigned long) (us % 1000000));
+
+  out.print((unsigned long) (us / 1000000));
+  out.print(frac);
+}
+
+static void printMetricHeader(Print &out, const __FlashStringHelper *name, const __FlashStringHelper *type,
+                              const __FlashStringHelper *help)
+{
+  out.print(F("# HELP "));
+  out.print(name);
+  out.print(' ');
+  out.println(help);
+  out.print(F("# TYPE "));
+  out.print(name);
+  out.print(' ');
+  out.println(type);
+}
+
+static void printMetric(Print &out, const __FlashStringHelper *name, uint32_t value)
+{
+  out.print(name);
+  out.print(' ');
+  out.println(value);
+}
+
+// label is in PROGMEM
+static void printMetric(Print &out, const __FlashStringHelper *name, const __FlashStringHelper *key, PGM_P label,
+                        uint32_t value)
+{
+  out.print(name);
+  out.print('{');
+  out.print(key);
+  out.print(F("=\""));
+  out.print(FPSTR(label));
+  out.print(F("\"} "));
+  out.println(value);
+}
+
+// key and label may be NULL for an unlabelled histogram, label is in PROGMEM
+static void printMetricHistogram(Print &out, const __FlashStringHelper *name, const __FlashStringHelper *key, PGM_P label,
+                                 const MetricHistogram &h, const uint32_t *bounds)
+{
+  uint32_t cumulative = 0;
+
+  for (uint8_t i = 0; i <= METRIC_BUCKETS; i++)
+  {
+    cumulative += h.buckets[i];
+
+    out.print(name);
+    out.print(F("_bucket{"));
+
+    if (key)
+    {
+      out.print(key);
+      out.print(F("=\""));
+      out.print(FPSTR(label));
+      out.print(F("\","));
+    }
+
+    out.print(F("le=\""));
+
+    if (i < METRIC_BUCKETS)
+      printMetricSeconds(out, pgm_read_dword(&bounds[i]));
+    else
+      out.print(F("+Inf"));
+
+    out.print(F("\"} "));
+    out.println(cumulative);
+  }
+
+  for (uint8_t i = 0; i < 2; i++)
+  {
+    out.print(name);
+    out.print(i ? F("_count") : F("_sum"));
+
+    if (key)
+    {
+      out.print('{');
+      out.print(key);
+      out.print(F("=\""));
+      out.print(FPSTR(label));
+      out.print(F("\"}"));
+    }
+
+    out.print(' ');
+
+    if (i)
+      out.println(cumulative);
+    else
+    {
+      printMetricSeconds(out, h.sumUs);
+      out.println();
+    }
+  }
+}
+
+#if ENCOMPASS_PROFILE
+// One gauge, by op and by route, for everything that has run
+static void printMetricProfile(Print &out, const __FlashStringHelper *name, const __FlashStringHelper *help,
+                               const MetricProfile *profileOps, const MetricProfile *profileRoutes,
+                               uint32_t MetricProfile::*field)
+{
+  printMetricHeader(out, name, F("gauge"), help);
+
+  for (uint8_t i = 0; i < OP_COUNT; i++)
+  {
+    if (profileOps[i].runs)
+      printMetric(out, name, F("op"), (PGM_P) pgm_read_ptr(&METRIC_OP_LABELS[i]), profileOps[i].*field);
+  }
+
+  for (uint8_t i = 0; i < METRIC_ROUTES; i++)
+  {
+    if (profileRoutes[i].runs)
+      printMetric(out, name, F("route"), (PGM_P) pgm_read_ptr(&METRIC_ROUTE_LABELS[i]), profileRoutes[i].*field);
+  }
+}
+#endif
+
+bool EncompassMetrics::printSection(Print &out, uint8_t section, uint8_t item) const
+{
+  switch (section)
+  {
+    case METRIC_SECTION_HEAP:
+      if (item > 0)
+        return false;
+
+      printMetricHeader(out, F("encompass_uptime_seconds"), F("gauge"), F("Time since boot"));
+      out.print(F("encompass_uptime_seconds "));
+      printMetricSeconds(out, (uint64_t) uptimeMs * 1000);
+      out.println();
+
+      printMetricHeader(out, F("encompass_heap_free_bytes"), F("gauge"), F("Free heap"));
+      printMetric(out, F("encompass_heap_free_bytes"), freeHeap);
+      printMetricHeader(out, F("encompass_heap_max_free_block_bytes"), F("gauge"), F("Largest allocatable block"));
+      printMetric(out, F("encompass_heap_max_free_block_bytes"), maxFreeBlock);
+      printMetricHeader(out, F("encompass_heap_fragmentation_percent"), F("gauge"), F("Heap fragmentation"));
+      printMetric(out, F("encompass_heap_fragmentation_percent"), heapFragmentation);
+      printMetricHeader(out, F("encompass_memory_pressure"), F("gauge"), F("0 none, 1 low, 2 high, 3 critical"));
+      printMetric(out, F("encompass_memory_pressure"), memoryPressure);
+      return true;
+
+    case METRIC_SECTION_DEGRADED:
+      if (item > DEGRADATIONS)
+        return false;
+
+      if (item == 0)
+        printMetricHeader(out, F("encompass_degraded_total"), F("counter"), F("Responses cut down or refused for lack of heap"));
+      else
+      {
+        printMetric(out, F("encompass_degraded_total"), F("mode"), (PGM_P) pgm_read_ptr(&METRIC_DEGRADE_LABELS[item - 1]),
+                    degraded[item - 1]);
+      }
+
+      return true;
+
+#if USE_ENCOMPASS_DNS
+    case METRIC_SECTION_DNS:
+      if (item > 0)
+        return false;
+
+      printMetricHeader(out, F("encompass_dns_queries_total"), F("counter"), F("Captive DNS queries received since the portal started"));
+      printMetric(out, F("encompass_dns_queries_total"), dnsQueries);
+      printMetricHeader(out, F("encompass_dns_answered_total"), F("counter"), F("Captive DNS queries answered"));
+      printMetric(out, F("encompass_dns_answered_total"), dnsAnswered);
+      printMetricHeader(out, F("encompass_dns_dropped_total"), F("counter"), F("Captive DNS queries dropped"));
+      printMetric(out, F("encompass_dns_dropped_total{reason=\"rate\"}"), dnsDroppedRate);
+      printMetric(out, F("encompass_dns_dropped_total{reason=\"malformed\"}"), dnsDroppedMalformed);
+      return true;
+#endif
+
+    case METRIC_SECTION_PORTAL:
+      if (item > 0)
+        return false;
+
+      printMetricHeader(out, F("encompass_ap_channel"), F("gauge"), F("Soft AP channel, 0 before the portal has started"));
+      printMetric(out, F("encompass_ap_channel"), apChannel);
+
+      if (apChannelScore >= 0)
+      {
+        printMetricHeader(out, F("encompass_ap_channel_score"), F("gauge"), F("Congestion score of the picked channel"));
+        printMetric(out, F("encompass_ap_channel_score"), (uint32_t) apChannelScore);
+      }
+
+      printMetricHeader(out, F("encompass_portal_bringup_seconds"), F("gauge"), F("Time the last portal start took, AP to routes"));
+      out.print(F("encompass_portal_bringup_seconds "));
+      printMetricSeconds(out, portalBringUpUs);
+      out.println();
+      return true;
+
+    case METRIC_SECTION_ADMISSION:
+      if (item > ADMISSION_OUTCOMES)
+        return false;
+
+      if (item == 0)
+      {
+        printMetricHeader(out, F("encompass_http_heavy_in_flight"), F("gauge"), F("Heavy page renders holding a slot"));
+        printMetric(out, F("encompass_http_heavy_in_flight"), heavyInFlight);
+        printMetricHeader(out, F("encompass_http_heavy_queued"), F("gauge"), F("Heavy page requests waiting for a slot"));
+        printMetric(out, F("encompass_http_heavy_queued"), heavyQueued);
+        printMetricHeader(out, F("encompass_http_admission_total"), F("counter"), F("Heavy page requests by admission outcome"));
+      }
+      else
+      {
+        printMetric(out, F("encompass_http_admission_total"), F("outcome"),
+                    (PGM_P) pgm_read_ptr(&METRIC_ADMISSION_LABELS[item - 1]), admission[item - 1]);
+      }
+
+      return true;
+
+    case METRIC_SECTION_JOBS:
+      if (item > 0)
+        return false;
+
+      printMetricHeader(out, F("encompass_jobs_posted_total"), F("counter"), F("Jobs request handlers left for loop()"));
+      printMetric(out, F("encompass_jobs_posted_total"), jobsPosted);
+      printMetricHeader(out, F("encompass_jobs_rejected_total"), F("counter"), F("Jobs refused with a full queue"));
+      printMetric(out, F("encompass_jobs_rejected_total"), jobsRejected);
+      return true;
+
+    case METRIC_SECTION_ROUTES:
+      if (item > METRIC_ROUTES)
+        return false;
+
+      if (item == 0)
+        printMetricHeader(out, F("encompass_http_request_duration_seconds"), F("histogram"), F("Handler time per portal route"));
+      else
+      {
+        printMetricHistogram(out, F("encompass_http_request_duration_seconds"), F("route"),
+                             (PGM_P) pgm_read_ptr(&METRIC_ROUTE_LABELS[item - 1]), routes[item - 1], METRIC_ROUTE_BOUNDS);
+      }
+
+      return true;
+
+    case METRIC_SECTION_SCAN:
+      if (item > 0)
+        return false;
+
+      printMetricHeader(out, F("encompass_wifi_scan_duration_seconds"), F("histogram"), F("WiFi network scans"));
+      printMetricHistogram(out, F("encompass_wifi_scan_duration_seconds"), NULL, NULL, scan, METRIC_SCAN_BOUNDS);
+      printMetricHeader(out, F("encompass_wifi_scan_networks"), F("gauge"), F("Networks found by the last scan"));
+      out.print(F("encompass_wifi_scan_networks "));
+      out.println(scanNetworks);
+      return true;
+
+    case METRIC_SECTION_CONNECT:
+      if (item > CONNECT_OUTCOMES)
+        return false;
+
+      if (item == 0)
+        printMetricHeader(out, F("encompass_wifi_connect_duration_seconds"), F("histogram"), F("WiFi connect attempts by outcome"));
+      else
+      {
+        printMetricHistogram(out, F("encompass_wifi_connect_duration_seconds"), F("outcome"),
+                             (PGM_P) pgm_read_ptr(&METRIC_CONNECT_LABELS[item - 1]), connect[item - 1], METRIC_CONNECT_BOUNDS);
+      }
+
+      return true;
+
+#if ENCOMPASS_ROAMING
+    case METRIC_SECTION_ROAMS:
+      if (item > 0)
+        return false;
+
+      printMetricHeader(out, F("encompass_wifi_roams_total"), F("counter"), F("Moves to a stronger AP of the network"));
+      printMetric(out, F("encompass_wifi_roams_total"), roams);
+      return true;
+#endif
+
+#if ENCOMPASS_TIME
+    case METRIC_SECTION_TIME:
+      if (item > 0)
+        return false;
+
+      printMetricHeader(out, F("encompass_time_source"), F("gauge"), F("Where the clock's time came from: 0 none, 1 RTC memory, 2 SNTP"));
+      printMetric(out, F("encompass_time_source"), timeSource);
+      printMetricHeader(out, F("encompass_time_offset_seconds"), F("gauge"), F("Difference the last SNTP answer found, slewed off since"));
+      out.print(F("encompass_time_offset_seconds "));
+
+      if (timeOffsetUs < 0)
+        out.print('-');
+
+      printMetricSeconds(out, (uint64_t) (timeOffsetUs < 0 ? -(int64_t) timeOffsetUs : timeOffsetUs));
+      out.println();
+      printMetricHeader(out, F("encompass_time_drift_ppb"), F("gauge"), F("Rate error of the clock's counter, as corrected"));
+      out.print(F("encompass_time_drift_ppb "));
+      out.println(timeDriftPpb);
+      printMetricHeader(out, F("encompass_ntp_requests_total"), F("counter"), F("SNTP requests by outcome"));
+      printMetric(out, F("encompass_ntp_requests_total{outcome=\"ok\"}"), ntpSyncs);
+      printMetric(out, F("encompass_ntp_requests_total{outcome=\"failed\"}"), ntpFailures);
+      return true;
+#endif
+
+    case METRIC_SECTION_LOOP:
+      if (item > 0)
+        return false;
+
+      printMetricHeader(out, F("encompass_loop_gap_seconds"), F("histogram"), F("Time between Encompass::loop() calls"));
+      printMetricHistogram(out, F("encompass_loop_gap_seconds"), NULL, NULL, loopGaps, METRIC_LOOP_BOUNDS);
+
+      printMetricHeader(out, F("encompass_loop_stall_threshold_seconds"), F("gauge"), F("Loop gap counted as a stall"));
+      out.print(F("encompass_loop_stall_threshold_seconds "));
+      printMetricSeconds(out, stallThresholdUs);
+      out.println();
+      return true;
+
+    case METRIC_SECTION_STALLS:
+      if (item > OP_COUNT)
+        return false;
+
+      if (item == 0)
+      {
+        printMetricHeader(out, F("encompass_loop_stalls_total"), F("counter"),
+                          F("Loop gaps over the threshold, by the operation that ran longest in them"));
+      }
+      else
+        printMetric(out, F("encompass_loop_stalls_total"), F("op"), (PGM_P) pgm_read_ptr(&METRIC_OP_LABELS[item - 1]), stalls[item - 1]);
+
+      return true;
+
+    case METRIC_SECTION_STALL_MAX:
+      if (item > OP_COUNT)
+        return false;
+
+      if (item == 0)
+        printMetricHeader(out, F("encompass_loop_stall_max_seconds"), F("gauge"), F("Longest stall by operation"));
+      else
+      {
+        out.print(F("encompass_loop_stall_max_seconds{op=\""));
+        out.print(FPSTR(pgm_read_ptr(&METRIC_OP_LABELS[item - 1])));
+        out.print(F("\"} "));
+        printMetricSeconds(out, stallMaxUs[item - 1]);
+        out.println();
+      }
+
+      return true;
+
+#if ENCOMPASS_PROFILE
+    case METRIC_SECTION_PROFILE:
+      switch (item)
+      {
+        case 0:
+          printMetricProfile(out, F("encompass_profile_stack_max_bytes"), F("Deepest stack use"),
+                             profileOps, profileRoutes, &MetricProfile::stackMax);
+          return true;
+
+        case 1:
+          printMetricProfile(out, F("encompass_profile_heap_drop_max_bytes"), F("Most free heap given up during one run"),
+                             profileOps, profileRoutes, &MetricProfile::heapDropMax);
+          return true;
+
+        case 2:
+          printMetricProfile(out, F("encompass_profile_heap_min_bytes"), F("Lowest free heap seen"),
+                             profileOps, profileRoutes, &MetricProfile::heapMin);
+          return true;
+
+        case 3:
+          printMetricProfile(out, F("encompass_profile_max_free_block_min_bytes"), F("Smallest largest free block seen"),
+                             profileOps, profileRoutes, &MetricProfile::blockMin);
+          return true;
+
+        case 4:
+          printMetricProfile(out, F("encompass_profile_fragmentation_rise_max_percent"), F("Largest fragmentation rise in one run"),
+                             profileOps, profileRoutes, &MetricProfile::fragRiseMax);
+          return true;
+      }
+
+      return false;
+#endif
+  }
+
+  // A section compiled out
+  return false;
+}
+
+void EncompassMetrics::printTo(Print &out) const
+{
+  for (uint8_t section = 0; section < METRIC_SECTIONS; section++)
+  {
+    for (uint8_t item = 0; printSection(out, section, item); item++)
+      ;
+  }
+}
+
+// An item that did not fit is printed again in the next chunk, skipping what went out - each chunk formats at most one
+// item twice rather than the whole document up to index
+size_t EncompassMetrics::render(uint8_t *buffer, size_t maxLen, size_t index)
+{
+  size_t len = 0;
+
+  if (index == 0)
+  {
+    renderSection = 0;
+    renderItem    = 0;
+    renderOffset  = 0;
+  }
+
+  while (len < maxLen && renderSection < METRIC_SECTIONS)
+  {
+    MetricChunk chunk(buffer + len, maxLen - len, renderOffset);
+
+    if (!printSection(chunk, renderSection, renderItem))
+    {
+      renderSection++;
+      renderItem = 0;
+      continue;
+    }
+
+    len += chunk.length();
+
+    if (chunk.full())
+    {
+      renderOffset += chunk.length();
+      break;
+    }
+
+    renderItem++;
+    renderOffset = 0;
+  }
+
+  return len;
+}
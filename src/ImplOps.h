@@ -0,0 +1,164 @@
+/*
+  ImplOps.h
+  For ESP8266 boards
+
+  Main loop stall detector - loop() gap histogram and stall attribution, see EncompassOps.cls.
+  Stack and heap profiling of the same operations with ENCOMPASS_PROFILE.
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#pragma once
+
+#if ENCOMPASS_PROFILE
+  #include <cont.h>
+
+  #define STACK_PAINT               0xA5C35A3CUL
+  // Left unpainted below paintStack()'s frame, so its own locals are not in the window
+  #define STACK_PAINT_GAP           256
+#endif
+
+EncompassOps::EncompassOps(EncompassMetrics &metrics) : thresholdUs(ENCOMPASS_STALL_THRESHOLD_US), _metrics(metrics), _current(NULL),
+                                                        _lastEntryUs(0), _started(false), _windowRouteUs(0), _windowRoute(ROUTE_NONE)
+{
+  memset(_windowUs, 0, sizeof(_windowUs));
+}
+
+void EncompassOps::loopEntry()
+{
+  uint32_t now = micros();
+
+  if (_started)
+  {
+    uint32_t gap    = now - _lastEntryUs;
+    uint32_t inside = 0;
+
+    for (uint8_t i = OP_SKETCH + 1; i < OP_COUNT; i++)
+      inside += _windowUs[i];
+
+    // Whatever no scope accounts for ran outside the library
+    _windowUs[OP_SKETCH] = (gap > inside) ? gap - inside : 0;
+
+    _metrics.observeLoopGap(gap, thresholdUs, _windowUs, _windowRoute);
+  }
+
+  memset(_windowUs, 0, sizeof(_windowUs));
+
+  _windowRouteUs  = 0;
+  _windowRoute    = ROUTE_NONE;
+  _lastEntryUs    = now;
+  _started        = true;
+}
+
+EncompassOp::EncompassOp(EncompassOps &ops, uint8_t op) : _ops(ops), _parent(ops._current), _startUs(micros()), _childUs(0),
+                                                          _op(op), _route(ROUTE_NONE)
+{
+#if ENCOMPASS_PROFILE
+  // The parent's marks so far, before this one paints over its window
+  if (_parent)
+    _parent->sample();
+
+  uint16_t block;
+
+  ESP.getHeapStats(&_heapStart, &block, &_fragStart);
+
+  _heapMin  = _heapStart;
+  _blockMin = block;
+
+  // Last, the heap walk is not the operation's stack
+  paintStack();
+#endif
+
+  _ops._current = this;
+}
+
+EncompassOp::~EncompassOp()
+{
+  uint32_t total  = micros() - _startUs;
+  uint32_t self   = (total > _childUs) ? total - _childUs : 0;
+
+  _ops._windowUs[_op] += self;
+
+  if (_op == OP_REQUEST && _route != ROUTE_NONE && self >= _ops._windowRouteUs)
+  {
+    _ops._windowRouteUs = self;
+    _ops._windowRoute   = _route;
+  }
+
+  if (_parent)
+    _parent->_childUs += total;
+
+#if ENCOMPASS_PROFILE
+  uint8_t fragEnd;
+
+  sample();
+  ESP.getHeapStats(NULL, NULL, &fragEnd);
+
+  _ops._metrics.observeProfile(_op, _route, _stackTop ? _stackEntry - (uintptr_t) _stackLow : 0, _heapStart, _heapMin,
+                               _blockMin, (int) fragEnd - _fragStart);
+
+  if (_parent)
+  {
+    // Only within the same painted stack
+    if (_stackTop && _parent->_stackTop && _stackLow < _parent->_stackLow)
+      _parent->_stackLow = _stackLow;
+
+    _parent->_heapMin   = std::min(_parent->_heapMin, _heapMin);
+    _parent->_blockMin  = std::min(_parent->_blockMin, _blockMin);
+  }
+#endif
+
+  _ops._current = _parent;
+}
+
+#if ENCOMPASS_PROFILE
+void EncompassOp::paintStack()
+{
+  _stackEntry   = (uintptr_t) __builtin_frame_address(0);
+
+  // Only on the loop() stack, whose bottom is known. Async handlers run on the SYS stack, which has no bound to paint
+  // against - those operations record heap only.
+  if (!g_pcont || _stackEntry <= (uintptr_t) g_pcont->stack || _stackEntry > (uintptr_t) g_pcont->stack_end)
+  {
+    _stackTop     = NULL;
+    _stackBottom  = NULL;
+    _stackLow     = NULL;
+    return;
+  }
+
+  _stackTop     = (uint32_t *) ((_stackEntry - STACK_PAINT_GAP) & ~(uintptr_t) 3);
+  _stackBottom  = _stackTop - ENCOMPASS_PROFILE_STACK_BYTES / 4;
+
+  // Not past the bottom of the loop() stack
+  if (_stackBottom < g_pcont->stack)
+    _stackBottom = g_pcont->stack;
+
+  for (uint32_t *p = _stackBottom; p < _stackTop; p++)
+    *p = STACK_PAINT;
+
+  _stackLow = _stackTop;
+}
+
+void EncompassOp::sample()
+{
+  uint32_t free;
+  uint16_t block;
+
+  // Only below the lowest word already found, the rest is known
+  for (uint32_t *p = _stackBottom; p < _stackLow; p++)
+  {
+    if (*p != STACK_PAINT)
+    {
+      _stackLow = p;
+      break;
+    }
+  }
+
+  ESP.getHeapStats(&free, &block, NULL);
+
+  _heapMin  = std::min(_heapMin, free);
+  _blockMin = std::min(_blockMin, (uint32_t) block);
+}
+#endif
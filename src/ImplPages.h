@@ -0,0 +1,178 @@
+/*
+  ImplPages.h
+  For ESP8266 boards
+
+  Custom page registry. A sketch registers a URI with a body template and a data provider, the page is rendered with
+  the same head, style and headers as the built-in pages and kept in RAM until the provider reports a new version.
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#pragma once
+
+bool Encompass::addPage(const char *uri, const char *title, PGM_P body, EncompassPageValue value,
+                        EncompassPageVersion version, void *ctx)
+{
+  if (_pageCount >= ENCOMPASS_MAX_PAGES)
+  {
+    LOGERROR1(F("No room for page"), uri);
+    return false;
+  }
+
+  if (!addRoute(uri, &Encompass::routePage))
+    return false;
+
+  EncompassPage &page = _pages[_pageCount++];
+
+  page.uri      = uri;
+  page.title    = title;
+  page.body     = body;
+  page.value    = value;
+  page.version  = version;
+  page.ctx      = ctx;
+
+  return true;
+}
+
+void Encompass::invalidatePages()
+{
+  for (uint8_t i = 0; i < _pageCount; i++)
+    _pages[i].cached = false;
+}
+
+void Encompass::routePage(Encompass *wm, AsyncWebServerRequest *request)
+{
+  wm->handlePage(request);
+}
+
+void Encompass::renderPage(EncompassPage &page, Print &out)
+{
+  String head = FPSTR(HTML_HEAD_START);
+  head.replace("{v}", page.title);
+
+  out.print(head);
+  out.print(FPSTR(HTML_SCRIPT));
+  out.print(FPSTR(HTML_SCRIPT_NTP));
+  out.print(FPSTR(HTML_STYLE));
+  out.print(_customHeadElement);
+  out.print(FPSTR(HTML_HEAD_CLOSE));
+
+  // Body template - {token} (letters, digits, '_') goes to the provider, any other brace is copied as is
+  PGM_P   p = page.body;
+  char    chunk[32];
+  size_t  n = 0;
+  char    c;
+
+  while ((c = pgm_read_byte(p++)) != 0)
+  {
+    if (c == '{' && page.value)
+    {
+      char    token[ENCOMPASS_PAGE_TOKEN_LEN + 1];
+      size_t  t = 0;
+      PGM_P   q = p;
+      char    d;
+
+      while ((d = pgm_read_byte(q)) != 0 && t < ENCOMPASS_PAGE_TOKEN_LEN && (isalnum(d) || d == '_'))
+      {
+        token[t++] = d;
+        q++;
+      }
+
+      if (d == '}' && t > 0)
+      {
+        token[t] = 0;
+
+        out.write(chunk, n);
+        n = 0;
+
+        page.value(page.ctx, token, out);
+
+        p = q + 1;
+        continue;
+      }
+    }
+
+    chunk[n++] = c;
+
+    if (n == sizeof(chunk))
+    {
+      out.write(chunk, n);
+      n = 0;
+    }
+  }
+
+  out.write(chunk, n);
+  out.print(FPSTR(HTML_CLOSE));
+}
+
+// Custom page handler
+void Encompass::handlePage(AsyncWebServerRequest *request)
+{
+  const char    *url  = request->url().c_str();
+  EncompassPage *page = NULL;
+
+  for (uint8_t i = 0; i < _pageCount; i++)
+  {
+    if (strcmp(_pages[i].uri, url) == 0)
+    {
+      page = &_pages[i];
+      break;
+    }
+  }
+
+  if (page == NULL)
+  {
+    handleNotFound(request);
+    return;
+  }
+
+  LOGDEBUG1(F("Handle page"), url);
+
+  // Disable _configPortalTimeout when someone accessing Portal to give some time to config
+  _configPortalTimeout = 0;
+
+  uint32_t  version = page->version ? page->version(page->ctx) : 0;
+  bool      stale   = !page->cached || version != page->cachedVersion;
+
+  if (stale && page->inFlight)
+  {
+    // The cached copy is still going out to another client, render this one straight into the response
+    AsyncResponseStream *response = request->beginResponseStream(FPSTR(HTTP_HEAD_CT));
+    setNoCacheHeaders(response);
+    renderPage(*page, *response);
+    request->send(response);
+
+    return;
+  }
+
+  if (stale)
+  {
+    // remove() keeps the capacity, later renders of a similar size don't reallocate
+    page->cache.remove(0);
+    renderPage(*page, page->cache);
+
+    page->cachedVersion = version;
+    page->cached        = true;
+    page->renders++;
+  }
+  else
+  {
+    page->hits++;
+  }
+
+  // Sent straight out of the cache, memcpy_P reads RAM as well as flash
+  page->inFlight++;
+  request->onDisconnect([page]()
+  {
+    page->inFlight--;
+  });
+
+  AsyncWebServerResponse *response = request->beginResponse_P(200, FPSTR(HTTP_HEAD_CT),
+                                                              (const uint8_t *) page->cache.c_str(), page->cache.length());
+  setNoCacheHeaders(response);
+  request->send(response);
+
+  LOGDEBUG(F("Page sent"));
+}
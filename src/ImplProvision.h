@@ -0,0 +1,373 @@
+/*
+  ImplProvision.h
+  For ESP8266 boards
+
+  UDP provisioning listener, up while the config portal is. A PROVISION datagram (see EncompassProvision.h) becomes
+  the same credentials job a form post to /save does, the ACK names the job so /job can follow the connect.
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#pragma once
+
+#if ENCOMPASS_PROVISIONING
+
+#define PROVISION_RECORD_MAGIC  0x454E5032      // "ENP2"
+
+// What RTC memory keeps, so a reset does not open the door to requests recorded before it
+struct ProvisionRecord
+{
+  uint32_t  magic;
+  uint32_t  counterHigh;
+  uint32_t  counterLow;
+  uint32_t  check;
+};
+
+void Encompass::setProvisioningKey(const char *key)
+{
+  size_t len = key ? strlen(key) : 0;
+
+  _provKeyed = (len > 0);
+
+  if (len == 0)
+  {
+    memset(&_provKeys, 0, sizeof(_provKeys));
+    stopProvisioning();
+    return;
+  }
+
+  _provKeys.derive(key, len);
+
+  if (len < 16)
+    LOGWARN(F("Provisioning key is short, anyone on the AP can guess it"));
+}
+
+void Encompass::setProvisioningCounter(uint64_t counter)
+{
+  if (counter <= _provCounter)
+    return;
+
+  _provCounter = counter;
+  saveProvisionCounter();
+}
+
+void Encompass::saveProvisionCounter()
+{
+  ProvisionRecord record;
+
+  record.magic        = PROVISION_RECORD_MAGIC;
+  record.counterHigh  = (uint32_t) (_provCounter >> 32);
+  record.counterLow   = (uint32_t) _provCounter;
+  record.check        = encompassRecordCheck(record);
+
+  ESP.rtcUserMemoryWrite(ENCOMPASS_PROVISION_RTC_BLOCK, (uint32_t *) &record, sizeof(record));
+}
+
+// From the constructor
+void Encompass::restoreProvisionCounter()
+{
+  ProvisionRecord record;
+
+  if (!ESP.rtcUserMemoryRead(ENCOMPASS_PROVISION_RTC_BLOCK, (uint32_t *) &record, sizeof(record)) ||
+      record.magic != PROVISION_RECORD_MAGIC || record.check != encompassRecordCheck(record))
+    return;
+
+  _provCounter = ((uint64_t) record.counterHigh << 32) | record.counterLow;
+}
+
+// The soft AP's subnet as the SDK has it, which covers a static AP IP as well as the default 192.168.4.1/24
+bool Encompass::onSoftAPSubnet(IPAddress ip)
+{
+  struct ip_info info;
+
+  if (!wifi_get_ip_info(SOFTAP_IF, &info) || info.ip.addr == 0)
+    return false;
+
+  return ((uint32_t) ip & info.netmask.addr) == (info.ip.addr & info.netmask.addr);
+}
+
+void Encompass::startProvisioning()
+{
+  if (!_provKeyed)
+    return;
+
+  // The requests already answered stay remembered, a portal restart is no reason to apply one again
+  _provRunning = (_provUdp.begin(ENCOMPASS_PROVISION_PORT) == 1);
+
+  LOGWARN1(F("Provisioning listener started ="), _provRunning);
+}
+
+void Encompass::stopProvisioning()
+{
+  if (_provRunning)
+  {
+    _provUdp.stop();
+    _provRunning = false;
+  }
+}
+
+// A few datagrams per run - each one costs an HMAC for the MAC and one per 32 bytes of body, its ACK as much again
+void Encompass::processProvisioning()
+{
+  if (!_provRunning)
+    return;
+
+  uint8_t buf[PROVISION_MAX_PACKET];
+
+  for (uint8_t n = 0; n < 4; n++)
+  {
+    int len = _provUdp.parsePacket();
+
+    if (len <= 0)
+      break;
+
+    // Unread packets are discarded by the next parsePacket()
+    if (len > PROVISION_MAX_PACKET)
+      continue;
+
+    // The socket is bound on every interface, only clients of the portal's AP may provision
+    if (!onSoftAPSubnet(_provUdp.remoteIP()))
+    {
+      LOGDEBUG1(F("Provisioning: not on the AP subnet"), _provUdp.remoteIP());
+      continue;
+    }
+
+    _provUdp.read(buf, len);
+
+    ProvisionReader reader(buf, len);
+
+    // Nothing goes back to a sender without the key
+    if (!reader.open(_provKeys) || reader.type() != PROVISION_REQUEST)
+    {
+      LOGDEBUG1(F("Provisioning: dropped from"), _provUdp.remoteIP());
+      continue;
+    }
+
+    static const uint8_t anyone[6] = { 0 };
+    uint8_t mac[6];
+
+    WiFi.macAddress(mac);
+
+    if (memcmp(reader.target(), anyone, 6) != 0 && memcmp(reader.target(), mac, 6) != 0)
+      continue;
+
+    // A repeat - the sender missed the ACK
+    ProvisionSeen *seen = NULL;
+
+    for (uint8_t i = 0; i < ENCOMPASS_PROVISION_NONCES; i++)
+    {
+      if (_provSeen[i].used && memcmp(_provSeen[i].nonce, reader.nonce(), PROVISION_NONCE_SIZE) == 0)
+      {
+        seen = &_provSeen[i];
+        break;
+      }
+    }
+
+    if (seen == NULL)
+    {
+      // Played back, or from a sender whose clock is behind the last one's
+      if (reader.counter() <= _provCounter)
+      {
+        LOGWARN1(F("Provisioning: stale counter from"), _provUdp.remoteIP());
+        sendProvisionAck(reader.nonce(), PROVISION_STALE, 0);
+        continue;
+      }
+
+      uint16_t  jobId   = 0;
+      uint8_t   status  = (reader.version() == PROVISION_VERSION) ? applyProvisioning(reader, jobId) : (uint8_t) PROVISION_UNSUPPORTED;
+
+      LOGWARN2(F("Provisioning: request from"), _provUdp.remoteIP(), status);
+
+      // Busy is worth a retry, so it is not remembered and the counter stays where it was
+      if (status == PROVISION_BUSY)
+      {
+        sendProvisionAck(reader.nonce(), status, 0);
+        continue;
+      }
+
+      _provCounter = reader.counter();
+      saveProvisionCounter();
+
+      seen          = &_provSeen[_provSeenNext];
+      _provSeenNext = (_provSeenNext + 1) % ENCOMPASS_PROVISION_NONCES;
+
+      seen->used    = true;
+      memcpy(seen->nonce, reader.nonce(), PROVISION_NONCE_SIZE);
+      seen->status  = status;
+      seen->job     = jobId;
+    }
+
+    sendProvisionAck(seen->nonce, seen->status, seen->job);
+  }
+}
+
+// Fills in and posts a credentials job, as handleSave() does for the form. DataFields the datagram leaves out keep
+// their values.
+uint8_t Encompass::applyProvisioning(ProvisionReader &reader, uint16_t &jobId)
+{
+  EncompassJob *job = _jobs.reserve(JOB_CREDENTIALS);
+
+  if (job == NULL)
+    return PROVISION_BUSY;
+
+  size_t fieldsLen = 0;
+
+  for (int i = 0; i < _DataFieldsCount && _DataFields[i] != NULL; i++)
+    fieldsLen += _DataFields[i]->_length;
+
+  if (fieldsLen)
+  {
+    job->fields = (char *) malloc(fieldsLen);
+
+    // Not posted, the slot is reused
+    if (job->fields == NULL)
+      return PROVISION_BUSY;
+
+    char *field = job->fields;
+
+    for (int i = 0; i < _DataFieldsCount && _DataFields[i] != NULL; i++)
+    {
+      if (_DataFields[i]->_length > 0)
+        strncpy(field, _DataFields[i]->_value, _DataFields[i]->_length);
+
+      field += _DataFields[i]->_length;
+    }
+  }
+
+  uint8_t       tag;
+  const uint8_t *value;
+  uint8_t       len;
+  uint8_t       status  = PROVISION_OK;
+  bool          ssid    = false;
+
+  while (status == PROVISION_OK && reader.next(tag, value, len))
+  {
+    switch (tag)
+    {
+      case PTAG_SSID:
+        if (len == 0 || len > JOB_SSID_LEN)
+          status = PROVISION_MALFORMED;
+        else
+          memcpy(job->ssid, value, len);
+
+        ssid = true;
+        break;
+
+      case PTAG_PASS:
+        if (len > JOB_PASS_LEN)
+          status = PROVISION_MALFORMED;
+        else
+          memcpy(job->pass, value, len);
+        break;
+
+      case PTAG_IP:
+      case PTAG_GW:
+      case PTAG_SN:
+      case PTAG_DNS1:
+      case PTAG_DNS2:
+      {
+        uint8_t i = JOB_IP + (tag - PTAG_IP);
+
+        if (len != 4)
+        {
+          status = PROVISION_MALFORMED;
+          break;
+        }
+
+#if !USE_CONFIGURABLE_DNS
+        if (i >= JOB_DNS1)
+          break;
+#endif
+
+        // IPAddress keeps the octets in network order in memory
+        memcpy(&job->ips[i], value, 4);
+        job->ipMask |= 1 << i;
+        break;
+      }
+
+      case PTAG_FIELD:
+      {
+        const uint8_t *end = (const uint8_t *) memchr(value, 0, len);
+
+        if (end == NULL)
+        {
+          status = PROVISION_MALFORMED;
+          break;
+        }
+
+        char *field = job->fields;
+        int   i     = 0;
+
+        for (; i < _DataFieldsCount && _DataFields[i] != NULL; i++)
+        {
+          if (_DataFields[i]->_id && strcmp(_DataFields[i]->_id, (const char *) value) == 0)
+            break;
+
+          field += _DataFields[i]->_length;
+        }
+
+        // Unknown ids are skipped, a newer sender may know fields this sketch does not have
+        if (i == _DataFieldsCount || _DataFields[i] == NULL || _DataFields[i]->_length <= 0)
+        {
+          LOGDEBUG1(F("Provisioning: no field"), (const char *) value);
+          break;
+        }
+
+        size_t valueLen = std::min<size_t>(len - (end + 1 - value), _DataFields[i]->_length - 1);
+
+        memcpy(field, end + 1, valueLen);
+        field[valueLen] = 0;
+        break;
+      }
+
+      default:
+        status = PROVISION_UNSUPPORTED;
+        break;
+    }
+  }
+
+  if (status == PROVISION_OK && (reader.malformed() || !ssid))
+    status = PROVISION_MALFORMED;
+
+  if (status != PROVISION_OK)
+  {
+    // Not posted, the slot is reused
+    free(job->fields);
+    job->fields = NULL;
+
+    return status;
+  }
+
+  jobId = _jobs.commit();
+
+  return PROVISION_OK;
+}
+
+void Encompass::sendProvisionAck(const uint8_t *nonce, uint8_t status, uint16_t jobId)
+{
+  uint8_t         buf[PROVISION_HEADER_SIZE + 64 + PROVISION_MAC_SIZE];
+  uint8_t         mac[6];
+  ProvisionWriter ack(buf, sizeof(buf));
+
+  WiFi.macAddress(mac);
+
+  // Uptime as the counter, the ACKs for one nonce do not share a keystream
+  ack.header(PROVISION_ACK, nonce, mac, micros64());
+  ack.addU8(PTAG_STATUS, status);
+
+  if (jobId)
+    ack.addU16(PTAG_JOB, jobId);
+
+  ack.addU32(PTAG_CHIP_ID, ESP.getChipId());
+  ack.add(PTAG_AP_NAME, _apName, std::min<size_t>(strlen(_apName), 32));
+
+  size_t len = ack.seal(_provKeys);
+
+  _provUdp.beginPacket(_provUdp.remoteIP(), _provUdp.remotePort());
+  _provUdp.write(buf, len);
+  _provUdp.endPacket();
+}
+
+#endif
@@ -0,0 +1,125 @@
+/*
+  ImplRoam.h
+  For ESP8266 boards
+
+  Roaming between the APs of one network. The SDK only changes AP when the link drops, so a station that associated
+  with a far AP stays on it however weak it gets. processRoaming() samples the link and, once the smoothed RSSI stays
+  under the threshold, scans in the background and makes a connect directed at the strongest other BSSID of the
+  network - if that one is clearly stronger. The move is not saved, the flash keeps the network rather than one AP.
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#pragma once
+
+#if ENCOMPASS_ROAMING
+
+// Every ENCOMPASS_ROAM_SAMPLE_MS from the scheduler
+void Encompass::processRoaming()
+{
+  if (_roamPending)
+  {
+    if (WiFi.status() == WL_CONNECTED)
+    {
+      LOGWARN1(F("Roamed to"), WiFi.BSSIDstr());
+
+      _metrics.roams++;
+      _roamPending  = false;
+      _roamRSSI     = 0;
+      _stateDirty   = true;
+    }
+    else if (millis() - _roamAt > ENCOMPASS_ROAM_TIMEOUT_MS)
+    {
+      LOGWARN(F("Roaming: no connect, any AP of the network will do"));
+
+      bool persistent = WiFi.getPersistent();
+
+      WiFi.persistent(false);
+      WiFi.begin(WiFi_SSID().c_str(), WiFi_Pass().c_str());
+      WiFi.persistent(persistent);
+
+      _roamPending = false;
+    }
+
+    return;
+  }
+
+  if (_roamThreshold == 0 || WiFi.status() != WL_CONNECTED)
+  {
+    _roamRSSI = 0;
+    return;
+  }
+
+  // A quarter of each sample, one weak beacon is not a reason to move
+  int32_t rssi = WiFi.RSSI();
+
+  _roamRSSI = _roamRSSI ? (3 * _roamRSSI + rssi) / 4 : rssi;
+
+  if (_roamScanning)
+  {
+    int8_t n = WiFi.scanComplete();
+
+    if (n == WIFI_SCAN_RUNNING)
+      return;
+
+    _roamScanning = false;
+
+    if (n <= 0)
+      return;
+
+    // The portal's network list gets the fresh results too
+    storeScanResults(n);
+
+    String  ssid    = WiFi_SSID();
+    uint8_t *bssid  = WiFi.BSSID();
+
+    // Sorted by RSSI, so the first other AP of the network is the strongest
+    for (int i = 0; i < wifiSSIDCount; i++)
+    {
+      if (wifiSSIDs[i].SSID == ssid && memcmp(wifiSSIDs[i].BSSID, bssid, 6) != 0)
+      {
+        if (wifiSSIDs[i].RSSI >= _roamRSSI + ENCOMPASS_ROAM_HYSTERESIS)
+          roamTo(i);
+        else
+          LOGDEBUG3(F("Roaming: best other AP"), wifiSSIDs[i].RSSI, F("dBm, link"), _roamRSSI);
+
+        return;
+      }
+    }
+
+    LOGDEBUG(F("Roaming: no other AP of the network"));
+    return;
+  }
+
+  if (_roamRSSI >= _roamThreshold || (_roamAt && millis() - _roamAt < ENCOMPASS_ROAM_HOLDOFF_MS))
+    return;
+
+  // In the background, the link stays up while the radio looks around
+  _roamAt = millis();
+
+  if (WiFi.scanNetworks(true) == WIFI_SCAN_RUNNING)
+  {
+    LOGDEBUG1(F("Roaming: scanning, link RSSI ="), _roamRSSI);
+    _roamScanning = true;
+  }
+}
+
+void Encompass::roamTo(int best)
+{
+  WiFiResult  &ap         = wifiSSIDs[best];
+  bool        persistent  = WiFi.getPersistent();
+
+  LOGWARN3(F("Roaming: link"), _roamRSSI, F("dBm, moving to"), ap.RSSI);
+
+  // The pass the SDK has - the PSK, when connectWifi() gave it that
+  WiFi.persistent(false);
+  WiFi.begin(WiFi_SSID().c_str(), WiFi_Pass().c_str(), ap.channel, ap.BSSID);
+  WiFi.persistent(persistent);
+
+  _roamPending  = true;
+  _roamAt       = millis();
+}
+
+#endif
@@ -0,0 +1,276 @@
+/*
+  ImplRoutes.h
+  For ESP8266 boards
+
+  Request dispatch for the config portal. One catch-all handler looks the URL up in a perfect hash table
+  built at compile time from ENCOMPASS_ROUTES, both the table and the paths stay in flash.
+  Heavy routes go through admission control first: at most ENCOMPASS_MAX_HEAVY of them hold a rendered page at once.
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#pragma once
+
+#define ROUTE_MATCH(id, path, handler, flags)     (encompassRouteSlot(encompassRouteHash(path)) == slot) ? (uint8_t) id :
+#define ROUTE_IN_SLOT(id, path, handler, flags)   + ((encompassRouteSlot(encompassRouteHash(path)) == slot) ? 1 : 0)
+#define ROUTE_ENTRY(id, path, handler, flags)     { id##_PATH, &Encompass::routeThunk<&Encompass::handler>, flags },
+
+// Route id stored in a slot, ROUTE_NONE if empty
+constexpr uint8_t encompassRouteAt(uint8_t slot)
+{
+  return ENCOMPASS_ROUTES(ROUTE_MATCH) (uint8_t) ROUTE_NONE;
+}
+
+constexpr uint8_t encompassRoutesInSlot(uint8_t slot)
+{
+  return 0 ENCOMPASS_ROUTES(ROUTE_IN_SLOT);
+}
+
+constexpr bool encompassRoutesPerfect(uint8_t slot = 0)
+{
+  return (slot == ROUTE_SLOTS) || ((encompassRoutesInSlot(slot) <= 1) && encompassRoutesPerfect(slot + 1));
+}
+
+static_assert(encompassRoutesPerfect(), "Encompass route hash collision - change ENCOMPASS_ROUTE_SEED");
+static_assert(ROUTE_SLOTS == 32, "Encompass route slot table is written out for 32 slots");
+
+#define ROUTE_SLOTS_8(n)    encompassRouteAt(n),      encompassRouteAt(n + 1),  encompassRouteAt(n + 2),  encompassRouteAt(n + 3), \
+                            encompassRouteAt(n + 4),  encompassRouteAt(n + 5),  encompassRouteAt(n + 6),  encompassRouteAt(n + 7)
+
+const uint8_t Encompass::_routeSlots[ROUTE_SLOTS] PROGMEM =
+{
+  ROUTE_SLOTS_8(0), ROUTE_SLOTS_8(8), ROUTE_SLOTS_8(16), ROUTE_SLOTS_8(24)
+};
+
+const EncompassRouteEntry Encompass::_routeTable[ROUTE_COUNT] PROGMEM =
+{
+  ENCOMPASS_ROUTES(ROUTE_ENTRY)
+};
+
+bool EncompassRequestHandler::canHandle(AsyncWebServerRequest *request)
+{
+  return _wm->_portalOpen;
+}
+
+void EncompassRequestHandler::handleRequest(AsyncWebServerRequest *request)
+{
+  _wm->dispatch(request);
+}
+
+uint8_t Encompass::findRoute(const char *url, uint32_t hash)
+{
+  uint8_t id = pgm_read_byte(&_routeSlots[encompassRouteSlot(hash)]);
+
+  // One string compare to rule out a URL that only shares the slot
+  if (id != ROUTE_NONE && strcmp_P(url, (PGM_P) pgm_read_ptr(&_routeTable[id].path)) == 0)
+    return id;
+
+  return ROUTE_NONE;
+}
+
+bool Encompass::addRoute(const char *path, EncompassRoute fn, bool apOnly)
+{
+  if (_customRouteCount >= ENCOMPASS_MAX_CUSTOM_ROUTES)
+  {
+    LOGERROR1(F("No room for route"), path);
+    return false;
+  }
+
+  CustomRoute &route = _customRoutes[_customRouteCount++];
+
+  route.path    = path;
+  route.hash    = encompassRouteHash(path, path + strlen(path));
+  route.fn      = fn;
+  route.apOnly  = apOnly;
+
+  LOGINFO1(F("Added route"), path);
+
+  return true;
+}
+
+void Encompass::dispatch(AsyncWebServerRequest *request)
+{
+  EncompassOp op(_ops, OP_REQUEST);
+  uint32_t    start = micros();
+  uint8_t     slot  = route(request);
+
+  _metrics.observeRoute(slot, micros() - start);
+  op.setRoute(slot);
+}
+
+uint8_t Encompass::route(AsyncWebServerRequest *request)
+{
+  const char  *url  = request->url().c_str();
+  uint32_t    hash  = encompassRouteHash(url, url + request->url().length());
+
+  // Sketch routes first, so they can also take over a built-in URI
+  for (uint8_t i = 0; i < _customRouteCount; i++)
+  {
+    if (_customRoutes[i].hash == hash && strcmp(_customRoutes[i].path, url) == 0)
+    {
+      if (!_customRoutes[i].apOnly || ON_AP_FILTER(request))
+      {
+        _customRoutes[i].fn(this, request);
+        return METRIC_ROUTE_CUSTOM;
+      }
+
+      break;
+    }
+  }
+
+  uint8_t id = findRoute(url, hash);
+
+  if (id != ROUTE_NONE)
+  {
+    EncompassRouteEntry entry;
+
+    memcpy_P(&entry, &_routeTable[id], sizeof(entry));
+
+    if (!(entry.flags & ROUTE_FLAG_AP) || ON_AP_FILTER(request))
+    {
+      // Queued or refused, nothing was rendered to time
+      if ((entry.flags & ROUTE_FLAG_HEAVY) && !admit(request))
+        return ROUTE_NONE;
+
+      entry.fn(this, request);
+      return id;
+    }
+  }
+
+  handleNotFound(request);
+
+  return METRIC_ROUTE_OTHER;
+}
+
+bool Encompass::admit(AsyncWebServerRequest *request)
+{
+  if (request == _admitting)
+    return true;
+
+  uint8_t limit = heavyLimit();
+
+  // Nothing heavy renders with a critical heap, waiting in the queue would not change that
+  if (limit == 0)
+  {
+    _metrics.observeDegraded(DEGRADE_REFUSED);
+    _metrics.observeAdmission(ADMISSION_REJECTED);
+    sendRetryLater(request);
+    return false;
+  }
+
+  // Behind the ones already waiting, even when a slot is free this instant
+  if (_heavyInFlight < limit && _admissionCount == 0)
+  {
+    startHeavy(request);
+    return true;
+  }
+
+  if (_admissionCount >= ENCOMPASS_ADMISSION_QUEUE)
+  {
+    _metrics.observeAdmission(ADMISSION_REJECTED);
+    sendRetryLater(request);
+    return false;
+  }
+
+  QueuedRequest &queued = _admissionQueue[(_admissionHead + _admissionCount++) % ENCOMPASS_ADMISSION_QUEUE];
+
+  queued.request  = request;
+  queued.sinceMs  = millis();
+
+  _metrics.observeAdmission(ADMISSION_QUEUED);
+
+  request->onDisconnect([this, request]()
+  {
+    for (uint8_t i = 0; i < _admissionCount; i++)
+    {
+      QueuedRequest &q = _admissionQueue[(_admissionHead + i) % ENCOMPASS_ADMISSION_QUEUE];
+
+      if (q.request == request)
+      {
+        q.request = NULL;
+        _metrics.observeAdmission(ADMISSION_ABANDONED);
+      }
+    }
+  });
+
+  return false;
+}
+
+// Heavy pages cost KBs of heap each, a captive probe's redirect next to none - so under pressure the heavy pages give way
+// first and the probes are only shed once the heap is critical
+uint8_t Encompass::heavyLimit()
+{
+  switch (getMemoryPressure())
+  {
+    case PRESSURE_NONE:
+      return _maxHeavy;
+
+    case PRESSURE_LOW:
+      return (_maxHeavy + 1) / 2;
+
+    case PRESSURE_HIGH:
+      return 1;
+  }
+
+  return 0;
+}
+
+// Holds a slot until the response has gone out and the connection is closed
+void Encompass::startHeavy(AsyncWebServerRequest *request)
+{
+  _heavyInFlight++;
+  _metrics.observeAdmission(ADMISSION_ADMITTED);
+
+  request->onDisconnect([this]()
+  {
+    endHeavy();
+  });
+}
+
+// A handler that needs the disconnect callback of a heavy request itself calls this from it
+void Encompass::endHeavy()
+{
+  if (_heavyInFlight)
+    _heavyInFlight--;
+
+  // The next one in the queue goes on the next loop(), not the next poll
+  if (_admissionCount)
+    _scheduler.trigger(TASK_ADMISSION);
+}
+
+void Encompass::processAdmission()
+{
+  while (_admissionCount)
+  {
+    QueuedRequest queued  = _admissionQueue[_admissionHead];
+    uint8_t       limit   = heavyLimit();
+
+    // Waits for a slot, unless there is none to wait for at this pressure
+    if (queued.request && limit && _heavyInFlight >= limit && millis() - queued.sinceMs < ENCOMPASS_ADMISSION_WAIT_MS)
+      return;
+
+    // Off the queue before anything is sent, a response can close the connection on the spot
+    _admissionHead = (_admissionHead + 1) % ENCOMPASS_ADMISSION_QUEUE;
+    _admissionCount--;
+
+    if (queued.request == NULL)
+      continue;
+
+    queued.request->onDisconnect(NULL);
+
+    if (_heavyInFlight >= limit)
+    {
+      _metrics.observeAdmission(ADMISSION_EXPIRED);
+      sendRetryLater(queued.request);
+      continue;
+    }
+
+    startHeavy(queued.request);
+
+    _admitting = queued.request;
+    dispatch(queued.request);
+    _admitting = NULL;
+  }
+}
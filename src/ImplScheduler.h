@@ -0,0 +1,281 @@
+/*
+  ImplScheduler.h
+  For ESP8266 boards
+
+  Cooperative scheduler for the portal's periodic work and the sketch's own tasks, see EncompassScheduler.cls.
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#pragma once
+
+static_assert(ENCOMPASS_MAX_TASKS >= TASK_LIBRARY && ENCOMPASS_MAX_TASKS <= 127, "ENCOMPASS_MAX_TASKS must hold the library's tasks");
+
+EncompassScheduler::EncompassScheduler() : tickBudgetUs(ENCOMPASS_TICK_BUDGET_US), ticks(0), tickOverruns(0), _count(0)
+{
+  memset(_tasks, 0, sizeof(_tasks));
+  memset(_order, 0, sizeof(_order));
+}
+
+int8_t EncompassScheduler::add(const char *name, EncompassTaskFn fn, void *arg, uint32_t periodMs, uint8_t priority,
+                               uint32_t budgetUs)
+{
+  if (_count >= ENCOMPASS_MAX_TASKS || fn == NULL)
+    return TASK_NONE;
+
+  int8_t        id  = _count++;
+  EncompassTask &t  = _tasks[id];
+
+  t.name      = name;
+  t.fn        = fn;
+  t.arg       = arg;
+  t.periodMs  = periodMs;
+  t.budgetUs  = budgetUs;
+  t.priority  = priority;
+  t.enabled   = true;
+  t.nextMs    = millis() + periodMs;
+
+  // Insertion sort, after any of the same priority
+  uint8_t at = id;
+
+  while (at > 0 && _tasks[_order[at - 1]].priority > priority)
+  {
+    _order[at] = _order[at - 1];
+    at--;
+  }
+
+  _order[at] = id;
+
+  return id;
+}
+
+bool EncompassScheduler::setPeriod(int8_t id, uint32_t periodMs)
+{
+  if (id < 0 || id >= _count)
+    return false;
+
+  _tasks[id].periodMs = periodMs;
+  _tasks[id].nextMs   = millis() + periodMs;
+
+  return true;
+}
+
+bool EncompassScheduler::enable(int8_t id, bool enabled)
+{
+  if (id < 0 || id >= _count)
+    return false;
+
+  // Back from disabled, a full period from now rather than every run it missed at once
+  if (enabled && !_tasks[id].enabled)
+    _tasks[id].nextMs = millis() + _tasks[id].periodMs;
+
+  _tasks[id].enabled = enabled;
+
+  return true;
+}
+
+void EncompassScheduler::trigger(int8_t id)
+{
+  if (id >= 0 && id < _count)
+    _tasks[id].triggered = true;
+}
+
+const EncompassTask* EncompassScheduler::task(int8_t id)
+{
+  return (id >= 0 && id < _count) ? &_tasks[id] : NULL;
+}
+
+bool EncompassScheduler::isDue(const EncompassTask &t, uint32_t now)
+{
+  if (!t.enabled)
+    return false;
+
+  return t.triggered || (t.periodMs && (int32_t) (now - t.nextMs) >= 0);
+}
+
+uint8_t EncompassScheduler::run()
+{
+  uint32_t  now     = millis();
+  uint32_t  startUs = micros();
+  uint8_t   ran     = 0;
+
+  ticks++;
+
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    EncompassTask &t = _tasks[_order[i]];
+
+    if (!isDue(t, now))
+      continue;
+
+    // The first due task always runs, so a tick that is all overrun still gets somewhere
+    if (ran && micros() - startUs >= tickBudgetUs)
+    {
+      t.deferred++;
+      continue;
+    }
+
+    uint32_t late = (!t.triggered && t.periodMs) ? now - t.nextMs : 0;
+
+    if (late > t.lateMaxMs)
+      t.lateMaxMs = late;
+
+    // Next period counted from the due time, or from now when a trigger or a long stall moved it
+    if (t.triggered || (int32_t) (now - t.nextMs) >= (int32_t) t.periodMs)
+      t.nextMs = now + t.periodMs;
+    else
+      t.nextMs += t.periodMs;
+
+    t.triggered = false;
+
+    uint32_t taskStartUs = micros();
+
+    t.fn(t.arg);
+
+    uint32_t us = micros() - taskStartUs;
+
+    t.runs++;
+
+    if (us > t.maxUs)
+      t.maxUs = us;
+
+    if (t.budgetUs && us > t.budgetUs)
+      t.overruns++;
+
+    ran++;
+  }
+
+  if (micros() - startUs > tickBudgetUs)
+    tickOverruns++;
+
+  return ran;
+}
+
+uint32_t EncompassScheduler::nextDeadline()
+{
+  uint32_t now  = millis();
+  uint32_t next = UINT32_MAX;
+
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    const EncompassTask &t = _tasks[i];
+
+    if (!t.enabled)
+      continue;
+
+    if (isDue(t, now))
+      return 0;
+
+    if (t.periodMs && t.nextMs - now < next)
+      next = t.nextMs - now;
+  }
+
+  return next;
+}
+
+void EncompassScheduler::printTo(Print &out)
+{
+  char line[96];
+
+  out.println(F("task         prio  period ms   runs  overruns  deferred   max us  late ms"));
+
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    const EncompassTask &t = _tasks[_order[i]];
+
+    snprintf(line, sizeof(line), "%-12.12s %4u %10lu %6lu %9lu %9lu %8lu %8lu%s", t.name ? t.name : "?", t.priority,
+             (unsigned long) t.periodMs, (unsigned long) t.runs, (unsigned long) t.overruns,
+             (unsigned long) t.deferred, (unsigned long) t.maxUs, (unsigned long) t.lateMaxMs,
+             t.enabled ? "" : " (off)");
+
+    out.println(line);
+  }
+
+  snprintf(line, sizeof(line), "ticks %lu, over the %lu us tick budget %lu", (unsigned long) ticks,
+           (unsigned long) tickBudgetUs, (unsigned long) tickOverruns);
+
+  out.println(line);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The library's tasks, in E_Task order
+
+void Encompass::addLibraryTasks()
+{
+  _scheduler.add("dns",       [](void *wm) { ((Encompass *) wm)->processDNS(); },       this, ENCOMPASS_POLL_MS, 0,
+                 ENCOMPASS_DNS_BUDGET_US);
+  _scheduler.add("admission", [](void *wm) { ((Encompass *) wm)->processAdmission(); }, this, ENCOMPASS_POLL_MS, 10);
+  _scheduler.add("jobs",      [](void *wm) { ((Encompass *) wm)->processJobs(); },      this, ENCOMPASS_POLL_MS, 20);
+  _scheduler.add("connect",   [](void *wm) { ((Encompass *) wm)->modelessConnect(); },  this, 0, 30);
+  _scheduler.add("scan",      [](void *wm) { ((Encompass *) wm)->modelessScan(); },     this, TIME_BETWEEN_MODELESS_SCANS, 40);
+
+#if ENCOMPASS_PRECOMPUTE_PSK
+  _scheduler.add("psk",       [](void *wm) { ((Encompass *) wm)->processPSK(); },       this, 0, 25);
+#endif
+
+#if ENCOMPASS_EVENTS
+  _scheduler.add("events",    [](void *wm) { ((Encompass *) wm)->processEvents(); },    this, ENCOMPASS_EVENT_POLL_MS, 50);
+#endif
+
+#if ENCOMPASS_PROVISIONING
+  _scheduler.add("provision", [](void *wm) { ((Encompass *) wm)->processProvisioning(); }, this, ENCOMPASS_POLL_MS, 15);
+#endif
+
+#if ENCOMPASS_ROAMING
+  _scheduler.add("roam",      [](void *wm) { ((Encompass *) wm)->processRoaming(); },   this, ENCOMPASS_ROAM_SAMPLE_MS, 60);
+#endif
+
+#if ENCOMPASS_TIME
+  _scheduler.add("time",      [](void *wm) { ((Encompass *) wm)->processTime(); },      this, ENCOMPASS_POLL_MS, 70);
+#endif
+
+#if ENCOMPASS_ASYNC_LOG
+  // Only what the debug port can take without blocking
+  _scheduler.add("log",       [](void *) { EncompassLog::drain(DBG_PORT, ENCOMPASS_LOG_DRAIN_US); }, this,
+                 ENCOMPASS_POLL_MS, 255, ENCOMPASS_LOG_DRAIN_US);
+#endif
+}
+
+int8_t Encompass::addTask(const char *name, EncompassTaskFn fn, void *arg, uint32_t periodMs, uint8_t priority,
+                          uint32_t budgetUs)
+{
+  int8_t id = _scheduler.add(name, fn, arg, periodMs, priority, budgetUs);
+
+  if (id == TASK_NONE)
+    LOGERROR1(F("No room for task"), name);
+
+  return id;
+}
+
+bool Encompass::setTaskPeriod(int8_t id, uint32_t periodMs)
+{
+  return _scheduler.setPeriod(id, periodMs);
+}
+
+bool Encompass::enableTask(int8_t id, bool enabled)
+{
+  return _scheduler.enable(id, enabled);
+}
+
+void Encompass::triggerTask(int8_t id)
+{
+  _scheduler.trigger(id);
+}
+
+uint32_t Encompass::nextDeadline()
+{
+  return _scheduler.nextDeadline();
+}
+
+void Encompass::setTickBudget(uint32_t us)
+{
+  _scheduler.tickBudgetUs = us;
+}
+
+void Encompass::printTasks(Print &out)
+{
+  _scheduler.printTo(out);
+}
@@ -0,0 +1,334 @@
+/*
+  ImplTime.h
+  For ESP8266 boards
+
+  Time service. processTime() asks an SNTP server once the station is connected and never waits for the answer - the
+  request goes out on one run, later runs pick the reply up, a lost one is tried again with a growing delay. Answers
+  correct an EncompassClock, which slews rather than steps, and the time goes to RTC memory every few seconds with the
+  RTC counter reading it was taken at. The RTC counter keeps running through a deep sleep and a software reset, so a
+  restored time is good from the constructor on, before the station has even started to connect.
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#pragma once
+
+#if ENCOMPASS_TIME
+
+#define TIME_RECORD_MAGIC       0x454E5431      // "ENT1"
+
+// What RTC memory keeps
+struct TimeRecord
+{
+  uint32_t  magic;
+  uint32_t  rtcTicks;                           // RTC counter when unixUs was read
+  uint32_t  rtcPeriod;                          // us per RTC tick then, Q12
+  int32_t   drift;
+  int64_t   unixUs;
+  uint32_t  check;
+  uint32_t  reserved;
+};
+
+void Encompass::setTimeServer(const char *server, uint16_t port)
+{
+  _ntpServer    = server ? server : "";
+  _ntpPort      = port;
+  _ntpIP        = IPAddress();
+  _ntpResolving = false;
+  _ntpRetryMs   = ENCOMPASS_NTP_RETRY_MS;
+  _ntpNextAt    = millis();
+
+  if (_ntpWaiting)
+  {
+    _ntpUdp.stop();
+    _ntpWaiting = false;
+  }
+}
+
+int64_t Encompass::getTimeUs()
+{
+  return _clock.at(micros64());
+}
+
+void Encompass::saveTime()
+{
+  if (!_clock.valid())
+    return;
+
+  TimeRecord record;
+
+  memset(&record, 0, sizeof(record));
+
+  record.magic      = TIME_RECORD_MAGIC;
+  record.rtcTicks   = system_get_rtc_time();
+  record.rtcPeriod  = system_rtc_clock_cali_proc();
+  record.drift      = _clock.drift();
+  record.unixUs     = _clock.at(micros64());
+  record.check      = encompassRecordCheck(record);
+
+  ESP.rtcUserMemoryWrite(ENCOMPASS_TIME_RTC_BLOCK, (uint32_t *) &record, sizeof(record));
+
+  _timeSavedAt = millis();
+}
+
+// From the constructor
+void Encompass::restoreTime()
+{
+  TimeRecord record;
+
+  if (!ESP.rtcUserMemoryRead(ENCOMPASS_TIME_RTC_BLOCK, (uint32_t *) &record, sizeof(record)) ||
+      record.magic != TIME_RECORD_MAGIC || record.check != encompassRecordCheck(record))
+    return;
+
+  uint32_t  reason  = ESP.getResetInfoPtr()->reason;
+  uint64_t  mono    = micros64();
+  int64_t   unixUs  = record.unixUs;
+
+  if (reason == REASON_DEFAULT_RST)
+    return;
+
+  if (reason == REASON_EXT_SYS_RST)
+  {
+    // The reset pin stops the RTC counter too - only the time since this boot is known, which leaves out up to
+    // ENCOMPASS_TIME_SAVE_MS before the reset and however long the pin was held
+    unixUs += mono;
+  }
+  else
+  {
+    uint32_t ticks = system_get_rtc_time() - record.rtcTicks;
+
+    unixUs += (int64_t) (((uint64_t) ticks * record.rtcPeriod) >> 12);
+  }
+
+  _clock.set(mono, unixUs, record.drift);
+  _timeSource = TIME_SAVED;
+
+  LOGWARN1(F("Time restored, reset reason ="), reason);
+}
+
+// Every ENCOMPASS_POLL_MS from the scheduler
+void Encompass::processTime()
+{
+  if (_clock.valid() && millis() - _timeSavedAt >= ENCOMPASS_TIME_SAVE_MS)
+    saveTime();
+
+  if (_ntpServer.length() == 0)
+    return;
+
+  if (WiFi.status() != WL_CONNECTED)
+  {
+    if (_ntpWaiting)
+    {
+      _ntpUdp.stop();
+      _ntpWaiting = false;
+    }
+
+    _ntpLinked    = false;
+    _ntpResolving = false;
+    return;
+  }
+
+  if (!_ntpLinked)
+  {
+    _ntpLinked = true;
+
+    // A new link asks at once, unless this boot has had an answer already
+    if (_timeSource != TIME_SNTP)
+    {
+      _ntpNextAt  = millis();
+      _ntpRetryMs = ENCOMPASS_NTP_RETRY_MS;
+    }
+  }
+
+  if (_ntpWaiting)
+    receiveTime();
+  else if ((long) (millis() - _ntpNextAt) >= 0)
+    sendTimeRequest();
+}
+
+// lwIP's answer to resolveTimeServer(), from its own context - only kept for the next run
+void Encompass::timeServerFound(const char *name, const ip_addr_t *ipaddr, void *arg)
+{
+  Encompass *wm = (Encompass *) arg;
+
+  // For a server setTimeServer() has replaced since
+  if (strcmp(name, wm->_ntpServer.c_str()) != 0)
+    return;
+
+  wm->_ntpFound     = ipaddr ? ip_addr_get_ip4_u32(ipaddr) : 0;
+  wm->_ntpAnswered  = true;
+}
+
+// The server's address without holding up loop(): lwIP looks a name up in the background (giving up after its own
+// retries) and processTime() checks back every run. True once _ntpIP is set.
+bool Encompass::resolveTimeServer()
+{
+  if (_ntpIP.fromString(_ntpServer))
+    return true;
+
+  if (!_ntpResolving)
+  {
+    ip_addr_t addr;
+
+    _ntpAnswered  = false;
+    _ntpResolving = true;
+
+    err_t err = dns_gethostbyname(_ntpServer.c_str(), &addr, &Encompass::timeServerFound, this);
+
+    if (err == ERR_INPROGRESS)
+      return false;
+
+    _ntpResolving = false;
+
+    // Cached, or a name lwIP cannot ask for
+    if (err != ERR_OK)
+    {
+      timeRequestFailed(F("no address"));
+      return false;
+    }
+
+    _ntpIP = IPAddress(ip_addr_get_ip4_u32(&addr));
+    return true;
+  }
+
+  if (!_ntpAnswered)
+    return false;
+
+  _ntpResolving = false;
+  _ntpIP        = IPAddress((uint32_t) _ntpFound);
+
+  if ((uint32_t) _ntpIP == 0)
+  {
+    timeRequestFailed(F("no address"));
+    return false;
+  }
+
+  return true;
+}
+
+void Encompass::sendTimeRequest()
+{
+  // Once, and again only after a failure
+  if ((uint32_t) _ntpIP == 0 && !resolveTimeServer())
+    return;
+
+  // Port 0, whatever port is free
+  if (_ntpUdp.begin(0) != 1)
+  {
+    timeRequestFailed(F("no socket"));
+    return;
+  }
+
+  uint8_t packet[SNTP_PACKET_SIZE];
+  uint32_t now = micros();
+
+  memcpy(_ntpNonce, &now, 4);
+
+  for (uint8_t i = 4; i < sizeof(_ntpNonce); i++)
+    _ntpNonce[i] = random(256);
+
+  EncompassClock::sntpRequest(packet, _ntpNonce);
+
+  _ntpSentUs = micros64();
+
+  if (!_ntpUdp.beginPacket(_ntpIP, _ntpPort) || _ntpUdp.write(packet, SNTP_PACKET_SIZE) != SNTP_PACKET_SIZE ||
+      !_ntpUdp.endPacket())
+  {
+    timeRequestFailed(F("send"));
+    return;
+  }
+
+  _ntpWaiting = true;
+}
+
+void Encompass::receiveTime()
+{
+  uint64_t  arrived  = 0;
+  uint8_t   packet[SNTP_PACKET_SIZE];
+  int64_t   received;
+  int64_t   transmitted;
+  bool      answered = false;
+
+  // Anything else that turns up on the port - another peer's datagram, an answer to an earlier request - is dropped
+  // and the wait goes on, only the timeout fails the request
+  for (uint8_t n = 0; n < 4 && !answered; n++)
+  {
+    int len = _ntpUdp.parsePacket();
+
+    if (len <= 0)
+      break;
+
+    // Taken before anything else, it stands for the moment the answer arrived
+    arrived = micros64();
+
+    if ((uint32_t) _ntpUdp.remoteIP() != (uint32_t) _ntpIP || _ntpUdp.read(packet, SNTP_PACKET_SIZE) != SNTP_PACKET_SIZE ||
+        !EncompassClock::sntpReply(packet, len, _ntpNonce, received, transmitted))
+    {
+      LOGDEBUG1(F("SNTP: dropped from"), _ntpUdp.remoteIP());
+      continue;
+    }
+
+    answered = true;
+  }
+
+  if (!answered)
+  {
+    if (micros64() - _ntpSentUs > ENCOMPASS_NTP_TIMEOUT_MS * 1000ULL)
+      timeRequestFailed(F("no answer"));
+
+    return;
+  }
+
+  _ntpUdp.stop();
+  _ntpWaiting = false;
+
+  // The server's time on arrival - its transmit time, plus half the round trip it did not spend itself
+  int64_t roundTrip = (int64_t) (arrived - _ntpSentUs) - (transmitted - received);
+
+  if (roundTrip < 0)
+    roundTrip = 0;
+
+  int64_t offset = _clock.correct(arrived, transmitted + roundTrip / 2);
+
+  _timeOffsetUs = (int32_t) std::max<int64_t>(std::min<int64_t>(offset, INT32_MAX), INT32_MIN);
+  _timeSource   = TIME_SNTP;
+  _ntpRetryMs   = ENCOMPASS_NTP_RETRY_MS;
+  _ntpNextAt    = millis() + ENCOMPASS_NTP_INTERVAL_MS;
+
+  _metrics.ntpSyncs++;
+  saveTime();
+
+  LOGWARN3(F("SNTP offset us ="), (long) offset, F(", round trip us ="), (long) roundTrip);
+}
+
+void Encompass::timeRequestFailed(const __FlashStringHelper *why)
+{
+  // Only read by the log, which may be compiled out
+  (void) why;
+
+  LOGWARN3(F("SNTP failed:"), why, F(", again in ms ="), _ntpRetryMs);
+
+  _ntpUdp.stop();
+  _ntpWaiting = false;
+  _ntpIP      = IPAddress();
+  _ntpNextAt  = millis() + _ntpRetryMs;
+  _ntpRetryMs = std::min<uint32_t>(_ntpRetryMs * 2, ENCOMPASS_NTP_INTERVAL_MS);
+
+  _metrics.ntpFailures++;
+}
+
+// 2020-12-13T09:30:00.123Z
+void Encompass::formatTime(int64_t unixUs, char out[25])
+{
+  time_t    seconds = (time_t) (unixUs / 1000000);
+  struct tm utc;
+
+  gmtime_r(&seconds, &utc);
+
+  strftime(out, 20, "%Y-%m-%dT%H:%M:%S", &utc);
+  snprintf(&out[19], 6, ".%03uZ", (unsigned) ((uint64_t) unixUs / 1000 % 1000));
+}
+
+#endif
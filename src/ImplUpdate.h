@@ -0,0 +1,277 @@
+/*
+  ImplUpdate.h
+  For ESP8266 boards
+
+  Firmware update on /update. The image goes into the updater chunk by chunk as the TCP callbacks hand it over, the
+  updater writes a flash sector whenever it has one, and a SHA-256 runs alongside - nothing holds the whole body. The
+  image is only staged once the hash matches the one sent with it, then a restart job boots it. Nothing is written
+  before the request has passed the credentials set with setUpdateCredentials(), and only the first file part of a
+  form is taken.
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#pragma once
+
+#if ENCOMPASS_UPDATE
+
+void EncompassRequestHandler::handleUpload(AsyncWebServerRequest *request, const String &, size_t index,
+                                           uint8_t *data, size_t len, bool final)
+{
+  _wm->updateData(request, index, data, len, final);
+}
+
+void EncompassRequestHandler::handleBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index,
+                                         size_t total)
+{
+  _wm->updateData(request, index, data, len, index + len >= total);
+}
+
+void Encompass::setUpdateCredentials(const char *user, const char *pass)
+{
+  _updateUser = user ? user : "";
+  _updatePass = pass ? pass : "";
+}
+
+// No credentials set means no updates at all
+bool Encompass::updateAuthorized(AsyncWebServerRequest *request)
+{
+  return _updateUser.length() && request->authenticate(_updateUser.c_str(), _updatePass.c_str());
+}
+
+// Runs in the TCP callback context, the first chunk claims the updater. final: the last chunk of the part (or body).
+void Encompass::updateData(AsyncWebServerRequest *request, size_t index, uint8_t *data, size_t len, bool final)
+{
+  if (request->method() != HTTP_POST || strcmp_P(request->url().c_str(), ROUTE_UPDATE_PATH) != 0 || !ON_AP_FILTER(request))
+    return;
+
+  if (index == 0)
+  {
+    // Ignored, handleUpdate() answers it once the body is in
+    if (!updateAuthorized(request))
+      return;
+
+    if (_updateOwner)
+    {
+      // The first upload keeps the updater, this one is only marked refused - the library takes one answer per
+      // request, handleUpdate() gives it once the body is in. The request frees its _tempObject.
+      if (_updateOwner != request && request->_tempObject == NULL)
+        request->_tempObject = malloc(1);
+
+      return;
+    }
+
+    _updateOwner      = request;
+    _updateWritten    = 0;
+    // A form's length is the whole body, not the image in it - 0 reports the size as unknown
+    _updateTotal      = request->multipart() ? 0 : request->contentLength();
+    _updateState      = UPDATE_WRITING;
+    _updatePartEnded  = false;
+    _updateHash.begin();
+
+    request->onDisconnect([this, request]()
+    {
+      if (_updateOwner != request)
+        return;
+
+      _updateOwner = NULL;
+
+      if (_updateState == UPDATE_WRITING)
+        updateFailed(F("upload cut off"));
+    });
+
+    // A form's body is larger than the image in it, take all the room there is and end() at what was written
+    uint32_t size = request->multipart() ? (ESP.getFreeSketchSpace() - 0x1000) & 0xFFFFF000 : request->contentLength();
+
+    LOGWARN1(F("Update started, body bytes ="), request->contentLength());
+
+    Update.runAsync(true);
+
+    if (!Update.begin(size))
+      updateFailed(F("no room"));
+
+#if ENCOMPASS_EVENTS
+    _scheduler.trigger(TASK_EVENTS);
+#endif
+  }
+
+  // A second file part starts at index 0 again and is turned away above, its later chunks here
+  if (_updateOwner != request || _updateState != UPDATE_WRITING || _updatePartEnded)
+    return;
+
+  _updatePartEnded = final;
+
+  if (len == 0)
+    return;
+
+  _updateHash.update(data, len);
+
+  if (Update.write(data, len) != len)
+  {
+    updateFailed(F("write"));
+    return;
+  }
+
+  _updateWritten = _updateWritten + len;
+}
+
+void Encompass::updateFailed(const __FlashStringHelper *why)
+{
+  // Only read by the log, which may be compiled out
+  (void) why;
+
+  LOGERROR2(F("Update failed:"), why, Update.getErrorString());
+
+  _updateState = UPDATE_FAILED;
+
+  // Drops whatever has been written, the running firmware stays
+  Update.end();
+
+#if ENCOMPASS_EVENTS
+  _scheduler.trigger(TASK_EVENTS);
+#endif
+}
+
+// {"status":"done","written":N,"sha256":"..."} or {"status":"failed","error":"..."}
+void Encompass::sendUpdateResult(AsyncWebServerRequest *request, int code, const String &error, const char *sha256,
+                                 uint16_t jobId)
+{
+  AsyncResponseStream *response = request->beginResponseStream(FPSTR(HTTP_HEAD_JSON));
+  setNoCacheHeaders(response);
+  response->setCode(code);
+
+  if (jobId)
+    response->addHeader(FPSTR(HTTP_JOB), String(jobId));
+
+  if (code == 200)
+  {
+    response->print(F("{\"status\":\"done\",\"written\":"));
+    response->print(_updateWritten);
+    response->print(F(",\"sha256\":\""));
+    response->print(sha256);
+    response->print(F("\"}"));
+  }
+  else
+  {
+    response->print(F("{\"status\":\"failed\",\"error\":"));
+    printJSONString(*response, error.c_str());
+    response->print(F("}"));
+  }
+
+  request->send(response);
+}
+
+// Handle the update page
+// GET - the upload form. POST - the end of an upload, the image is staged when its SHA-256 matches the sha256 argument.
+void Encompass::handleUpdate(AsyncWebServerRequest *request)
+{
+  if (!updateAuthorized(request))
+  {
+    if (_updateUser.length())
+      request->requestAuthentication();
+    else
+      sendUpdateResult(request, 403, F("Updates are off, no credentials set"), NULL);
+
+    return;
+  }
+
+  if (request->method() != HTTP_POST)
+  {
+    String page = FPSTR(HTML_HEAD_START);
+    page.replace("{v}", "Update");
+    page += FPSTR(HTML_SCRIPT);
+    page += FPSTR(HTML_STYLE);
+    page += _customHeadElement;
+#if ENCOMPASS_EVENTS
+    page += FPSTR(HTML_SCRIPT_UPDATE);
+#endif
+    page += FPSTR(HTML_HEAD_CLOSE);
+    page += F("<h2>Firmware Update</h2>");
+    page += FPSTR(HTML_UPDATE_FORM);
+    page += FPSTR(HTML_CLOSE);
+
+    AsyncWebServerResponse *response = request->beginResponse(200, FPSTR(HTTP_HEAD_CT), page);
+    setNoCacheHeaders(response);
+    request->send(response);
+
+    return;
+  }
+
+  // Refused in updateData() behind another upload, or it had no firmware in it
+  if (_updateOwner != request)
+  {
+    bool refused = _updateOwner || request->_tempObject;
+
+    sendUpdateResult(request, refused ? 409 : 400,
+                     refused ? F("Another update is in progress") : F("No firmware in the request"), NULL);
+    return;
+  }
+
+  _updateOwner = NULL;
+
+  uint8_t digest[SHA256_DIGEST_SIZE];
+  char    hex[2 * SHA256_DIGEST_SIZE + 1];
+
+  _updateHash.finish(digest);
+
+  for (uint8_t i = 0; i < SHA256_DIGEST_SIZE; i++)
+    snprintf(&hex[2 * i], 3, "%02x", digest[i]);
+
+  if (_updateState != UPDATE_WRITING)
+  {
+    sendUpdateResult(request, 500, Update.getErrorString(), NULL);
+    return;
+  }
+
+  String expected = request->arg("sha256");
+
+  expected.trim();
+  expected.toLowerCase();
+
+  if (expected != hex)
+  {
+    // The updater only stages an image in end() - an MD5 nothing can match makes it drop this one instead
+    Update.setMD5("00000000000000000000000000000000");
+    Update.end(true);
+
+    _updateState = UPDATE_FAILED;
+
+#if ENCOMPASS_EVENTS
+    _scheduler.trigger(TASK_EVENTS);
+#endif
+
+    LOGERROR1(F("Update refused, SHA-256 ="), hex);
+
+    sendUpdateResult(request, 400, expected.length() ? F("SHA-256 mismatch") : F("No sha256 given"), NULL);
+    return;
+  }
+
+  if (!Update.end(true))
+  {
+    updateFailed(F("end"));
+    sendUpdateResult(request, 500, Update.getErrorString(), NULL);
+    return;
+  }
+
+  _updateState = UPDATE_DONE;
+
+#if ENCOMPASS_EVENTS
+  _scheduler.trigger(TASK_EVENTS);
+#endif
+
+  LOGWARN1(F("Update staged, bytes ="), _updateWritten);
+
+  // The new firmware boots with the restart, once this answer is out
+  uint16_t jobId = 0;
+
+  if (_jobs.reserve(JOB_RESTART))
+    jobId = _jobs.commit();
+  else
+    LOGERROR(F("No room for the restart job, the update applies with the next one"));
+
+  sendUpdateResult(request, 200, String(), hex, jobId);
+}
+
+#endif
@@ -0,0 +1,143 @@
+/*
+  test_clock.cpp
+  Host (Linux) build
+
+  Tests for EncompassClock.h: the clock slews without running backwards, steps over a large difference and learns a
+  counter's drift; SNTP replies are read right in both NTP eras and only taken for the request that was sent. A clock
+  that ran backwards would reorder the time service's timestamps, a misread era would put every device in 1900.
+
+    pio test -e test
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#include "EncompassClock.h"
+
+#include <unity.h>
+
+// 2020-09-13 12:26:40
+static const int64_t  base     = 1600000000LL * 1000000;
+static const uint8_t  nonce[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+
+// A server reply to the request carrying nonce, both server timestamps set to the NTP time given
+static void sntpPacket(uint8_t packet[SNTP_PACKET_SIZE], const char *ntp)
+{
+  memset(packet, 0, SNTP_PACKET_SIZE);
+
+  packet[0] = 0x24;
+  packet[1] = 2;
+
+  memcpy(&packet[24], nonce, 8);
+  memcpy(&packet[32], ntp, 8);
+  memcpy(&packet[40], ntp, 8);
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+// 200 ms behind, paid off at 5 ms/s - never backwards, all of it caught up 40 s later
+void test_clock_slew()
+{
+  EncompassClock clock(5000, 1000000);
+
+  clock.correct(0, base);
+
+  int64_t error = clock.correct(10000000, base + 10000000 - 200000);
+  int64_t last  = 0;
+
+  TEST_ASSERT_EQUAL_INT64(-200000, error);
+
+  for (uint64_t mono = 10000000; mono <= 60000000; mono += 1000)
+  {
+    int64_t now = clock.at(mono);
+
+    TEST_ASSERT_TRUE_MESSAGE(now >= last, "clock went back");
+
+    last = now;
+  }
+
+  TEST_ASSERT_EQUAL_INT64(base + 60000000 - 200000, clock.at(60000000));
+}
+
+// 5 s off is past stepUs, the clock is set outright
+void test_clock_step()
+{
+  EncompassClock clock(5000, 1000000);
+
+  clock.correct(0, base);
+  clock.correct(10000000, base + 15000000);
+
+  TEST_ASSERT_EQUAL_INT64(base + 15000000, clock.at(10000000));
+}
+
+// A counter 100 ppm slow, measured every 10 minutes for 2 hours
+void test_clock_drift()
+{
+  EncompassClock clock(5000, 1000000);
+
+  for (int64_t mono = 0; mono <= 7200000000LL; mono += 600000000)
+    clock.correct(mono, base + mono + mono / 10000);
+
+  TEST_ASSERT_INT_WITHIN(10000, 100000, clock.drift());
+}
+
+// 2036-02-07 06:28:16.5, seconds 0 of era 1
+void test_sntp_era1()
+{
+  uint8_t packet[SNTP_PACKET_SIZE];
+  int64_t received;
+  int64_t transmitted;
+
+  sntpPacket(packet, "\x00\x00\x00\x00\x80\x00\x00\x00");
+
+  TEST_ASSERT_TRUE(EncompassClock::sntpReply(packet, sizeof(packet), nonce, received, transmitted));
+  TEST_ASSERT_EQUAL_INT64(2085978496LL * 1000000 + 500000, transmitted);
+}
+
+// 2020-09-13 12:26:40.25
+void test_sntp_timestamp()
+{
+  uint8_t packet[SNTP_PACKET_SIZE];
+  int64_t received;
+  int64_t transmitted;
+
+  sntpPacket(packet, "\xE3\x08\x8E\x80\x40\x00\x00\x00");
+
+  TEST_ASSERT_TRUE(EncompassClock::sntpReply(packet, sizeof(packet), nonce, received, transmitted));
+  TEST_ASSERT_EQUAL_INT64(base + 250000, received);
+  TEST_ASSERT_EQUAL_INT64(base + 250000, transmitted);
+}
+
+// The originate timestamp has to be the nonce the request carried
+void test_sntp_nonce_mismatch()
+{
+  uint8_t packet[SNTP_PACKET_SIZE];
+  int64_t received;
+  int64_t transmitted;
+
+  sntpPacket(packet, "\xE3\x08\x8E\x80\x40\x00\x00\x00");
+  packet[24] ^= 1;
+
+  TEST_ASSERT_FALSE(EncompassClock::sntpReply(packet, sizeof(packet), nonce, received, transmitted));
+}
+
+int main()
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_clock_slew);
+  RUN_TEST(test_clock_step);
+  RUN_TEST(test_clock_drift);
+  RUN_TEST(test_sntp_era1);
+  RUN_TEST(test_sntp_timestamp);
+  RUN_TEST(test_sntp_nonce_mismatch);
+
+  return UNITY_END();
+}
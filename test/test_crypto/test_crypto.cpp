@@ -0,0 +1,243 @@
+/*
+  test_crypto.cpp
+  Host (Linux) build
+
+  Known-answer tests for EncompassCrypto.h: SHA-256 against FIPS 180-4 (the examples NIST publishes for it),
+  HMAC-SHA256 against RFC 4231 and PBKDF2-HMAC-SHA1 against RFC 6070 and IEEE 802.11i. The provisioning MAC and
+  keystream are both HMAC-SHA256, a wrong digest would leave every device deaf to a correct sender; a wrong PSK would
+  only show up as connects that never succeed. Then a provisioning datagram (EncompassProvision.h) both ways.
+
+    pio test -e test
+
+  Built by A. K. N.       https://github.com/thewhiterabbit/Encompass
+
+  License to be determined in the future.
+*/
+
+#include "EncompassCrypto.h"
+#include "EncompassProvision.h"
+
+#include <stdio.h>
+#include <unity.h>
+
+static void toHex(const uint8_t *data, size_t len, char *hex)
+{
+  for (size_t i = 0; i < len; i++)
+    snprintf(&hex[2 * i], 3, "%02x", data[i]);
+}
+
+static void checkSHA256(const void *data, size_t len, const char *expected)
+{
+  uint8_t digest[SHA256_DIGEST_SIZE];
+  char    hex[2 * SHA256_DIGEST_SIZE + 1];
+
+  EncompassSHA256::hash(data, len, digest);
+  toHex(digest, sizeof(digest), hex);
+
+  TEST_ASSERT_EQUAL_STRING(expected, hex);
+}
+
+// Compares only as many digits as expected has, RFC 4231 test 5 keeps the first 128 bits
+static void checkHMAC(const void *key, size_t keyLen, const void *data, size_t len, const char *expected)
+{
+  uint8_t mac[SHA256_DIGEST_SIZE];
+  char    hex[2 * SHA256_DIGEST_SIZE + 1];
+
+  EncompassHMAC::mac(key, keyLen, data, len, mac);
+  toHex(mac, sizeof(mac), hex);
+  hex[strlen(expected)] = 0;
+
+  TEST_ASSERT_EQUAL_STRING(expected, hex);
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void test_sha256_fips180()
+{
+  checkSHA256("abc", 3, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+  checkSHA256("", 0, "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+  checkSHA256("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 56,
+              "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+  checkSHA256("abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrs"
+              "mnopqrstnopqrstu", 112, "cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1");
+}
+
+// One million 'a's, fed in uneven pieces so the block buffering is crossed at every offset
+void test_sha256_million()
+{
+  EncompassSHA256 sha;
+  uint8_t         chunk[997];
+  uint8_t         digest[SHA256_DIGEST_SIZE];
+  char            hex[2 * SHA256_DIGEST_SIZE + 1];
+  size_t          left = 1000000;
+
+  memset(chunk, 'a', sizeof(chunk));
+  sha.begin();
+
+  for (size_t n = 1; left; n = n % sizeof(chunk) + 1)
+  {
+    size_t take = (n < left) ? n : left;
+
+    sha.update(chunk, take);
+    left -= take;
+  }
+
+  sha.finish(digest);
+  toHex(digest, sizeof(digest), hex);
+
+  TEST_ASSERT_EQUAL_STRING("cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0", hex);
+}
+
+void test_hmac_rfc4231()
+{
+  uint8_t key[131];
+  uint8_t data[50];
+
+  memset(key, 0x0b, 20);
+  checkHMAC(key, 20, "Hi There", 8, "b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7");
+
+  checkHMAC("Jefe", 4, "what do ya want for nothing?", 28,
+            "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843");
+
+  memset(key, 0xaa, 20);
+  memset(data, 0xdd, 50);
+  checkHMAC(key, 20, data, 50, "773ea91e36800e46854db8ebd09181a72959098b3ef8c122d9635514ced565fe");
+
+  for (uint8_t i = 0; i < 25; i++)
+    key[i] = i + 1;
+
+  memset(data, 0xcd, 50);
+  checkHMAC(key, 25, data, 50, "82558a389a443c0ea4cc819899f2083a85f0faa3e578f8077a2e3ff46729665b");
+
+  memset(key, 0x0c, 20);
+  checkHMAC(key, 20, "Test With Truncation", 20, "a3b6167473100ee06e0c796c2955552b");
+
+  // Keys longer than a block are hashed first
+  memset(key, 0xaa, 131);
+  checkHMAC(key, 131, "Test Using Larger Than Block-Size Key - Hash Key First", 54,
+            "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54");
+  checkHMAC(key, 131, "This is a test using a larger than block-size key and a larger than block-size data. The key "
+            "needs to be hashed before being used by the HMAC algorithm.", 152,
+            "9b09ffa71b942fcb27635fbcd5b0e944bfdc63644f0713938a7f51535c3a35e2");
+}
+
+// RFC 6070 without the 16777216 iteration one, then IEEE 802.11i H.4
+void test_pbkdf2_rfc6070()
+{
+  struct Vector
+  {
+    const char  *pass;
+    size_t      passLen;
+    const char  *salt;
+    size_t      saltLen;
+    uint32_t    iterations;
+    size_t      keyLen;
+    const char  *key;
+  };
+
+  static const Vector vectors[] =
+  {
+    { "password", 8, "salt", 4, 1,    20, "0c60c80f961f0e71f3a9b524af6012062fe037a6" },
+    { "password", 8, "salt", 4, 2,    20, "ea6c014dc72d6f8ccd1ed92ace1d41f0d8de8957" },
+    { "password", 8, "salt", 4, 4096, 20, "4b007901b765489abead49d926f721d065a429c1" },
+    { "passwordPASSWORDpassword", 24, "saltSALTsaltSALTsaltSALTsaltSALTsalt", 36, 4096, 25,
+      "3d2eec4fe41c849b80c8d83662c0e44a8b291a964cf2f07038" },
+    { "pass\0word", 9, "sa\0lt", 5, 4096, 16, "56fa6aa75548099dcc37d7f03425e0c3" },
+    { "password", 8, "IEEE", 4, WPA_PSK_ITERATIONS, WPA_PSK_SIZE,
+      "f42c6fc52df0ebef9ebb4b90b38a5f902e83fe1b135a70e23aed762e9710a12e" }
+  };
+
+  for (size_t v = 0; v < sizeof(vectors) / sizeof(vectors[0]); v++)
+  {
+    uint8_t key[PBKDF2_MAX_KEY_SIZE];
+    char    hex[2 * PBKDF2_MAX_KEY_SIZE + 1];
+
+    TEST_ASSERT_TRUE(EncompassPBKDF2::derive(vectors[v].pass, vectors[v].passLen, vectors[v].salt, vectors[v].saltLen,
+                                             vectors[v].iterations, key, vectors[v].keyLen));
+    toHex(key, vectors[v].keyLen, hex);
+
+    TEST_ASSERT_EQUAL_STRING(vectors[v].key, hex);
+  }
+}
+
+// The "psk" task's way: a slice of iterations per call, the same key
+void test_pbkdf2_slices()
+{
+  EncompassPBKDF2 pbkdf2;
+  uint8_t         key[WPA_PSK_SIZE];
+  char            hex[2 * WPA_PSK_SIZE + 1];
+  uint32_t        calls = 1;
+
+  TEST_ASSERT_TRUE(pbkdf2.begin("password", 8, "IEEE", 4, WPA_PSK_ITERATIONS, WPA_PSK_SIZE));
+
+  while (!pbkdf2.run(64))
+    calls++;
+
+  pbkdf2.key(key);
+  toHex(key, sizeof(key), hex);
+
+  TEST_ASSERT_EQUAL_STRING("f42c6fc52df0ebef9ebb4b90b38a5f902e83fe1b135a70e23aed762e9710a12e", hex);
+  TEST_ASSERT_TRUE(calls > 100);
+}
+
+// Sealed, the password is not in the datagram; opened, it is back. A flipped bit or another key fails the MAC.
+void test_provision_seal_open()
+{
+  static const uint8_t nonce[PROVISION_NONCE_SIZE] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+  uint8_t         buf[PROVISION_MAX_PACKET];
+  uint8_t         copy[PROVISION_MAX_PACKET];
+  ProvisionKeys   keys;
+  ProvisionKeys   other;
+  ProvisionWriter writer(buf, sizeof(buf));
+
+  keys.derive("provisioning key", 16);
+  other.derive("provisioning kez", 16);
+
+  writer.header(PROVISION_REQUEST, nonce, NULL, 0x0102030405060708ULL);
+  writer.addString(PTAG_SSID, "Rack");
+  writer.addString(PTAG_PASS, "rackpassword");
+
+  size_t len = writer.seal(keys);
+
+  TEST_ASSERT_EQUAL(PROVISION_HEADER_SIZE + 2 + 4 + 2 + 12 + PROVISION_MAC_SIZE, len);
+  TEST_ASSERT_TRUE(memmem(buf, len, "rackpassword", 12) == NULL);
+
+  memcpy(copy, buf, len);
+  copy[PROVISION_HEADER_SIZE + 3] ^= 1;
+  TEST_ASSERT_TRUE(!ProvisionReader(copy, len).open(keys));
+
+  memcpy(copy, buf, len);
+  TEST_ASSERT_TRUE(!ProvisionReader(copy, len).open(other));
+
+  ProvisionReader reader(buf, len);
+  uint8_t         tag;
+  const uint8_t   *value;
+  uint8_t         vlen;
+
+  TEST_ASSERT_TRUE(reader.open(keys));
+  TEST_ASSERT_TRUE(reader.counter() == 0x0102030405060708ULL);
+  TEST_ASSERT_TRUE(reader.next(tag, value, vlen) && tag == PTAG_SSID && vlen == 4 && memcmp(value, "Rack", 4) == 0);
+  TEST_ASSERT_TRUE(reader.next(tag, value, vlen) && tag == PTAG_PASS && vlen == 12 &&
+                   memcmp(value, "rackpassword", 12) == 0);
+  TEST_ASSERT_TRUE(!reader.next(tag, value, vlen) && !reader.malformed());
+}
+
+int main()
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_sha256_fips180);
+  RUN_TEST(test_sha256_million);
+  RUN_TEST(test_hmac_rfc4231);
+  RUN_TEST(test_pbkdf2_rfc6070);
+  RUN_TEST(test_pbkdf2_slices);
+  RUN_TEST(test_provision_seal_open);
+
+  return UNITY_END();
+}